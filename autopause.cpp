@@ -0,0 +1,69 @@
+#include "autopause.h"
+#include <string.h>
+
+#define AVERAGE_MIN_DISTANCE_KM 0.001 // Legalább 1 m kell az átlaghoz
+
+void autopause_init(AutoPause_t *ap, const AutoPauseConfig_t *config,
+                    uint32_t movingSeconds, double distanceKm) {
+  memset(ap, 0, sizeof(*ap));
+  ap->config = *config;
+  ap->state = AUTOPAUSE_STOPPED;
+  ap->movingUs = (int64_t)movingSeconds * 1000000;
+  autopause_reset_average(ap, distanceKm);
+}
+
+bool autopause_pulse(AutoPause_t *ap, int64_t pulseUs, double speedKmh) {
+  int64_t dt = (ap->lastPulseUs != 0) ? pulseUs - ap->lastPulseUs : 0;
+  ap->lastPulseUs = pulseUs;
+  if (dt < 0) dt = 0;
+
+  if (ap->state == AUTOPAUSE_MOVING) {
+    if (speedKmh < ap->config.pauseSpeedKmh) {
+      // Ez az intervallum már túl lassú volt: nem számít mozgásnak
+      ap->state = AUTOPAUSE_STOPPED;
+      ap->pauses++;
+      return true;
+    }
+    ap->movingUs += dt;
+    return false;
+  }
+
+  if (speedKmh >= ap->config.resumeSpeedKmh) {
+    ap->state = AUTOPAUSE_MOVING;
+    ap->movingUs += dt;
+    return true;
+  }
+  return false;
+}
+
+bool autopause_update(AutoPause_t *ap, double speedKmh) {
+  if (ap->state == AUTOPAUSE_MOVING && speedKmh < ap->config.pauseSpeedKmh) {
+    // Az utolsó impulzusig már jóváírtuk az időt, utána nincs bizonyíték mozgásra
+    ap->state = AUTOPAUSE_STOPPED;
+    ap->pauses++;
+    return true;
+  }
+  return false;
+}
+
+uint32_t autopause_moving_seconds(const AutoPause_t *ap) {
+  return (uint32_t)(ap->movingUs / 1000000);
+}
+
+double autopause_average_kmh(const AutoPause_t *ap, double distanceKm) {
+  int64_t movingUs = ap->movingUs - ap->avgStartMovingUs;
+  double distance = distanceKm - ap->avgStartDistanceKm;
+  if (movingUs <= 0 || distance < AVERAGE_MIN_DISTANCE_KM) return 0.0;
+  return distance / (movingUs / 3600e6);
+}
+
+void autopause_reset_moving(AutoPause_t *ap) {
+  // Az átlag ablaka megmarad: a kezdőpontot ugyanennyivel toljuk el
+  ap->avgStartMovingUs -= ap->movingUs;
+  ap->movingUs = 0;
+}
+
+void autopause_reset_average(AutoPause_t *ap, double distanceKm) {
+  ap->avgStartMovingUs = ap->movingUs;
+  ap->avgStartDistanceKm = distanceKm;
+}
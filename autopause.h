@@ -0,0 +1,48 @@
+// autopause.h
+// Automatikus szünet állapotgép: a mozgási idő és az átlagsebesség egyetlen
+// forrása. Az impulzusok időbélyegei hajtják; a megállás/indulás
+// hiszterézissel történik (külön indulási és megállási küszöb), így a lassú,
+// határ körüli haladás nem billegteti az állapotot. Hardverfüggetlen.
+#ifndef AUTOPAUSE_H
+#define AUTOPAUSE_H
+
+#include <stdint.h>
+
+typedef enum {
+  AUTOPAUSE_STOPPED,
+  AUTOPAUSE_MOVING
+} AutoPauseState_t;
+
+typedef struct {
+  double resumeSpeedKmh;  // Álló helyzetből e sebesség felett indul a mozgás
+  double pauseSpeedKmh;   // Mozgás közben e sebesség alatt szünet (< resume)
+} AutoPauseConfig_t;
+
+typedef struct {
+  AutoPauseConfig_t config;
+  AutoPauseState_t state;
+  int64_t lastPulseUs;        // 0 = még nem volt impulzus
+  int64_t movingUs;           // Összes mozgási idő
+  int64_t avgStartMovingUs;   // Átlagsebesség kezdete: mozgási idő...
+  double avgStartDistanceKm;  // ...és össztáv
+  uint32_t pauses;            // Szünetek száma az indulás óta
+} AutoPause_t;
+
+void autopause_init(AutoPause_t *ap, const AutoPauseConfig_t *config,
+                    uint32_t movingSeconds, double distanceKm);
+
+// Új impulzus a becsült sebességgel. Mozgás közben az előző impulzus óta
+// eltelt idő mozgási idő; induláskor az indulást jelző intervallum is az.
+// true, ha állapot változott.
+bool autopause_pulse(AutoPause_t *ap, int64_t pulseUs, double speedKmh);
+
+// Impulzus nélküli frissítés (lecsengő sebesség); true, ha szünet kezdődött
+bool autopause_update(AutoPause_t *ap, double speedKmh);
+
+uint32_t autopause_moving_seconds(const AutoPause_t *ap);
+double autopause_average_kmh(const AutoPause_t *ap, double distanceKm);
+
+void autopause_reset_moving(AutoPause_t *ap);
+void autopause_reset_average(AutoPause_t *ap, double distanceKm);
+
+#endif
@@ -0,0 +1,275 @@
+#include "binlog.h"
+#include <atomic>
+#include <stdio.h>
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "taskplacement.h"
+
+extern const char *TAG;
+
+#define RING_MASK (BINLOG_SLOTS - 1)
+static_assert((BINLOG_SLOTS & RING_MASK) == 0, "BINLOG_SLOTS must be a power of two");
+
+typedef struct {
+  uint8_t level;
+  uint8_t count;      // Argumentum szavak
+  bool overflow;      // Több argumentum volt, mint BINLOG_MAX_WORDS
+  const char *tag;
+  const char *fmt;    // Formátum azonosító: a literál címe
+  int64_t timeUs;
+  uint32_t words[BINLOG_MAX_WORDS];
+} BinLogEntry_t;
+
+// Korlátos MPMC gyűrű (Vyukov): a helyek sorszáma jelzi, hogy írható vagy olvasható
+typedef struct {
+  std::atomic<uint32_t> seq;
+  BinLogEntry_t entry;
+} BinLogSlot_t;
+
+static BinLogSlot_t ring[BINLOG_SLOTS];
+static std::atomic<uint32_t> enqueuePos(0);
+static std::atomic<uint32_t> dequeuePos(0);
+static std::atomic<bool> ready(false);
+static std::atomic<uint32_t> writtenCount(0), droppedCount(0), maxFill(0), writeCycles(0);
+
+// --- Formázás (ürítő task vagy flush) ---
+
+static uint32_t take_word(const BinLogEntry_t *e, uint8_t *next, bool *missing) {
+  if (*next >= e->count) {
+    *missing = true;
+    return 0;
+  }
+  return e->words[(*next)++];
+}
+
+static uint64_t take_u64(const BinLogEntry_t *e, uint8_t *next, bool *missing) {
+  uint64_t lo = take_word(e, next, missing);
+  uint64_t hi = take_word(e, next, missing);
+  return lo | (hi << 32);
+}
+
+static const void *take_ptr(const BinLogEntry_t *e, uint8_t *next, bool *missing) {
+  if (sizeof(void *) > sizeof(uint32_t)) return (const void *)(uintptr_t)take_u64(e, next, missing);
+  return (const void *)(uintptr_t)take_word(e, next, missing);
+}
+
+// printf formátum a tárolt szavakból; a hosszmódosítót a tárolt szélesség adja
+static void render(const BinLogEntry_t *e, char *out, size_t size) {
+  size_t n = 0;
+  uint8_t next = 0;
+  bool missing = false;
+  const char *p = e->fmt;
+  while (*p && n + 1 < size) {
+    if (*p != '%') {
+      out[n++] = *p++;
+      continue;
+    }
+    // Specifikáció: jelzők, szélesség, pontosság, hossz, konverzió
+    char spec[24];
+    size_t s = 0;
+    spec[s++] = *p++;
+    while (*p && strchr("-+ #0", *p) && s < 8) spec[s++] = *p++;
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*p != '.') break;
+        spec[s++] = *p++;
+      }
+      if (*p == '*') {
+        s += snprintf(spec + s, sizeof(spec) - s - 4, "%d", (int)take_word(e, &next, &missing));
+        p++;
+      }
+      while (*p >= '0' && *p <= '9' && s < 12) spec[s++] = *p++;
+    }
+    uint8_t longs = 0;
+    while (*p && strchr("hlLqjzt", *p)) {
+      if (*p == 'l' || *p == 'q' || *p == 'j') longs++;
+      p++;
+    }
+    char conv = *p ? *p++ : '\0';
+    bool wide = longs >= 2 || (longs == 1 && sizeof(long) == 8);
+    int w = 0;
+    size_t room = size - n;
+
+    switch (conv) {
+      case '%':
+        out[n++] = '%';
+        continue;
+      case 'd':
+      case 'i':
+        memcpy(spec + s, "lld", 4);
+        w = snprintf(out + n, room, spec,
+                     wide ? (long long)take_u64(e, &next, &missing) : (long long)(int32_t)take_word(e, &next, &missing));
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+        spec[s++] = 'l';
+        spec[s++] = 'l';
+        spec[s++] = conv;
+        spec[s] = '\0';
+        w = snprintf(out + n, room, spec,
+                     wide ? (unsigned long long)take_u64(e, &next, &missing)
+                          : (unsigned long long)take_word(e, &next, &missing));
+        break;
+      case 'c':
+        memcpy(spec + s, "c", 2);
+        w = snprintf(out + n, room, spec, (int)take_word(e, &next, &missing));
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A': {
+        uint64_t bits = take_u64(e, &next, &missing);
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        spec[s++] = conv;
+        spec[s] = '\0';
+        w = snprintf(out + n, room, spec, v);
+        break;
+      }
+      case 's': {
+        // Csak literál: a mutató a flash-be mutat, a hívás után is érvényes
+        const char *str = (const char *)take_ptr(e, &next, &missing);
+        memcpy(spec + s, "s", 2);
+        w = snprintf(out + n, room, spec, str ? str : "(null)");
+        break;
+      }
+      case 'p':
+        w = snprintf(out + n, room, "%p", take_ptr(e, &next, &missing));
+        break;
+      default:
+        w = 0; // Ismeretlen konverzió: kimarad
+        break;
+    }
+    if (w > 0) n += (size_t)w < room ? (size_t)w : room - 1;
+  }
+  out[n] = '\0';
+  if ((missing || e->overflow) && n + 12 < size) strcpy(out + n, " <args?>");
+}
+
+static void print_entry(const BinLogEntry_t *e) {
+  static const char letters[] = "NEWIDV";
+  char text[192];
+  render(e, text, sizeof(text));
+  char letter = e->level < sizeof(letters) - 1 ? letters[e->level] : '?';
+  esp_log_write((esp_log_level_t)e->level, e->tag, "%c (%lu) %s: %s\n", letter,
+                (unsigned long)(e->timeUs / 1000), e->tag, text);
+}
+
+// --- Gyűrű ---
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *fmt, const BinLogArgs_t *args) {
+  uint32_t start = esp_cpu_get_ccount();
+  BinLogEntry_t *e;
+  BinLogEntry_t direct;
+  uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+  BinLogSlot_t *slot = NULL;
+
+  if (!ready.load(std::memory_order_acquire)) {
+    e = &direct; // Indulás előtt közvetlen kiírás
+  } else {
+    while (true) {
+      slot = &ring[pos & RING_MASK];
+      uint32_t seq = slot->seq.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed); // Tele: az író nem várhat
+        return;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    e = &slot->entry;
+  }
+
+  e->level = (uint8_t)level;
+  e->count = args->count;
+  e->overflow = args->overflow;
+  e->tag = tag;
+  e->fmt = fmt;
+  e->timeUs = esp_timer_get_time();
+  memcpy(e->words, args->words, args->count * sizeof(uint32_t));
+
+  if (slot == NULL) {
+    print_entry(e);
+    return;
+  }
+  slot->seq.store(pos + 1, std::memory_order_release);
+
+  writtenCount.fetch_add(1, std::memory_order_relaxed);
+  uint32_t fill = pos + 1 - dequeuePos.load(std::memory_order_relaxed);
+  uint32_t seen = maxFill.load(std::memory_order_relaxed);
+  while (fill > seen && !maxFill.compare_exchange_weak(seen, fill, std::memory_order_relaxed)) {
+  }
+  writeCycles.fetch_add(esp_cpu_get_ccount() - start, std::memory_order_relaxed);
+}
+
+static bool ring_pop(BinLogEntry_t *out) {
+  uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+  BinLogSlot_t *slot;
+  while (true) {
+    slot = &ring[pos & RING_MASK];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - (pos + 1));
+    if (diff == 0) {
+      if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      return false; // Üres (vagy az író még tölti a helyet)
+    } else {
+      pos = dequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+  *out = slot->entry;
+  slot->seq.store(pos + BINLOG_SLOTS, std::memory_order_release);
+  return true;
+}
+
+void binlog_flush(void) {
+  BinLogEntry_t e;
+  while (ring_pop(&e)) print_entry(&e);
+}
+
+BinLogStats_t binlog_stats(void) {
+  BinLogStats_t s;
+  s.written = writtenCount.load(std::memory_order_relaxed);
+  s.dropped = droppedCount.load(std::memory_order_relaxed);
+  s.maxFill = maxFill.load(std::memory_order_relaxed);
+  s.cycles = writeCycles.load(std::memory_order_relaxed);
+  return s;
+}
+
+static void binlog_task(void *pvParameters) {
+  uint32_t reportedDrops = 0;
+  while (true) {
+    binlog_flush();
+    uint32_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops) {
+      ESP_LOGW(TAG, "Binlog: %lu entries dropped (ring of %d full).",
+               (unsigned long)(dropped - reportedDrops), BINLOG_SLOTS);
+      reportedDrops = dropped;
+    }
+    vTaskDelay(pdMS_TO_TICKS(BINLOG_DRAIN_MS));
+  }
+}
+
+void binlog_init(void) {
+#if BINLOG_ENABLE
+  for (uint32_t i = 0; i < BINLOG_SLOTS; i++) ring[i].seq.store(i, std::memory_order_relaxed);
+  if (task_start(TASK_BINLOG, binlog_task, NULL) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create binlog task, logging stays synchronous!");
+    return;
+  }
+  ready.store(true, std::memory_order_release);
+  ESP_LOGI(TAG, "Binlog: %d slots x %u bytes, drained every %d ms.", BINLOG_SLOTS,
+           (unsigned)sizeof(BinLogSlot_t), BINLOG_DRAIN_MS);
+#endif
+}
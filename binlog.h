@@ -0,0 +1,115 @@
+// binlog.h
+// Halasztott bináris napló a forró ágakra (számoló task, GUI, timer
+// callbackek). A hívó csak a formátum címét (a literál a flash-ben marad,
+// ez az azonosító), a szintet, az időbélyeget és a nyers argumentumokat
+// teszi egy zármentes, több író / több olvasó RAM gyűrűbe; a formázást és a
+// UART kiírást egy alacsony prioritású ürítő task végzi, az eredeti
+// időbélyeggel. Megtelt gyűrűnél a bejegyzés eldobódik (számolva), az író
+// sosem vár. ISR-ből is hívható.
+// Argumentumok: egész (max. 64 bit), lebegőpontos (double-ként) és %s csak
+// string literálra (a mutató kerül tárolásra). BINLOG_ENABLE 0 esetén a
+// makrók közvetlenül ESP_LOGx hívások (összehasonlításhoz).
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "esp_log.h"
+
+#define BINLOG_MAX_WORDS 8 // Argumentum szavak bejegyzésenként (egy double: 2)
+
+// Gyűrű és ürítő task indítása
+void binlog_init(void);
+
+// Minden függő bejegyzés kiírása a hívó taskban (mélyalvás előtt)
+void binlog_flush(void);
+
+typedef struct {
+  uint32_t written;   // Gyűrűbe került bejegyzések
+  uint32_t dropped;   // Megtelt gyűrű miatt eldobva
+  uint32_t maxFill;   // Legnagyobb egyidejű telítettség
+  uint32_t cycles;    // Írók összes CPU ciklusa (átlaghoz: / written)
+} BinLogStats_t;
+
+BinLogStats_t binlog_stats(void);
+
+// --- Belső: argumentumok szavakba csomagolása ---
+typedef struct {
+  uint32_t words[BINLOG_MAX_WORDS];
+  uint8_t count;
+  bool overflow;
+} BinLogArgs_t;
+
+static inline void binlog_put_word(BinLogArgs_t *a, uint32_t w) {
+  if (a->count < BINLOG_MAX_WORDS) a->words[a->count++] = w;
+  else a->overflow = true;
+}
+static inline void binlog_put_u64(BinLogArgs_t *a, uint64_t v) {
+  binlog_put_word(a, (uint32_t)v);
+  binlog_put_word(a, (uint32_t)(v >> 32));
+}
+static inline void binlog_put(BinLogArgs_t *a, int v) { binlog_put_word(a, (uint32_t)v); }
+static inline void binlog_put(BinLogArgs_t *a, unsigned v) { binlog_put_word(a, v); }
+static inline void binlog_put(BinLogArgs_t *a, long v) {
+  if (sizeof(v) > sizeof(uint32_t)) binlog_put_u64(a, (uint64_t)v); // Hoszton
+  else binlog_put_word(a, (uint32_t)v);
+}
+static inline void binlog_put(BinLogArgs_t *a, unsigned long v) {
+  if (sizeof(v) > sizeof(uint32_t)) binlog_put_u64(a, v);
+  else binlog_put_word(a, (uint32_t)v);
+}
+static inline void binlog_put(BinLogArgs_t *a, long long v) { binlog_put_u64(a, (uint64_t)v); }
+static inline void binlog_put(BinLogArgs_t *a, unsigned long long v) { binlog_put_u64(a, v); }
+static inline void binlog_put(BinLogArgs_t *a, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  binlog_put_u64(a, bits);
+}
+static inline void binlog_put(BinLogArgs_t *a, const void *p) {
+  if (sizeof(p) > sizeof(uint32_t)) binlog_put_u64(a, (uint64_t)(uintptr_t)p); // Hoszton
+  else binlog_put_word(a, (uint32_t)(uintptr_t)p);
+}
+
+static inline void binlog_pack(BinLogArgs_t *a) {}
+template <typename T, typename... Rest>
+static inline void binlog_pack(BinLogArgs_t *a, T value, Rest... rest) {
+  binlog_put(a, value);
+  binlog_pack(a, rest...);
+}
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *fmt, const BinLogArgs_t *args);
+
+// Csak a fordítási idejű printf formátum ellenőrzéshez, sosem hívódik
+static inline void binlog_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void binlog_check_format(const char *fmt, ...) {}
+
+template <typename... Args>
+static inline void binlog_record(esp_log_level_t level, const char *tag, const char *fmt, Args... args) {
+  BinLogArgs_t a;
+  a.count = 0;
+  a.overflow = false;
+  binlog_pack(&a, args...);
+  binlog_write(level, tag, fmt, &a);
+}
+
+#if BINLOG_ENABLE
+#define BINLOG_AT(level, tag, fmt, ...)                                                  \
+  do {                                                                                   \
+    if (LOG_LOCAL_LEVEL >= level) {                                                      \
+      if (0) binlog_check_format(fmt, ##__VA_ARGS__);                                    \
+      binlog_record(level, tag, fmt, ##__VA_ARGS__);                                     \
+    }                                                                                    \
+  } while (0)
+#define BLOG_E(tag, fmt, ...) BINLOG_AT(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define BLOG_W(tag, fmt, ...) BINLOG_AT(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define BLOG_I(tag, fmt, ...) BINLOG_AT(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define BLOG_D(tag, fmt, ...) BINLOG_AT(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define BLOG_E ESP_LOGE
+#define BLOG_W ESP_LOGW
+#define BLOG_I ESP_LOGI
+#define BLOG_D ESP_LOGD
+#endif
+
+#endif
@@ -20,13 +20,132 @@
 #define WHEEL_DIAMETER_M    0.348        // Kerék átmérője méterben (!! FONTOS: Állítsd be a valós értéket !!)
 #define PULSES_PER_REVOLUTION 1         // Impulzusok száma egy teljes kerékfordulat alatt
 
+// --- Impulzus időbélyegzés ---
+#define PULSE_CAPTURE_GPIO_ISR 0 // esp_timer_get_time() a GPIO ISR-ben
+#define PULSE_CAPTURE_MCPWM    1 // MCPWM capture egység hardveres időbélyege
+#define PULSE_CAPTURE_MODE PULSE_CAPTURE_GPIO_ISR // Melyik út táplálja a feldolgozást
+#define PULSE_CAPTURE_DIAG 0            // 1 = mindkét út aktív, jitter összevetés a soros porton
+#define PULSE_CAPTURE_DIAG_REPORT_S 10  // Diagnosztikai riport gyakorisága
+
+// --- Pergésmentesítés (a várható periódushoz igazodó tiltási ablak) ---
+#define DEBOUNCE_MIN_US         1000     // Ablak alsó korlátja (max. 1 kHz bemenet)
+#define DEBOUNCE_MAX_US         20000    // Ablak felső korlátja (lassú, pergő zárás)
+#define DEBOUNCE_FRACTION_PCT   50       // Az ablak a várható periódus ennyi %-a
+#define DEBOUNCE_STOP_PERIOD_US 3000000  // Ennél hosszabb szünet után nincs predikció
+
+// --- Sebességbecslés (több mágnes, fáziskompenzáció) ---
+#define SPEED_EST_LEARN_ALPHA 0.0625    // Mágnesívek tanulási sebessége fordulatonként
+#define SPEED_EST_STEADY_PCT  5         // Tanulás csak ennél kisebb periódusváltozásnál
+#define SPEED_EST_COMBINE_PCT 10        // Kombinált intervallumok megengedett sebességeltérése
+#define SPEED_EST_STOP_US     3000000   // Ennél hosszabb szünet után új becslés indul
+#define SPEED_EST_SLIP_PCT    4         // Fáziscsúszás: a szomszéd mágnes íve ennyivel jobban illik
+#define SPEED_DECAY_TICK_MS   100       // Impulzus nélkül ilyen ütemben csökken a kijelzett sebesség
+#define SPEED_ZERO_KMH        1.0       // A lecsengő sebesség ez alatt 0 km/h
+#define SPEED_TIMEOUT_MS      5000      // Legkésőbb ennyi impulzusmentes idő után 0 km/h
+
+// --- Impulzusfolyam ellenőrzés (kimaradt és fantom impulzusok) ---
+#define PULSE_VALID_MAX_ACCEL_MPS2 6.0  // Ennél nagyobb |gyorsulás| nem valós mozgás (erős fékezés ~5)
+#define PULSE_VALID_MATCH_PCT      20   // Kimaradás mintázat: eltérés a jósolt ívösszegtől
+#define PULSE_VALID_PHANTOM_PCT    50   // Ennél rövidebb intervallum (a jóslathoz képest) fantom lehet
+#define PULSE_VALID_MAX_MISSED     3    // Egymás utáni kimaradások pótlásának felső korlátja
+
+// --- Származtatott metrikák (gyorsulás, becsült teljesítmény) ---
+#define RIDER_MASS_KG     85.0   // Kerékpáros + kerékpár tömege
+#define ROLLING_CRR       0.005  // Gördülési ellenállás (aszfalt, országúti gumi)
+#define DRAG_CDA_M2       0.50   // Légellenállás * homlokfelület (egyenes testtartás)
+#define AIR_DENSITY_KGM3  1.225  // Levegő sűrűsége tengerszinten, 15 °C
+#define DERIVED_WINDOW_MS 2000   // A gyorsulás regressziós ablaka
+#define DERIVED_MAX_RATE_HZ 100 // Eddig a mintasűrűségig fér el a teljes ablak (8 mágnes, 60+ km/h)
+
+// --- Automatikus szünet (mozgási idő, átlagsebesség) ---
+#define AUTOPAUSE_RESUME_KMH 3.0  // Álló helyzetből e fölött indul a mozgási idő
+#define AUTOPAUSE_PAUSE_KMH  1.5  // Mozgás közben e alatt szünet (hiszterézis)
+
+// --- Menettörténet (ridehist partíció) ---
+#define RIDE_HISTORY_END_IDLE_S 120  // Ennyi álló idő után a menet lezárul és mentődik
+#define RIDE_HISTORY_MIN_KM     0.1  // Ennél rövidebb menetet nem tárolunk
+
+// --- Menetnapló írás (saját task; a számoló task csak sorba állít) ---
+#define RIDE_LOG_QUEUE_LEN      128  // Írásra váró impulzusok (szektortörlés alatt is)
+#define RIDE_LOG_END_TIMEOUT_MS 500  // A lezárás legfeljebb ennyit vár az író taskra
+
+// --- Menetnapló letöltés (HTTP a soft-AP ablak alatt) ---
+#define LOG_SERVER_PORT          80
+#define LOG_SERVER_CHUNK_BYTES   1460 // Egy TCP szegmensnyi darab a flash-ből
+#define LOG_SERVER_TASK_PRIORITY 1    // Az impulzusfeldolgozás alatt fut
+
+// --- Taskok elhelyezése (a WiFi/lwIP a 0. magon fut) ---
+#define TASK_AFFINITY_ANY        0 // Nincs rögzítés, az ütemező választ
+#define TASK_AFFINITY_SPLIT      1 // Impulzusfeldolgozás az 1. magon, kijelző és flash a rádió mellett
+#define TASK_AFFINITY_RADIO_CORE 2 // Minden a rádió magján (összehasonlításhoz, legrosszabb eset)
+#define TASK_AFFINITY_MODE TASK_AFFINITY_SPLIT
+#define TASK_RADIO_CORE      0   // PRO_CPU: WiFi, esp_timer
+#define TASK_PULSE_CORE      1   // APP_CPU: számoló task, gombok
+#define TASK_JITTER_REPORT_S 60  // Impulzus-feldolgozási jitter riport (0 = kikapcsolva)
+#define PIPELINE_REPORT_S    30  // Feldolgozási számlálók a soros porton (0 = kikapcsolva)
+#define PULSE_QUEUE_LEN      64  // Feldolgozásra váró él időbélyegek (ISR -> számoló task)
+
+// --- Halasztott bináris napló (forró ágak: számoló task, GUI, timer callbackek) ---
+#define BINLOG_ENABLE   1   // 0 = a BLOG_x makrók közvetlen ESP_LOGx hívások
+#define BINLOG_SLOTS    64  // Bejegyzések a gyűrűben (2 hatványa, ~64 bájt/bejegyzés)
+#define BINLOG_DRAIN_MS 50  // Az ürítő task ennyi időnként formáz és ír a UART-ra
+
+// --- Ütemező (időzített és gomb munkák egy közös taskban) ---
+#define SCHED_TICK_MS     10  // Az időzítő kerék felbontása
+#define SCHED_WHEEL_SLOTS 64  // Kerék rések (2 hatványa)
+#define SCHED_MAX_JOBS    8   // Felvehető munkák
+#define SCHED_QUEUE_LEN   16  // Eseménysor mélysége (gombélek, újraélesítések)
+
+// Kerékprofilok: az első alapértelmezésként a fenti értékeket használja.
+// Első induláskor NVS-be kerülnek, az aktív profil futás közben váltható
+// (hosszú nyomás a sebesség képernyőn).
+#define WHEEL_PROFILE_COUNT 3
+#define WHEEL_PROFILE_DEFAULTS { \
+  { "default", WHEEL_DIAMETER_M, PULSES_PER_REVOLUTION }, \
+  { "26in",    0.660,            1 }, \
+  { "700c",    0.680,            1 }, \
+}
+
 #define REPORTING_INTERVAL_MS 1000      // Adatküldés, számítás gyakorisága (1 mp)
 #define CALC_UPDATE_INTERVAL_MS 1000 // Adatok frissítési gyakorisága (1 mp)
-#define INACTIVITY_TIMEOUT_S  (5 * 60) // Inaktivitási időkorlát másodpercben (5 perc)
+#define INACTIVITY_TIMEOUT_S  (5 * 60) // Tétlenség után mélyalvás (a lépcső utolsó foka, 5 perc)
 #define INACTIVITY_TIMEOUT_US (INACTIVITY_TIMEOUT_S * 1000000ULL)
 #define NVS_SAVE_INTERVAL_MS (15 * 60 * 1000) // NVS mentési intervallum (15 perc)
 #define RESET_BUTTON_HOLD_TIME_MS 1000    // Napi számláló nullázásához nyomva tartás ideje
-#define RESET_BUTTON_POLL_INTERVAL_MS 50  // Napi nullázó gomb figyelési gyakorisága
+#define BUTTON_SETTLE_MS 30               // Gombél után ennyi nyugalom kell az állapot elfogadásához
+#define INACTIVITY_CHECK_MS 30000         // Tétlenségi lépcső ellenőrzés gyakorisága
+
+// --- Kijelző sprite ---
+#define SPRITE_COLOR_DEPTH 4   // 16: 65 KB, 8: 32 KB (RGB332), 4: 16 KB (16 színű paletta)
+#define GUI_PERF_REPORT_S  60  // Képkocka idő és heap riport (0 = kikapcsolva)
+
+// --- Kijelző energiagazdálkodás ---
+#define DISPLAY_BL_PIN          GPIO_NUM_4  // TTGO T-Display háttérvilágítás (TFT_BL)
+#define DISPLAY_BL_PWM_CHANNEL  0           // LEDC csatorna a háttérvilágításhoz
+#define DISPLAY_BL_PWM_FREQ_HZ  5000
+#define DISPLAY_BL_PWM_BITS     8
+#define DISPLAY_BL_FULL_DUTY    255         // Teljes fényerő
+#define DISPLAY_BL_DIM_DUTY     40          // Halványított fényerő
+#define DISPLAY_DIM_TIMEOUT_S   30          // Tétlenség után halványítás
+#define DISPLAY_OFF_TIMEOUT_S   60          // Tétlenség után háttérvilágítás ki
+#define DISPLAY_SLEEP_TIMEOUT_S 120         // Tétlenség után a panel (ST7789) alvó módba
+
+// --- Tétlenségi lépcső (halványítás és kijelző: fent, mélyalvás: INACTIVITY_TIMEOUT_S) ---
+#define IDLE_LIGHT_SLEEP_S      180         // Tétlenség után light sleep (REED/gomb ébreszt, nincs újraindulás)
+#define IDLE_RECORD_MIN_S       15          // Ennél rövidebb szünet nem kerül a tétlenségi eloszlásba
+
+// --- Energia becslés (állapotonkénti áramfelvétel, a mért értékekre hangolandó) ---
+#define ENERGY_BATTERY_MAH       1000   // Akkumulátor kapacitás (hidegindításkor teljesnek tekintve)
+#define ENERGY_CPU_BASE_MA       12.0   // CPU, frekvenciától független rész
+#define ENERGY_CPU_MA_PER_MHZ    0.16   // Frekvenciával arányos rész (240 MHz: ~50 mA összesen)
+#define ENERGY_WIFI_AP_MA        110.0  // Soft-AP bekapcsolva (beacon, vétel)
+#define ENERGY_BACKLIGHT_MA      22.0   // Háttérvilágítás teljes fényerőn (a PWM kitöltéssel arányos)
+#define ENERGY_PANEL_MA          3.0    // ST7789 panel aktív
+#define ENERGY_PANEL_SLEEP_MA    0.1    // ST7789 panel alvó módban
+#define ENERGY_PULSE_ISR_UC      2.0    // Egy impulzus él ébresztése és feldolgozása (mikrocoulomb)
+#define ENERGY_BOARD_MA          4.0    // Feszültségszabályzó, USB-UART, felhúzó ellenállások
+#define ENERGY_DEEP_SLEEP_MA     0.15   // Mélyalvásban a teljes panel
+#define ENERGY_LIGHT_SLEEP_MA    0.8    // CPU light sleep-ben (RTC és GPIO ébresztés él)
 
 // Kijelző váltási intervallum (már nem használt, de a kompatibilitás miatt megtartva)
 #define KEP_VALTAS 3500  // 3 másodperc milliszekundumban
@@ -36,6 +155,19 @@
 #define SIMULATE_REED_INPUT 1        // 1 = Szimuláció aktív, 0 = Szimuláció inaktív
 #define SIMULATED_SPEED_KMH 8.8     // Szimulált sebesség km/h-ban
 #define SIMULATION_DURATION_MINUTES 3 // Szimuláció időtartama percben (csak szimulációhoz)
+#define PULSESIM_PROFILE_CONSTANT  0 // SIMULATED_SPEED_KMH, SIMULATION_DURATION_MINUTES ideig
+#define PULSESIM_PROFILE_INTERVALS 1 // Bemelegítés, intervallumok, megállás
+#define PULSESIM_PROFILE_SWEEP     2 // Rámpa PULSESIM_SWEEP_MAX_HZ-ig: a feldolgozás határa
+#define PULSESIM_PROFILE_REPLAY    3 // A legutóbbi menetnapló visszajátszása
+#define PULSESIM_PROFILE PULSESIM_PROFILE_CONSTANT
+#define PULSESIM_BOUNCE_PERMILLE 0     // Pergő zárások aránya ezrelékben
+#define PULSESIM_BOUNCE_EDGES    3     // Pergő élek zárásonként
+#define PULSESIM_BOUNCE_SPAN_US  800   // A pergés időtartama
+#define PULSESIM_MISS_PERMILLE   0     // Kimaradó impulzusok aránya ezrelékben
+#define PULSESIM_SWEEP_MAX_HZ    5000  // A rámpa végén az impulzusráta
+#define PULSESIM_SWEEP_S         120   // A rámpa hossza
+#define PULSESIM_BACKLOG_LIMIT   8     // Ennyi feldolgozatlan impulzus felett a lánc telített
+#define PULSESIM_SEED            12345 // Ismételhető pergés/kimaradás sorozat
 
 #define SET_INITIAL_ODOMETER 0 // 1 = Kilométeróra beállítása, 0 = Nincs beállítás
 
@@ -0,0 +1,52 @@
+#include "debounce.h"
+#include <string.h>
+
+#define PREDICTION_SHIFT 2 // Mozgóátlag súlya: 1/4
+
+static uint32_t IRAM_ATTR lockout_for(const DebounceConfig_t *config, uint32_t predictedUs) {
+  if (predictedUs == 0) return config->maxLockoutUs;
+  uint32_t window = (uint32_t)(((uint64_t)predictedUs * config->fractionPct) / 100);
+  if (window < config->minLockoutUs) return config->minLockoutUs;
+  if (window > config->maxLockoutUs) return config->maxLockoutUs;
+  return window;
+}
+
+void debounce_init(DebounceState_t *state, const DebounceConfig_t *config) {
+  memset(state, 0, sizeof(*state));
+  state->lockoutUs = lockout_for(config, 0);
+}
+
+bool IRAM_ATTR debounce_edge(DebounceState_t *state, const DebounceConfig_t *config, int64_t edgeUs) {
+  if (state->lastAcceptedUs != 0) {
+    int64_t dt = edgeUs - state->lastAcceptedUs;
+
+    if (dt < (int64_t)state->lockoutUs) {
+      if (dt < (int64_t)config->minLockoutUs) {
+        state->rejected[DEBOUNCE_REJECT_CHATTER]++;
+      } else if (state->predictedPeriodUs == 0) {
+        state->rejected[DEBOUNCE_REJECT_COLD]++;
+      } else {
+        state->rejected[DEBOUNCE_REJECT_EARLY]++;
+      }
+      return false;
+    }
+
+    if (dt < (int64_t)config->stopPeriodUs) {
+      uint32_t period = (uint32_t)dt;
+      if (state->predictedPeriodUs == 0) {
+        state->predictedPeriodUs = period;
+      } else {
+        int32_t diff = (int32_t)(period - state->predictedPeriodUs);
+        state->predictedPeriodUs += diff >> PREDICTION_SHIFT;
+      }
+    } else {
+      // Megállás után nincs érvényes predikció
+      state->predictedPeriodUs = 0;
+    }
+  }
+
+  state->lastAcceptedUs = edgeUs;
+  state->lockoutUs = lockout_for(config, state->predictedPeriodUs);
+  state->accepted++;
+  return true;
+}
@@ -0,0 +1,46 @@
+// debounce.h
+// Sebességfüggő pergésmentesítés a REED impulzusokhoz. A tiltási ablak a
+// várható következő periódus egy hányada, [min, max] határok között, így
+// nagy sebességnél (több mágnes, kis kerék) rövid, lassú, pergő záráskor
+// hosszú. Csak egész aritmetika: ISR-ből hívható, hardverfüggetlen.
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Eldobott élek kategóriái
+typedef enum {
+  DEBOUNCE_REJECT_CHATTER, // A minimális ablakon belül: érintkező pergés
+  DEBOUNCE_REJECT_EARLY,   // A várható periódushoz képest túl korai él
+  DEBOUNCE_REJECT_COLD,    // Álló helyzetből indulva (nincs predikció) a max. ablakon belül
+  DEBOUNCE_REJECT_COUNT
+} DebounceReject_t;
+
+typedef struct {
+  uint32_t minLockoutUs;  // Ablak alsó korlátja
+  uint32_t maxLockoutUs;  // Ablak felső korlátja, predikció nélkül is ez él
+  uint32_t fractionPct;   // Az ablak a várható periódus ennyi százaléka
+  uint32_t stopPeriodUs;  // Ennél hosszabb intervallum után a predikció törlődik
+} DebounceConfig_t;
+
+typedef struct {
+  int64_t lastAcceptedUs;     // 0 = még nem volt elfogadott él
+  uint32_t predictedPeriodUs; // Elfogadott intervallumok mozgóátlaga, 0 = ismeretlen
+  uint32_t lockoutUs;         // Az aktuális tiltási ablak
+  uint32_t accepted;
+  uint32_t rejected[DEBOUNCE_REJECT_COUNT];
+} DebounceState_t;
+
+void debounce_init(DebounceState_t *state, const DebounceConfig_t *config);
+
+// true, ha az él érvényes impulzus; false esetén a kategória számlálója nő
+bool debounce_edge(DebounceState_t *state, const DebounceConfig_t *config, int64_t edgeUs);
+
+#endif
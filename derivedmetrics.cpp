@@ -0,0 +1,85 @@
+#include "derivedmetrics.h"
+#include <string.h>
+
+#define GRAVITY_MPS2 9.81
+
+void derived_metrics_init(DerivedMetrics_t *dm, const DerivedConfig_t *config) {
+  memset(dm, 0, sizeof(*dm));
+  dm->config = *config;
+}
+
+void derived_metrics_reset(DerivedMetrics_t *dm) {
+  dm->head = 0;
+  dm->count = 0;
+  dm->sumT = dm->sumV = dm->sumTT = dm->sumTV = 0.0;
+  dm->accelerationMps2 = 0.0;
+  dm->powerW = 0.0;
+}
+
+// Ennél régebbi kezdőpontnál az összegek újraszámolódnak, hogy a
+// kivonásokból eredő kerekítési hiba ne halmozódjon
+#define DERIVED_REBASE_US 10000000LL
+
+static void accumulate(DerivedMetrics_t *dm, int idx, double sign) {
+  double t = (dm->sampleUs[idx] - dm->originUs) * 1e-6;
+  double v = dm->speedMps[idx];
+  dm->sumT += sign * t;
+  dm->sumV += sign * v;
+  dm->sumTT += sign * t * t;
+  dm->sumTV += sign * t * v;
+}
+
+static int oldest(const DerivedMetrics_t *dm) {
+  return (dm->head + DERIVED_MAX_SAMPLES - dm->count) % DERIVED_MAX_SAMPLES;
+}
+
+static void rebase(DerivedMetrics_t *dm, int64_t originUs) {
+  dm->originUs = originUs;
+  dm->sumT = dm->sumV = dm->sumTT = dm->sumTV = 0.0;
+  for (int i = 0, idx = oldest(dm); i < dm->count; i++, idx = (idx + 1) % DERIVED_MAX_SAMPLES) {
+    accumulate(dm, idx, 1.0);
+  }
+}
+
+// Legkisebb négyzetes meredekség az összegekből (m/s^2)
+static double regression_slope(const DerivedMetrics_t *dm) {
+  int n = dm->count;
+  if (n < 2) return 0.0;
+  double denom = n * dm->sumTT - dm->sumT * dm->sumT;
+  if (denom <= 0.0) return 0.0;
+  return (n * dm->sumTV - dm->sumT * dm->sumV) / denom;
+}
+
+void derived_metrics_sample(DerivedMetrics_t *dm, int64_t nowUs, double speedKmh) {
+  double v = speedKmh / 3.6;
+
+  // Az ablakból kiesett minták távoznak az összegekből
+  while (dm->count > 0 && nowUs - dm->sampleUs[oldest(dm)] > dm->config.windowUs) {
+    accumulate(dm, oldest(dm), -1.0);
+    dm->count--;
+  }
+  if (dm->count == DERIVED_MAX_SAMPLES) {
+    accumulate(dm, oldest(dm), -1.0); // Tele, a legrégebbi még az ablakban van
+    dm->count--;
+    dm->truncatedSamples++;
+  }
+  if (dm->count == 0) rebase(dm, nowUs);
+
+  int idx = dm->head;
+  dm->sampleUs[idx] = nowUs;
+  dm->speedMps[idx] = (float)v;
+  dm->head = (idx + 1) % DERIVED_MAX_SAMPLES;
+  dm->count++;
+  if (nowUs - dm->originUs > DERIVED_REBASE_US) rebase(dm, dm->sampleUs[oldest(dm)]);
+  else accumulate(dm, idx, 1.0);
+
+  dm->accelerationMps2 = regression_slope(dm);
+
+  // P = v * (m*g*Crr + 1/2*rho*CdA*v^2 + m*a); gurulás/fékezés közben nincs negatív teljesítmény
+  const DerivedConfig_t *c = &dm->config;
+  double force = c->massKg * GRAVITY_MPS2 * c->crr +
+                 0.5 * c->airDensity * c->cdA * v * v +
+                 c->massKg * dm->accelerationMps2;
+  double power = v * force;
+  dm->powerW = power > 0.0 ? power : 0.0;
+}
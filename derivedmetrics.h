@@ -0,0 +1,47 @@
+// derivedmetrics.h
+// Származtatott metrikák a sebességbecslő kimenetéből: gyorsulás (lineáris
+// regresszió a legutóbbi időablak sebességmintáira) és becsült
+// tekerési teljesítmény (gördülési ellenállás + légellenállás + gyorsítás).
+// Rögzített méretű gyűrűpuffer, dinamikus foglalás nincs; hardverfüggetlen.
+// A puffer a DERIVED_WINDOW_MS ablakot DERIVED_MAX_RATE_HZ mintasűrűségig
+// teljesen lefedi; a kiesett minták idő szerint távoznak, a regressziós
+// összegek mintánként O(1) frissülnek. Ennél sűrűbb mintáknál az ablak
+// csonkolódik (truncatedSamples).
+#ifndef DERIVEDMETRICS_H
+#define DERIVEDMETRICS_H
+
+#include <stdint.h>
+#include "config.h"
+
+#define DERIVED_MAX_SAMPLES (DERIVED_WINDOW_MS * DERIVED_MAX_RATE_HZ / 1000 + 1)
+
+typedef struct {
+  double massKg;        // Kerékpáros + kerékpár tömege
+  double crr;           // Gördülési ellenállási együttható
+  double cdA;           // Légellenállási tényező * homlokfelület (m^2)
+  double airDensity;    // Levegő sűrűsége (kg/m^3)
+  int64_t windowUs;     // A gyorsulás regressziós ablaka
+} DerivedConfig_t;
+
+typedef struct {
+  DerivedConfig_t config;
+  int64_t sampleUs[DERIVED_MAX_SAMPLES];
+  float speedMps[DERIVED_MAX_SAMPLES];
+  uint16_t head;         // A következő írási pozíció
+  uint16_t count;
+  int64_t originUs;      // A regressziós összegek időtengelyének kezdőpontja
+  double sumT, sumV, sumTT, sumTV; // Az ablakban lévő mintákra (t: s originUs-tól)
+  uint32_t truncatedSamples; // Még az ablakon belül felülírt minták (túl sűrű mintavétel)
+  double accelerationMps2;
+  double powerW;
+} DerivedMetrics_t;
+
+void derived_metrics_init(DerivedMetrics_t *dm, const DerivedConfig_t *config);
+
+// Új sebességminta (km/h) a becslés időpontjában; frissíti a gyorsulást és a teljesítményt
+void derived_metrics_sample(DerivedMetrics_t *dm, int64_t nowUs, double speedKmh);
+
+// Megálláskor: az előzmény törlődik, a metrikák nullázódnak
+void derived_metrics_reset(DerivedMetrics_t *dm);
+
+#endif
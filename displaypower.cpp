@@ -0,0 +1,123 @@
+#include "displaypower.h"
+#include <atomic>
+#include "displaytft.h"
+#include "esp_log.h"
+#include "binlog.h"
+#include "config.h"
+
+extern const char *TAG;
+
+static const char *const stateNames[DISPLAY_POWER_STATE_COUNT] = {
+  "ON", "DIM", "BLANK", "SLEEP"
+};
+
+static std::atomic<int64_t> lastActivityUs(0);
+static DisplayPowerState_t powerState = DISPLAY_POWER_ON;
+static int64_t stateEnteredUs = 0;
+static int64_t stateTimeUs[DISPLAY_POWER_STATE_COUNT] = {0};
+
+static void set_backlight(uint32_t duty) {
+  ledcWrite(DISPLAY_BL_PWM_CHANNEL, duty);
+}
+
+void display_power_init(void) {
+  // A TFT_eSPI digitálisan kapcsolja be a háttérvilágítást, innentől PWM vezérli
+  ledcSetup(DISPLAY_BL_PWM_CHANNEL, DISPLAY_BL_PWM_FREQ_HZ, DISPLAY_BL_PWM_BITS);
+  ledcAttachPin(DISPLAY_BL_PIN, DISPLAY_BL_PWM_CHANNEL);
+  set_backlight(DISPLAY_BL_FULL_DUTY);
+
+  int64_t now = esp_timer_get_time();
+  lastActivityUs.store(now, std::memory_order_relaxed);
+  stateEnteredUs = now;
+  powerState = DISPLAY_POWER_ON;
+  ESP_LOGI(TAG, "Display power manager started (dim %ds, off %ds, sleep %ds)",
+           DISPLAY_DIM_TIMEOUT_S, DISPLAY_OFF_TIMEOUT_S, DISPLAY_SLEEP_TIMEOUT_S);
+}
+
+void display_power_activity(void) {
+  lastActivityUs.store(esp_timer_get_time(), std::memory_order_relaxed);
+}
+
+static DisplayPowerState_t target_state(int64_t idleUs) {
+  if (idleUs >= (int64_t)DISPLAY_SLEEP_TIMEOUT_S * 1000000) return DISPLAY_POWER_SLEEP;
+  if (idleUs >= (int64_t)DISPLAY_OFF_TIMEOUT_S * 1000000) return DISPLAY_POWER_BLANK;
+  if (idleUs >= (int64_t)DISPLAY_DIM_TIMEOUT_S * 1000000) return DISPLAY_POWER_DIM;
+  return DISPLAY_POWER_ON;
+}
+
+static void enter_state(DisplayPowerState_t newState, int64_t nowUs) {
+  stateTimeUs[powerState] += nowUs - stateEnteredUs;
+  stateEnteredUs = nowUs;
+
+  // Alvó módból előbb a panelt ébresztjük (ST7789: 5 ms a következő parancsig)
+  if (powerState == DISPLAY_POWER_SLEEP) {
+    lcd.writecommand(TFT_SLPOUT);
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+
+  switch (newState) {
+  case DISPLAY_POWER_ON:
+    set_backlight(DISPLAY_BL_FULL_DUTY);
+    break;
+  case DISPLAY_POWER_DIM:
+    set_backlight(DISPLAY_BL_DIM_DUTY);
+    break;
+  case DISPLAY_POWER_BLANK:
+    set_backlight(0);
+    break;
+  case DISPLAY_POWER_SLEEP:
+    set_backlight(0);
+    lcd.writecommand(TFT_SLPIN);
+    break;
+  default:
+    break;
+  }
+
+  BLOG_I(TAG, "Display power: %s -> %s", stateNames[powerState], stateNames[newState]);
+  powerState = newState;
+}
+
+bool display_power_update(int64_t nowUs) {
+  int64_t idleUs = nowUs - lastActivityUs.load(std::memory_order_relaxed);
+  DisplayPowerState_t target = target_state(idleUs);
+  if (target == powerState) {
+    return false;
+  }
+
+  bool woke = (target < powerState) && (powerState >= DISPLAY_POWER_BLANK);
+  enter_state(target, nowUs);
+  return woke;
+}
+
+DisplayPowerState_t display_power_state(void) {
+  return powerState;
+}
+
+bool display_power_is_visible(void) {
+  return powerState == DISPLAY_POWER_ON || powerState == DISPLAY_POWER_DIM;
+}
+
+int64_t display_power_time_in_state_us(DisplayPowerState_t state) {
+  if (state >= DISPLAY_POWER_STATE_COUNT) return 0;
+  int64_t t = stateTimeUs[state];
+  if (state == powerState) t += esp_timer_get_time() - stateEnteredUs;
+  return t;
+}
+
+void display_power_report(void) {
+  int64_t total = 0;
+  int64_t times[DISPLAY_POWER_STATE_COUNT];
+  for (int i = 0; i < DISPLAY_POWER_STATE_COUNT; i++) {
+    times[i] = display_power_time_in_state_us((DisplayPowerState_t)i);
+    total += times[i];
+  }
+  if (total <= 0) return;
+  for (int i = 0; i < DISPLAY_POWER_STATE_COUNT; i++) {
+    ESP_LOGI(TAG, "Display %-5s: %8.1f s (%5.1f%%)", stateNames[i],
+             times[i] / 1000000.0, 100.0 * times[i] / total);
+  }
+}
+
+void display_power_shutdown(void) {
+  set_backlight(0);
+}
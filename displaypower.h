@@ -0,0 +1,42 @@
+// displaypower.h
+// Kijelző energiagazdálkodás: tétlenség után halványítás (PWM), majd a
+// háttérvilágítás kikapcsolása, végül az ST7789 panel alvó módba tétele.
+// Impulzus vagy gombnyomás azonnal visszaállítja a kijelzőt.
+#ifndef DISPLAYPOWER_H
+#define DISPLAYPOWER_H
+
+#include <stdint.h>
+
+typedef enum {
+  DISPLAY_POWER_ON,     // Teljes fényerő
+  DISPLAY_POWER_DIM,    // Halványított háttérvilágítás
+  DISPLAY_POWER_BLANK,  // Háttérvilágítás kikapcsolva, panel aktív
+  DISPLAY_POWER_SLEEP,  // Háttérvilágítás ki, panel alvó módban (GRAM megmarad)
+  DISPLAY_POWER_STATE_COUNT
+} DisplayPowerState_t;
+
+// lcd.init() után hívandó (a GUI taskból)
+void display_power_init(void);
+
+// Aktivitás jelzése (impulzus, gombnyomás) - bármelyik taskból hívható
+void display_power_activity(void);
+
+// Állapotgép léptetése a GUI taskból. true, ha a kijelző most ébredt fel
+// kikapcsolt/alvó állapotból, ilyenkor a megtartott képkockát ki kell küldeni.
+bool display_power_update(int64_t nowUs);
+
+DisplayPowerState_t display_power_state(void);
+
+// Olvasható-e a kijelző (teljes vagy halványított fényerő)
+bool display_power_is_visible(void);
+
+// Az egyes állapotokban eltöltött idő (mikroszekundum), az aktuálisat is beleértve
+int64_t display_power_time_in_state_us(DisplayPowerState_t state);
+
+// Állapotonkénti idők naplózása
+void display_power_report(void);
+
+// Háttérvilágítás kikapcsolása mélyalvás előtt
+void display_power_shutdown(void);
+
+#endif
@@ -1,8 +1,16 @@
 #include "displaytft.h" // Include-old a saját headerödet
 #include "esp_log.h"    // Az ESP_LOGI-hoz
+#include "binlog.h"    // Halasztott napló a GUI ágakra
+#include "scheduler.h" // Automatikus képváltás ütemezett munkaként
 #include "icons.h"     // Az ikonokhoz
 #include "driver/gpio.h" // GPIO funkciókhoz
 #include "config.h"
+#include "layout.h"  // Widget alapú képernyő elrendezés
+#include "displaypower.h" // Háttérvilágítás és panel energiagazdálkodás
+#include "idleladder.h"   // Gombnyomás a tétlenségi lépcsőnek
+#include "pulselatency.h" // Impulzus -> képpont késleltetés mérése
+#include "energymodel.h"  // Energia képernyő
+#include "esp_heap_caps.h"
 
 // Külső változók deklarálása
 extern const char *TAG;
@@ -13,13 +21,13 @@ extern DisplayState_t sharedDisplayState;
 extern SemaphoreHandle_t xDisplayStateMutex;
 
 
-static TimerHandle_t xDisplayTimer = NULL;
+static SchedJob_t displayAutoJob = SCHED_NO_JOB;
 static bool manualDisplayChange = false;
 TFT_eSPI lcd = TFT_eSPI();
 TFT_eSprite sprite = TFT_eSprite(&lcd);
 
-// Timer callback függvény - automatikus kijelző váltáshoz
-void displayTimerCallback(TimerHandle_t xTimer) {
+// Ütemezett munka - automatikus kijelző váltáshoz
+static void display_auto_switch_job(void *arg) {
 
   if (keptoggle) {
     return;
@@ -36,7 +44,7 @@ void displayTimerCallback(TimerHandle_t xTimer) {
         xSemaphoreTake(xDisplayStateMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
       sharedDisplayState = newState;
       xSemaphoreGive(xDisplayStateMutex);
-      ESP_LOGI(TAG, "Auto display switch: %d -> %d", sharedDisplayState,
+      BLOG_I(TAG, "Auto display switch: %d -> %d", sharedDisplayState,
                newState);
     }
   }
@@ -63,52 +71,37 @@ void guiTask(void *pvParameters)
   lcd.setRotation(1);
   //lcd.setColorDepth(16);
 
-  sprite.setColorDepth(16); // Színmélység beállítása
-  sprite.createSprite(lcd.width(), lcd.height()); // Sprite méretének beállítása
+  // Sprite a beállított színmélységgel (SPRITE_COLOR_DEPTH), heap mérés előtte/utána
+  uint32_t heapBefore = esp_get_free_heap_size();
+  size_t spriteBytes = layout_create_sprite(lcd.width(), lcd.height());
+  ESP_LOGI(TAG, "Sprite: %u bytes at %d bpp, free heap %lu -> %lu, largest block %u.",
+           (unsigned)spriteBytes, layout_color_depth(), (unsigned long)heapBefore,
+           (unsigned long)esp_get_free_heap_size(),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
   sprite.setTextSize(1);                          // Betűméret beállítása
   sprite.setTextDatum(MC_DATUM); // Szöveg középre igazítása
-  sprite.setTextColor(TFT_WHITE,
-                      TFT_BLUE); // Szöveg színe: fehér, háttér: kék
+  sprite.setTextColor(layout_color(TFT_WHITE),
+                      layout_color(TFT_BLUE)); // Szöveg színe: fehér, háttér: kék
   sprite.setFreeFont(&FreeMonoBoldOblique12pt7b); // Betűtípus beállítása
 
-  // Timer létrehozása
-  xDisplayTimer =
-      xTimerCreate("DisplayTimer",            // Timer neve
-                   pdMS_TO_TICKS(KEP_VALTAS), // Periódus (KEP_VALTAS ms)
-                   pdTRUE,                    // Auto-reload (ismétlődő)
-                   0,                         // Timer ID
-                   displayTimerCallback       // Callback függvény
-                   );
+  display_power_init(); // Háttérvilágítás PWM vezérlése
 
-  if (xDisplayTimer == NULL) {
-    ESP_LOGE(TAG, "Failed to create display timer!");
+  // Automatikus váltás az ütemező taskban (KEP_VALTAS ms-onként)
+  displayAutoJob = sched_every("display_auto", KEP_VALTAS, display_auto_switch_job, NULL);
+  if (displayAutoJob == SCHED_NO_JOB) {
+    ESP_LOGE(TAG, "Failed to schedule display auto-switch!");
   } else {
-    // Timer indítása
-    if (xTimerStart(xDisplayTimer, 0) != pdPASS) {
-      ESP_LOGE(TAG, "Failed to start display timer!");
-    } else {
-      ESP_LOGI(TAG, "Display auto-switch timer started (%d ms)", KEP_VALTAS);
-    }
+    ESP_LOGI(TAG, "Display auto-switch scheduled (%d ms)", KEP_VALTAS);
   }
 
   ESP_LOGI(TAG, "Initial TFT ok.");
   ESP_LOGI(TAG, "Waking from deep sleep. Boot count: %u", bootCount);
 
-  char display_buffer[40];
-  char me_str[10];
-
   static DisplayState_t currentDisplayState = DISPLAY_SPEED;
   SensorData_t localSensorData;
-  SensorData_t prevSensorData = {-1.0, -1.0, -1.0, -1.0, 0}; // 5 mező: speedKmh, dailyDistanceKm, totalDistanceKm, instantaneousSpeedKmh, movingTimeSeconds
+  double localMaxSpeedKmh = 0.0;
   bool force_redraw = true; // Az első ciklusban mindenképp rajzoljunk
 
-  // Átlagsebesség számításhoz - csak a mérési idő marad lokális
-  static int64_t lastMeasurementTimeUs = 0;
-
-  // Mozgási idő változók módosítása - most a sharedSensorData-t használjuk
-  static int64_t lastMovementUpdateTimeUs = 0; // Utolsó mozgási idő frissítés ideje
-  static bool movementTimeInitialized = false; // Inicializálás flag
-
   // Gomb kezelési változók - EGYSZERŰSÍTETT (csak display state váltáshoz)
   static bool utolsoGombAllapot = 1;  // ESP-IDF-ben 1/0 értékek
   static bool jelenlegiGombAllapot = 1;
@@ -117,12 +110,20 @@ void guiTask(void *pvParameters)
   const TickType_t prellezesiIdo = pdMS_TO_TICKS(50);
   const TickType_t rovidNyomasMaxIdo = pdMS_TO_TICKS(400);
   static TickType_t utolsoPrellezesIdo = 0;
+  static bool gombEbresztett = false; // A nyomás a kijelzőt ébresztette
+
+  // Képkocka idő statisztika
+  uint32_t fullFrames = 0, partialFrames = 0;
+  int64_t fullFrameUs = 0, partialFrameUs = 0, fullFrameMaxUs = 0, partialFrameMaxUs = 0;
+  int64_t lastPerfReportUs = esp_timer_get_time();
+  int64_t lastPulseEdgeUs = 0; // A legutóbb kirajzolt impulzus (késleltetés méréshez)
 
   ESP_LOGI(TAG, "GUI Task started with initial display state: %d", currentDisplayState);
 
   while (1) {
-    bool data_changed = false;
     bool state_switched = false;
+    bool newPulse = false;
+    int64_t readUs = 0;
 
     // EGYSZERŰSÍTETT gomb kezelés - csak rövid nyomás (display state váltás)
     int gombOlvasas = gpio_get_level(RESET_DAILY_BTN_PIN);
@@ -141,23 +142,25 @@ void guiTask(void *pvParameters)
         if (jelenlegiGombAllapot == 0 && !gombNyomva) {  // 0 = lenyomott állapot
           gombNyomasKezdete = xTaskGetTickCount();
           gombNyomva = true;
-          ESP_LOGD(TAG, "Button pressed down");
+          // Sötét kijelzőnél a nyomás csak ébreszt, nem vált képernyőt
+          gombEbresztett = !display_power_is_visible();
+          idle_ladder_activity();
+          BLOG_D(TAG, "Button pressed down");
         } else if (jelenlegiGombAllapot == 1 && gombNyomva) {  // 1 = felengedett állapot
           TickType_t nyomasHossza = xTaskGetTickCount() - gombNyomasKezdete;
           gombNyomva = false;
           
-          if (nyomasHossza < rovidNyomasMaxIdo) {
+          if (nyomasHossza < rovidNyomasMaxIdo && !gombEbresztett) {
             // Rövid nyomás - kijelző állapot váltás
             DisplayState_t oldState = currentDisplayState;
             currentDisplayState = (DisplayState_t)((currentDisplayState + 1) % DISPLAY_STATE_COUNT);
             state_switched = true;
             manualDisplayChange = true;
-            // Timer újraindítása a manuális váltás után
-            if (xDisplayTimer != NULL) {
-              xTimerReset(xDisplayTimer, 0);
-              ESP_LOGD(TAG, "Display timer reset after manual change");
+            // Automatikus váltás újraindítása a manuális váltás után
+            if (sched_arm(displayAutoJob)) {
+              BLOG_D(TAG, "Display auto-switch restarted after manual change");
             }
-            ESP_LOGI(TAG, "GUI: Short button press - display state changed %d -> %d", oldState, currentDisplayState);
+            BLOG_I(TAG, "GUI: Short button press - display state changed %d -> %d", oldState, currentDisplayState);
             
             // Frissítsük a megosztott display state-et
             if (xDisplayStateMutex != NULL && xSemaphoreTake(xDisplayStateMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
@@ -165,7 +168,7 @@ void guiTask(void *pvParameters)
               xSemaphoreGive(xDisplayStateMutex);
             }
           }
-          // Hosszú nyomás kezelését a reset task végzi
+          // Hosszú nyomás kezelését az ütemező reset_hold_job munkája végzi
         }
       }
     }
@@ -184,7 +187,7 @@ void guiTask(void *pvParameters)
       if (sharedState != currentDisplayState) {
         currentDisplayState = sharedState;
         state_switched = true;
-        ESP_LOGI(TAG, "GUI: Auto display switch detected - new state: %d",
+        BLOG_I(TAG, "GUI: Auto display switch detected - new state: %d",
                  currentDisplayState);
       }
     }
@@ -193,158 +196,15 @@ void guiTask(void *pvParameters)
     if (xDataMutex != NULL &&
         xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
       localSensorData = sharedSensorData;
+      localMaxSpeedKmh = maxSpeedKmh; // A számoló task követi, ellenőrzött impulzusokból
       xSemaphoreGive(xDataMutex);
-      
-      // Mozgási idő frissítése a sharedSensorData-ban
-      bool isCurrentlyMovingForTime = (localSensorData.speedKmh > 0.01); // 0.01 km/h felett mozgás
-      int64_t currentTimeUs = esp_timer_get_time();
-      
-      // Mozgási idő inicializálása, ha még nem volt
-      if (!movementTimeInitialized) {
-        lastMovementUpdateTimeUs = currentTimeUs;
-        movementTimeInitialized = true;
-        ESP_LOGI(TAG, "Mozgási idő mérés inicializálva - sebesség: %.2f km/h", localSensorData.speedKmh);
-      } else {
-        // Időkülönbség kiszámítása az utolsó frissítés óta
-        int64_t deltaTimeUs = currentTimeUs - lastMovementUpdateTimeUs;
-        
-        // Ha mozgunk, akkor minden delta időt hozzáadunk másodperc pontossággal
-        if (isCurrentlyMovingForTime && deltaTimeUs > 0) {
-          // Minden 100ms-nál nagyobb időkülönbségnél frissítünk
-          if (deltaTimeUs >= 100000) { // 0.1 másodperc (100ms)
-            double deltaSecondsFloat = (double)deltaTimeUs / 1000000.0;
-            uint32_t deltaSecondsInt = (uint32_t)(deltaSecondsFloat + 0.5); // Kerekítés
-            
-            sharedSensorData.movingTimeSeconds += deltaSecondsInt;
-            lastMovementUpdateTimeUs = currentTimeUs;
-          } else {
-            lastMovementUpdateTimeUs = currentTimeUs;
-          }
-        } else if (!isCurrentlyMovingForTime) {
-          // Ha nem mozgunk, akkor frissítjük az időt (de nem adjuk hozzá a mozgási időhöz)
-          lastMovementUpdateTimeUs = currentTimeUs;
-        }
-      }
-      
-      // Frissített localSensorData lekérése
-      localSensorData = sharedSensorData;
-      
-      xSemaphoreGive(xDataMutex);
-
-      // Átlagsebesség frissítése minden állapotnál (időalapú módszer)
-      bool isCurrentlyMoving = (localSensorData.speedKmh > 0.1); // 0.1 km/h felett mozgás
-      
-      // Ha még nem volt inicializálva a mérés kezdete
-      if (lastMeasurementTimeUs == 0) {
-        lastMeasurementTimeUs = currentTimeUs;
-        startTotalDistanceKm = localSensorData.totalDistanceKm;
-        totalMovingTimeUs = 0; // FONTOS: kezdéskor 0
-        ESP_LOGI(TAG, "Átlagsebesség mérés inicializálva: %.3f km-től", startTotalDistanceKm);
-      } else {
-        // Időkülönbség kiszámítása az utolsó mérés óta
-        int64_t deltaTimeUs = currentTimeUs - lastMeasurementTimeUs;
-        
-        // JAVÍTÁS: Ha JELENLEG mozgunk, akkor az időintervallumot hozzáadjuk
-        if (isCurrentlyMoving && deltaTimeUs > 0) {
-          totalMovingTimeUs += deltaTimeUs;
-        }
-        
-        // Átlagsebesség újraszámítása
-        double distanceTraveledKm = localSensorData.totalDistanceKm - startTotalDistanceKm;
-        
-        if (totalMovingTimeUs > 0 && distanceTraveledKm > 0.001) { // Legalább 1 méter megtételével
-          double totalMovingTimeHours = (double)totalMovingTimeUs / (1000000.0 * 3600.0); // mikroszekundum -> óra
-          averageSpeedKmh = distanceTraveledKm / totalMovingTimeHours;
-          
-          // JAVÍTÁS: Ésszerű határok beállítása
-          if (averageSpeedKmh > 200.0) { // Ha 200 km/h felett van, valami nem stimmel
-            ESP_LOGW(TAG, "Irreális átlagsebesség (%.1f km/h) - nullázás", averageSpeedKmh);
-            // Nullázzuk és újrakezdünk
-            startTotalDistanceKm = localSensorData.totalDistanceKm;
-            totalMovingTimeUs = 0;
-            averageSpeedKmh = 0.0;
-          }
-          
-          // Debug log az átlagsebesség számításhoz
-          static int debug_avg_counter = 0;
-          if (++debug_avg_counter >= 50) { // Minden 50. ciklusban
-            /*ESP_LOGI(TAG, "Átlag debug: táv=%.4f km, idő_us=%lld, idő_h=%.6f, átlag=%.2f km/h, mozgás: %s", 
-                     distanceTraveledKm, totalMovingTimeUs, totalMovingTimeHours, averageSpeedKmh, 
-                     isCurrentlyMoving ? "IGEN" : "NEM");*/
-            debug_avg_counter = 0;
-          }
-        } else {
-          // Ha nincs elég távolság vagy idő, 0 marad az átlag
-          if (totalMovingTimeUs == 0) {
-            averageSpeedKmh = 0.0;
-          }
-        }
-        
-        // Állapotok frissítése
-        lastMeasurementTimeUs = currentTimeUs;
-      }
+      readUs = esp_timer_get_time();
 
-      // Ellenőrizzük, hogy az aktuálisan kijelzendő adat változott-e
-      switch (currentDisplayState) {
-      case DISPLAY_SPEED:
-        if (fabs(localSensorData.speedKmh - prevSensorData.speedKmh) > 0.01)
-          data_changed = true;
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-        }
-        break;
-      case DISPLAY_DAILY_DISTANCE:
-        if (fabs(localSensorData.dailyDistanceKm - 
-                 prevSensorData.dailyDistanceKm) > 0.01)
-          data_changed = true;
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-        }
-        break;
-      case DISPLAY_TOTAL_DISTANCE:
-        if (fabs(localSensorData.totalDistanceKm - 
-                 prevSensorData.totalDistanceKm) > 0.0001)
-          data_changed = true;
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-        }
-        break;
-      case DISPLAY_MAX_SPEED:
-        // A max sebesség változását ellenőrizzük
-        static double prevMaxSpeed = -1.0;
-        if (fabs(maxSpeedKmh - prevMaxSpeed) > 0.01) {
-          data_changed = true;
-          prevMaxSpeed = maxSpeedKmh;
-        }
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-          data_changed = true;
-        }
-        break;
-      case DISPLAY_AVERAGE_SPEED:
-        // Az átlagsebesség változását ellenőrizzük
-        static double prevAvgSpeed = -1.0;
-        if (fabs(averageSpeedKmh - prevAvgSpeed) > 0.01) {
-          data_changed = true;
-          prevAvgSpeed = averageSpeedKmh;
-        }
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-        }
-        break;
-      case DISPLAY_MOVEMENT_TIME:
-        // A mozgási idő változását ellenőrizzük (másodpercenként frissül)
-        static uint32_t prevMovementTime = UINT32_MAX;
-        if (localSensorData.movingTimeSeconds != prevMovementTime) {
-          data_changed = true;
-          prevMovementTime = localSensorData.movingTimeSeconds;
-        }
-        if (localSensorData.speedKmh > maxSpeedKmh) {
-          maxSpeedKmh = localSensorData.speedKmh;
-        }
-        break;
-      default:
-        break;
+      // Új impulzus: a közbülső impulzusok összevonódnak, a legutolsót mérjük
+      newPulse = localSensorData.pulseEdgeUs != lastPulseEdgeUs;
+      if (newPulse) {
+        lastPulseEdgeUs = localSensorData.pulseEdgeUs;
+        pulse_latency_record(LATENCY_PUBLISH_TO_GUI, readUs - localSensorData.publishUs);
       }
 
     } else {
@@ -356,116 +216,66 @@ void guiTask(void *pvParameters)
       continue;
     }
 
-    // 3. Kijelző frissítése, ha kell
-    if (force_redraw || state_switched || data_changed) {
-      // Ha állapot váltás vagy erőltetett rajzolás van, mindig töröljünk mindent
+    // 3. Kijelző frissítése: csak a megváltozott widgetek rajzolódnak újra
+    MetricSnapshot_t snapshot;
+    snapshot.sensor = localSensorData;
+    snapshot.maxSpeedKmh = localMaxSpeedKmh;
+    snapshot.averageSpeedKmh = localSensorData.averageSpeedKmh;
+    ride_history_summary(&snapshot.rides); // Konstans idejű: RAM index + leképezett rekord
+    energy_summary(&snapshot.energy);
+    layout_sample(&snapshot, esp_timer_get_time());
+
+    // Kijelző energiaállapot: ébredéskor a sprite-ban megtartott képkocka azonnal kimegy
+    if (display_power_update(esp_timer_get_time())) {
+      sprite.pushSprite(0, 0);
+    }
+
+    // Sötét vagy alvó panelre nem rajzolunk
+    if (display_power_is_visible()) {
       if (force_redraw || state_switched) {
-        sprite.fillScreen(TFT_BLUE); // Teljes képernyő törlése
-        sprite.drawRect(0, 0, sprite.width(), sprite.height(), TFT_WHITE);
-        ESP_LOGI(TAG, "Screen cleared for state: %d", currentDisplayState);
+        BLOG_I(TAG, "Screen cleared for state: %d", currentDisplayState);
       }
+      bool full = force_redraw || state_switched;
+      int64_t frameStart = esp_timer_get_time();
+      bool pulseDrawn = false;
+      int redrawn = layout_render(currentDisplayState, &snapshot, full, &pulseDrawn);
+      int64_t frameEnd = esp_timer_get_time();
+      int64_t frameUs = frameEnd - frameStart;
+      force_redraw = false;
 
-      // ikon kirajzolás állapottól függően
-      sprite.fillSprite(TFT_BLUE);
-      sprite.fillScreen(TFT_BLUE); // Teljes képernyő törlése
-      sprite.drawRect(0, 0, sprite.width(), sprite.height(), TFT_WHITE);
-
-      switch (currentDisplayState) {
-      case DISPLAY_SPEED:
-        draw1bitBitmap(7, 82, iconSpeed, iconSpeedWidth, iconSpeedHeight, TFT_WHITE, TFT_BLUE);
-        //ESP_LOGD(TAG, "Drawing speed icon");
-        break;
-      case DISPLAY_DAILY_DISTANCE:
-        draw1bitBitmap(7, 82, iconDistance, iconDistanceWidth, iconDistanceHeight, TFT_WHITE, TFT_BLUE);
-        //ESP_LOGD(TAG, "Drawing daily distance icon");
-        break;
-      case DISPLAY_TOTAL_DISTANCE:
-        draw1bitBitmap(7, 82, iconDistance, iconDistanceWidth, iconDistanceHeight, TFT_WHITE, TFT_BLUE);
-        //ESP_LOGD(TAG, "Drawing total distance icon");
-        break;
-      case DISPLAY_MAX_SPEED:
-        //ESP_LOGD(TAG, "Drawing max speed icon");
-        break;
-      case DISPLAY_AVERAGE_SPEED:
-        //ESP_LOGD(TAG, "Drawing average speed icon");
-        break;
-      case DISPLAY_MOVEMENT_TIME:
-        //ESP_LOGD(TAG, "Drawing movement time (no icon)");
-        break;
-      default:
-        break;
+      // A layout_render visszatérésekor a képpontok már a panelen vannak. Csak
+      // akkor mérünk, ha impulzusból számolt érték rajzolódott (pl. az energia
+      // képernyő frissülése nem az impulzus megjelenése).
+      if (newPulse && pulseDrawn) {
+        pulse_latency_record(LATENCY_GUI_TO_PIXELS, frameEnd - readUs);
+        pulse_latency_record(LATENCY_EDGE_TO_PIXELS, frameEnd - localSensorData.pulseEdgeUs);
       }
 
-      // Megfelelő szöveg összeállítása az aktuális állapot alapján
-      switch (currentDisplayState) {
-      case DISPLAY_SPEED:
-        snprintf(display_buffer, sizeof(display_buffer), "%.1f",
-                 localSensorData.speedKmh);
-        strncpy(me_str, "km/h", sizeof(me_str));
-        prevSensorData.speedKmh = localSensorData.speedKmh;
-        break;
-      case DISPLAY_DAILY_DISTANCE:
-        snprintf(display_buffer, sizeof(display_buffer), "%.2f",
-                 localSensorData.dailyDistanceKm);
-        strncpy(me_str, "km day", sizeof(me_str));
-        prevSensorData.dailyDistanceKm = localSensorData.dailyDistanceKm;
-        break;
-      case DISPLAY_TOTAL_DISTANCE:
-        snprintf(display_buffer, sizeof(display_buffer), "%.1f",
-                 localSensorData.totalDistanceKm);
-        strncpy(me_str, "km all", sizeof(me_str));
-        prevSensorData.totalDistanceKm = localSensorData.totalDistanceKm;
-        break;
-      case DISPLAY_MAX_SPEED:
-        snprintf(display_buffer, sizeof(display_buffer), "%.1f", maxSpeedKmh);
-        strncpy(me_str, "km/h max", sizeof(me_str));
-        break;
-      case DISPLAY_AVERAGE_SPEED:
-        snprintf(display_buffer, sizeof(display_buffer), "%.1f", averageSpeedKmh);
-        strncpy(me_str, "km/h avg", sizeof(me_str));
-        break;
-      case DISPLAY_MOVEMENT_TIME:
-        // Mozgási idő óó:pp formátumban - most a sharedSensorData-ból
-        {
-          int hours = localSensorData.movingTimeSeconds / 3600;
-          int minutes = (localSensorData.movingTimeSeconds % 3600) / 60;
-          snprintf(display_buffer, sizeof(display_buffer), "%02d:%02d", hours, minutes);
-          strncpy(me_str, "fut.ido", sizeof(me_str));
-        }
-        break;
-      default:
-        strncpy(display_buffer, "Error", sizeof(display_buffer));
-        strncpy(me_str, "ERR", sizeof(me_str));
-        break;
-      }
-
-      // Szöveg kirajzolása
-      sprite.setTextColor(TFT_WHITE, TFT_BLUE);
-      sprite.setTextSize(3);
-      sprite.setFreeFont(&FreeMonoBold12pt7b);
-      sprite.drawString(display_buffer, sprite.width() / 2, sprite.height() / 2 - 27);
-      sprite.setFreeFont(&FreeSerif9pt7b);
-
-      // Ellenőrizzük, hogy "km "-rel kezdődik-e
-      int me_str_x_pos;
-      if (strncmp(me_str, "km ", 3) == 0) {
-        me_str_x_pos = sprite.width() / 2 + 20; // Más pozíció km esetén
-      } else {
-        me_str_x_pos = sprite.width() / 2 + 8; // Eredeti pozíció
+      // Képkocka idők a színmélység hatásának méréséhez
+      if (full) {
+        fullFrames++;
+        fullFrameUs += frameUs;
+        if (frameUs > fullFrameMaxUs) fullFrameMaxUs = frameUs;
+      } else if (redrawn > 0) {
+        partialFrames++;
+        partialFrameUs += frameUs;
+        if (frameUs > partialFrameMaxUs) partialFrameMaxUs = frameUs;
       }
+    }
 
-      sprite.drawString(me_str, me_str_x_pos, sprite.height() / 2 + 33);
-      sprite.setTextSize(2);
-      sprite.setFreeFont(nullptr);
-      sprite.setTextColor(TFT_LIGHTGREY, TFT_BLUE);
-      sprite.drawString("HR", 18, 11);
-      
-      force_redraw = false;
+#if GUI_PERF_REPORT_S > 0
+    if (esp_timer_get_time() - lastPerfReportUs >= (int64_t)GUI_PERF_REPORT_S * 1000000) {
+      lastPerfReportUs = esp_timer_get_time();
+      ESP_LOGI(TAG, "GUI perf (%d bpp): full %lu x avg %lld us max %lld us, partial %lu x avg %lld us max %lld us, heap %lu min %lu",
+               layout_color_depth(), (unsigned long)fullFrames, fullFrames ? fullFrameUs / fullFrames : 0,
+               fullFrameMaxUs, (unsigned long)partialFrames,
+               partialFrames ? partialFrameUs / partialFrames : 0, partialFrameMaxUs,
+               (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size());
+      fullFrames = partialFrames = 0;
+      fullFrameUs = partialFrameUs = fullFrameMaxUs = partialFrameMaxUs = 0;
     }
+#endif
 
-    // FONTOS: A sprite push mindig történjen meg
-    sprite.pushSprite(0, 0);
-    
     vTaskDelay(pdMS_TO_TICKS(100));
   }
 }
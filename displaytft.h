@@ -10,6 +10,7 @@
 #define TOUCH_CS 33
 #include "TFT_eSPI.h"
 #include "config.h"
+#include "timeseries.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
@@ -32,6 +33,11 @@ typedef struct {
   double totalDistanceKm;
   double instantaneousSpeedKmh;   // <-- új mező
   uint32_t movingTimeSeconds;     // <-- új mező: mozgásban eltöltött idő másodpercekben
+  double accelerationMps2;        // Gyorsulás (m/s^2), a számoló task frissíti
+  double powerW;                  // Becsült tekerési teljesítmény (W)
+  double averageSpeedKmh;         // Átlagsebesség a mozgási időből (autopause)
+  int64_t pulseEdgeUs;            // A legutóbb közzétett impulzus ISR időbélyege
+  int64_t publishUs;              // Közzététel ideje (késleltetés méréshez)
 } SensorData_t;
 
 // Enumeráció a kijelzett adatok típusához
@@ -42,6 +48,9 @@ typedef enum {
   DISPLAY_MAX_SPEED,    // Maximális sebesség
   DISPLAY_AVERAGE_SPEED, // Átlagsebesség
   DISPLAY_MOVEMENT_TIME, // Új: tényleges mozgási idő
+  DISPLAY_RIDE_HISTORY,  // Utolsó menet, heti és havi táv
+  DISPLAY_SPEED_GRAPH,   // Sebesség görbe 1 s / 10 s / 1 perc felbontással
+  DISPLAY_ENERGY,        // Becsült energia: menet mAh, átlagáram, hátralévő üzemidő
   DISPLAY_STATE_COUNT   // Az állapotok száma a ciklikus váltáshoz
 } DisplayState_t;
 
@@ -52,6 +61,8 @@ extern const char *TAG; // Ha a displaytft.cpp-ben is szükséged van rá
 // Globális adatok és mutex extern deklarációja
 extern SensorData_t sharedSensorData;
 extern SemaphoreHandle_t xDataMutex;
+// Sebesség idősor (a számoló task tölti, xDataMutex védi)
+extern TimeSeries_t speedHistory;
 
 // Új: Megosztott kijelző állapot a reset task számára
 extern DisplayState_t sharedDisplayState;
@@ -59,12 +70,11 @@ extern SemaphoreHandle_t xDisplayStateMutex;
 
 // Új: Globális sebesség változók extern deklarációi
 extern double maxSpeedKmh;
-extern double averageSpeedKmh;
-extern double startTotalDistanceKm;
-extern int64_t totalMovingTimeUs;
 
 extern volatile bool keptoggle;
 
+void draw1bitBitmap(int x, int y, const uint8_t *bitmap, int w, int h,
+                    uint16_t fgColor, uint16_t bgColor);
 void guiTask(void *pvParameters); // Csak a deklaráció
 
 #endif
@@ -0,0 +1,209 @@
+#include "energymodel.h"
+#include <string.h>
+#include <sys/time.h>
+#include "config.h"
+#include "displaypower.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "pipelinestats.h"
+
+extern const char *TAG;
+
+#define ENERGY_RTC_MAGIC 0x454E5247 // "ENRG"
+#define US_PER_S 1000000.0
+#define MAS_PER_MAH 3600.0
+
+// Mélyalváson át megőrzött összegek (mA*s), hidegindításkor nullázva
+typedef struct {
+  uint32_t magic;
+  double componentMas[ENERGY_COMPONENT_COUNT];
+  int64_t awakeUs;       // Korábbi ébrenlétek összesen
+  int64_t sleepUs;       // Korábbi mélyalvások összesen
+  int64_t sleepStartUs;  // Rendszeridő az utolsó elalváskor (0: nincs)
+} EnergyCarry_t;
+
+static RTC_DATA_ATTR EnergyCarry_t carry;
+
+static portMUX_TYPE energyMux = portMUX_INITIALIZER_UNLOCKED;
+// CPU és WiFi: az eddigi töltés és az aktuális állapot kezdete (ebben a bootban)
+static double cpuMas = 0.0;
+static uint32_t cpuMhz = 0;
+static bool cpuLightSleep = false;
+static int64_t cpuSinceUs = 0;
+static double wifiMas = 0.0;
+static bool wifiOn = false;
+static int64_t wifiSinceUs = 0;
+static double rideBaseMas = 0.0;
+static bool rideActive = false;
+static double lastRideMah = 0.0;
+
+static const char *const componentNames[ENERGY_COMPONENT_COUNT] = {
+    "cpu", "wifi", "display", "pulse_isr", "board", "deep_sleep",
+};
+
+static int64_t wall_clock_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL); // Az RTC időzítő mélyalvásban is fut
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static double cpu_ma(uint32_t mhz, bool lightSleep) {
+  return lightSleep ? ENERGY_LIGHT_SLEEP_MA : ENERGY_CPU_BASE_MA + ENERGY_CPU_MA_PER_MHZ * mhz;
+}
+
+static double display_ma(DisplayPowerState_t state) {
+  switch (state) {
+  case DISPLAY_POWER_ON:
+    return ENERGY_PANEL_MA + ENERGY_BACKLIGHT_MA;
+  case DISPLAY_POWER_DIM:
+    return ENERGY_PANEL_MA + ENERGY_BACKLIGHT_MA * DISPLAY_BL_DIM_DUTY / DISPLAY_BL_FULL_DUTY;
+  case DISPLAY_POWER_BLANK:
+    return ENERGY_PANEL_MA;
+  default:
+    return ENERGY_PANEL_SLEEP_MA;
+  }
+}
+
+void energy_init(bool coldBoot) {
+  if (coldBoot || carry.magic != ENERGY_RTC_MAGIC) {
+    memset(&carry, 0, sizeof(carry));
+    carry.magic = ENERGY_RTC_MAGIC;
+  } else if (carry.sleepStartUs != 0) {
+    int64_t sleptUs = wall_clock_us() - carry.sleepStartUs;
+    if (sleptUs > 0) {
+      carry.sleepUs += sleptUs;
+      carry.componentMas[ENERGY_DEEP_SLEEP] += ENERGY_DEEP_SLEEP_MA * sleptUs / US_PER_S;
+    }
+  }
+  carry.sleepStartUs = 0;
+
+  double carriedMas = 0.0;
+  for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) carriedMas += carry.componentMas[c];
+  ESP_LOGI(TAG, "Energy model: %.1f mAh used since cold boot, %.0f s in deep sleep.",
+           carriedMas / MAS_PER_MAH, carry.sleepUs / US_PER_S);
+}
+
+void energy_set_cpu_mhz(uint32_t mhz) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&energyMux);
+  cpuMas += cpu_ma(cpuMhz, cpuLightSleep) * (now - cpuSinceUs) / US_PER_S;
+  cpuMhz = mhz;
+  cpuSinceUs = now;
+  portEXIT_CRITICAL(&energyMux);
+}
+
+void energy_set_light_sleep(bool asleep) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&energyMux);
+  cpuMas += cpu_ma(cpuMhz, cpuLightSleep) * (now - cpuSinceUs) / US_PER_S;
+  cpuLightSleep = asleep;
+  cpuSinceUs = now;
+  portEXIT_CRITICAL(&energyMux);
+}
+
+void energy_set_wifi(bool on) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&energyMux);
+  if (wifiOn) wifiMas += ENERGY_WIFI_AP_MA * (now - wifiSinceUs) / US_PER_S;
+  wifiOn = on;
+  wifiSinceUs = now;
+  portEXIT_CRITICAL(&energyMux);
+}
+
+// Ebben a bootban felhasznált töltés komponensenként (mA*s)
+static void boot_components(double mas[ENERGY_COMPONENT_COUNT], int64_t nowUs) {
+  portENTER_CRITICAL(&energyMux);
+  mas[ENERGY_CPU] = cpuMas + cpu_ma(cpuMhz, cpuLightSleep) * (nowUs - cpuSinceUs) / US_PER_S;
+  mas[ENERGY_WIFI] = wifiMas + (wifiOn ? ENERGY_WIFI_AP_MA * (nowUs - wifiSinceUs) / US_PER_S : 0.0);
+  portEXIT_CRITICAL(&energyMux);
+
+  double display = 0.0;
+  for (int s = 0; s < DISPLAY_POWER_STATE_COUNT; s++) {
+    display += display_ma((DisplayPowerState_t)s) *
+               display_power_time_in_state_us((DisplayPowerState_t)s) / US_PER_S;
+  }
+  mas[ENERGY_DISPLAY] = display;
+
+  PipelineCounters_t pc;
+  pipeline_counters(&pc);
+  mas[ENERGY_PULSE_ISR] = pc.value[PIPELINE_EDGES_SEEN] * ENERGY_PULSE_ISR_UC / 1000.0;
+  mas[ENERGY_BOARD] = ENERGY_BOARD_MA * nowUs / US_PER_S;
+  mas[ENERGY_DEEP_SLEEP] = 0.0;
+}
+
+static double total_mas(int64_t nowUs) {
+  double mas[ENERGY_COMPONENT_COUNT];
+  boot_components(mas, nowUs);
+  double total = 0.0;
+  for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) total += mas[c] + carry.componentMas[c];
+  return total;
+}
+
+void energy_ride_begin(void) {
+  double base = total_mas(esp_timer_get_time());
+  portENTER_CRITICAL(&energyMux);
+  rideBaseMas = base;
+  rideActive = true;
+  portEXIT_CRITICAL(&energyMux);
+}
+
+double energy_ride_end(void) {
+  double total = total_mas(esp_timer_get_time());
+  portENTER_CRITICAL(&energyMux);
+  if (rideActive) lastRideMah = (total - rideBaseMas) / MAS_PER_MAH;
+  rideActive = false;
+  double mah = lastRideMah;
+  portEXIT_CRITICAL(&energyMux);
+  return mah;
+}
+
+void energy_summary(EnergySummary_t *out) {
+  int64_t now = esp_timer_get_time();
+  double mas[ENERGY_COMPONENT_COUNT];
+  boot_components(mas, now);
+  out->totalMah = 0.0;
+  for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+    out->componentMah[c] = (mas[c] + carry.componentMas[c]) / MAS_PER_MAH;
+    out->totalMah += out->componentMah[c];
+  }
+
+  portENTER_CRITICAL(&energyMux);
+  out->rideMah = rideActive ? out->totalMah - rideBaseMas / MAS_PER_MAH : lastRideMah;
+  uint32_t mhz = cpuMhz;
+  bool wifi = wifiOn;
+  portEXIT_CRITICAL(&energyMux);
+  out->nowMa = cpu_ma(mhz, false) + (wifi ? ENERGY_WIFI_AP_MA : 0.0) +
+               display_ma(display_power_state()) + ENERGY_BOARD_MA;
+
+  double elapsedS = (carry.awakeUs + carry.sleepUs + now) / US_PER_S;
+  out->averageMa = elapsedS > 0.0 ? out->totalMah * MAS_PER_MAH / elapsedS : 0.0;
+  out->remainingMah = ENERGY_BATTERY_MAH > out->totalMah ? ENERGY_BATTERY_MAH - out->totalMah : 0.0;
+  out->runtimeH = out->averageMa > 0.0 ? out->remainingMah / out->averageMa : 0.0;
+  out->deepSleepS = (uint32_t)(carry.sleepUs / 1000000);
+}
+
+void energy_before_deep_sleep(void) {
+  int64_t now = esp_timer_get_time();
+  double mas[ENERGY_COMPONENT_COUNT];
+  boot_components(mas, now);
+  for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) carry.componentMas[c] += mas[c];
+  carry.awakeUs += now;
+  carry.sleepStartUs = wall_clock_us();
+}
+
+void energy_report(void) {
+  EnergySummary_t e;
+  energy_summary(&e);
+  ESP_LOGI(TAG, "Energy: %.1f mAh since cold boot (ride %.1f mAh), now %.1f mA, avg %.1f mA, %.0f mAh left ~ %.1f h",
+           e.totalMah, e.rideMah, e.nowMa, e.averageMa, e.remainingMah, e.runtimeH);
+  ESP_LOGI(TAG, "Energy by state: cpu %.2f, wifi %.2f, display %.2f, pulse_isr %.3f, board %.2f, deep_sleep %.2f mAh",
+           e.componentMah[ENERGY_CPU], e.componentMah[ENERGY_WIFI], e.componentMah[ENERGY_DISPLAY],
+           e.componentMah[ENERGY_PULSE_ISR], e.componentMah[ENERGY_BOARD],
+           e.componentMah[ENERGY_DEEP_SLEEP]);
+}
+
+const char *energy_component_name(EnergyComponent_t component) {
+  return component < ENERGY_COMPONENT_COUNT ? componentNames[component] : "?";
+}
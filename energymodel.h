@@ -0,0 +1,64 @@
+// energymodel.h
+// Energia elszámolás állapotonkénti áramfelvételből (config.h: ENERGY_*).
+// Az egyes hardverállapotokban töltött időt követi - CPU frekvencia és
+// light sleep, WiFi AP be/ki, kijelző állapot (háttérvilágítás fényereje,
+// panel alvás), impulzus ISR ébredések, mélyalvás - és a beállított
+// áramértékekkel szorozza. A
+// korábbi ébrenlétek és mélyalvások töltése RTC memóriában öröklődik
+// (bootCount), így az összeg a hidegindítás óta érvényes.
+// Kimenet: mAh komponensenként, az aktuális menet mAh-ja, pillanatnyi és
+// átlagos áram, a hidegindításkor teljesnek vett akkumulátorral becsült
+// hátralévő üzemidő. Becslés, nem mérés: firmware változatok energia
+// szerinti összevetésére, azonos áramértékekkel.
+#ifndef ENERGYMODEL_H
+#define ENERGYMODEL_H
+
+#include <stdint.h>
+
+typedef enum {
+  ENERGY_CPU,         // CPU a mindenkori frekvencián, light sleep-ben alvó áramon
+  ENERGY_WIFI,        // Soft-AP
+  ENERGY_DISPLAY,     // Háttérvilágítás és panel
+  ENERGY_PULSE_ISR,   // Impulzus élek feldolgozása
+  ENERGY_BOARD,       // Állandó alapfogyasztás ébren
+  ENERGY_DEEP_SLEEP,  // Mélyalvás (korábbi alvások)
+  ENERGY_COMPONENT_COUNT
+} EnergyComponent_t;
+
+typedef struct {
+  double componentMah[ENERGY_COMPONENT_COUNT]; // Hidegindítás óta
+  double totalMah;      // Hidegindítás óta
+  double rideMah;       // Az aktuális (vagy legutóbbi) menet, 0 ha még nem volt
+  double nowMa;         // Pillanatnyi becsült áram
+  double averageMa;     // Hidegindítás óta, mélyalvással együtt
+  double remainingMah;
+  double runtimeH;      // Hátralévő üzemidő az átlagos árammal
+  uint32_t deepSleepS;  // Mélyalvásban töltött idő hidegindítás óta
+} EnergySummary_t;
+
+// Induláskor, a bootCount beállítása után: hidegindításkor nulláz, ébredéskor
+// az RTC-ben átadott töltéshez hozzáadja a mélyalvás idejét
+void energy_init(bool coldBoot);
+
+// Állapotváltások (bármelyik taskból)
+void energy_set_cpu_mhz(uint32_t mhz);
+void energy_set_wifi(bool on);
+// Light sleep előtt és után (idleladder)
+void energy_set_light_sleep(bool asleep);
+
+// Menet eleje és vége (ridehistory); a vége a menet mAh-ját adja, amely a
+// következő menetig az összefoglalóban marad
+void energy_ride_begin(void);
+double energy_ride_end(void);
+
+void energy_summary(EnergySummary_t *out);
+
+// Mélyalvás előtt: az ébrenlét töltése és az alvás kezdete az RTC-be
+void energy_before_deep_sleep(void);
+
+// Komponensenkénti mAh, áramok és üzemidő a soros portra
+void energy_report(void);
+
+const char *energy_component_name(EnergyComponent_t component);
+
+#endif
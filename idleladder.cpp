@@ -0,0 +1,211 @@
+#include "idleladder.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "config.h"
+#include "displaypower.h"
+#include "driver/uart.h"
+#include "energymodel.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+extern const char *TAG;
+
+#define IDLE_RTC_MAGIC 0x49444C45 // "IDLE"
+#define IDLE_MAX_WAKE_PINS 4
+
+static_assert(DISPLAY_DIM_TIMEOUT_S < DISPLAY_OFF_TIMEOUT_S &&
+                  DISPLAY_SLEEP_TIMEOUT_S < IDLE_LIGHT_SLEEP_S &&
+                  IDLE_LIGHT_SLEEP_S < INACTIVITY_TIMEOUT_S,
+              "Idle ladder thresholds must increase");
+
+// A rések felső határai: a lépcső küszöbei köré sűrítve
+static const uint32_t binLimitS[IDLE_HIST_BINS - 1] = {15, 30, 60, 120, 180, 300, 600, 1800, 3600};
+
+static const char *const stageNames[IDLE_STAGE_COUNT] = {
+    "active", "dim", "display_off", "light_sleep", "deep_sleep",
+};
+
+// Mélyalváson át megőrizve, hidegindításkor nullázva
+typedef struct {
+  uint32_t magic;
+  IdleLadderStats_t stats;
+  int64_t idleStartWallUs; // A mélyalvással végződött tétlen szakasz kezdete (0: nincs)
+} IdleCarry_t;
+
+static RTC_DATA_ATTR IdleCarry_t carry;
+
+static portMUX_TYPE idleMux = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<int64_t> lastActivityUs(0);
+static std::atomic<uint8_t> sleptStage(IDLE_STAGE_ACTIVE); // Ebben a szakaszban ténylegesen elért alvás
+
+static IdleWakePin_t wakePins[IDLE_MAX_WAKE_PINS];
+static uint8_t wakePinCount = 0;
+static IdleWakeHandler_t wakeHandler = NULL;
+
+static int64_t wall_clock_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL); // Az RTC időzítő mélyalvásban is fut
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint8_t bin_of(int64_t idleUs) {
+  uint8_t bin = 0;
+  while (bin < IDLE_HIST_BINS - 1 && idleUs >= (int64_t)binLimitS[bin] * 1000000) bin++;
+  return bin;
+}
+
+// A kijelző fokai az időből adódnak, az alvásokat csak a tényleges belépés jelzi
+static IdleStage_t display_stage(int64_t idleUs) {
+  if (idleUs >= DISPLAY_OFF_TIMEOUT_S * 1000000LL) return IDLE_STAGE_DISPLAY_OFF;
+  if (idleUs >= DISPLAY_DIM_TIMEOUT_S * 1000000LL) return IDLE_STAGE_DIM;
+  return IDLE_STAGE_ACTIVE;
+}
+
+static void record_period(int64_t idleUs, IdleStage_t deepest) {
+  if (idleUs < IDLE_RECORD_MIN_S * 1000000LL) return; // Impulzusok közti szünet, nem tétlenség
+  portENTER_CRITICAL(&idleMux);
+  carry.stats.periods[bin_of(idleUs)]++;
+  carry.stats.deepest[deepest]++;
+  portEXIT_CRITICAL(&idleMux);
+}
+
+void idle_ladder_init(bool coldBoot, const IdleWakePin_t *pins, uint8_t pinCount,
+                      IdleWakeHandler_t onWake) {
+  if (coldBoot || carry.magic != IDLE_RTC_MAGIC) {
+    memset(&carry, 0, sizeof(carry));
+    carry.magic = IDLE_RTC_MAGIC;
+  } else if (carry.idleStartWallUs != 0) {
+    record_period(wall_clock_us() - carry.idleStartWallUs, IDLE_STAGE_DEEP_SLEEP);
+  }
+  carry.idleStartWallUs = 0;
+
+  if (pinCount > IDLE_MAX_WAKE_PINS) pinCount = IDLE_MAX_WAKE_PINS;
+  memcpy(wakePins, pins, pinCount * sizeof(IdleWakePin_t));
+  wakePinCount = pinCount;
+  wakeHandler = onWake;
+  lastActivityUs.store(esp_timer_get_time(), std::memory_order_relaxed);
+
+  ESP_LOGI(TAG, "Idle ladder: dim %d s, display off %d s, panel sleep %d s, light sleep %d s, deep sleep %d s.",
+           DISPLAY_DIM_TIMEOUT_S, DISPLAY_OFF_TIMEOUT_S, DISPLAY_SLEEP_TIMEOUT_S,
+           IDLE_LIGHT_SLEEP_S, INACTIVITY_TIMEOUT_S);
+}
+
+void idle_ladder_activity(void) {
+  int64_t now = esp_timer_get_time();
+  int64_t last = lastActivityUs.exchange(now, std::memory_order_relaxed);
+  uint8_t slept = sleptStage.exchange(IDLE_STAGE_ACTIVE, std::memory_order_relaxed);
+  int64_t idleUs = now - last;
+  IdleStage_t deepest = display_stage(idleUs);
+  if (slept > deepest) deepest = (IdleStage_t)slept;
+  record_period(idleUs, deepest);
+  display_power_activity();
+}
+
+IdleStage_t idle_ladder_stage(int64_t nowUs) {
+  int64_t idleUs = nowUs - lastActivityUs.load(std::memory_order_relaxed);
+  if (idleUs >= INACTIVITY_TIMEOUT_US) return IDLE_STAGE_DEEP_SLEEP;
+  if (idleUs >= IDLE_LIGHT_SLEEP_S * 1000000LL) return IDLE_STAGE_LIGHT_SLEEP;
+  return display_stage(idleUs);
+}
+
+bool idle_ladder_light_sleep(int64_t nowUs) {
+  int64_t remainingUs = (int64_t)INACTIVITY_TIMEOUT_US - (nowUs - lastActivityUs.load(std::memory_order_relaxed));
+  if (remainingUs <= 0) return false;
+
+  // Ébresztés a jelenlegi szint ellenkezőjére: a REED előtt parkoló mágnes
+  // (zárt érintkező) nem ébreszt folyamatosan, csak az elengedése
+  int levels[IDLE_MAX_WAKE_PINS];
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    gpio_intr_disable(wakePins[i].pin);
+    levels[i] = gpio_get_level(wakePins[i].pin);
+    gpio_wakeup_enable(wakePins[i].pin, levels[i] ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)remainingUs);
+
+  fflush(stdout);
+  uart_wait_tx_idle_polling((uart_port_t)CONFIG_ESP_CONSOLE_UART_NUM);
+  energy_set_light_sleep(true);
+  int64_t sleepUs = esp_timer_get_time();
+  esp_err_t err = esp_light_sleep_start();
+  int64_t wakeUs = esp_timer_get_time();
+  energy_set_light_sleep(false);
+  esp_sleep_source_t cause = esp_sleep_get_wakeup_cause();
+
+  // A mélyalvás saját forrásokat állít be, ezek ne maradjanak élesek
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  uint32_t changed = 0;
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    gpio_wakeup_disable(wakePins[i].pin);
+    gpio_set_intr_type(wakePins[i].pin, wakePins[i].intrType);
+    if (gpio_get_level(wakePins[i].pin) != levels[i]) changed |= 1u << i;
+  }
+
+  bool byGpio = err == ESP_OK && cause == ESP_SLEEP_WAKEUP_GPIO;
+  // A kezelő pótolt impulzusa már ezt a szakaszt zárja le
+  if (err == ESP_OK) sleptStage.store(IDLE_STAGE_LIGHT_SLEEP, std::memory_order_relaxed);
+  if (byGpio && wakeHandler) wakeHandler(wakeUs, changed);
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    if (wakePins[i].intrType != GPIO_INTR_DISABLE) gpio_intr_enable(wakePins[i].pin);
+  }
+
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Light sleep rejected: %s", esp_err_to_name(err));
+    return false;
+  }
+  portENTER_CRITICAL(&idleMux);
+  carry.stats.lightSleeps++;
+  if (byGpio) carry.stats.gpioWakes++;
+  else carry.stats.timerWakes++;
+  carry.stats.lightSleepUs += wakeUs - sleepUs;
+  portEXIT_CRITICAL(&idleMux);
+  return byGpio;
+}
+
+void idle_ladder_before_deep_sleep(void) {
+  int64_t idleUs = esp_timer_get_time() - lastActivityUs.load(std::memory_order_relaxed);
+  carry.idleStartWallUs = wall_clock_us() - idleUs;
+}
+
+void idle_ladder_stats(IdleLadderStats_t *out) {
+  portENTER_CRITICAL(&idleMux);
+  *out = carry.stats;
+  portEXIT_CRITICAL(&idleMux);
+}
+
+void idle_ladder_report(void) {
+  IdleLadderStats_t s;
+  idle_ladder_stats(&s);
+  char line[160];
+  int len = 0;
+  for (uint8_t b = 0; b < IDLE_HIST_BINS && len < (int)sizeof(line); b++) {
+    if (b < IDLE_HIST_BINS - 1) {
+      len += snprintf(line + len, sizeof(line) - len, " <%lus:%lu", (unsigned long)binLimitS[b],
+                      (unsigned long)s.periods[b]);
+    } else {
+      len += snprintf(line + len, sizeof(line) - len, " more:%lu", (unsigned long)s.periods[b]);
+    }
+  }
+  ESP_LOGI(TAG, "Idle periods:%s", line);
+  ESP_LOGI(TAG, "Idle deepest stage: dim %lu, display_off %lu, light_sleep %lu, deep_sleep %lu; "
+                "light sleep %lu x (%lu pin, %lu timer), %.0f s",
+           (unsigned long)s.deepest[IDLE_STAGE_DIM], (unsigned long)s.deepest[IDLE_STAGE_DISPLAY_OFF],
+           (unsigned long)s.deepest[IDLE_STAGE_LIGHT_SLEEP], (unsigned long)s.deepest[IDLE_STAGE_DEEP_SLEEP],
+           (unsigned long)s.lightSleeps, (unsigned long)s.gpioWakes, (unsigned long)s.timerWakes,
+           s.lightSleepUs / 1e6);
+}
+
+uint32_t idle_ladder_bin_limit_s(uint8_t bin) {
+  return bin < IDLE_HIST_BINS - 1 ? binLimitS[bin] : 0;
+}
+
+const char *idle_ladder_stage_name(IdleStage_t stage) {
+  return stage < IDLE_STAGE_COUNT ? stageNames[stage] : "?";
+}
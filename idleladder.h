@@ -0,0 +1,78 @@
+// idleladder.h
+// Tétlenségi lépcső: az utolsó aktivitás (impulzus vagy gombnyomás) óta
+// eltelt idő szerint egyre mélyebb energiatakarékos állapot:
+//   halványítás -> háttérvilágítás ki / panel alvás (displaypower) ->
+//   light sleep (IDLE_LIGHT_SLEEP_S) -> mélyalvás (INACTIVITY_TIMEOUT_S).
+// A light sleep-ből a REED vagy egy gomb szintváltása újraindítás nélkül
+// ébreszt; az ébresztő REED élt a kezelő pótolja, így az impulzus nem vész
+// el (az MCPWM capture egység órája alvás alatt áll, az sem látja).
+// A tétlen szakaszok hossza és a bennük elért legmélyebb fok hisztogramba
+// kerül (RTC memória, hidegindítás óta), a küszöbök hangolásához.
+#ifndef IDLELADDER_H
+#define IDLELADDER_H
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+typedef enum {
+  IDLE_STAGE_ACTIVE,
+  IDLE_STAGE_DIM,          // DISPLAY_DIM_TIMEOUT_S
+  IDLE_STAGE_DISPLAY_OFF,  // DISPLAY_OFF_TIMEOUT_S (majd panel alvás)
+  IDLE_STAGE_LIGHT_SLEEP,  // IDLE_LIGHT_SLEEP_S
+  IDLE_STAGE_DEEP_SLEEP,   // INACTIVITY_TIMEOUT_S
+  IDLE_STAGE_COUNT
+} IdleStage_t;
+
+#define IDLE_HIST_BINS 10
+
+// Light sleep ébresztő láb és a visszaállítandó megszakítás típusa.
+// GPIO_INTR_DISABLE: csak ébreszt, a megszakítása ébredés után tiltva marad
+// (nincs hozzá kezelő, pl. MCPWM capture módban a REED).
+typedef struct {
+  gpio_num_t pin;
+  gpio_int_type_t intrType;
+} IdleWakePin_t;
+
+// Light sleep utáni kezelő, a lábak megszakításai még tiltva vannak.
+// changedPins: i. bit = pins[i] szintje az alvás alatt megváltozott.
+typedef void (*IdleWakeHandler_t)(int64_t wakeUs, uint32_t changedPins);
+
+typedef struct {
+  uint32_t periods[IDLE_HIST_BINS];       // Tétlen szakaszok hossz szerint
+  uint32_t deepest[IDLE_STAGE_COUNT];     // Szakaszok a legmélyebb elért fok szerint
+  uint32_t lightSleeps;                   // Light sleep belépések
+  uint32_t gpioWakes;                     // Ebből REED/gomb ébresztés
+  uint32_t timerWakes;                    // Ebből a mélyalvás küszöbe
+  int64_t lightSleepUs;                   // Light sleep-ben töltött idő
+} IdleLadderStats_t;
+
+// Induláskor, a GPIO-k beállítása után. Ébredéskor a mélyalvással végződött
+// tétlen szakasz a hisztogramba kerül.
+void idle_ladder_init(bool coldBoot, const IdleWakePin_t *pins, uint8_t pinCount,
+                      IdleWakeHandler_t onWake);
+
+// Aktivitás (impulzus, gombnyomás) - bármelyik taskból; a kijelzőt is ébreszti
+void idle_ladder_activity(void);
+
+// Az utolsó aktivitás óta eltelt idő alapján esedékes fok
+IdleStage_t idle_ladder_stage(int64_t nowUs);
+
+// Light sleep a mélyalvás küszöbéig vagy a következő REED/gomb szintváltásig.
+// true: lábváltás ébresztett (a kezelő lefutott), false: időzítő, a mélyalvás
+// esedékes (vagy az alvás nem indult el).
+bool idle_ladder_light_sleep(int64_t nowUs);
+
+// Mélyalvás előtt: a folyamatban lévő tétlen szakasz kezdete az RTC-be
+void idle_ladder_before_deep_sleep(void);
+
+void idle_ladder_stats(IdleLadderStats_t *out);
+
+// Tétlenségi eloszlás és light sleep számlálók a soros portra
+void idle_ladder_report(void);
+
+// A hisztogram rés felső határa másodpercben (az utolsóé 0: nincs felső határ)
+uint32_t idle_ladder_bin_limit_s(uint8_t bin);
+
+const char *idle_ladder_stage_name(IdleStage_t stage);
+
+#endif
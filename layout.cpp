@@ -0,0 +1,534 @@
+#include "layout.h"
+#include "config.h"
+#include "esp_log.h"
+#include "icons.h"
+
+extern const char *TAG;
+
+// --- Képernyő táblák ---
+// A widgetek a tábla sorrendjében rajzolódnak; ha egy widget újrarajzolódik,
+// a később következő, vele átfedő widgetek is újrarajzolódnak (pl. "HR").
+#define VALUE_RECT        2, 8, 236, 66   // Nagy érték, középpont (120, 41)
+#define UNIT_RECT_128     44, 80, 168, 42 // Mértékegység, középpont (128, 101)
+#define UNIT_RECT_140     60, 80, 160, 42 // "km ..." mértékegység, középpont (140, 101)
+#define ICON_RECT         7, 82, 48, 48
+#define HR_RECT           6, 3, 24, 16    // Középpont (18, 11)
+
+#define BIG_VALUE(metric, fmt) \
+  { WIDGET_VALUE, metric, VALUE_RECT, fmt, &FreeMonoBold12pt7b, 3, TFT_WHITE, 0.0, nullptr, 0, 0, 0 }
+#define UNIT(rect, label, size) \
+  { WIDGET_UNIT, METRIC_NONE, rect, label, &FreeSerif9pt7b, size, TFT_WHITE, 0.0, nullptr, 0, 0, 0 }
+#define ICON(bmp) \
+  { WIDGET_ICON, METRIC_NONE, ICON_RECT, nullptr, nullptr, 0, TFT_WHITE, 0.0, bmp, bmp##Width, bmp##Height, 0 }
+#define HR_LABEL \
+  { WIDGET_UNIT, METRIC_NONE, HR_RECT, "HR", nullptr, 2, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 }
+
+static const Widget_t speedWidgets[] = {
+  BIG_VALUE(METRIC_SPEED, "%.1f"),
+  UNIT(UNIT_RECT_128, "km/h", 3),
+  ICON(iconSpeed),
+  { WIDGET_BAR, METRIC_SPEED, 60, 124, 116, 6, nullptr, nullptr, 0, TFT_WHITE, 40.0, nullptr, 0, 0, 0 },
+  { WIDGET_VALUE, METRIC_DAILY_DISTANCE, 184, 84, 52, 16, "%.1f", nullptr, 2, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_UNIT, METRIC_NONE, 184, 102, 52, 10, "km day", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  HR_LABEL,
+};
+
+static const Widget_t dailyWidgets[] = {
+  BIG_VALUE(METRIC_DAILY_DISTANCE, "%.2f"),
+  UNIT(UNIT_RECT_140, "km day", 3),
+  ICON(iconDistance),
+  HR_LABEL,
+};
+
+static const Widget_t totalWidgets[] = {
+  BIG_VALUE(METRIC_TOTAL_DISTANCE, "%.1f"),
+  UNIT(UNIT_RECT_140, "km all", 3),
+  ICON(iconDistance),
+  HR_LABEL,
+};
+
+static const Widget_t maxSpeedWidgets[] = {
+  BIG_VALUE(METRIC_MAX_SPEED, "%.1f"),
+  UNIT(UNIT_RECT_128, "km/h max", 3),
+  HR_LABEL,
+};
+
+static const Widget_t avgSpeedWidgets[] = {
+  BIG_VALUE(METRIC_AVERAGE_SPEED, "%.1f"),
+  { WIDGET_UNIT, METRIC_NONE, 72, 80, 112, 42, "km/h avg", &FreeSerif9pt7b, 2, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_SPARKLINE, METRIC_SPEED, 6, 84, 64, 44, nullptr, nullptr, 0, TFT_WHITE, 40.0, nullptr, 0, 0, 0 },
+  { WIDGET_VALUE, METRIC_POWER, 184, 84, 52, 16, "%.0f", nullptr, 2, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_UNIT, METRIC_NONE, 184, 102, 52, 10, "W est", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_VALUE, METRIC_ACCELERATION, 184, 114, 52, 12, "%+.1f m/s2", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  HR_LABEL,
+};
+
+static const Widget_t movementTimeWidgets[] = {
+  BIG_VALUE(METRIC_MOVING_TIME, nullptr), // Formátum: óó:pp
+  UNIT(UNIT_RECT_128, "fut.ido", 3),
+  HR_LABEL,
+};
+
+#define HISTORY_COLUMN(x, metric, fmt, label) \
+  { WIDGET_VALUE, metric, x, 84, 76, 20, fmt, nullptr, 2, TFT_WHITE, 0.0, nullptr, 0, 0, 0 }, \
+  { WIDGET_UNIT, METRIC_NONE, x, 106, 76, 12, label, nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 }
+
+static const Widget_t rideHistoryWidgets[] = {
+  { WIDGET_VALUE, METRIC_LAST_RIDE_KM, 2, 8, 236, 58, "%.1f", &FreeMonoBold12pt7b, 3, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_UNIT, METRIC_NONE, 2, 66, 236, 12, "km last ride", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  HISTORY_COLUMN(4, METRIC_WEEK_KM, "%.1f", "km week"),
+  HISTORY_COLUMN(82, METRIC_MONTH_KM, "%.1f", "km month"),
+  HISTORY_COLUMN(160, METRIC_RIDE_COUNT, "%.0f", "rides"),
+  HR_LABEL,
+};
+
+static const Widget_t energyWidgets[] = {
+  { WIDGET_VALUE, METRIC_RIDE_MAH, 2, 8, 236, 58, "%.1f", &FreeMonoBold12pt7b, 3, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_UNIT, METRIC_NONE, 2, 66, 236, 12, "mAh ride", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  HISTORY_COLUMN(4, METRIC_USED_MAH, "%.0f", "mAh used"),
+  HISTORY_COLUMN(82, METRIC_AVERAGE_MA, "%.1f", "mA avg"),
+  HISTORY_COLUMN(160, METRIC_RUNTIME_H, "%.0f", "h left"),
+  HR_LABEL,
+};
+
+// Három egymás alatti görbe, balra a felbontás felirata
+#define GRAPH_ROW(y, level, label) \
+  { WIDGET_UNIT, METRIC_NONE, 4, y, 30, 34, label, nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 }, \
+  { WIDGET_HISTORY, METRIC_SPEED, 34, y, 202, 34, nullptr, nullptr, 0, TFT_WHITE, 50.0, nullptr, 0, 0, level }
+
+static const Widget_t speedGraphWidgets[] = {
+  HR_LABEL,
+  { WIDGET_VALUE, METRIC_SPEED, 130, 3, 60, 18, "%.1f", nullptr, 2, TFT_WHITE, 0.0, nullptr, 0, 0, 0 },
+  { WIDGET_UNIT, METRIC_NONE, 192, 3, 44, 18, "km/h", nullptr, 1, TFT_LIGHTGREY, 0.0, nullptr, 0, 0, 0 },
+  GRAPH_ROW(24, 0, "1s"),
+  GRAPH_ROW(61, 1, "10s"),
+  GRAPH_ROW(98, 2, "1min"),
+};
+
+// A LAYOUT_MAX_WIDGETS-nél hosszabb tábla fordítási hiba, nem csonkul csendben
+template <size_t N>
+static constexpr Screen_t screen_of(const Widget_t (&widgets)[N]) {
+  static_assert(N <= LAYOUT_MAX_WIDGETS, "Screen widget table exceeds LAYOUT_MAX_WIDGETS");
+  return { widgets, (uint8_t)N };
+}
+#define SCREEN(w) screen_of(w)
+
+constexpr Screen_t screens[DISPLAY_STATE_COUNT] = {
+  SCREEN(speedWidgets),        // DISPLAY_SPEED
+  SCREEN(dailyWidgets),        // DISPLAY_DAILY_DISTANCE
+  SCREEN(totalWidgets),        // DISPLAY_TOTAL_DISTANCE
+  SCREEN(maxSpeedWidgets),     // DISPLAY_MAX_SPEED
+  SCREEN(avgSpeedWidgets),     // DISPLAY_AVERAGE_SPEED
+  SCREEN(movementTimeWidgets), // DISPLAY_MOVEMENT_TIME
+  SCREEN(rideHistoryWidgets),  // DISPLAY_RIDE_HISTORY
+  SCREEN(speedGraphWidgets),   // DISPLAY_SPEED_GRAPH
+  SCREEN(energyWidgets),       // DISPLAY_ENERGY
+};
+
+// Új állapotnál a hiányzó tábla üres képernyő lenne: ez is fordítási hiba
+static constexpr bool every_state_has_screen(void) {
+  for (int s = 0; s < DISPLAY_STATE_COUNT; s++) {
+    if (screens[s].widgets == nullptr || screens[s].count == 0) return false;
+  }
+  return true;
+}
+static_assert(every_state_has_screen(), "A DisplayState_t value has no screen table");
+
+// --- Színmélység és paletta ---
+// 4 bites módban a rajzoló függvények színe paletta index, a kiküldéskor
+// a TFT_eSPI a palettával bontja ki 16 bitesre.
+static const uint16_t palette[16] = {
+  LAYOUT_BG_COLOR, TFT_WHITE, TFT_LIGHTGREY, TFT_BLACK,
+  TFT_DARKGREY, TFT_RED, TFT_GREEN, TFT_YELLOW,
+  TFT_ORANGE, TFT_CYAN, TFT_MAGENTA, TFT_NAVY,
+  TFT_DARKGREEN, TFT_MAROON, TFT_PURPLE, TFT_OLIVE,
+};
+static uint8_t spriteDepth = 16;
+
+uint16_t layout_color(uint16_t rgb565) {
+  if (spriteDepth != 4) return rgb565; // 8 bitnél a TFT_eSPI maga konvertál
+  for (uint16_t i = 0; i < 16; i++) {
+    if (palette[i] == rgb565) return i;
+  }
+  ESP_LOGW(TAG, "Color 0x%04X not in palette, using index 1.", rgb565);
+  return 1;
+}
+
+size_t layout_create_sprite(int16_t width, int16_t height) {
+  // Ha a kért mélységhez nincs elég összefüggő heap, kisebbel próbálkozunk
+  static const uint8_t depths[] = {16, 8, 4};
+  for (uint8_t depth : depths) {
+    if (depth > SPRITE_COLOR_DEPTH) continue;
+    sprite.setColorDepth(depth);
+    if (sprite.createSprite(width, height) != nullptr) {
+      spriteDepth = depth;
+      if (depth == 4) sprite.createPalette(palette, 16);
+      size_t bytes = (size_t)width * height * depth / 8;
+      ESP_LOGI(TAG, "Sprite %dx%d @ %d bpp: %u bytes.", width, height, depth, (unsigned)bytes);
+      return bytes;
+    }
+    ESP_LOGW(TAG, "Sprite allocation failed at %d bpp.", depth);
+  }
+  return 0;
+}
+
+uint8_t layout_color_depth(void) { return spriteDepth; }
+
+// --- Widget állapot (az utoljára kirajzolt reprezentáció) ---
+typedef struct {
+  bool valid;
+  char lastText[16];  // VALUE: utoljára kirajzolt szöveg
+  int16_t lastPx;     // BAR: utoljára kirajzolt kitöltés pixelben
+  uint32_t lastSeq;   // SPARKLINE: utoljára kirajzolt minta sorszáma
+} WidgetState_t;
+
+static WidgetState_t widgetState[DISPLAY_STATE_COUNT][LAYOUT_MAX_WIDGETS];
+static DisplayState_t lastRenderedState = DISPLAY_STATE_COUNT;
+
+// --- Görbe minták ---
+#define SPARKLINE_MAX_SERIES 2
+
+typedef struct {
+  Metric_t metric;
+  float points[SPARKLINE_MAX_POINTS];
+  uint8_t head;   // Következő írási pozíció
+  uint8_t count;
+  uint32_t seq;   // Minden új mintánál nő
+} SparkSeries_t;
+
+static SparkSeries_t sparkSeries[SPARKLINE_MAX_SERIES];
+static bool sparkSeriesInitialized = false;
+static int64_t lastSparkSampleUs = 0;
+
+static SparkSeries_t *find_series(Metric_t metric) {
+  for (int i = 0; i < SPARKLINE_MAX_SERIES; i++) {
+    if (sparkSeries[i].metric == metric) return &sparkSeries[i];
+  }
+  return nullptr;
+}
+
+// A táblákban szereplő görbe widgetek metrikáihoz sorozatot rendelünk
+static void init_spark_series(void) {
+  for (int i = 0; i < SPARKLINE_MAX_SERIES; i++) sparkSeries[i].metric = METRIC_NONE;
+  for (int s = 0; s < DISPLAY_STATE_COUNT; s++) {
+    for (int i = 0; i < screens[s].count; i++) {
+      const Widget_t *w = &screens[s].widgets[i];
+      if (w->type != WIDGET_SPARKLINE || find_series(w->metric)) continue;
+      SparkSeries_t *free_slot = find_series(METRIC_NONE);
+      if (free_slot == nullptr) {
+        ESP_LOGW(TAG, "No free sparkline series for metric %d", w->metric);
+        continue;
+      }
+      free_slot->metric = w->metric;
+    }
+  }
+  sparkSeriesInitialized = true;
+}
+
+double layout_metric_value(Metric_t metric, const MetricSnapshot_t *snap) {
+  switch (metric) {
+  case METRIC_SPEED:          return snap->sensor.speedKmh;
+  case METRIC_DAILY_DISTANCE: return snap->sensor.dailyDistanceKm;
+  case METRIC_TOTAL_DISTANCE: return snap->sensor.totalDistanceKm;
+  case METRIC_MAX_SPEED:      return snap->maxSpeedKmh;
+  case METRIC_AVERAGE_SPEED:  return snap->averageSpeedKmh;
+  case METRIC_MOVING_TIME:    return (double)snap->sensor.movingTimeSeconds;
+  case METRIC_ACCELERATION:   return snap->sensor.accelerationMps2;
+  case METRIC_POWER:          return snap->sensor.powerW;
+  case METRIC_LAST_RIDE_KM:   return snap->rides.lastKm;
+  case METRIC_WEEK_KM:        return snap->rides.weekKm;
+  case METRIC_MONTH_KM:       return snap->rides.monthKm;
+  case METRIC_RIDE_COUNT:     return (double)snap->rides.rides;
+  case METRIC_RIDE_MAH:       return snap->energy.rideMah;
+  case METRIC_USED_MAH:       return snap->energy.totalMah;
+  case METRIC_AVERAGE_MA:     return snap->energy.averageMa;
+  case METRIC_RUNTIME_H:      return snap->energy.runtimeH;
+  default:                    return 0.0;
+  }
+}
+
+void layout_sample(const MetricSnapshot_t *snap, int64_t nowUs) {
+  if (!sparkSeriesInitialized) init_spark_series();
+  if (lastSparkSampleUs != 0 && (nowUs - lastSparkSampleUs) < (int64_t)SPARKLINE_SAMPLE_MS * 1000) {
+    return;
+  }
+  lastSparkSampleUs = nowUs;
+
+  for (int i = 0; i < SPARKLINE_MAX_SERIES; i++) {
+    SparkSeries_t *s = &sparkSeries[i];
+    if (s->metric == METRIC_NONE) continue;
+    s->points[s->head] = (float)layout_metric_value(s->metric, snap);
+    s->head = (s->head + 1) % SPARKLINE_MAX_POINTS;
+    if (s->count < SPARKLINE_MAX_POINTS) s->count++;
+    s->seq++;
+  }
+}
+
+static void format_value(const Widget_t *w, const MetricSnapshot_t *snap, char *buf, size_t len) {
+  double value = layout_metric_value(w->metric, snap);
+  if (w->metric == METRIC_MOVING_TIME) {
+    // Mozgási idő óó:pp formátumban
+    uint32_t seconds = (uint32_t)value;
+    snprintf(buf, len, "%02lu:%02lu", (unsigned long)(seconds / 3600),
+             (unsigned long)((seconds % 3600) / 60));
+  } else {
+    snprintf(buf, len, w->text ? w->text : "%.1f", value);
+  }
+}
+
+static int16_t bar_fill_px(const Widget_t *w, double value) {
+  int16_t inner = w->w - 2;
+  if (w->scale <= 0.0 || value <= 0.0) return 0;
+  if (value >= w->scale) return inner;
+  return (int16_t)(value / w->scale * inner);
+}
+
+static void draw_text(const Widget_t *w, const char *text) {
+  // A viewport levágja a téglalapon kívül eső részeket, a koordináták relatívak
+  sprite.setViewport(w->x, w->y, w->w, w->h);
+  sprite.fillRect(0, 0, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+  sprite.setFreeFont(w->font);
+  sprite.setTextSize(w->textSize);
+  sprite.setTextColor(layout_color(w->fgColor), layout_color(LAYOUT_BG_COLOR));
+  sprite.setTextDatum(MC_DATUM);
+  sprite.drawString(text, w->w / 2, w->h / 2);
+  sprite.resetViewport();
+}
+
+// --- Idősor görbe ---
+#define HISTORY_CHUNK 32 // Egyszerre ennyi pont másolódik ki a mutex alatt
+
+static int16_t history_y(const Widget_t *w, float v) {
+  if (v < 0.0f) v = 0.0f;
+  if (v > (float)w->scale) v = (float)w->scale;
+  return w->y + w->h - 1 - (int16_t)(v / (float)w->scale * (w->h - 1));
+}
+
+// Legfeljebb HISTORY_CHUNK pont a "from" sorszámtól a mutex alatt; 0, ha a
+// mutex nem volt megszerezhető. *first = az első kiolvasott pont sorszáma.
+static uint16_t read_history(const Widget_t *w, uint32_t from, uint32_t to,
+                             TimeSeriesPoint_t *chunk, uint32_t *first) {
+  uint16_t want = (to - from) < HISTORY_CHUNK ? (uint16_t)(to - from) : HISTORY_CHUNK;
+  uint16_t n = 0;
+  *first = from;
+  if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+    n = timeseries_read(&speedHistory, w->level, from, chunk, want, first);
+    xSemaphoreGive(xDataMutex);
+  }
+  return n;
+}
+
+// n pont a "col" oszloptól jobbra
+static void draw_history_points(const Widget_t *w, const TimeSeriesPoint_t *chunk, uint16_t n,
+                                int16_t col) {
+  uint16_t band = layout_color(TFT_DARKGREY);
+  uint16_t line = layout_color(w->fgColor);
+  for (uint16_t i = 0; i < n; i++, col++) {
+    int16_t x = w->x + col;
+    int16_t yMax = history_y(w, chunk[i].max);
+    int16_t yMin = history_y(w, chunk[i].min);
+    if (yMin > yMax) sprite.drawFastVLine(x, yMax, yMin - yMax + 1, band);
+    sprite.drawPixel(x, history_y(w, chunk[i].mean), line);
+  }
+}
+
+// Az idősor "from" sorszámtól kezdődő pontjai a "col" oszloptól jobbra;
+// false, ha egy darab olvasása elmaradt (a görbe hiányos)
+static bool draw_history_columns(const Widget_t *w, uint32_t from, uint32_t to, int16_t col) {
+  TimeSeriesPoint_t chunk[HISTORY_CHUNK];
+  while (from < to) {
+    uint32_t first;
+    uint16_t n = read_history(w, from, to, chunk, &first);
+    if (n == 0) return false;
+    col += (int16_t)(first - from); // A gyűrűből már kiesett pontok helye üres marad
+    draw_history_points(w, chunk, n, col);
+    col += n;
+    from = first + n;
+  }
+  return true;
+}
+
+// false, ha a teljes újrarajzolás hiányos maradt: a widget érvénytelen marad,
+// a következő képkocka újra megpróbálja
+static bool draw_history(const Widget_t *w, WidgetState_t *st) {
+  uint32_t seq = timeseries_seq(&speedHistory, w->level);
+  uint32_t added = seq - st->lastSeq;
+
+  if (st->valid && added > 0 && added <= HISTORY_CHUNK && added < (uint32_t)w->w) {
+    // Csak az új oszlopok (egy darabnyi; hosszabb kimaradás után teljes
+    // újrarajzolás). Előbb az adat: ha nincs meg, a görbe és lastSeq
+    // változatlan, és a következő képkocka újra próbálja.
+    TimeSeriesPoint_t chunk[HISTORY_CHUNK];
+    uint32_t first;
+    uint16_t n = read_history(w, st->lastSeq, seq, chunk, &first);
+    if (n == 0) return true;
+    // A meglévő görbe balra léptetése, jobb szélen az új pontok
+    uint32_t end = first + n;
+    sprite.setScrollRect(w->x, w->y, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+    sprite.scroll(-(int16_t)(end - st->lastSeq), 0);
+    draw_history_points(w, chunk, n, w->w - (int16_t)n);
+    st->lastSeq = end;
+    return true;
+  }
+  sprite.fillRect(w->x, w->y, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+  uint32_t from = seq > (uint32_t)w->w ? seq - w->w : 0;
+  if (!draw_history_columns(w, from, seq, w->w - (int16_t)(seq - from))) return false;
+  st->lastSeq = seq;
+  return true;
+}
+
+static void draw_widget(const Widget_t *w, WidgetState_t *st, const MetricSnapshot_t *snap) {
+  switch (w->type) {
+  case WIDGET_VALUE: {
+    char text[sizeof(st->lastText)];
+    format_value(w, snap, text, sizeof(text));
+    draw_text(w, text);
+    strncpy(st->lastText, text, sizeof(st->lastText));
+    break;
+  }
+  case WIDGET_UNIT:
+    draw_text(w, w->text);
+    break;
+  case WIDGET_ICON:
+    sprite.fillRect(w->x, w->y, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+    draw1bitBitmap(w->x, w->y, w->bitmap, w->bmpW, w->bmpH, layout_color(w->fgColor),
+                   layout_color(LAYOUT_BG_COLOR));
+    break;
+  case WIDGET_BAR: {
+    int16_t px = bar_fill_px(w, layout_metric_value(w->metric, snap));
+    sprite.fillRect(w->x, w->y, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+    sprite.drawRect(w->x, w->y, w->w, w->h, layout_color(w->fgColor));
+    if (px > 0) sprite.fillRect(w->x + 1, w->y + 1, px, w->h - 2, layout_color(w->fgColor));
+    st->lastPx = px;
+    break;
+  }
+  case WIDGET_SPARKLINE: {
+    sprite.fillRect(w->x, w->y, w->w, w->h, layout_color(LAYOUT_BG_COLOR));
+    const SparkSeries_t *s = find_series(w->metric);
+    if (s == nullptr) break;
+    int n = s->count < w->w ? s->count : w->w;
+    if (n > SPARKLINE_MAX_POINTS) n = SPARKLINE_MAX_POINTS;
+    int prevX = 0, prevY = 0;
+    uint16_t color = layout_color(w->fgColor);
+    for (int i = 0; i < n; i++) {
+      // A legrégebbi megjelenítendő mintától a legújabbig, jobbra igazítva
+      int idx = (s->head + SPARKLINE_MAX_POINTS - n + i) % SPARKLINE_MAX_POINTS;
+      float v = s->points[idx];
+      if (v < 0.0f) v = 0.0f;
+      if (v > (float)w->scale) v = (float)w->scale;
+      int px = w->x + w->w - n + i;
+      int py = w->y + w->h - 1 - (int)(v / (float)w->scale * (w->h - 1));
+      if (i > 0) sprite.drawLine(prevX, prevY, px, py, color);
+      else sprite.drawPixel(px, py, color);
+      prevX = px;
+      prevY = py;
+    }
+    st->lastSeq = s->seq;
+    break;
+  }
+  case WIDGET_HISTORY:
+    if (!draw_history(w, st)) {
+      st->valid = false;
+      return;
+    }
+    break;
+  }
+  st->valid = true;
+}
+
+// Változott-e a widget megjelenített reprezentációja az utolsó rajzolás óta
+static bool widget_dirty(const Widget_t *w, const WidgetState_t *st, const MetricSnapshot_t *snap) {
+  if (!st->valid) return true;
+  switch (w->type) {
+  case WIDGET_VALUE: {
+    char text[sizeof(st->lastText)];
+    format_value(w, snap, text, sizeof(text));
+    return strncmp(text, st->lastText, sizeof(st->lastText)) != 0;
+  }
+  case WIDGET_BAR:
+    return bar_fill_px(w, layout_metric_value(w->metric, snap)) != st->lastPx;
+  case WIDGET_SPARKLINE: {
+    const SparkSeries_t *s = find_series(w->metric);
+    return s != nullptr && s->seq != st->lastSeq;
+  }
+  case WIDGET_HISTORY:
+    return timeseries_seq(&speedHistory, w->level) != st->lastSeq;
+  default:
+    return false; // Statikus widgetek csak teljes újrarajzoláskor
+  }
+}
+
+static bool rects_overlap(const Widget_t *a, const Widget_t *b) {
+  return a->x < b->x + b->w && b->x < a->x + a->w &&
+         a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+// Az aktuális impulzusból számolt értéket mutató widget (a görbék mintavételezett
+// múltat rajzolnak, azok nem számítanak)
+static bool shows_pulse_metric(const Widget_t *w) {
+  if (w->type != WIDGET_VALUE && w->type != WIDGET_BAR) return false;
+  switch (w->metric) {
+  case METRIC_SPEED:
+  case METRIC_DAILY_DISTANCE:
+  case METRIC_TOTAL_DISTANCE:
+  case METRIC_AVERAGE_SPEED:
+    return true;
+  default:
+    return false;
+  }
+}
+
+int layout_render(DisplayState_t state, const MetricSnapshot_t *snap, bool force,
+                  bool *pulseDrawn) {
+  bool pulse = false;
+  if (pulseDrawn) *pulseDrawn = false;
+  if (state >= DISPLAY_STATE_COUNT) return 0;
+  const Screen_t *screen = &screens[state];
+  WidgetState_t *states = widgetState[state];
+  int count = screen->count; // screen_of() garantálja: legfeljebb LAYOUT_MAX_WIDGETS
+
+  if (force || state != lastRenderedState) {
+    sprite.fillSprite(layout_color(LAYOUT_BG_COLOR));
+    sprite.drawRect(0, 0, sprite.width(), sprite.height(), layout_color(LAYOUT_BORDER_COLOR));
+    for (int i = 0; i < count; i++) {
+      states[i].valid = false; // A képernyő törlődött, nincs mire inkrementálisan rajzolni
+      draw_widget(&screen->widgets[i], &states[i], snap);
+      pulse = pulse || shows_pulse_metric(&screen->widgets[i]);
+    }
+    sprite.pushSprite(0, 0);
+    lastRenderedState = state;
+    if (pulseDrawn) *pulseDrawn = pulse;
+    return count;
+  }
+
+  bool redraw[LAYOUT_MAX_WIDGETS] = {false};
+  int redrawn = 0;
+  for (int i = 0; i < count; i++) {
+    const Widget_t *w = &screen->widgets[i];
+    if (!redraw[i] && !widget_dirty(w, &states[i], snap)) continue;
+    redraw[i] = true;
+    // Átfedő, később rajzolt widgetek is újrarajzolódnak, hogy a rétegzés megmaradjon
+    for (int j = i + 1; j < count; j++) {
+      if (rects_overlap(w, &screen->widgets[j])) redraw[j] = true;
+    }
+    draw_widget(w, &states[i], snap);
+    pulse = pulse || shows_pulse_metric(w);
+    redrawn++;
+  }
+
+  // Csak a megváltozott widgetek területe kerül ki a kijelzőre
+  for (int i = 0; i < count; i++) {
+    if (!redraw[i]) continue;
+    const Widget_t *w = &screen->widgets[i];
+    int16_t x = w->x, width = w->w;
+    if (spriteDepth == 4) {
+      // 4 bites sprite-nál páros x és szélesség: bájthatáros, gyors kiküldés
+      width += x & 1;
+      x &= ~1;
+      width = (width + 1) & ~1;
+    }
+    sprite.pushSprite(x, w->y, x, w->y, width, w->h);
+  }
+  if (pulseDrawn) *pulseDrawn = pulse;
+  return redrawn;
+}
@@ -0,0 +1,104 @@
+// layout.h
+// Retained-mode képernyő elrendezés: a képernyők widget-táblákként vannak
+// deklarálva, minden widget egy metrikához kötött, és csak az a widget
+// rajzolódik újra (és kerül ki a kijelzőre), amelynek a megjelenített
+// értéke megváltozott.
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include "displaytft.h"
+#include "ridehistory.h"
+#include "energymodel.h"
+
+// A widgetekhez köthető metrikák
+typedef enum {
+  METRIC_NONE,           // Statikus widget (felirat, ikon)
+  METRIC_SPEED,
+  METRIC_DAILY_DISTANCE,
+  METRIC_TOTAL_DISTANCE,
+  METRIC_MAX_SPEED,
+  METRIC_AVERAGE_SPEED,
+  METRIC_MOVING_TIME,
+  METRIC_ACCELERATION,
+  METRIC_POWER,
+  METRIC_LAST_RIDE_KM,
+  METRIC_WEEK_KM,
+  METRIC_MONTH_KM,
+  METRIC_RIDE_COUNT,
+  METRIC_RIDE_MAH,        // Energia becslés (energymodel)
+  METRIC_USED_MAH,
+  METRIC_AVERAGE_MA,
+  METRIC_RUNTIME_H,
+  METRIC_COUNT
+} Metric_t;
+
+typedef enum {
+  WIDGET_VALUE,     // Formázott számérték
+  WIDGET_UNIT,      // Mértékegység / felirat (statikus szöveg)
+  WIDGET_ICON,      // 1 bites bitmap
+  WIDGET_BAR,       // Vízszintes sáv: érték / skála
+  WIDGET_SPARKLINE, // A kötött metrika utolsó mintái görbeként
+  WIDGET_HISTORY    // Sebesség idősor (speedHistory) egy szintje: min-max sáv és átlag
+} WidgetType_t;
+
+typedef struct {
+  WidgetType_t type;
+  Metric_t metric;
+  int16_t x, y, w, h;        // Befoglaló téglalap sprite koordinátákban
+  const char *text;          // VALUE: printf formátum, UNIT: felirat
+  const GFXfont *font;       // nullptr = beépített font
+  uint8_t textSize;
+  uint16_t fgColor;
+  double scale;              // BAR / SPARKLINE teljes skála
+  const uint8_t *bitmap;     // ICON
+  uint16_t bmpW, bmpH;
+  uint8_t level;             // HISTORY: idősor szint (0: 1 s, 1: 10 s, 2: 1 perc)
+} Widget_t;
+
+typedef struct {
+  const Widget_t *widgets;
+  uint8_t count;
+} Screen_t;
+
+// Egy képernyő-frissítéshez szükséges összes adat egy pillanatképben
+typedef struct {
+  SensorData_t sensor;
+  double maxSpeedKmh;
+  double averageSpeedKmh;
+  RideSummary_t rides;
+  EnergySummary_t energy;
+} MetricSnapshot_t;
+
+#define LAYOUT_BG_COLOR      TFT_BLUE
+#define LAYOUT_BORDER_COLOR  TFT_WHITE
+#define LAYOUT_MAX_WIDGETS   10    // Widgetek max. száma képernyőnként
+#define SPARKLINE_MAX_POINTS 64    // Görbe mintáinak száma (max. szélesség pixelben)
+#define SPARKLINE_SAMPLE_MS  1000  // Görbe mintavételi periódusa
+
+// Az állapotokhoz tartozó képernyő-táblák
+extern const Screen_t screens[DISPLAY_STATE_COUNT];
+
+// Sprite létrehozása SPRITE_COLOR_DEPTH mélységgel (sikertelen foglalásnál
+// kisebbel); visszatér a sprite puffer méretével, 0 ha nem sikerült
+size_t layout_create_sprite(int16_t width, int16_t height);
+uint8_t layout_color_depth(void);
+
+// RGB565 szín átalakítása a sprite mélységéhez (4 bitnél paletta index)
+uint16_t layout_color(uint16_t rgb565);
+
+// Metrika értéke a pillanatképből
+double layout_metric_value(Metric_t metric, const MetricSnapshot_t *snap);
+
+// Görbe mintavétel (a GUI ciklusból hívva, belül SPARKLINE_SAMPLE_MS-re ritkít)
+void layout_sample(const MetricSnapshot_t *snap, int64_t nowUs);
+
+// Képernyő kirajzolása. Állapotváltáskor (vagy force esetén) a teljes
+// képernyőt újrarajzolja és kiküldi, egyébként csak a megváltozott widgeteket.
+// Visszatérési érték: az újrarajzolt widgetek száma. *pulseDrawn (ha nem
+// nullptr): kirajzolódott-e impulzusból számolt érték (sebesség, táv,
+// átlagsebesség) - a késleltetés mérés csak ezt számolja.
+int layout_render(DisplayState_t state, const MetricSnapshot_t *snap, bool force,
+                  bool *pulseDrawn);
+
+#endif
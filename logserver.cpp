@@ -0,0 +1,218 @@
+#include "logserver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include "config.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rideexport.h"
+#include "ridelog.h"
+#include "taskplacement.h"
+#include "wheelprofile.h"
+
+extern const char *TAG;
+
+static WebServer *server = NULL;
+// Egyszerre egy kérés fut: az export állapota és puffere nem a task stackjén van
+static RideExport_t exporter;
+static uint8_t exportChunk[LOG_SERVER_CHUNK_BYTES];
+
+int log_server_parse_range(const char *header, uint32_t total, uint32_t *start, uint32_t *end) {
+  if (header == NULL || strncmp(header, "bytes=", 6) != 0) return 0;
+  const char *spec = header + 6;
+  if (strchr(spec, ',') != NULL) return 0; // Több tartományt nem szolgálunk ki: teljes válasz
+
+  char *rest = NULL;
+  if (*spec == '-') {
+    // Utolsó N bájt
+    unsigned long suffix = strtoul(spec + 1, &rest, 10);
+    if (rest == spec + 1 || suffix == 0 || total == 0) return -1;
+    *start = suffix >= total ? 0 : total - (uint32_t)suffix;
+    *end = total - 1;
+    return 1;
+  }
+
+  unsigned long first = strtoul(spec, &rest, 10);
+  if (rest == spec || *rest != '-') return 0;
+  if (first >= total) return -1;
+  const char *lastStr = rest + 1;
+  unsigned long last = total - 1;
+  if (*lastStr != '\0') {
+    last = strtoul(lastStr, &rest, 10);
+    if (rest == lastStr) return 0;
+    if (last < first) return -1;
+    if (last >= total) last = total - 1;
+  }
+  *start = (uint32_t)first;
+  *end = (uint32_t)last;
+  return 1;
+}
+
+static void handle_list(void) {
+  uint32_t count = ride_log_count();
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send(200, "application/json", "");
+  server->sendContent("[");
+  char line[128];
+  for (uint32_t n = 0; n < count; n++) {
+    RideLogInfo_t info;
+    if (!ride_log_info(n, &info)) break;
+    int len = snprintf(line, sizeof(line), "%s{\"id\":%lu,\"seq\":%lu,\"epoch\":%lu,\"bytes\":%lu}",
+                       n ? "," : "", (unsigned long)n, (unsigned long)info.logSeq,
+                       (unsigned long)info.startEpoch, (unsigned long)info.totalBytes);
+    server->sendContent(line, len);
+  }
+  server->sendContent("]\n");
+  server->sendContent(""); // Chunked válasz vége
+}
+
+static void send_log(uint32_t id, const RideLogInfo_t &info) {
+  uint32_t start = 0, end = info.totalBytes - 1;
+  char value[64];
+  int range = log_server_parse_range(server->header("Range").c_str(), info.totalBytes, &start, &end);
+  if (range < 0) {
+    snprintf(value, sizeof(value), "bytes */%lu", (unsigned long)info.totalBytes);
+    server->sendHeader("Content-Range", value);
+    server->send(416, "text/plain", "");
+    return;
+  }
+
+  uint32_t length = end - start + 1;
+  server->sendHeader("Accept-Ranges", "bytes");
+  snprintf(value, sizeof(value), "attachment; filename=\"ride%05lu.bin\"", (unsigned long)info.logSeq);
+  server->sendHeader("Content-Disposition", value);
+  if (range > 0) {
+    snprintf(value, sizeof(value), "bytes %lu-%lu/%lu", (unsigned long)start, (unsigned long)end,
+             (unsigned long)info.totalBytes);
+    server->sendHeader("Content-Range", value);
+  }
+  server->setContentLength(length);
+  server->send(range > 0 ? 206 : 200, "application/octet-stream", "");
+  if (server->method() == HTTP_HEAD) return;
+
+  // Közvetlenül a leképezett flash-ből; a socket puffer telítődésekor a write blokkol
+  WiFiClient client = server->client();
+  const uint8_t *p = info.data + start;
+  uint32_t remaining = length;
+  while (remaining > 0 && client.connected()) {
+    uint32_t chunk = remaining < LOG_SERVER_CHUNK_BYTES ? remaining : LOG_SERVER_CHUNK_BYTES;
+    size_t written = client.write(p, chunk);
+    if (written == 0) break;
+    p += written;
+    remaining -= written;
+  }
+  ESP_LOGI(TAG, "Log %lu sent: %lu of %lu bytes from offset %lu.", (unsigned long)id,
+           (unsigned long)(length - remaining), (unsigned long)length, (unsigned long)start);
+}
+
+// A hely a küldés végéig rögzítve: egy közben induló menet nem írhatja felül
+static void handle_log(uint32_t id) {
+  RideLogInfo_t info;
+  if (!ride_log_pin(id, &info)) {
+    server->send(404, "text/plain", "No such log\n");
+    return;
+  }
+  send_log(id, info);
+  ride_log_unpin(&info);
+}
+
+// FIT/GPX menet közben generálva, darabonként a socketre
+static void send_export(uint32_t id, const RideLogInfo_t &info, RideExportFormat_t format) {
+  const WheelCalib_t calib = wheel_calib();
+  RideExportSource_t source = {};
+  source.log = info.data;
+  source.logBytes = info.totalBytes;
+  source.circumferenceM = calib.circumferenceM; // Csak a kerék nélküli régebbi naplókhoz
+  source.pulsesPerRev = calib.pulsesPerRev;
+  // GPS fixeket még nem tárolunk, ezért GPX nem készíthető
+  if (!ride_export_init(&exporter, format, &source)) {
+    server->send(404, "text/plain", format == RIDE_EXPORT_GPX ? "No GPS fixes for this log\n" : "Log not exportable\n");
+    return;
+  }
+
+  char value[64];
+  bool fit = format == RIDE_EXPORT_FIT;
+  snprintf(value, sizeof(value), "attachment; filename=\"ride%05lu.%s\"", (unsigned long)info.logSeq,
+           fit ? "fit" : "gpx");
+  server->sendHeader("Content-Disposition", value);
+  server->setContentLength(fit ? ride_export_size(&exporter) : CONTENT_LENGTH_UNKNOWN);
+  server->send(200, fit ? "application/vnd.ant.fit" : "application/gpx+xml", "");
+  if (server->method() == HTTP_HEAD) return;
+
+  WiFiClient client = server->client();
+  size_t n;
+  while (client.connected() && (n = ride_export_read(&exporter, exportChunk, sizeof(exportChunk))) > 0) {
+    if (fit) {
+      if (client.write(exportChunk, n) != n) break;
+    } else {
+      server->sendContent((const char *)exportChunk, n);
+    }
+  }
+  if (!fit) server->sendContent(""); // Chunked válasz vége
+  ESP_LOGI(TAG, "Log %lu exported as %s: %lu bytes.", (unsigned long)id, fit ? "FIT" : "GPX",
+           (unsigned long)exporter.emitted);
+}
+
+static void handle_export(uint32_t id, RideExportFormat_t format) {
+  RideLogInfo_t info;
+  if (!ride_log_pin(id, &info)) {
+    server->send(404, "text/plain", "No such log\n");
+    return;
+  }
+  send_export(id, info, format);
+  ride_log_unpin(&info);
+}
+
+static void handle_not_found(void) {
+  String uri = server->uri();
+  if (uri.startsWith("/logs/")) {
+    // Csak olvasás: minden más metódus 405
+    if (server->method() != HTTP_GET && server->method() != HTTP_HEAD) {
+      server->sendHeader("Allow", "GET, HEAD");
+      server->send(405, "text/plain", "Method not allowed\n");
+      return;
+    }
+    char *rest = NULL;
+    const char *idStr = uri.c_str() + 6;
+    unsigned long id = strtoul(idStr, &rest, 10);
+    if (rest != idStr && *rest == '\0') {
+      handle_log((uint32_t)id);
+      return;
+    }
+    if (rest != idStr && (strcmp(rest, ".fit") == 0 || strcmp(rest, ".gpx") == 0)) {
+      handle_export((uint32_t)id, strcmp(rest, ".fit") == 0 ? RIDE_EXPORT_FIT : RIDE_EXPORT_GPX);
+      return;
+    }
+  }
+  server->send(404, "text/plain", "Not found\n");
+}
+
+static void log_server_task(void *pvParameters) {
+  static const char *headers[] = {"Range"};
+  server = new WebServer(LOG_SERVER_PORT);
+  server->collectHeaders(headers, 1);
+  server->on("/logs", HTTP_GET, handle_list);
+  server->onNotFound(handle_not_found);
+  server->begin();
+  ESP_LOGI(TAG, "Log server listening on port %d.", LOG_SERVER_PORT);
+
+  // A WiFi-off timer lekapcsolja az AP-t, ekkor a szerver is leáll
+  while (WiFi.getMode() != WIFI_OFF) {
+    server->handleClient();
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  server->stop();
+  delete server;
+  server = NULL;
+  ESP_LOGI(TAG, "Log server stopped (WiFi off).");
+  vTaskDelete(NULL);
+}
+
+void log_server_start(void) {
+  if (task_start(TASK_LOG_SERVER, log_server_task, NULL) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create log server task!");
+  }
+}
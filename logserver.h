@@ -0,0 +1,23 @@
+// logserver.h
+// Menetnaplók letöltése HTTP-n a hidegindításkori soft-AP ablak alatt.
+// GET /logs: a tárolt naplók listája (JSON); GET /logs/<n>: az n. legfrissebb
+// napló nyers bájtjai, Range támogatással (folytatható letöltés). A tartalom
+// darabokban, közvetlenül a leképezett flash-ből megy a socketre; a hely a
+// küldés végéig rögzített (ride_log_pin), egy közben induló menet nem írja
+// felül. A /logs/ alatt csak GET és HEAD, más metódusra 405.
+// GET /logs/<n>.fit, /logs/<n>.gpx: ugyanez tevékenységfájlként (rideexport),
+// menet közben generálva; GPX csak GPS fixekkel.
+#ifndef LOGSERVER_H
+#define LOGSERVER_H
+
+#include <stdint.h>
+
+// Saját, alacsony prioritású taskban szolgál ki, amíg a WiFi be van kapcsolva
+void log_server_start(void);
+
+// "Range: bytes=..." fejléc értelmezése egy total hosszú erőforrásra.
+// 1: érvényes tartomány (start..end, zárt), 0: nincs/nem támogatott fejléc
+// (teljes válasz), -1: nem teljesíthető tartomány (416).
+int log_server_parse_range(const char *header, uint32_t total, uint32_t *start, uint32_t *end);
+
+#endif
@@ -6,6 +6,25 @@
 #include <ArduinoOTA.h>     // hozzáadva: OTA
 
 #include "displaytft.h" // SensorData_t innen jön
+#include "displaypower.h" // Kijelző ébresztése aktivitásra
+#include "wheelprofile.h" // Kerékprofilok és kalibrációs konstansok
+#include "pulsecapture.h" // MCPWM hardveres időbélyegzés
+#include "debounce.h"     // Sebességfüggő pergésmentesítés
+#include "speedestimator.h" // Több mágneses sebességbecslés
+#include "derivedmetrics.h" // Gyorsulás és becsült teljesítmény
+#include "autopause.h"      // Mozgási idő és átlagsebesség
+#include "ridehistory.h"    // Menetösszesítők flash partíción
+#include "ridelog.h"        // Nyers impulzusnapló menetenként
+#include "logserver.h"      // Naplóletöltés HTTP-n
+#include "taskplacement.h"  // Statikus taskok magokhoz rendelve
+#include "pulsesim.h"       // Profilvezérelt impulzus szimulátor
+#include "pipelinestats.h"  // Impulzusvesztés és lemaradás számlálók
+#include "pulselatency.h"   // Impulzus -> képpont késleltetés szakaszonként
+#include "pulsevalidator.h"  // Kimaradt és fantom impulzusok javítása
+#include "binlog.h"         // Halasztott napló a forró ágakra
+#include "scheduler.h"      // Időzített és gomb munkák egy közös taskban
+#include "energymodel.h"    // Állapotonkénti energia becslés
+#include "idleladder.h"     // Tétlenségi lépcső: kijelző, light sleep, mélyalvás
 #include "driver/gpio.h"
 #include "driver/uart.h"
 #include "esp_err.h"
@@ -24,7 +43,6 @@
 
 // --- Globális Változók (szálbiztos) ---
 std::atomic<uint64_t> pulseCount(0);        // Teljes impulzusszám (induláskor NVS-ből töltődik)
-std::atomic<int64_t> lastPulseTimeUs(0);    // Utolsó REED impulzus ideje mikroszekundumban
 
 // --- RTC Memória Változók ---
 // Ezek megőrzik értéküket mélyalvás alatt, de teljes tápmegszakításkor elvesznek/meghatározatlanok
@@ -32,18 +50,17 @@ RTC_DATA_ATTR uint64_t dailyTripStartPulseCount = 0; // Az a pulseCount érték,
 RTC_DATA_ATTR uint16_t bootCount;
 
 // --- Globális változók (mutex-szel védett) ---
-SensorData_t sharedSensorData = {0.0, 0.0, 0.0, 0.0, 0}; // Kezdeti értékek, hozzáadva movingTimeSeconds
+SensorData_t sharedSensorData = {0.0, 0.0, 0.0, 0.0, 0, 0.0, 0.0, 0.0, 0, 0}; // Kezdeti értékek, hozzáadva movingTimeSeconds
 SemaphoreHandle_t xDataMutex = NULL;       // Mutex a sharedSensorData védelmére
+TimeSeries_t speedHistory;                 // Sebesség idősor a görbe képernyőhöz (xDataMutex)
 
 // Új: Megosztott kijelző állapot
 DisplayState_t sharedDisplayState = DISPLAY_SPEED;
 SemaphoreHandle_t xDisplayStateMutex = NULL;
 
 // Új: Maximális sebesség és átlagsebesség változók (most globálisan elérhetők a reset task és GUI task számára)
-double maxSpeedKmh = 0.0;  // Eltávolítottuk a static kulcsszót
-double startTotalDistanceKm = 0.0;  // Eltávolítottuk a static kulcsszót
-int64_t totalMovingTimeUs = 0;  // Eltávolítottuk a static kulcsszót
-double averageSpeedKmh = 0.0;  // Eltávolítottuk a static kulcsszót
+double maxSpeedKmh = 0.0;  // A számoló task írja ellenőrzött impulzusokból (xDataMutex)
+AutoPause_t autoPause;     // Mozgási idő/átlag állapotgép, xDataMutex védi
 extern bool data_changed; // Ez a változó jelzi, hogy az adatok frissültek-e
 bool kepfix = false, oldkepfix = false;
 volatile bool keptoggle = false;
@@ -64,59 +81,123 @@ esp_err_t load_total_pulses_from_nvs(uint64_t *pulses);
 esp_err_t save_total_pulses_to_nvs(uint64_t pulses);
 esp_err_t load_moving_time_from_nvs(uint32_t *movingTimeSeconds); // Új
 esp_err_t save_moving_time_to_nvs(uint32_t movingTimeSeconds);    // Új
-void reset_button_monitor_task(void *pvParameters);
 void reed_simulation_task(void *pvParameters);
-void serial_output_task(void *pvParameters); // Hiányzó prototípus hozzáadása
 
-volatile int64_t lastDebounceTimeUs = 0;
-const int64_t debounceDelayUs = 10000; // 10 ms
+// Pergésmentesítés: az ablak a várható periódus hányada (config.h: DEBOUNCE_*)
+static const DRAM_ATTR DebounceConfig_t reedDebounceConfig = {
+    DEBOUNCE_MIN_US, DEBOUNCE_MAX_US, DEBOUNCE_FRACTION_PCT, DEBOUNCE_STOP_PERIOD_US
+};
+static DRAM_ATTR DebounceState_t reedDebounce;
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_MCPWM
+// A capture ISR és az ébredés utáni pótlás (ütemező task) más magon is futhat
+static portMUX_TYPE reedMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+// Impulzus sor: az elfogadott élek ISR időbélyegei a számoló taskhoz
+static QueueHandle_t xPulseQueue = NULL;
 
-// Új: impulzusesemény jelzésére counting semaphore
-static SemaphoreHandle_t xPulseSemaphore = NULL;
+// Szenzor állapot: a validátor javításai (a számoló task másolja, xDataMutex)
+static PulseValidatorStats_t pulseHealth = {};
 
-// Új: WiFi-off timer
-static TimerHandle_t wifiOffTimer = NULL;
+// Gomb munkák az ütemezőben (a gomb ISR élesíti a pergés utáni mintavételt)
+static SchedJob_t buttonSettleJob = SCHED_NO_JOB;
+static SchedJob_t resetHoldJob = SCHED_NO_JOB;
 
-// visszahívás 10 perc múlva
-void wifiOffTimerCallback(TimerHandle_t xTimer) {
+// WiFi lekapcsolás: egyszeri ütemezett munka, 10 perc múlva
+static void wifi_off_job(void *arg) {
     ESP_LOGI(TAG, "Disabling WiFi to save power");
     //if (WiFi.isConnected()) {
         //WiFi.disconnect(true);
         WiFi.mode(WIFI_OFF);
+        energy_set_wifi(false);
     //}
 }
 
+// --- Impulzus él feldolgozása (ISR kontextus) ---
+// A GPIO ISR és az MCPWM capture callback is ide adja az él időbélyegét
+void IRAM_ATTR pulse_edge_from_isr(int64_t edgeUs, BaseType_t *hptw) {
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_MCPWM
+    portENTER_CRITICAL_ISR(&reedMux);
+    bool accepted = debounce_edge(&reedDebounce, &reedDebounceConfig, edgeUs);
+    portEXIT_CRITICAL_ISR(&reedMux);
+#else
+    bool accepted = debounce_edge(&reedDebounce, &reedDebounceConfig, edgeUs);
+#endif
+    pipeline_edge(accepted);
+    if (accepted) {
+        pulseCount.fetch_add(1, std::memory_order_relaxed);
+        if (xQueueSendFromISR(xPulseQueue, &edgeUs, hptw) != pdTRUE) pulse_latency_dropped();
+    }
+}
+
 // --- ISR (Interrupt Service Routine - REED) ---
 void IRAM_ATTR gpio_isr_handler(void* arg) {
     int64_t now = esp_timer_get_time();
-    if ((now - lastDebounceTimeUs) > debounceDelayUs) {
-        lastDebounceTimeUs = now;
-        lastPulseTimeUs.store(now, std::memory_order_relaxed);
-        pulseCount.fetch_add(1, std::memory_order_relaxed);
-        BaseType_t hptw = pdFALSE;
-        xSemaphoreGiveFromISR(xPulseSemaphore, &hptw);
-        if (hptw) portYIELD_FROM_ISR();
+#if PULSE_CAPTURE_DIAG == 1
+    pulse_capture_diag_isr_edge(now);
+#endif
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_GPIO_ISR
+    BaseType_t hptw = pdFALSE;
+    pulse_edge_from_isr(now, &hptw);
+    if (hptw) portYIELD_FROM_ISR();
+#endif
+}
+
+// Ugyanaz a lánc task kontextusból (szimulátor, light sleep utáni pótlás);
+// false, ha a pergésszűrő vagy a teli sor eldobta
+static bool pulse_edge_from_task(int64_t edgeUs) {
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_MCPWM
+    portENTER_CRITICAL(&reedMux);
+    bool accepted = debounce_edge(&reedDebounce, &reedDebounceConfig, edgeUs);
+    portEXIT_CRITICAL(&reedMux);
+#else
+    bool accepted = debounce_edge(&reedDebounce, &reedDebounceConfig, edgeUs);
+#endif
+    pipeline_edge(accepted);
+    if (!accepted) return false;
+    pulseCount.fetch_add(1, std::memory_order_relaxed);
+    if (xQueueSend(xPulseQueue, &edgeUs, 0) != pdTRUE) {
+        pulse_latency_dropped();
+        return false; // Nem jutott el a számoló taskig
     }
+    return true;
 }
 
-void inactivity_monitor_task(void *pvParameters) {
-  ESP_LOGI(TAG, "Inactivity monitor task started.");
-  while (1) {
-    // Várjunk egy ésszerű ideig, pl. 30 másodpercig
-    vTaskDelay(pdMS_TO_TICKS(30000));
+// Light sleep utáni ébredés (ütemező task, a REED és gomb megszakítások még tiltva)
+static void idle_wake_handler(int64_t wakeUs, uint32_t changedPins) {
+#if SIMULATE_REED_INPUT == 0
+    // Bit 0: REED. Az alvás alatt zárt érintkező éle nem jutott el az ISR-ig
+    // (MCPWM módban sem: light sleep alatt az APB órája áll, a capture egység
+    // nem látja), ezért a pergésszűrőn át pótoljuk. Ha mégis rögzült, a
+    // duplikátumot a tiltási ablak eldobja.
+    if ((changedPins & 1u) && gpio_get_level(REED_SWITCH_PIN) == 0) pulse_edge_from_task(wakeUs);
+#endif
+    // Gombok: a pergés utáni mintavétel dönt a lenyomásról
+    if (changedPins & ~1u) sched_arm(buttonSettleJob);
+}
 
-    int64_t currentTimeUs = esp_timer_get_time();
-    int64_t last_pulse_time = lastPulseTimeUs.load(std::memory_order_relaxed);
-    int64_t inactivity_duration_us = currentTimeUs - last_pulse_time;
+// Tétlenségi lépcső: ütemezett munka INACTIVITY_CHECK_MS-enként. A kijelző
+// fokait a displaypower maga lépteti, itt a két alvási fok dől el.
+static void inactivity_job(void *arg) {
+  int64_t currentTimeUs = esp_timer_get_time();
+  IdleStage_t stage = idle_ladder_stage(currentTimeUs);
+
+  // WiFi AP alatt nincs light sleep: a kapcsolat és a naplóletöltés élne tovább
+  if (stage == IDLE_STAGE_LIGHT_SLEEP && WiFi.getMode() == WIFI_OFF) {
+    ESP_LOGI(TAG, "Idle for over %d s. Entering light sleep.", IDLE_LIGHT_SLEEP_S);
+    if (idle_ladder_light_sleep(currentTimeUs)) {
+      ESP_LOGI(TAG, "Woken from light sleep by pin.");
+      return;
+    }
+    stage = idle_ladder_stage(esp_timer_get_time());
+  }
 
-    // Ha az utolsó impulzus óta eltelt idő nagyobb, mint a timeout
-    if (inactivity_duration_us > INACTIVITY_TIMEOUT_US) {
-      ESP_LOGI(TAG,
-               "Inactivity detected for over %d minutes. Entering deep sleep.",
-               INACTIVITY_TIMEOUT_S / 60);
+  if (stage == IDLE_STAGE_DEEP_SLEEP) {
+    ESP_LOGI(TAG,
+             "Inactivity detected for over %d minutes. Entering deep sleep.",
+             INACTIVITY_TIMEOUT_S / 60);
 
-      go_to_deep_sleep();
-    }
+    go_to_deep_sleep();
   }
 }
 
@@ -249,48 +330,77 @@ esp_err_t save_moving_time_to_nvs(uint32_t movingTimeSeconds) {
     return err;
 }
 
-// --- NVS Mentő Task ---
-void nvs_save_task(void *pvParameters) {
-    ESP_LOGI(TAG, "NVS save task started. Saving every %d minutes.", NVS_SAVE_INTERVAL_MS / (60 * 1000));
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(NVS_SAVE_INTERVAL_MS));
+// --- NVS Mentés (ütemezett munka, NVS_SAVE_INTERVAL_MS-enként) ---
+static void nvs_save_job(void *arg) {
+    uint64_t currentTotalPulses = pulseCount.load(std::memory_order_relaxed);
+    esp_err_t err = save_total_pulses_to_nvs(currentTotalPulses);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Total pulses (%llu) saved to NVS.", currentTotalPulses);
+    } else {
+        ESP_LOGE(TAG, "Failed to save total pulses to NVS!");
+    }
 
-        uint64_t currentTotalPulses = pulseCount.load(std::memory_order_relaxed);
-        esp_err_t err = save_total_pulses_to_nvs(currentTotalPulses);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "Total pulses (%llu) saved to NVS.", currentTotalPulses);
+    // Mozgási idő mentése is
+    uint32_t currentMovingTime = 0;
+    if (xDataMutex != NULL && xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        currentMovingTime = sharedSensorData.movingTimeSeconds;
+        xSemaphoreGive(xDataMutex);
+        
+        esp_err_t moving_err = save_moving_time_to_nvs(currentMovingTime);
+        if (moving_err == ESP_OK) {
+            ESP_LOGI(TAG, "Moving time (%lu sec = %.1f min) saved to NVS.", 
+                     (unsigned long)currentMovingTime, currentMovingTime/60.0);
         } else {
-            ESP_LOGE(TAG, "Failed to save total pulses to NVS!");
+            ESP_LOGE(TAG, "Failed to save moving time to NVS!");
         }
+    } else {
+        ESP_LOGW(TAG, "NVS save job couldn't get mutex for moving time!");
+    }
+}
 
-        // Mozgási idő mentése is
-        uint32_t currentMovingTime = 0;
-        if (xDataMutex != NULL && xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            currentMovingTime = sharedSensorData.movingTimeSeconds;
-            xSemaphoreGive(xDataMutex);
-            
-            esp_err_t moving_err = save_moving_time_to_nvs(currentMovingTime);
-            if (moving_err == ESP_OK) {
-                ESP_LOGI(TAG, "Moving time (%lu sec = %.1f min) saved to NVS.", 
-                         (unsigned long)currentMovingTime, currentMovingTime/60.0);
-            } else {
-                ESP_LOGE(TAG, "Failed to save moving time to NVS!");
-            }
-        } else {
-            ESP_LOGW(TAG, "NVS save task couldn't get mutex for moving time!");
-        }
+// A regressziós ablak csonkolása (a mintasűrűség meghaladta a DERIVED_MAX_RATE_HZ-t):
+// az 1., 2., 4., ... felülírt mintánál naplóz, hogy tartós túllépés ne árassza el a naplót
+static void report_derived_truncation(const DerivedMetrics_t *dm) {
+    static uint32_t reported = 0;
+    uint32_t n = dm->truncatedSamples;
+    if (n == reported) return;
+    reported = n;
+    if ((n & (n - 1)) == 0) {
+        BLOG_W(TAG, "Acceleration window truncated: %lu in-window samples overwritten (> %d Hz).",
+               (unsigned long)n, DERIVED_MAX_RATE_HZ);
     }
 }
 
 // --- Sebesség/Távolság Számoló Task (pulse driven) ---
-#define SPEED_TIMEOUT_MS 5000  // 5 mp inaktivitás után 0 km/h
 
 void calculation_and_control_task(void *pvParameters) {
     ESP_LOGI(TAG, "Calc task (pulse-driven) started.");
-    const double wheelCircM = M_PI * WHEEL_DIAMETER_M;
     int64_t prevPulseUs = 0;
     double curSpeed = 0.0;
-    static double moveAccum = 0.0; // <-- Új: mozgásidő felhalmozó
+
+    // Sebességbecslő a mindenkori kerékprofilhoz (mágnesszám, kerület)
+    static const SpeedEstimatorConfig_t estimatorConfig = {
+        SPEED_EST_LEARN_ALPHA, SPEED_EST_STEADY_PCT / 100.0,
+        SPEED_EST_COMBINE_PCT / 100.0, SPEED_EST_STOP_US, SPEED_EST_SLIP_PCT / 100.0};
+    static SpeedEstimator_t estimator;
+    WheelCalib_t estimatorCalib = wheel_calib();
+    speed_estimator_init(&estimator, &estimatorConfig, estimatorCalib.pulsesPerRev,
+                         estimatorCalib.circumferenceM);
+    uint32_t reportedResyncs = 0;
+
+    // Impulzusfolyam ellenőrzés: kimaradt és fantom impulzusok a becslő előtt
+    static const PulseValidatorConfig_t validatorConfig = {
+        PULSE_VALID_MAX_ACCEL_MPS2, PULSE_VALID_MATCH_PCT / 100.0,
+        PULSE_VALID_PHANTOM_PCT / 100.0, PULSE_VALID_MAX_MISSED, SPEED_EST_STOP_US};
+    static PulseValidator_t validator;
+    pulse_validator_init(&validator, &validatorConfig, estimatorCalib.pulsesPerRev,
+                         estimatorCalib.circumferenceM);
+
+    static const DerivedConfig_t derivedConfig = {
+        RIDER_MASS_KG, ROLLING_CRR, DRAG_CDA_M2, AIR_DENSITY_KGM3,
+        (int64_t)DERIVED_WINDOW_MS * 1000};
+    static DerivedMetrics_t derived;
+    derived_metrics_init(&derived, &derivedConfig);
 
     uint64_t last_saved_total_pulses =
         pulseCount.load(std::memory_order_relaxed);
@@ -301,17 +411,15 @@ void calculation_and_control_task(void *pvParameters) {
     if (xDataMutex != NULL &&
         xSemaphoreTake(xDataMutex, portMAX_DELAY) == pdTRUE) {
       uint64_t initial_pulses = pulseCount.load(std::memory_order_relaxed);
-      sharedSensorData.totalDistanceKm =
-          (double)initial_pulses * (WHEEL_DIAMETER_M * M_PI) / 1000.0;
-
-      // napi távolság init: különbség a start-impulzusoktól
-      {
-        uint64_t dp = (initial_pulses >= dailyTripStartPulseCount)
-                          ? (initial_pulses - dailyTripStartPulseCount)
-                          : 0;
-        sharedSensorData.dailyDistanceKm =
-          (double)dp * (WHEEL_DIAMETER_M * M_PI) / 1000.0;
-      }
+      // teljes és napi táv az impulzusokból, a profilváltások figyelembevételével
+      wheel_distances_km(initial_pulses, &sharedSensorData.totalDistanceKm,
+                         &sharedSensorData.dailyDistanceKm);
+
+      // Mozgási idő a visszaállított értékről, átlag a jelenlegi össztávtól
+      static const AutoPauseConfig_t autoPauseConfig = {AUTOPAUSE_RESUME_KMH, AUTOPAUSE_PAUSE_KMH};
+      autopause_init(&autoPause, &autoPauseConfig, sharedSensorData.movingTimeSeconds,
+                     sharedSensorData.totalDistanceKm);
+      timeseries_init(&speedHistory, esp_timer_get_time());
 
       ESP_LOGI(TAG,
                "Initial calculation complete. Total: %.2f km, Daily: %.2f km",
@@ -322,46 +430,118 @@ void calculation_and_control_task(void *pvParameters) {
     // --- VÉGE ---
 
     while (1) {
-        // Várunk új impulzusra, max 5 mp ig
-        if (xSemaphoreTake(xPulseSemaphore, pdMS_TO_TICKS(SPEED_TIMEOUT_MS)) == pdTRUE) {
-            int64_t now = lastPulseTimeUs.load(std::memory_order_relaxed);
+        // Várunk új impulzusra; mozgás közben rövid ütemben a lassulást is követjük
+        TickType_t wait = (curSpeed != 0.0) ? pdMS_TO_TICKS(SPEED_DECAY_TICK_MS)
+                                            : pdMS_TO_TICKS(SPEED_TIMEOUT_MS);
+        int64_t now;
+        if (xQueueReceive(xPulseQueue, &now, wait) == pdTRUE) {
+            // Lemaradásnál is minden impulzus a saját élidejével számol
+            int64_t wakeUs = esp_timer_get_time();
+            task_jitter_sample(now, wakeUs);
+            pulse_latency_record(LATENCY_ISR_TO_TASK, wakeUs - now);
+            pipeline_processed(wakeUs - now, uxQueueMessagesWaiting(xPulseQueue));
+            idle_ladder_activity();
+
+            const WheelCalib_t calib = wheel_calib();
+            if (calib.profileIndex != estimatorCalib.profileIndex) {
+                // Profilváltás: más mágnesszám/kerület, a tanult ívek és az előzmény érvénytelenek
+                estimatorCalib = calib;
+                speed_estimator_init(&estimator, &estimatorConfig, calib.pulsesPerRev,
+                                     calib.circumferenceM);
+                if (prevPulseUs != 0) speed_estimator_pulse(&estimator, prevPulseUs);
+                reportedResyncs = 0;
+                PulseValidatorStats_t kept = validator.stats;
+                pulse_validator_init(&validator, &validatorConfig, calib.pulsesPerRev,
+                                     calib.circumferenceM);
+                validator.stats = kept;
+                validator.lastUs = prevPulseUs;
+            }
+            PulseCheck_t check = pulse_validator_pulse(&validator, now);
+            if (check.verdict == PULSE_VALID_PHANTOM) {
+                // Rezgés: a nyers naplóba kerül, de sem a távolságba, sem a becslőbe
+                pulseCount.fetch_sub(1, std::memory_order_relaxed);
+                if (ride_log_active()) ride_log_pulse(now);
+                BLOG_D(TAG, "Phantom pulse dropped (%lu so far).", (unsigned long)validator.stats.phantom);
+                continue;
+            }
+            uint8_t restored = check.missedPulses + check.lateMissed;
+            if (restored > 0) {
+                // Kimaradt fordulatrészek a távolságba (a késői javítás csak ide)
+                pulseCount.fetch_add(restored, std::memory_order_relaxed);
+                BLOG_D(TAG, "Restored %u missed pulse(s).", (unsigned)restored);
+            }
+
             if (prevPulseUs != 0) {
-                double dt = (now - prevPulseUs) / 1000000.0;        // s
-                curSpeed = (wheelCircM / dt) * 3.6;                // km/h
-                double incKm = wheelCircM / 1000.0;                // km per pulse
+                // Pótolt impulzusok egyenletesen elosztva, hogy a becslő fázisa megmaradjon
+                for (uint8_t m = 1; m <= check.missedPulses; m++) {
+                    speed_estimator_pulse(&estimator, pulse_validator_interpolate(
+                                                          prevPulseUs, now, check.missedPulses, m));
+                }
+                curSpeed = speed_estimator_pulse(&estimator, now);  // km/h
+                if (estimator.phaseResyncs != reportedResyncs) {
+                    reportedResyncs = estimator.phaseResyncs;
+                    BLOG_W(TAG, "Magnet phase slip, estimator resynced (%lu so far).",
+                           (unsigned long)reportedResyncs);
+                }
 
+                bool rideMoving = false;
                 if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+                    // Lehetetlen gyorsulásból származó érték nem rögzül csúcsként
+                    if (check.verdict != PULSE_VALID_IMPLAUSIBLE && curSpeed > maxSpeedKmh) {
+                        maxSpeedKmh = curSpeed;
+                    }
+                    pulseHealth = validator.stats;
                     sharedSensorData.instantaneousSpeedKmh = curSpeed;
                     sharedSensorData.speedKmh = curSpeed;
-                    sharedSensorData.totalDistanceKm += incKm;
-
-                    // napi távolság minden pulzusnál újraszámolva
-                    {
-                      uint64_t total_p = pulseCount.load(std::memory_order_relaxed);
-                      uint64_t dp = (total_p >= dailyTripStartPulseCount)
-                                        ? (total_p - dailyTripStartPulseCount)
-                                        : 0;
-                      sharedSensorData.dailyDistanceKm =
-                        (double)dp * wheelCircM / 1000.0;
-                    }
-
-                    moveAccum += dt;                        // felhalmozzuk a tört másodperceket
-                    /*uint32_t addSec = (uint32_t)moveAccum;  // csak egész másodpercek
-                    if (addSec > 0) {
-                        sharedSensorData.movingTimeSeconds += addSec;
-                        moveAccum -= addSec;                // maradék vissza
-                    }*/
-
-                    if (moveAccum >= 1.0) {
-                      uint32_t addSec = floor(
-                          moveAccum); // Kerekítés lefelé a biztonság kedvéért
-                      sharedSensorData.movingTimeSeconds += addSec;
-                      moveAccum -= addSec; // maradék vissza
+                    timeseries_add(&speedHistory, now, (float)curSpeed);
+                    derived_metrics_sample(&derived, now, curSpeed);
+                    report_derived_truncation(&derived);
+                    sharedSensorData.accelerationMps2 = derived.accelerationMps2;
+                    sharedSensorData.powerW = derived.powerW;
+
+                    // teljes és napi távolság minden pulzusnál az impulzusszámból
+                    wheel_distances_km(pulseCount.load(std::memory_order_relaxed),
+                                       &sharedSensorData.totalDistanceKm,
+                                       &sharedSensorData.dailyDistanceKm);
+
+                    // Mozgási idő és átlag egyetlen helyen, az impulzus időbélyegéből
+                    if (autopause_pulse(&autoPause, now, curSpeed)) {
+                        BLOG_I(TAG, "Auto-pause: %s at %.1f km/h.",
+                                 autoPause.state == AUTOPAUSE_MOVING ? "moving" : "paused", curSpeed);
                     }
-
+                    sharedSensorData.movingTimeSeconds = autopause_moving_seconds(&autoPause);
+                    sharedSensorData.averageSpeedKmh =
+                        autopause_average_kmh(&autoPause, sharedSensorData.totalDistanceKm);
+                    rideMoving = autoPause.state == AUTOPAUSE_MOVING;
+                    // A menet csúcssebességébe sem kerül lehetetlen gyorsulású érték
+                    double trackedKmh = check.verdict != PULSE_VALID_IMPLAUSIBLE ? curSpeed : 0.0;
+                    ride_history_track(rideMoving, sharedSensorData.totalDistanceKm,
+                                       sharedSensorData.movingTimeSeconds, trackedKmh, now);
+
+                    // A GUI ebből méri a saját szakaszait
+                    int64_t publishUs = esp_timer_get_time();
+                    sharedSensorData.pulseEdgeUs = now;
+                    sharedSensorData.publishUs = publishUs;
                     xSemaphoreGive(xDataMutex);
+                    pulse_latency_record(LATENCY_TASK_TO_PUBLISH, publishUs - wakeUs);
+                } else {
+                    pipeline_skipped(); // Az impulzus számít, de a metrikák most nem frissültek
+                }
+                // Nyers napló az induláskori intervallumtól a menet végéig, a mutex
+                // után: csak sorba állít, a flash írás az író taskban fut
+                if (rideMoving && !ride_log_active()) {
+                    ride_log_begin(prevPulseUs);
                 }
+                ride_log_pulse(now);
                // ESP_LOGD(TAG, "Pulse dt=%.3f s, speed=%.1f km/h", dt, curSpeed);
+            } else {
+                speed_estimator_pulse(&estimator, now); // Első impulzus: csak időbélyeg
+                if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+                    autopause_pulse(&autoPause, now, 0.0);
+                    xSemaphoreGive(xDataMutex);
+                } else {
+                    pipeline_skipped();
+                }
             }
             prevPulseUs = now;
         } else {
@@ -375,36 +555,52 @@ void calculation_and_control_task(void *pvParameters) {
                 }
                 ESP_LOGI(TAG, "No pulse for 5s, speed set to 0");*/
 
-            // Timeout: nem jött impulzus, megálltunk
+            // Nem jött impulzus: az eltelt idő felső korlát a sebességre
             if (curSpeed != 0.0) {
-              if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                // ÚJ: Az utolsó impulzus óta eltelt idő hozzáadása a megállás
-                // előtt
-                int64_t now = esp_timer_get_time();
-                int64_t prevPulseUs =
-                    lastPulseTimeUs.load(std::memory_order_relaxed);
-                if (prevPulseUs != 0) {
-                  double dt_since_last =
-                      (double)(now - prevPulseUs) / 1000000.0;
-                  // Csak a timeout-ig eltelt időt adjuk hozzá, ne a teljeset,
-                  // ha az több
-                  if (dt_since_last > (SPEED_TIMEOUT_MS / 1000.0)) {
-                    dt_since_last = (SPEED_TIMEOUT_MS / 1000.0);
-                  }
-                  moveAccum += dt_since_last;
-                  if (moveAccum >= 1.0) {
-                    uint32_t addSec = floor(moveAccum);
-                    sharedSensorData.movingTimeSeconds += addSec;
-                    moveAccum -= addSec;
+              int64_t nowUs = esp_timer_get_time();
+              double decayed = curSpeed;
+              SpeedDecay_t decay = speed_estimator_decay(&estimator, nowUs, SPEED_ZERO_KMH,
+                                                         (int64_t)SPEED_TIMEOUT_MS * 1000, &decayed);
+              if (decay != SPEED_DECAY_ZERO) {
+                // Lassulás: csak csökkenhet, a következő impulzus adja a pontos értéket
+                if (decay == SPEED_DECAY_LOWER &&
+                    xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+                  curSpeed = decayed;
+                  sharedSensorData.instantaneousSpeedKmh = curSpeed;
+                  sharedSensorData.speedKmh = curSpeed;
+                  timeseries_add(&speedHistory, nowUs, (float)curSpeed);
+                  derived_metrics_sample(&derived, nowUs, curSpeed);
+                  report_derived_truncation(&derived);
+                  sharedSensorData.accelerationMps2 = derived.accelerationMps2;
+                  sharedSensorData.powerW = derived.powerW;
+                  if (autopause_update(&autoPause, curSpeed)) {
+                    BLOG_I(TAG, "Auto-pause: paused at %.1f km/h.", curSpeed);
                   }
+                  xSemaphoreGive(xDataMutex);
                 }
-
+              } else if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
                 curSpeed = 0.0;
                 sharedSensorData.instantaneousSpeedKmh = 0.0;
                 sharedSensorData.speedKmh = 0.0;
+                timeseries_add(&speedHistory, nowUs, 0.0f);
+                derived_metrics_reset(&derived);
+                sharedSensorData.accelerationMps2 = 0.0;
+                sharedSensorData.powerW = 0.0;
+                // Megállás: a mozgási időt az utolsó impulzusig már jóváírtuk
+                autopause_update(&autoPause, 0.0);
                 //data_changed = true;
                 xSemaphoreGive(xDataMutex);
-                ESP_LOGI(TAG, "Speed timeout. Set speed to 0.");
+                BLOG_I(TAG, "Speed decayed below %.1f km/h. Set speed to 0.", (double)SPEED_ZERO_KMH);
+              }
+            } else {
+              // Állva: az idősor másodpercei a 0 értékkel telnek
+              if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+                timeseries_tick(&speedHistory, esp_timer_get_time());
+                xSemaphoreGive(xDataMutex);
+              }
+              // Állva: hosszabb szünet után a menet lezárul és a történetbe kerül
+              if (ride_history_idle_check(esp_timer_get_time())) {
+                ride_log_end();
               }
             }
        }
@@ -424,6 +620,10 @@ void go_to_deep_sleep(void) {
         ESP_LOGE(TAG, "Failed to save final total pulses to NVS before sleep!");
     }
 
+    // Folyamatban lévő menet mentése a történetbe és a napló lezárása
+    ride_history_end_ride();
+    ride_log_end();
+
     // Mozgási idő mentése alvás előtt
     /*if (xDataMutex != NULL && xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE)*/ {
         uint32_t currentMovingTime = sharedSensorData.movingTimeSeconds;
@@ -447,12 +647,32 @@ void go_to_deep_sleep(void) {
         ESP_LOGW(TAG, "NVS handle was not open (or already closed) before sleep.");
     }
 
+    ESP_LOGI(TAG, "Debounce: %lu accepted, rejected chatter %lu, early %lu, cold %lu (window %lu us)",
+             (unsigned long)reedDebounce.accepted,
+             (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_CHATTER],
+             (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_EARLY],
+             (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_COLD],
+             (unsigned long)reedDebounce.lockoutUs);
+
+    // Kijelző állapotok statisztikája és háttérvilágítás kikapcsolása
+    display_power_report();
+    display_power_shutdown();
+
+    // Az ébrenlét töltése az RTC-be, az alvás ideje ébredéskor adódik hozzá
+    energy_report();
+    energy_before_deep_sleep();
+
+    // A tétlen szakasz ébredéskor, mélyalvásként kerül az eloszlásba
+    idle_ladder_report();
+    idle_ladder_before_deep_sleep();
+
     ESP_LOGI(TAG, "Configuring wake up sources...");
     esp_sleep_enable_ext0_wakeup(BUTTON_PIN, 0); // Gomb (GPIO0)
     const uint64_t ext1_wakeup_pin_mask = 1ULL << REED_SWITCH_PIN; // REED (GPIO32)
     esp_sleep_enable_ext1_wakeup(ext1_wakeup_pin_mask, ESP_EXT1_WAKEUP_ALL_LOW);
 
     ESP_LOGI(TAG, "Entering deep sleep now.");
+    binlog_flush(); // A gyűrűben maradt bejegyzések az alvás előtt
     fflush(stdout); // Biztosítjuk, hogy minden log kimenjen
     lcd.setTextColor(TFT_WHITE, TFT_BLUE);
     vTaskDelay(pdMS_TO_TICKS(10)); // Várunk egy kicsit
@@ -461,226 +681,347 @@ void go_to_deep_sleep(void) {
     // A program innen már nem folytatódik, csak ébredés után újraindul az app_main-től
 }
 
-// --- REED Szimulációs Task ---
-void reed_simulation_task(void *pvParameters) {
-  ESP_LOGI(TAG,
-           "REED Simulation Task started. Simulating %.1f km/h for %d minutes.",
-           SIMULATED_SPEED_KMH, SIMULATION_DURATION_MINUTES);
+// --- REED Szimulátor (esp_timer, mikroszekundumos élek) ---
+// Bemelegítés, intervallumok, megállás (autopause és menetzárás próbája)
+static const PulseSimSegment_t intervalProfile[] = {
+    {0, 25, 20000},  {25, 25, 60000},
+    {25, 40, 10000}, {40, 40, 30000}, {40, 20, 10000}, {20, 20, 30000},
+    {20, 40, 10000}, {40, 40, 30000}, {40, 20, 10000}, {20, 20, 30000},
+    {20, 0, 15000},  {0, 0, 30000},
+    {0, 30, 20000},  {30, 30, 60000}, {30, 0, 20000},
+};
+
+static PulseSim_t pulseSim;
+static esp_timer_handle_t pulseSimTimer = NULL;
+static TaskHandle_t pulseSimTask = NULL;
+static int64_t pulseSimNextUs = 0;
+static bool pulseSimNextBounce = false;
+// Terhelési mérés: a legnagyobb veszteség nélküli impulzusráta
+static double pulseSimCleanHz = 0.0;
+static double pulseSimFirstLossHz = 0.0;
+static uint32_t pulseSimLostReal = 0;
+static UBaseType_t pulseSimMaxBacklog = 0;
+
+// Ugyanaz a lánc, mint az ISR-ben, de az esp_timer task kontextusából
+static void pulse_sim_emit(int64_t edgeUs, bool bounce) {
+    bool accepted = pulse_edge_from_task(edgeUs);
+    if (bounce) return;
+
+    // Valódi él: elveszett, ha a pergésszűrő vagy a teli sor eldobta, vagy a számoló task lemaradt
+    UBaseType_t backlog = uxQueueMessagesWaiting(xPulseQueue);
+    if (backlog > pulseSimMaxBacklog) pulseSimMaxBacklog = backlog;
+    double rateHz = pulseSim.lastIntervalUs > 0 ? 1e6 / pulseSim.lastIntervalUs : 0.0;
+    if (!accepted || backlog > PULSESIM_BACKLOG_LIMIT) {
+        if (pulseSimLostReal++ == 0) pulseSimFirstLossHz = rateHz;
+    } else if (pulseSimLostReal == 0 && rateHz > pulseSimCleanHz) {
+        pulseSimCleanHz = rateHz;
+    }
+}
+
+static void pulse_sim_timer_callback(void *arg) {
+    // Késésnél az esedékes éleket azonnal, az ütemezett időbélyegükkel adjuk ki
+    int64_t now = esp_timer_get_time();
+    for (int burst = 0; pulseSimNextUs <= now && burst < 64; burst++) {
+        pulse_sim_emit(pulseSimNextUs, pulseSimNextBounce);
+        if (!pulsesim_next(&pulseSim, &pulseSimNextUs, &pulseSimNextBounce)) {
+            xTaskNotifyGive(pulseSimTask);
+            return;
+        }
+    }
+    int64_t delayUs = pulseSimNextUs - esp_timer_get_time();
+    esp_timer_start_once(pulseSimTimer, delayUs > 0 ? delayUs : 1);
+}
 
+void reed_simulation_task(void *pvParameters) {
+  const WheelCalib_t calib = wheel_calib();
+  PulseSimConfig_t simConfig = {};
+  simConfig.circumferenceM = calib.circumferenceM;
+  simConfig.pulsesPerRev = calib.pulsesPerRev;
+  simConfig.bouncePermille = PULSESIM_BOUNCE_PERMILLE;
+  simConfig.bounceEdges = PULSESIM_BOUNCE_EDGES;
+  simConfig.bounceSpanUs = PULSESIM_BOUNCE_SPAN_US;
+  simConfig.missPermille = PULSESIM_MISS_PERMILLE;
+  simConfig.seed = PULSESIM_SEED;
+
+#if PULSESIM_PROFILE == PULSESIM_PROFILE_INTERVALS
+  simConfig.segments = intervalProfile;
+  simConfig.segmentCount = sizeof(intervalProfile) / sizeof(intervalProfile[0]);
+  ESP_LOGI(TAG, "REED Simulation: interval profile, %u segments.", simConfig.segmentCount);
+#elif PULSESIM_PROFILE == PULSESIM_PROFILE_SWEEP
+  // Rámpa a megadott impulzusrátáig, jóval a valós tekerés fölé
+  static PulseSimSegment_t sweep[1];
+  double sweepMaxKmh = (double)PULSESIM_SWEEP_MAX_HZ * calib.circumferenceM / calib.pulsesPerRev * 3.6;
+  sweep[0] = {0.0f, (float)sweepMaxKmh, PULSESIM_SWEEP_S * 1000};
+  simConfig.segments = sweep;
+  simConfig.segmentCount = 1;
+  ESP_LOGI(TAG, "REED Simulation: rate sweep to %d Hz (%.0f km/h) over %d s.",
+           PULSESIM_SWEEP_MAX_HZ, sweepMaxKmh, PULSESIM_SWEEP_S);
+#elif PULSESIM_PROFILE == PULSESIM_PROFILE_REPLAY
+  // A legutóbbi lezárt menetnapló intervallumai
+  RideLogInfo_t replay;
+  const RideLogHeader_t *replayHeader = NULL;
+  // Rögzítve: a visszajátszott helyet egy új menet sem írhatja felül
+  if (ride_log_pin(0, &replay)) replayHeader = (const RideLogHeader_t *)replay.data;
+  if (replayHeader == NULL) {
+    ESP_LOGW(TAG, "No ride log to replay. Simulation task stopping.");
+    vTaskDelete(NULL);
+    return;
+  }
+  const uint8_t *replayData = replay.data + replayHeader->headerSize;
+  uint32_t replayBytes = replay.totalBytes - replayHeader->headerSize;
+  if (replayHeader->version == RIDE_LOG_VERSION_RAW32) {
+    simConfig.intervalsUs = (const uint32_t *)replayData;
+    simConfig.intervalCount = replayBytes / sizeof(uint32_t);
+  } else {
+    simConfig.encoded = replayData;
+    simConfig.encodedBytes = replayBytes;
+  }
+  ESP_LOGI(TAG, "REED Simulation: replaying ride log #%lu (v%u, %lu bytes).",
+           (unsigned long)replay.logSeq, replayHeader->version, (unsigned long)replayBytes);
+#else
+  // Állandó sebesség a megadott ideig
+  static PulseSimSegment_t constant[1];
   if (SIMULATED_SPEED_KMH <= 0 || SIMULATION_DURATION_MINUTES <= 0) {
     ESP_LOGW(TAG, "Simulated speed or duration is 0 or negative. Simulation "
                   "task stopping.");
     vTaskDelete(NULL);
     return;
   }
+  constant[0] = {(float)SIMULATED_SPEED_KMH, (float)SIMULATED_SPEED_KMH,
+                 (uint32_t)SIMULATION_DURATION_MINUTES * 60 * 1000};
+  simConfig.segments = constant;
+  simConfig.segmentCount = 1;
+  ESP_LOGI(TAG, "REED Simulation: %.1f km/h for %d minutes.", SIMULATED_SPEED_KMH,
+           SIMULATION_DURATION_MINUTES);
+#endif
 
-  // Számítások a szimulációhoz
-  const double speed_mps = SIMULATED_SPEED_KMH / 3.6;
-  const double wheel_circumference_m = M_PI * WHEEL_DIAMETER_M;
-  const double revolutions_per_sec = speed_mps / wheel_circumference_m;
-  const double pulses_per_sec = revolutions_per_sec * PULSES_PER_REVOLUTION;
-
-  if (pulses_per_sec <= 0) {
-    ESP_LOGW(TAG, "Calculated pulses_per_sec is 0 or negative. Simulation task "
-                  "stopping.");
+  pulseSimTask = xTaskGetCurrentTaskHandle();
+  pulsesim_init(&pulseSim, &simConfig, esp_timer_get_time());
+  if (!pulsesim_next(&pulseSim, &pulseSimNextUs, &pulseSimNextBounce)) {
+    ESP_LOGW(TAG, "Simulation profile produces no pulses. Simulation task stopping.");
     vTaskDelete(NULL);
     return;
   }
 
-  const uint32_t delay_between_pulses_ms =
-      (uint32_t)((1.0 / pulses_per_sec) * 1000.0);
-
-  if (delay_between_pulses_ms == 0) {
-    ESP_LOGW(TAG, "Delay between pulses is 0 (speed too high or config error). "
-                  "Task stopping.");
+  const esp_timer_create_args_t timerArgs = {
+      .callback = pulse_sim_timer_callback,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "pulse_sim",
+      .skip_unhandled_events = false,
+  };
+  if (esp_timer_create(&timerArgs, &pulseSimTimer) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create simulation timer! Simulation task stopping.");
     vTaskDelete(NULL);
     return;
   }
+  int64_t firstDelayUs = pulseSimNextUs - esp_timer_get_time();
+  esp_timer_start_once(pulseSimTimer, firstDelayUs > 0 ? firstDelayUs : 1);
+
+  // Az élek a timerből jönnek; itt csak az állapotot naplózzuk a végéig
+  while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10000)) == 0) {
+    ESP_LOGI(TAG, "REED Simulation: %.1f km/h, %lu pulses, %lu bounce edges, %lu missed, backlog max %u",
+             pulsesim_speed_kmh(&pulseSim), (unsigned long)pulseSim.realEdges,
+             (unsigned long)pulseSim.bounceEdgesOut, (unsigned long)pulseSim.missedPulses,
+             (unsigned)pulseSimMaxBacklog);
+  }
+  esp_timer_delete(pulseSimTimer);
+  pulseSimTimer = NULL;
+
+  ESP_LOGI(TAG, "REED Simulation finished: %lu pulses, %lu bounce edges, %lu missed; debounce accepted %lu, rejected chatter %lu early %lu cold %lu.",
+           (unsigned long)pulseSim.realEdges, (unsigned long)pulseSim.bounceEdgesOut,
+           (unsigned long)pulseSim.missedPulses, (unsigned long)reedDebounce.accepted,
+           (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_CHATTER],
+           (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_EARLY],
+           (unsigned long)reedDebounce.rejected[DEBOUNCE_REJECT_COLD]);
+  if (pulseSimLostReal > 0) {
+    ESP_LOGI(TAG, "Pipeline limit: clean up to %.0f Hz, first lost pulse at %.0f Hz (%lu lost, backlog max %u).",
+             pulseSimCleanHz, pulseSimFirstLossHz, (unsigned long)pulseSimLostReal,
+             (unsigned)pulseSimMaxBacklog);
+  } else {
+    ESP_LOGI(TAG, "Pipeline limit: no lost pulses up to %.0f Hz (backlog max %u).",
+             pulseSimCleanHz, (unsigned)pulseSimMaxBacklog);
+  }
 
-  ESP_LOGI(TAG, "Simulation details: Speed: %.2f m/s, Circumference: %.3f m, "
-                "RPS: %.3f, PPS: %.3f, Delay: %lu ms",
-           speed_mps, wheel_circumference_m, revolutions_per_sec,
-           pulses_per_sec, delay_between_pulses_ms);
-
-  const int64_t simulation_start_time_us = esp_timer_get_time();
-  const int64_t simulation_duration_us = (int64_t)SIMULATION_DURATION_MINUTES *
-                                         60 * 1000 * 1000; // Mikroszekundumban
+  // Az utolsó impulzus ideje már be van állítva, az inaktivitás figyelő innen számolhat.
+  ESP_LOGI(TAG, "REED Simulation task finished and self-deleted.");
+  vTaskDelete(NULL); // Task törlése
+}
 
-  while (1) {
-    // Ellenőrizzük, hogy lejárt-e a szimulációs idő
-    if ((esp_timer_get_time() - simulation_start_time_us) >=
-        simulation_duration_us) {
-      ESP_LOGI(TAG, "Simulation duration of %d minutes reached. Stopping "
-                    "simulation task.",
-               SIMULATION_DURATION_MINUTES);
-      // Az utolsó impulzus ideje már be van állítva, az inaktivitás figyelő
-      // innen számolhat.
-      break; // Kilépés a while ciklusból
+// --- Soros port riport (ütemezett munka, PIPELINE_REPORT_S-enként) ---
+static void serial_report_job(void *arg) {
+    // Impulzus-feldolgozási számlálók induláskor óta
+    PipelineCounters_t pc;
+    pipeline_counters(&pc);
+    ESP_LOGI(TAG, "Pipeline: seen %lu, accepted %lu, processed %lu, skipped %lu, max backlog %lu, max delay %lu us",
+             (unsigned long)pc.value[PIPELINE_EDGES_SEEN],
+             (unsigned long)pc.value[PIPELINE_EDGES_ACCEPTED],
+             (unsigned long)pc.value[PIPELINE_PULSES_PROCESSED],
+             (unsigned long)pc.value[PIPELINE_UPDATES_SKIPPED],
+             (unsigned long)pc.value[PIPELINE_MAX_BACKLOG],
+             (unsigned long)pc.value[PIPELINE_MAX_DELAY_US]);
+    BinLogStats_t bl = binlog_stats();
+    ESP_LOGI(TAG, "Binlog: %lu written, %lu dropped, max fill %lu/%d, %lu cycles/entry",
+             (unsigned long)bl.written, (unsigned long)bl.dropped, (unsigned long)bl.maxFill,
+             BINLOG_SLOTS, (unsigned long)(bl.written ? bl.cycles / bl.written : 0));
+    sched_report();
+    // Impulzus -> képpont késleltetés az előző riport óta
+    for (int st = 0; st < LATENCY_STAGE_COUNT; st++) {
+        LatencySummary_t ls;
+        pulse_latency_summary((LatencyStage_t)st, &ls, true);
+        if (ls.count == 0) continue;
+        ESP_LOGI(TAG, "Latency %-13s: %lu x p50 %lu us p99 %lu us max %lu us",
+                 pulse_latency_stage_name((LatencyStage_t)st), (unsigned long)ls.count,
+                 (unsigned long)ls.p50Us, (unsigned long)ls.p99Us, (unsigned long)ls.maxUs);
     }
-
-    vTaskDelay(pdMS_TO_TICKS(delay_between_pulses_ms));
-
-    // Ellenőrizzük újra az időt a vTaskDelay után, hogy ne generáljunk
-    // impulzust, ha már lejárt az idő
-    if ((esp_timer_get_time() - simulation_start_time_us) >=
-        simulation_duration_us) {
-      ESP_LOGI(TAG, "Simulation duration reached during delay. Stopping "
-                    "simulation task.");
-      break;
+    energy_report();
+    idle_ladder_report();
+    uint32_t droppedEdges = pulse_latency_dropped_count();
+    if (droppedEdges) ESP_LOGW(TAG, "Pulse queue full: %lu edges dropped", (unsigned long)droppedEdges);
+    SensorData_t dataToPrint;
+
+    uint64_t local_daily_trip_start_pulses = dailyTripStartPulseCount; // Olvassuk ki az RTC változót
+    uint64_t current_total_p = pulseCount.load(std::memory_order_relaxed);
+    uint64_t current_daily_p = 0;
+    if (current_total_p >= local_daily_trip_start_pulses) {
+         current_daily_p = current_total_p - local_daily_trip_start_pulses;
     }
 
-    // Szimuláljuk az ISR működését
-    pulseCount.fetch_add(1, std::memory_order_relaxed);
-    lastPulseTimeUs.store(esp_timer_get_time(), std::memory_order_relaxed);
-
-    // ÚJ: impulzus jelzése a számoló (calculation_and_control) tasknak
-    {
-      BaseType_t xHPTW = pdFALSE;
-      xSemaphoreGiveFromISR(xPulseSemaphore, &xHPTW);
-      if (xHPTW) portYIELD_FROM_ISR();
+    if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        dataToPrint = sharedSensorData;
+        PulseValidatorStats_t health = pulseHealth;
+        xSemaphoreGive(xDataMutex);
+        ESP_LOGI(TAG, "Sensor health: %lu intervals, %lu missed restored (%lu late), %lu phantom dropped, %lu implausible",
+                 (unsigned long)health.checked, (unsigned long)health.missed,
+                 (unsigned long)health.lateMissed, (unsigned long)health.phantom,
+                 (unsigned long)health.implausible);
+        /*ESP_LOGI(TAG, "Speed: %.2f km/h, Daily: %.2f km, Total: %.2f km, Moving: %lu sec | TP: %llu, DSP: %llu, CDP: %llu",
+               dataToPrint.speedKmh,
+               dataToPrint.dailyDistanceKm,
+               dataToPrint.totalDistanceKm,
+               (unsigned long)dataToPrint.movingTimeSeconds,
+               current_total_p,
+               local_daily_trip_start_pulses,
+               current_daily_p);*/
+    } else {
+        ESP_LOGW(TAG, "Serial report job couldn't get mutex for printing!");
     }
+}
 
-    // ESP_LOGD(TAG, "Simulated pulse. Count: %llu",
-    // pulseCount.load(std::memory_order_relaxed));
-  }
-
-  ESP_LOGI(TAG, "REED Simulation task finished and self-deleted.");
-  vTaskDelete(NULL); // Task törlése
+// --- Gombok (eseményvezérelt ütemezett munkák) ---
+// Mindkét gomb élére a GPIO ISR élesíti a mintavételt BUTTON_SETTLE_MS
+// múlvára; minden újabb pergés-él újraindítja, így a munka már a nyugodt
+// állapotot olvassa. Korábban a loop() 100 ms-onként, a nullázó gomb taskja
+// 50 ms-onként ébredt akkor is, ha senki nem nyúlt a gombokhoz.
+static void IRAM_ATTR button_isr_handler(void *arg) {
+    BaseType_t hptw = pdFALSE;
+    sched_arm_from_isr(buttonSettleJob, &hptw);
+    if (hptw) portYIELD_FROM_ISR();
 }
 
-// --- Soros Portra Küldő Task ---
-void serial_output_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Serial output task started.");
-    uint64_t local_daily_trip_start_pulses;
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(REPORTING_INTERVAL_MS));
-        SensorData_t dataToPrint;
-
-        local_daily_trip_start_pulses = dailyTripStartPulseCount; // Olvassuk ki az RTC változót
-        uint64_t current_total_p = pulseCount.load(std::memory_order_relaxed);
-        uint64_t current_daily_p = 0;
-        if (current_total_p >= local_daily_trip_start_pulses) {
-             current_daily_p = current_total_p - local_daily_trip_start_pulses;
-        }
+static void buttons_settle_job(void *arg) {
+    static bool resetBtnPressed = false;
 
-        if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-            dataToPrint = sharedSensorData;
-            xSemaphoreGive(xDataMutex);
-            /*ESP_LOGI(TAG, "Speed: %.2f km/h, Daily: %.2f km, Total: %.2f km, Moving: %lu sec | TP: %llu, DSP: %llu, CDP: %llu",
-                   dataToPrint.speedKmh,
-                   dataToPrint.dailyDistanceKm,
-                   dataToPrint.totalDistanceKm,
-                   (unsigned long)dataToPrint.movingTimeSeconds,
-                   current_total_p,
-                   local_daily_trip_start_pulses,
-                   current_daily_p);*/
-        } else {
-            ESP_LOGW(TAG, "Serial task couldn't get mutex for printing!");
-        }
+    // Képváltás rögzítő gomb: lenyomáskor vált
+    kepfix = digitalRead(BUTTON_PIN);
+    if (kepfix == LOW && oldkepfix == HIGH) {
+        keptoggle = !keptoggle;
+        idle_ladder_activity();
+        ESP_LOGD(TAG, "Button state changed: %d", keptoggle);
     }
-}
+    oldkepfix = kepfix;
 
-// --- Napi Út Nullázó és Kontextusfüggő Reset Gomb Figyelő Task ---
-void reset_button_monitor_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Reset button monitor task started (GPIO%d).", RESET_DAILY_BTN_PIN);
+    // Napi nullázó gomb: lenyomáskor indul a nyomva tartás időzítése
+    bool pressed = gpio_get_level(RESET_DAILY_BTN_PIN) == 0;
+    if (pressed && !resetBtnPressed) {
+        idle_ladder_activity();
+        sched_arm(resetHoldJob);
+        ESP_LOGD(TAG, "Reset button (GPIO%d) pressed down.", RESET_DAILY_BTN_PIN);
+    } else if (!pressed && resetBtnPressed) {
+        sched_cancel(resetHoldJob);
+        ESP_LOGD(TAG, "Reset button (GPIO%d) released.", RESET_DAILY_BTN_PIN);
+    }
+    resetBtnPressed = pressed;
+}
 
-    TickType_t button_press_start_time = 0;
-    bool button_currently_pressed = false;
-    bool reset_action_taken_this_press = false;
+// --- Napi Út Nullázó és Kontextusfüggő Reset (RESET_BUTTON_HOLD_TIME_MS nyomva tartás után) ---
+static void reset_hold_job(void *arg) {
+    if (gpio_get_level(RESET_DAILY_BTN_PIN) != 0) return; // Közben felengedték
 
-    while(1) {
-        vTaskDelay(pdMS_TO_TICKS(RESET_BUTTON_POLL_INTERVAL_MS));
+    DisplayState_t currentDisplayState = DISPLAY_SPEED; // Default érték
+    
+    // Aktuális kijelző állapot lekérése
+    if (xDisplayStateMutex != NULL && xSemaphoreTake(xDisplayStateMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        currentDisplayState = sharedDisplayState;
+        xSemaphoreGive(xDisplayStateMutex);
+    } else {
+        ESP_LOGW(TAG, "Reset hold job couldn't get display state mutex!");
+    }
 
-        int button_state = gpio_get_level(RESET_DAILY_BTN_PIN);
+    // Kontextusfüggő reset végrehajtása
+    switch (currentDisplayState) {
+        case DISPLAY_DAILY_DISTANCE:
+            ESP_LOGI(TAG, "Reset button held - resetting DAILY distance.");
+            {
+                uint64_t current_total_pulses_for_reset = pulseCount.load(std::memory_order_relaxed);
+                wheel_reset_daily(current_total_pulses_for_reset);
+                ESP_LOGI(TAG, "Daily trip start pulse count set to: %llu", dailyTripStartPulseCount);
+
+                if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                    sharedSensorData.dailyDistanceKm = 0.0;
+                    xSemaphoreGive(xDataMutex);
+                    ESP_LOGI(TAG, "Shared daily distance updated to 0 km.");
+                }
+            }
+            break;
 
-        if (button_state == 0) { // Gomb lenyomva (LOW)
-            if (!button_currently_pressed) { // Éppen most nyomták le
-                button_currently_pressed = true;
-                button_press_start_time = xTaskGetTickCount();
-                reset_action_taken_this_press = false;
-                ESP_LOGD(TAG, "Reset button (GPIO%d) pressed down.", RESET_DAILY_BTN_PIN);
+        case DISPLAY_MAX_SPEED:
+            ESP_LOGI(TAG, "Reset button held - resetting MAX speed.");
+            if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                maxSpeedKmh = 0.0;
+                xSemaphoreGive(xDataMutex);
             }
+            break;
 
-            if (button_currently_pressed && !reset_action_taken_this_press) {
-                if ((xTaskGetTickCount() - button_press_start_time) * portTICK_PERIOD_MS >= RESET_BUTTON_HOLD_TIME_MS) {
-                    // Hosszú nyomás észlelve - kontextusfüggő reset
-                    DisplayState_t currentDisplayState = DISPLAY_SPEED; // Default érték
-                    
-                    // Aktuális kijelző állapot lekérése
-                    if (xDisplayStateMutex != NULL && xSemaphoreTake(xDisplayStateMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                        currentDisplayState = sharedDisplayState;
-                        xSemaphoreGive(xDisplayStateMutex);
-                    } else {
-                        ESP_LOGW(TAG, "Reset task couldn't get display state mutex!");
-                    }
+        case DISPLAY_AVERAGE_SPEED:
+            ESP_LOGI(TAG, "Reset button held - resetting AVERAGE speed.");
+            if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                autopause_reset_average(&autoPause, sharedSensorData.totalDistanceKm);
+                sharedSensorData.averageSpeedKmh = 0.0;
+                xSemaphoreGive(xDataMutex);
+                ESP_LOGI(TAG, "Average speed calculation restarted from %.3f km",
+                         autoPause.avgStartDistanceKm);
+            }
+            break;
 
-                    // Kontextusfüggő reset végrehajtása
-                    switch (currentDisplayState) {
-                        case DISPLAY_DAILY_DISTANCE:
-                            ESP_LOGI(TAG, "Reset button held - resetting DAILY distance.");
-                            {
-                                uint64_t current_total_pulses_for_reset = pulseCount.load(std::memory_order_relaxed);
-                                dailyTripStartPulseCount = current_total_pulses_for_reset;
-                                ESP_LOGI(TAG, "Daily trip start pulse count set to: %llu", dailyTripStartPulseCount);
-
-                                if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                                    sharedSensorData.dailyDistanceKm = 0.0;
-                                    xSemaphoreGive(xDataMutex);
-                                    ESP_LOGI(TAG, "Shared daily distance updated to 0 km.");
-                                }
-                            }
-                            break;
-
-                        case DISPLAY_MAX_SPEED:
-                            ESP_LOGI(TAG, "Reset button held - resetting MAX speed.");
-                            maxSpeedKmh = 0.0;
-                            break;
-
-                        case DISPLAY_AVERAGE_SPEED:
-                            ESP_LOGI(TAG, "Reset button held - resetting AVERAGE speed.");
-                            if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                                startTotalDistanceKm = sharedSensorData.totalDistanceKm;
-                                xSemaphoreGive(xDataMutex);
-                            }
-                            totalMovingTimeUs = 0;
-                            averageSpeedKmh = 0.0;
-                            ESP_LOGI(TAG, "Average speed calculation restarted from %.3f km", startTotalDistanceKm);
-                            break;
-
-                        case DISPLAY_MOVEMENT_TIME:
-                            ESP_LOGI(TAG, "Reset button held - resetting MOVEMENT time.");
-                            if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                                sharedSensorData.movingTimeSeconds = 0;
-                                xSemaphoreGive(xDataMutex);
-                                ESP_LOGI(TAG, "Movement time reset to 0 in sharedSensorData.");
-                            }
-                            // Mentés NVS-be is
-                            save_moving_time_to_nvs(0);
-                            break;
-
-                        case DISPLAY_SPEED:
-                            ESP_LOGI(TAG, "Reset button held on SPEED display - no reset action defined.");
-                            break;
-
-                        case DISPLAY_TOTAL_DISTANCE:
-                            ESP_LOGI(TAG, "Reset button held on TOTAL distance - reset NOT ALLOWED for safety.");
-                            break;
-
-                        default:
-                            ESP_LOGW(TAG, "Reset button held - unknown display state: %d", currentDisplayState);
-                            break;
-                    }
-                    
-                    reset_action_taken_this_press = true;
-                }
+        case DISPLAY_MOVEMENT_TIME:
+            ESP_LOGI(TAG, "Reset button held - resetting MOVEMENT time.");
+            if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                autopause_reset_moving(&autoPause);
+                sharedSensorData.movingTimeSeconds = 0;
+                xSemaphoreGive(xDataMutex);
+                ESP_LOGI(TAG, "Movement time reset to 0 in sharedSensorData.");
             }
-        } else { // Gomb felengedve (HIGH)
-            if (button_currently_pressed) {
-                ESP_LOGD(TAG, "Reset button (GPIO%d) released.", RESET_DAILY_BTN_PIN);
-                button_currently_pressed = false;
-                reset_action_taken_this_press = false;
+            // Mentés NVS-be is
+            save_moving_time_to_nvs(0);
+            break;
+
+        case DISPLAY_SPEED:
+            // Sebesség képernyőn: következő kerékprofil
+            {
+                uint8_t next = (wheel_calib().profileIndex + 1) % wheel_profile_count();
+                ESP_LOGI(TAG, "Reset button held on SPEED display - switching wheel profile to %u.", next);
+                wheel_select_profile(next, pulseCount.load(std::memory_order_relaxed));
             }
-        }
+            break;
+
+        case DISPLAY_TOTAL_DISTANCE:
+            ESP_LOGI(TAG, "Reset button held on TOTAL distance - reset NOT ALLOWED for safety.");
+            break;
+
+        default:
+            ESP_LOGW(TAG, "Reset button held - unknown display state: %d", currentDisplayState);
+            break;
     }
 }
 
@@ -706,10 +1047,39 @@ void init_gps_uart(void) {
            GPS_TX_PIN, GPS_RX_PIN);
 }
 
+// --- Ütemezett munkák felvétele és a gomb megszakítások bekötése ---
+static esp_err_t start_scheduled_jobs(void) {
+    sched_every("nvs_save", NVS_SAVE_INTERVAL_MS, nvs_save_job, NULL);
+    sched_every("inactivity", INACTIVITY_CHECK_MS, inactivity_job, NULL);
+#if PIPELINE_REPORT_S > 0
+    sched_every("serial_report", PIPELINE_REPORT_S * 1000, serial_report_job, NULL);
+#endif
+    buttonSettleJob = sched_add("buttons", BUTTON_SETTLE_MS, false, buttons_settle_job, NULL);
+    resetHoldJob = sched_add("reset_hold", RESET_BUTTON_HOLD_TIME_MS, false, reset_hold_job, NULL);
+    if (buttonSettleJob == SCHED_NO_JOB || resetHoldJob == SCHED_NO_JOB) return ESP_ERR_NO_MEM;
+    ESP_LOGI(TAG, "Scheduled: NVS save every %d min, inactivity check every %d s, buttons on GPIO%d/GPIO%d edges.",
+             NVS_SAVE_INTERVAL_MS / (60 * 1000), INACTIVITY_CHECK_MS / 1000, BUTTON_PIN, RESET_DAILY_BTN_PIN);
+
+    // A REED ág már telepíthette (szimulációban nem)
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return err;
+    err = gpio_isr_handler_add(BUTTON_PIN, button_isr_handler, NULL);
+    if (err == ESP_OK) err = gpio_isr_handler_add(RESET_DAILY_BTN_PIN, button_isr_handler, NULL);
+    if (err != ESP_OK) return err;
+
+    sched_arm(buttonSettleJob); // Kiinduló gombállapot
+    return ESP_OK;
+}
+
 // --- Main (app_main) ---
 void setup()
 {
     ESP_LOGI(TAG, "Starting Wheel Sensor Application V3 (Corrected Sleep Logic)");
+    binlog_init(); // A forró ágak naplója innentől a gyűrűbe megy
+    if (sched_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start scheduler! Halting.");
+        return;
+    }
 
     // NVS inicializálása és handle megnyitása
     esp_err_t nvs_err = init_nvs();
@@ -718,8 +1088,17 @@ void setup()
         return;
     }
 
+    // Menettörténet partíció (hiba esetén a többi funkció működik tovább)
+    if (ride_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Ride history unavailable.");
+    }
+    if (ride_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Ride log unavailable.");
+    }
+
     // MUTEX LÉTREHOZÁSA KORÁN (mielőtt bármilyen sharedSensorData műveletet végeznénk)
-    xDataMutex = xSemaphoreCreateMutex();
+    static StaticSemaphore_t dataMutexBuffer;
+    xDataMutex = xSemaphoreCreateMutexStatic(&dataMutexBuffer);
     if (xDataMutex == NULL) {
         ESP_LOGE(TAG, "Failed to create data mutex! Halting.");
         if (g_nvs_handle) nvs_close(g_nvs_handle);
@@ -727,7 +1106,8 @@ void setup()
     }
 
     // Új: Display state mutex létrehozása
-    xDisplayStateMutex = xSemaphoreCreateMutex();
+    static StaticSemaphore_t displayStateMutexBuffer;
+    xDisplayStateMutex = xSemaphoreCreateMutexStatic(&displayStateMutexBuffer);
     if (xDisplayStateMutex == NULL) {
         ESP_LOGE(TAG, "Failed to create display state mutex! Halting.");
         if (g_nvs_handle) nvs_close(g_nvs_handle);
@@ -735,20 +1115,24 @@ void setup()
         return;
     }
 
+    // Kerékprofilok betöltése (a távolságszámítás előtt)
+    wheel_profiles_init();
+
     // JAVÍTÁS: Kilométeróra beállítása 75 km-re (csak egyszer!)
     //const double targetDistanceKm = 220.0;
 #if SET_INITIAL_ODOMETER == 1
-    const double wheelCircumferenceM = M_PI * WHEEL_DIAMETER_M;
+    const WheelCalib_t initCalib = wheel_calib();
+    const double wheelCircumferenceM = initCalib.circumferenceM;
     const double targetDistanceM = INITIAL_TOTAL_KM * 1000.0;
     const double revolutionsNeeded = targetDistanceM / wheelCircumferenceM;
-    const uint64_t pulsesNeeded = (uint64_t)(revolutionsNeeded * PULSES_PER_REVOLUTION);
+    const uint64_t pulsesNeeded = (uint64_t)(revolutionsNeeded * initCalib.pulsesPerRev);
     
     ESP_LOGI(TAG, "Target: %.1f km = %.0f m = %.2f rev = %llu pulses", 
              targetDistanceM / 1000.0, targetDistanceM, revolutionsNeeded, pulsesNeeded);
     save_total_pulses_to_nvs(pulsesNeeded);
     pulseCount.store(pulsesNeeded, std::memory_order_relaxed);
     double currentKm =
-        ((double)pulsesNeeded / PULSES_PER_REVOLUTION) *
+        ((double)pulsesNeeded / initCalib.pulsesPerRev) *
         wheelCircumferenceM / 1000.0;
 #endif
 
@@ -798,8 +1182,7 @@ void setup()
         default:
             bootCount = 0;
             ESP_LOGI(TAG, "Cold boot: dailyTripStartPulseCount set to %llu pulses", pulseCount.load(std::memory_order_relaxed));
-            dailyTripStartPulseCount = pulseCount.load(std::memory_order_relaxed);
-            lastPulseTimeUs.store(0, std::memory_order_relaxed);
+            wheel_reset_daily(pulseCount.load(std::memory_order_relaxed));
             
             // POWER-ON: Mozgási idő nullázása (MOST MÁR VAN MUTEX!)
             if (xSemaphoreTake(xDataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
@@ -814,6 +1197,7 @@ void setup()
           // WiFi és OTA csak cold-bootkor
           WiFi.mode(WIFI_AP);
           if (WiFi.softAP(WIFI_SSID, WIFI_PASS, 6)) {
+            energy_set_wifi(true);
             ESP_LOGI(TAG,
                      "WiFi AP started successfully on channel 6 with SSID: %s",
                      WIFI_SSID);
@@ -834,21 +1218,18 @@ void setup()
             ArduinoOTA.begin();
             ESP_LOGI(TAG, "OTA Ready");
           //}
+          // Menetnaplók letöltése az AP ablak alatt (a WiFi lekapcsolásáig)
+          log_server_start();
 
-          // egyszer futó timer 10 perc múlva WiFi lekapcsoláshoz
-          wifiOffTimer = xTimerCreate(
-              "WiFiOffTimer",
-              pdMS_TO_TICKS(10 * 60 * 1000),
-              pdFALSE,
-              NULL,
-              wifiOffTimerCallback
-          );
-          if (wifiOffTimer) {
-              xTimerStart(wifiOffTimer, 0);
-          }
+          // egyszer futó munka 10 perc múlva WiFi lekapcsoláshoz
+          sched_after("wifi_off", 10 * 60 * 1000, wifi_off_job, NULL);
           break;
     }
 
+    // Energia elszámolás: ébredéskor a mélyalvás ideje is hozzáadódik
+    energy_init(bootCount == 0);
+    energy_set_cpu_mhz(getCpuFrequencyMhz());
+
     // GPIO konfiguráció UTÁN a mutex létrehozása után
     gpio_config_t io_conf_reed = {};
     io_conf_reed.intr_type = GPIO_INTR_NEGEDGE;
@@ -859,6 +1240,7 @@ void setup()
     ESP_LOGI(TAG, "REED GPIO %d configured.", REED_SWITCH_PIN);
 
     gpio_config_t io_conf_button = {};
+    io_conf_button.intr_type = GPIO_INTR_ANYEDGE; // Pergés utáni mintavétel az ütemezőben
     io_conf_button.pin_bit_mask = (1ULL << BUTTON_PIN);
     io_conf_button.mode = GPIO_MODE_INPUT;
     io_conf_button.pull_up_en = GPIO_PULLUP_ENABLE;
@@ -866,6 +1248,7 @@ void setup()
     ESP_LOGI(TAG, "Wakeup Button GPIO %d configured.", BUTTON_PIN);
 
     gpio_config_t io_conf_reset_btn = {};
+    io_conf_reset_btn.intr_type = GPIO_INTR_ANYEDGE;
     io_conf_reset_btn.pin_bit_mask = (1ULL << RESET_DAILY_BTN_PIN);
     io_conf_reset_btn.mode = GPIO_MODE_INPUT;
     io_conf_reset_btn.pull_up_en = GPIO_PULLUP_DISABLE;
@@ -873,7 +1256,44 @@ void setup()
     gpio_config(&io_conf_reset_btn);
     ESP_LOGI(TAG, "Reset Daily Button GPIO %d configured (EXTERNAL PULL-UP NEEDED!).", RESET_DAILY_BTN_PIN);
 
+    // Tétlenségi lépcső; a light sleep ezekre a lábakra ébred (a REED az első).
+    // A REED GPIO megszakítása csak akkor él, ha van kezelője (GPIO ISR út vagy diagnosztika)
+    static const IdleWakePin_t idleWakePins[] = {
+#if SIMULATE_REED_INPUT == 0 && (PULSE_CAPTURE_MODE == PULSE_CAPTURE_GPIO_ISR || PULSE_CAPTURE_DIAG == 1)
+        {REED_SWITCH_PIN, GPIO_INTR_NEGEDGE},
+#else
+        {REED_SWITCH_PIN, GPIO_INTR_DISABLE},
+#endif
+        {BUTTON_PIN, GPIO_INTR_ANYEDGE},
+        {RESET_DAILY_BTN_PIN, GPIO_INTR_ANYEDGE},
+    };
+    idle_ladder_init(bootCount == 0, idleWakePins, sizeof(idleWakePins) / sizeof(idleWakePins[0]),
+                     idle_wake_handler);
+
+    debounce_init(&reedDebounce, &reedDebounceConfig);
+
+    // Impulzus sor létrehozása (még az ISR-ek bekötése előtt)
+    static StaticQueue_t pulseQueueBuffer;
+    static uint8_t pulseQueueStorage[PULSE_QUEUE_LEN * sizeof(int64_t)];
+    xPulseQueue = xQueueCreateStatic(PULSE_QUEUE_LEN, sizeof(int64_t), pulseQueueStorage, &pulseQueueBuffer);
+    if (!xPulseQueue) {
+        ESP_LOGE(TAG, "Failed to create pulse queue!");
+        return;
+    }
+
 #if SIMULATE_REED_INPUT == 0
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_MCPWM || PULSE_CAPTURE_DIAG == 1
+    // Hardveres időbélyegzés; diagnosztikában csak összevetésre, ha a GPIO út táplál
+    esp_err_t cap_err = pulse_capture_init(
+        PULSE_CAPTURE_MODE == PULSE_CAPTURE_MCPWM ? pulse_edge_from_isr : NULL);
+    if (cap_err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start MCPWM pulse capture: %s. Halting.", esp_err_to_name(cap_err));
+        if (g_nvs_handle) nvs_close(g_nvs_handle);
+        vSemaphoreDelete(xDataMutex);
+        return;
+    }
+#endif
+#if PULSE_CAPTURE_MODE == PULSE_CAPTURE_GPIO_ISR || PULSE_CAPTURE_DIAG == 1
     esp_err_t isr_err = gpio_install_isr_service(0);
      if (isr_err != ESP_OK && isr_err != ESP_ERR_INVALID_STATE) {
         ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s. Halting.", esp_err_to_name(isr_err));
@@ -895,38 +1315,22 @@ void setup()
     } else {
          ESP_LOGI(TAG, "ISR handler added for REED GPIO %d", REED_SWITCH_PIN);
     }
+#endif
 #else
   ESP_LOGW(TAG, "REED Simulation is ACTIVE. Real REED ISR is NOT attached.");
 #endif
-    // Impulzus semafor létrehozása
-    xPulseSemaphore = xSemaphoreCreateCounting(UINT32_MAX, 0);
-    if (!xPulseSemaphore) {
-        ESP_LOGE(TAG, "Failed to create pulse semaphore!");
-        return;
-    }
-
-    BaseType_t task_created;
-    task_created = xTaskCreate(calculation_and_control_task, "calc_ctrl_task", 4096, NULL, 5, NULL);
-    if (task_created != pdPASS) { ESP_LOGE(TAG, "Failed to create calculation_and_control_task! Halting."); /* Cleanup... */ return; }
 
-    /*task_created = xTaskCreate(serial_output_task, "serial_task", 4096, NULL, 4, NULL);
-    if (task_created != pdPASS) { ESP_LOGE(TAG, "Failed to create serial_output_task! Halting."); /* Cleanup... * return; } */
+    // Statikus stackek, magokhoz rendelve (TASK_AFFINITY_MODE)
+    if (task_start(TASK_CALC, calculation_and_control_task, NULL) != ESP_OK) { ESP_LOGE(TAG, "Failed to create calculation_and_control_task! Halting."); /* Cleanup... */ return; }
 
-    task_created = xTaskCreate(nvs_save_task, "nvs_save_task", 4096, NULL, 3, NULL);
-    if (task_created != pdPASS) { ESP_LOGE(TAG, "Failed to create nvs_save_task! Halting."); /* Cleanup... */ return; }
+    if (task_start(TASK_GUI, guiTask, NULL) != ESP_OK) { ESP_LOGE(TAG, "Failed to create TFT task! Halting."); /* Cleanup... */ return; }
 
-    task_created = xTaskCreate(reset_button_monitor_task, "reset_btn_task", 2048, NULL, 6, NULL);
-    if (task_created != pdPASS) { ESP_LOGE(TAG, "Failed to create reset_button_monitor_task! Halting."); /* Cleanup... */ return; }
-
-    task_created = xTaskCreate(guiTask, "TFT task", 4096, NULL, 6, NULL);
-    if (task_created != pdPASS) { ESP_LOGE(TAG, "Failed to create TFT task! Halting."); /* Cleanup... */ return; }
-
-    xTaskCreate(inactivity_monitor_task, "inactivity_monitor", 2048, NULL, 3, NULL);
+    // NVS mentés, inaktivitás, soros riport és gombok: munkák az ütemező taskban
+    esp_err_t sched_err = start_scheduled_jobs();
+    if (sched_err != ESP_OK) { ESP_LOGE(TAG, "Failed to start scheduled jobs: %s! Halting.", esp_err_to_name(sched_err)); return; }
 
 #if SIMULATE_REED_INPUT == 1
-    task_created = xTaskCreate(reed_simulation_task, "reed_sim_task", 4096,
-                               NULL, 4, NULL);
-    if (task_created != pdPASS) {
+    if (task_start(TASK_REED_SIM, reed_simulation_task, NULL) != ESP_OK) {
       ESP_LOGE(TAG, "Failed to create REED simulation task! Halting.");
       return;
     } else {
@@ -934,16 +1338,14 @@ void setup()
     }
 #endif
 
+    task_jitter_start_report();
+
     ESP_LOGI(TAG, "Initialization complete. Tasks are running.");
     vTaskDelay(pdMS_TO_TICKS(100));
 }
 
 void loop() {
-    kepfix = digitalRead(BUTTON_PIN);
-    if (kepfix == LOW && oldkepfix == HIGH) {
-        keptoggle = !keptoggle;
-        ESP_LOGD(TAG, "Button state changed: %d", keptoggle);
-    }
-    oldkepfix = kepfix;
-    vTaskDelay(pdMS_TO_TICKS(100)); // Csak hogy ne terheljük túl a CPU-t
+    // A gombot az ütemező figyeli; az Arduino loop task stackje visszakerül a heapre
+    ESP_LOGI(TAG, "Arduino loop task retired, %d B stack returned to the heap.", SCHED_LOOP_STACK_BYTES);
+    vTaskDelete(NULL);
 }
\ No newline at end of file
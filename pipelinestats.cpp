@@ -0,0 +1,70 @@
+#include "pipelinestats.h"
+#include <atomic>
+
+// Összegző számlálók (ISR és task is írja)
+static std::atomic<uint32_t> edgesSeen(0);
+static std::atomic<uint32_t> edgesAccepted(0);
+static std::atomic<uint32_t> pulsesProcessed(0);
+static std::atomic<uint32_t> updatesSkipped(0);
+// Maximumok: csak a számoló task írja, bárki olvashatja
+static std::atomic<uint32_t> maxBacklog(0);
+static std::atomic<uint32_t> maxDelayUs(0);
+static std::atomic<uint32_t> rideMaxBacklog(0);
+static std::atomic<uint32_t> rideMaxDelayUs(0);
+
+static PipelineCounters_t rideBase = {};
+
+static const char *const counterNames[PIPELINE_COUNTER_COUNT] = {
+    "seen", "accepted", "processed", "skipped", "max_backlog", "max_delay_us",
+};
+
+void IRAM_ATTR pipeline_edge(bool accepted) {
+  edgesSeen.fetch_add(1, std::memory_order_relaxed);
+  if (accepted) edgesAccepted.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void raise_max(std::atomic<uint32_t> &max, uint32_t value) {
+  if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+}
+
+void pipeline_processed(int64_t delayUs, uint32_t backlog) {
+  pulsesProcessed.fetch_add(1, std::memory_order_relaxed);
+  uint32_t delay = delayUs < 0 ? 0 : (delayUs > UINT32_MAX ? UINT32_MAX : (uint32_t)delayUs);
+  raise_max(maxBacklog, backlog);
+  raise_max(maxDelayUs, delay);
+  raise_max(rideMaxBacklog, backlog);
+  raise_max(rideMaxDelayUs, delay);
+}
+
+void pipeline_skipped(void) {
+  updatesSkipped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void pipeline_counters(PipelineCounters_t *out) {
+  out->value[PIPELINE_EDGES_SEEN] = edgesSeen.load(std::memory_order_relaxed);
+  out->value[PIPELINE_EDGES_ACCEPTED] = edgesAccepted.load(std::memory_order_relaxed);
+  out->value[PIPELINE_PULSES_PROCESSED] = pulsesProcessed.load(std::memory_order_relaxed);
+  out->value[PIPELINE_UPDATES_SKIPPED] = updatesSkipped.load(std::memory_order_relaxed);
+  out->value[PIPELINE_MAX_BACKLOG] = maxBacklog.load(std::memory_order_relaxed);
+  out->value[PIPELINE_MAX_DELAY_US] = maxDelayUs.load(std::memory_order_relaxed);
+}
+
+void pipeline_ride_begin(void) {
+  pipeline_counters(&rideBase);
+  rideMaxBacklog.store(0, std::memory_order_relaxed);
+  rideMaxDelayUs.store(0, std::memory_order_relaxed);
+}
+
+void pipeline_ride_counters(PipelineCounters_t *out) {
+  pipeline_counters(out);
+  // Az összegek különbsége túlcsordulásnál is helyes (moduláris)
+  for (int i = PIPELINE_EDGES_SEEN; i <= PIPELINE_UPDATES_SKIPPED; i++) {
+    out->value[i] -= rideBase.value[i];
+  }
+  out->value[PIPELINE_MAX_BACKLOG] = rideMaxBacklog.load(std::memory_order_relaxed);
+  out->value[PIPELINE_MAX_DELAY_US] = rideMaxDelayUs.load(std::memory_order_relaxed);
+}
+
+const char *pipeline_counter_name(PipelineCounter_t counter) {
+  return counter < PIPELINE_COUNTER_COUNT ? counterNames[counter] : "?";
+}
@@ -0,0 +1,49 @@
+// pipelinestats.h
+// Mindig futó számlálók az impulzus-feldolgozási láncra: látott és
+// elfogadott élek, feldolgozott impulzusok, kihagyott metrika frissítések
+// (foglalt adat mutex), legnagyobb impulzus sor lemaradás és a leghosszabb
+// él -> feldolgozás késleltetés. Induláskori és menetenkénti nézet; a
+// menetenkénti értékek a menetrekordba kerülnek.
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+typedef enum {
+  PIPELINE_EDGES_SEEN,       // A pergésszűrőhöz érkezett élek
+  PIPELINE_EDGES_ACCEPTED,   // Impulzusként elfogadott élek
+  PIPELINE_PULSES_PROCESSED, // A számoló task által feldolgozott impulzusok
+  PIPELINE_UPDATES_SKIPPED,  // Impulzusok, amelyeknél a metrika frissítés elmaradt
+  PIPELINE_MAX_BACKLOG,      // Legnagyobb feldolgozatlan impulzusszám
+  PIPELINE_MAX_DELAY_US,     // Leghosszabb él -> feldolgozás idő
+  PIPELINE_COUNTER_COUNT
+} PipelineCounter_t;
+
+typedef struct {
+  uint32_t value[PIPELINE_COUNTER_COUNT];
+} PipelineCounters_t;
+
+// ISR-ből is hívható
+void IRAM_ATTR pipeline_edge(bool accepted);
+
+// Számoló task: egy impulzus feldolgozása, a várakozó impulzusok számával
+void pipeline_processed(int64_t delayUs, uint32_t backlog);
+void pipeline_skipped(void);
+
+// Induláskor óta
+void pipeline_counters(PipelineCounters_t *out);
+
+// Menetenként: a kezdetkor rögzített alaphoz képest, a maximumok csak erre a menetre
+void pipeline_ride_begin(void);
+void pipeline_ride_counters(PipelineCounters_t *out);
+
+const char *pipeline_counter_name(PipelineCounter_t counter);
+
+#endif
@@ -0,0 +1,184 @@
+#include "pulsecapture.h"
+#include <math.h>
+#include "config.h"
+#include "driver/mcpwm.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc.h"
+
+extern const char *TAG;
+
+#define CAPTURE_TICKS_PER_US (APB_CLK_FREQ / 1000000) // A capture időzítő APB órajelről jár
+// A 32 bites számláló ~53 s alatt fordul át; ennél rövidebb szünetig a
+// különbség egyértelmű, hosszabb után újra az esp_timer-hez igazítunk.
+#define CAPTURE_REANCHOR_US (40LL * 1000000LL)
+#define DIAG_PAIR_WINDOW_US 2000 // Ennyin belüli GPIO és hardveres él ugyanaz az esemény
+
+static PulseEdgeHandler_t edgeHandler = NULL;
+
+// Hardveres időbélyeg kiterjesztése 64 bitre, esp_timer időtartományban
+static DRAM_ATTR uint32_t lastCaptureTicks = 0;
+static DRAM_ATTR int64_t lastHwUs = 0;
+static DRAM_ATTR uint32_t tickRemainder = 0; // A mikroszekundumra nem osztható maradék
+static DRAM_ATTR bool anchored = false;
+
+// --- Diagnosztika: GPIO ISR vs. hardveres időbélyeg ---
+typedef struct {
+  uint32_t pairs;        // Összepárosított élek
+  uint32_t unmatchedIsr; // Párosítatlan GPIO ISR él
+  uint32_t unmatchedHw;  // Párosítatlan hardveres él
+  int64_t latSum, latSqSum, latMin, latMax;     // ISR késleltetés (us)
+  uint32_t jitterCount;
+  int64_t jitSum, jitSqSum, jitMaxAbs;          // Intervallum különbség (us)
+} CaptureDiag_t;
+
+static DRAM_ATTR CaptureDiag_t diag = {};
+static DRAM_ATTR int64_t pendingIsrUs = 0;
+static DRAM_ATTR int64_t pendingHwUs = 0;
+static DRAM_ATTR int64_t prevLatencyUs = 0;
+static DRAM_ATTR bool havePrevLatency = false;
+static portMUX_TYPE diagMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR diag_pair(int64_t isrUs, int64_t hwUs) {
+  int64_t lat = isrUs - hwUs;
+  diag.pairs++;
+  diag.latSum += lat;
+  diag.latSqSum += lat * lat;
+  if (diag.pairs == 1 || lat < diag.latMin) diag.latMin = lat;
+  if (diag.pairs == 1 || lat > diag.latMax) diag.latMax = lat;
+
+  // Két egymást követő késleltetés különbsége = dt_isr - dt_hw, ez kerül a sebességbe
+  if (havePrevLatency) {
+    int64_t jit = lat - prevLatencyUs;
+    int64_t absJit = jit < 0 ? -jit : jit;
+    diag.jitterCount++;
+    diag.jitSum += jit;
+    diag.jitSqSum += jit * jit;
+    if (absJit > diag.jitMaxAbs) diag.jitMaxAbs = absJit;
+  }
+  prevLatencyUs = lat;
+  havePrevLatency = true;
+}
+
+void IRAM_ATTR pulse_capture_diag_isr_edge(int64_t isrUs) {
+  portENTER_CRITICAL_ISR(&diagMux);
+  if (pendingHwUs != 0 && (isrUs - pendingHwUs) < DIAG_PAIR_WINDOW_US) {
+    diag_pair(isrUs, pendingHwUs);
+    pendingHwUs = 0;
+  } else {
+    if (pendingIsrUs != 0) diag.unmatchedIsr++;
+    pendingIsrUs = isrUs;
+  }
+  portEXIT_CRITICAL_ISR(&diagMux);
+}
+
+static void IRAM_ATTR diag_hw_edge(int64_t hwUs) {
+  portENTER_CRITICAL_ISR(&diagMux);
+  if (pendingIsrUs != 0 && (pendingIsrUs - hwUs) < DIAG_PAIR_WINDOW_US &&
+      (hwUs - pendingIsrUs) < DIAG_PAIR_WINDOW_US) {
+    diag_pair(pendingIsrUs, hwUs);
+    pendingIsrUs = 0;
+  } else {
+    if (pendingHwUs != 0) diag.unmatchedHw++;
+    pendingHwUs = hwUs;
+  }
+  portEXIT_CRITICAL_ISR(&diagMux);
+}
+
+// --- MCPWM capture callback ---
+static bool IRAM_ATTR capture_isr(mcpwm_unit_t unit, mcpwm_capture_channel_id_t channel,
+                                  const cap_event_data_t *edata, void *user_data) {
+  int64_t now = esp_timer_get_time();
+  uint32_t ticks = edata->cap_value;
+
+  if (!anchored || (now - lastHwUs) > CAPTURE_REANCHOR_US) {
+    // Hosszú szünet után az ISR idejéhez igazítunk; ennek a dt-je úgysem számít
+    lastHwUs = now;
+    tickRemainder = 0;
+    anchored = true;
+  } else {
+    uint32_t elapsed = (ticks - lastCaptureTicks) + tickRemainder; // Moduláris különbség
+    lastHwUs += elapsed / CAPTURE_TICKS_PER_US;
+    tickRemainder = elapsed % CAPTURE_TICKS_PER_US;
+  }
+  lastCaptureTicks = ticks;
+
+#if PULSE_CAPTURE_DIAG == 1
+  diag_hw_edge(lastHwUs);
+#endif
+
+  BaseType_t hptw = pdFALSE;
+  if (edgeHandler) edgeHandler(lastHwUs, &hptw);
+  return hptw == pdTRUE;
+}
+
+#if PULSE_CAPTURE_DIAG == 1
+static esp_timer_handle_t diagTimer = NULL;
+
+static void diag_timer_callback(void *arg) {
+  pulse_capture_diag_report();
+}
+#endif
+
+esp_err_t pulse_capture_init(PulseEdgeHandler_t handler) {
+  edgeHandler = handler;
+
+  esp_err_t err = mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM_CAP_0, REED_SWITCH_PIN);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "MCPWM capture GPIO init failed: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  mcpwm_capture_config_t conf = {};
+  conf.cap_edge = MCPWM_NEG_EDGE; // A REED lehúzza a lábat, mint a GPIO ISR-nél
+  conf.cap_prescale = 1;
+  conf.capture_cb = capture_isr;
+  conf.user_data = NULL;
+  err = mcpwm_capture_enable_channel(MCPWM_UNIT_0, MCPWM_SELECT_CAP0, &conf);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "MCPWM capture enable failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  ESP_LOGI(TAG, "MCPWM capture started on REED GPIO %d (%d ticks/us).", REED_SWITCH_PIN,
+           CAPTURE_TICKS_PER_US);
+
+#if PULSE_CAPTURE_DIAG == 1
+  const esp_timer_create_args_t timerArgs = {
+      .callback = diag_timer_callback,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "capture_diag",
+      .skip_unhandled_events = true,
+  };
+  if (esp_timer_create(&timerArgs, &diagTimer) == ESP_OK) {
+    esp_timer_start_periodic(diagTimer, (uint64_t)PULSE_CAPTURE_DIAG_REPORT_S * 1000000ULL);
+    ESP_LOGI(TAG, "Capture jitter diagnostics active, report every %d s.", PULSE_CAPTURE_DIAG_REPORT_S);
+  }
+#endif
+  return ESP_OK;
+}
+
+void pulse_capture_diag_report(void) {
+  CaptureDiag_t d;
+  portENTER_CRITICAL(&diagMux);
+  d = diag;
+  portEXIT_CRITICAL(&diagMux);
+
+  if (d.pairs == 0) {
+    ESP_LOGI(TAG, "Capture diag: no paired edges yet (unmatched ISR %lu, HW %lu).",
+             (unsigned long)d.unmatchedIsr, (unsigned long)d.unmatchedHw);
+    return;
+  }
+
+  double latMean = (double)d.latSum / d.pairs;
+  double latStd = sqrt(fmax(0.0, (double)d.latSqSum / d.pairs - latMean * latMean));
+  ESP_LOGI(TAG, "Capture diag: %lu edges, ISR latency mean %.1f us, std %.1f us, min %lld us, max %lld us",
+           (unsigned long)d.pairs, latMean, latStd, d.latMin, d.latMax);
+
+  if (d.jitterCount > 0) {
+    double jitMean = (double)d.jitSum / d.jitterCount;
+    double jitStd = sqrt(fmax(0.0, (double)d.jitSqSum / d.jitterCount - jitMean * jitMean));
+    ESP_LOGI(TAG, "Capture diag: interval jitter (GPIO ISR - HW) std %.1f us, max |%lld| us; unmatched ISR %lu, HW %lu",
+             jitStd, d.jitMaxAbs, (unsigned long)d.unmatchedIsr, (unsigned long)d.unmatchedHw);
+  }
+}
@@ -0,0 +1,26 @@
+// pulsecapture.h
+// Hardveres időbélyegzés az MCPWM capture egységgel: az él idejét a periféria
+// rögzíti, így a GPIO ISR késleltetése és jittere (WiFi, flash cache leállás
+// NVS commit közben, más taskok) nem kerül bele a sebességbe.
+#ifndef PULSECAPTURE_H
+#define PULSECAPTURE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Impulzus-él továbbítása a feldolgozási láncba (ISR kontextusban hívódik)
+typedef void (*PulseEdgeHandler_t)(int64_t edgeUs, BaseType_t *hptw);
+
+// MCPWM capture indítása a REED lábon. A handler esp_timer időtartományba
+// átszámolt hardveres időbélyeget kap. handler == NULL esetén csak a
+// diagnosztika kapja meg az éleket.
+esp_err_t pulse_capture_init(PulseEdgeHandler_t handler);
+
+// Diagnosztikai mód (PULSE_CAPTURE_DIAG): a GPIO ISR ideje az összehasonlításhoz
+void pulse_capture_diag_isr_edge(int64_t isrUs);
+
+// GPIO ISR és hardveres időbélyeg összevetése: késleltetés és intervallum jitter
+void pulse_capture_diag_report(void);
+
+#endif
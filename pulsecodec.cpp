@@ -0,0 +1,138 @@
+#include "pulsecodec.h"
+#include <string.h>
+
+#define HEADER_SIZE  sizeof(PulseBlockHeader_t)
+#define MAX_VARINT   10 // 64 bites érték leghosszabb varint alakja
+
+static_assert(sizeof(PulseBlockHeader_t) == 16, "pulse block header layout");
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t varint_put(uint8_t *out, uint64_t v) {
+  uint8_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// false, ha a varint túlnyúlik a blokkon vagy túl hosszú
+static inline bool varint_get(const uint8_t **cursor, const uint8_t *end, uint64_t *v) {
+  uint64_t result = 0;
+  for (uint8_t shift = 0; shift < 64 && *cursor < end; shift += 7) {
+    uint8_t b = *(*cursor)++;
+    result |= (uint64_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *v = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+void pulse_encoder_init(PulseEncoder_t *enc, PulseBlockSink_t sink, void *ctx) {
+  memset(enc, 0, sizeof(*enc));
+  enc->sink = sink;
+  enc->ctx = ctx;
+}
+
+void pulse_encoder_flush(PulseEncoder_t *enc) {
+  if (enc->count == 0) return;
+  PulseBlockHeader_t *h = (PulseBlockHeader_t *)enc->block;
+  h->pulseCount = enc->count;
+  h->payloadBytes = enc->fill - HEADER_SIZE;
+  if (enc->sink) enc->sink(enc->block, enc->fill, enc->ctx);
+  enc->blocks++;
+  enc->bytes += enc->fill;
+  enc->fill = 0;
+  enc->count = 0;
+}
+
+void pulse_encoder_add(PulseEncoder_t *enc, int64_t pulseUs) {
+  if (enc->count > 0) {
+    int64_t delta = pulseUs - enc->lastUs;
+    uint8_t tmp[MAX_VARINT];
+    uint8_t n = varint_put(tmp, zigzag(delta - enc->lastDeltaUs));
+    if (enc->fill + n <= PULSE_BLOCK_SIZE && enc->count < UINT16_MAX) {
+      memcpy(enc->block + enc->fill, tmp, n);
+      enc->fill += n;
+      enc->count++;
+      enc->lastDeltaUs = delta;
+      enc->lastUs = pulseUs;
+      enc->pulses++;
+      return;
+    }
+    pulse_encoder_flush(enc); // Megtelt: az impulzus az új blokk alapideje lesz
+  }
+
+  PulseBlockHeader_t h;
+  h.magic = PULSE_BLOCK_MAGIC;
+  h.version = PULSE_BLOCK_VERSION;
+  h.headerSize = HEADER_SIZE;
+  h.pulseCount = 0;
+  h.payloadBytes = 0;
+  h.baseUs = pulseUs;
+  memcpy(enc->block, &h, sizeof(h));
+  enc->fill = HEADER_SIZE;
+  enc->count = 1;
+  enc->lastUs = pulseUs;
+  enc->lastDeltaUs = 0; // Blokkon belül az első különbség önmagában kódolt
+  enc->pulses++;
+}
+
+size_t pulse_block_length(const uint8_t *data, size_t available) {
+  if (available < HEADER_SIZE) return 0;
+  PulseBlockHeader_t h;
+  memcpy(&h, data, sizeof(h));
+  if (h.magic != PULSE_BLOCK_MAGIC || h.version != PULSE_BLOCK_VERSION ||
+      h.headerSize < HEADER_SIZE || h.pulseCount == 0) {
+    return 0;
+  }
+  size_t total = (size_t)h.headerSize + h.payloadBytes;
+  return total <= available ? total : 0;
+}
+
+void pulse_decoder_init(PulseDecoder_t *dec, const uint8_t *data, size_t length) {
+  memset(dec, 0, sizeof(*dec));
+  dec->data = data;
+  dec->length = length;
+}
+
+bool pulse_decoder_next(PulseDecoder_t *dec, int64_t *pulseUs) {
+  while (true) {
+    if (dec->remaining > 0) {
+      uint64_t raw;
+      if (varint_get(&dec->cursor, dec->end, &raw)) {
+        int64_t delta = dec->lastDeltaUs + unzigzag(raw);
+        dec->lastUs += delta;
+        dec->lastDeltaUs = delta;
+        dec->remaining--;
+        *pulseUs = dec->lastUs;
+        return true;
+      }
+      dec->badBlocks++; // Csonka blokk: a következővel folytatjuk
+      dec->remaining = 0;
+    }
+
+    size_t len = pulse_block_length(dec->data + dec->offset, dec->length - dec->offset);
+    if (len == 0) return false;
+    PulseBlockHeader_t h;
+    memcpy(&h, dec->data + dec->offset, sizeof(h));
+    dec->cursor = dec->data + dec->offset + h.headerSize;
+    dec->end = dec->data + dec->offset + len;
+    dec->offset += len;
+    dec->remaining = h.pulseCount - 1;
+    dec->lastUs = h.baseUs;
+    dec->lastDeltaUs = 0;
+    *pulseUs = h.baseUs;
+    return true;
+  }
+}
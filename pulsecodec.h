@@ -0,0 +1,69 @@
+// pulsecodec.h
+// Impulzus időbélyegek tömörítése: blokkonként az első impulzus abszolút
+// ideje a fejlécben, utána a második különbségek (delta-of-delta) zig-zag
+// varint kódolással. Egyenletes haladásnál egy impulzus 1 bájt. Minden blokk
+// önleíró (magic, verzió, darabszám, hossz) és önállóan dekódolható, így egy
+// sérült vagy hiányzó blokk csak a saját impulzusait viszi el. A kódoló
+// tetszőleges nyelőbe (flash, RAM, fájl) írja a kész blokkokat.
+// Hardverfüggetlen, a hoszt oldali dekóder (tools/) ugyanezt a kódot használja.
+#ifndef PULSECODEC_H
+#define PULSECODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PULSE_BLOCK_MAGIC   0x4250 // "PB"
+#define PULSE_BLOCK_VERSION 1
+#define PULSE_BLOCK_SIZE    256    // Blokk max. mérete fejléccel (egy flash lap)
+
+typedef struct {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t headerSize;
+  uint16_t pulseCount;    // Impulzusok a blokkban, az alapidővel együtt
+  uint16_t payloadBytes;  // A fejlécet követő varint bájtok
+  int64_t baseUs;         // A blokk első impulzusának ideje
+} PulseBlockHeader_t;
+
+// Kész blokk átadása a nyelőnek
+typedef void (*PulseBlockSink_t)(const uint8_t *block, uint16_t length, void *ctx);
+
+typedef struct {
+  uint8_t block[PULSE_BLOCK_SIZE];
+  uint16_t fill;          // Bájtok a blokkban (fejléccel)
+  uint16_t count;         // Impulzusok a blokkban
+  int64_t lastUs;
+  int64_t lastDeltaUs;
+  PulseBlockSink_t sink;
+  void *ctx;
+  uint32_t blocks;        // Kiadott blokkok
+  uint32_t pulses;        // Kódolt impulzusok
+  uint32_t bytes;         // Kiadott bájtok
+} PulseEncoder_t;
+
+void pulse_encoder_init(PulseEncoder_t *enc, PulseBlockSink_t sink, void *ctx);
+void pulse_encoder_add(PulseEncoder_t *enc, int64_t pulseUs);
+// A félkész blokk kiadása (napló lezárásakor)
+void pulse_encoder_flush(PulseEncoder_t *enc);
+
+// Dekódolás egy bájtfolyamból (egymás utáni blokkok)
+typedef struct {
+  const uint8_t *data;
+  size_t length;
+  size_t offset;          // A következő blokk eleje
+  const uint8_t *cursor;  // Az aktuális blokk következő varintja
+  const uint8_t *end;
+  uint16_t remaining;     // Hátralévő impulzusok az aktuális blokkban
+  int64_t lastUs;
+  int64_t lastDeltaUs;
+  uint32_t badBlocks;     // Átugrott (sérült) blokkok
+} PulseDecoder_t;
+
+void pulse_decoder_init(PulseDecoder_t *dec, const uint8_t *data, size_t length);
+// A következő impulzus ideje; false a folyam végén (első érvénytelen fejléc)
+bool pulse_decoder_next(PulseDecoder_t *dec, int64_t *pulseUs);
+
+// Egy blokk ellenőrzése; a teljes hossz (fejléc + adat), 0 ha érvénytelen
+size_t pulse_block_length(const uint8_t *data, size_t available);
+
+#endif
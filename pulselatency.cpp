@@ -0,0 +1,89 @@
+#include "pulselatency.h"
+#include <atomic>
+
+#define LATENCY_EXACT_BUCKETS 16 // 0..15 us egyenként
+#define LATENCY_SUB_BITS 2       // Oktávonként 1 << 2 rés
+#define LATENCY_MAX_BIT 25       // 2^26 us (~67 s) felett az utolsó résbe
+#define LATENCY_BUCKETS                                                                  \
+  (LATENCY_EXACT_BUCKETS + (LATENCY_MAX_BIT - 3) * (1 << LATENCY_SUB_BITS))
+
+// Írók: a számoló task és a GUI; olvasó és nullázó: a soros riport
+static std::atomic<uint32_t> buckets[LATENCY_STAGE_COUNT][LATENCY_BUCKETS];
+static std::atomic<uint32_t> stageMax[LATENCY_STAGE_COUNT];
+static std::atomic<uint32_t> droppedEdges(0);
+
+static const char *const stageNames[LATENCY_STAGE_COUNT] = {
+    "isr->task", "task->publish", "publish->gui", "gui->pixels", "edge->pixels",
+};
+
+static int bucket_of(uint32_t us) {
+  if (us < LATENCY_EXACT_BUCKETS) return (int)us;
+  if (us >> (LATENCY_MAX_BIT + 1)) return LATENCY_BUCKETS - 1;
+  int msb = 31 - __builtin_clz(us);
+  int sub = (int)(us >> (msb - LATENCY_SUB_BITS)) & ((1 << LATENCY_SUB_BITS) - 1);
+  return LATENCY_EXACT_BUCKETS + (msb - 4) * (1 << LATENCY_SUB_BITS) + sub;
+}
+
+// A rés legnagyobb értéke
+static uint32_t bucket_upper(int bucket) {
+  if (bucket < LATENCY_EXACT_BUCKETS) return (uint32_t)bucket;
+  int octave = (bucket - LATENCY_EXACT_BUCKETS) >> LATENCY_SUB_BITS;
+  int sub = (bucket - LATENCY_EXACT_BUCKETS) & ((1 << LATENCY_SUB_BITS) - 1);
+  int msb = octave + 4;
+  uint32_t width = 1u << (msb - LATENCY_SUB_BITS);
+  return ((uint32_t)((1 << LATENCY_SUB_BITS) + sub) << (msb - LATENCY_SUB_BITS)) + width - 1;
+}
+
+void pulse_latency_record(LatencyStage_t stage, int64_t us) {
+  if (stage >= LATENCY_STAGE_COUNT) return;
+  uint32_t v = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+  buckets[stage][bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+  // Szakaszonként egy író, a maximum egyszerű tárolással is helyes
+  if (v > stageMax[stage].load(std::memory_order_relaxed)) {
+    stageMax[stage].store(v, std::memory_order_relaxed);
+  }
+}
+
+void IRAM_ATTR pulse_latency_dropped(void) {
+  droppedEdges.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t pulse_latency_dropped_count(void) {
+  return droppedEdges.load(std::memory_order_relaxed);
+}
+
+static uint32_t percentile(const uint32_t *counts, uint32_t total, uint32_t pct, uint32_t maxUs) {
+  uint32_t rank = (uint32_t)(((uint64_t)total * pct + 99) / 100);
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int b = 0; b < LATENCY_BUCKETS; b++) {
+    seen += counts[b];
+    if (seen >= rank) {
+      uint32_t upper = bucket_upper(b);
+      return upper < maxUs ? upper : maxUs;
+    }
+  }
+  return maxUs;
+}
+
+void pulse_latency_summary(LatencyStage_t stage, LatencySummary_t *out, bool reset) {
+  *out = LatencySummary_t();
+  if (stage >= LATENCY_STAGE_COUNT) return;
+
+  // Résenként atomikus kiolvasás; a közben érkező minta a következő ablakba kerül
+  uint32_t counts[LATENCY_BUCKETS];
+  for (int b = 0; b < LATENCY_BUCKETS; b++) {
+    counts[b] = reset ? buckets[stage][b].exchange(0, std::memory_order_relaxed)
+                      : buckets[stage][b].load(std::memory_order_relaxed);
+    out->count += counts[b];
+  }
+  out->maxUs = reset ? stageMax[stage].exchange(0, std::memory_order_relaxed)
+                     : stageMax[stage].load(std::memory_order_relaxed);
+  if (out->count == 0) return;
+  out->p50Us = percentile(counts, out->count, 50, out->maxUs);
+  out->p99Us = percentile(counts, out->count, 99, out->maxUs);
+}
+
+const char *pulse_latency_stage_name(LatencyStage_t stage) {
+  return stage < LATENCY_STAGE_COUNT ? stageNames[stage] : "?";
+}
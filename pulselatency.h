@@ -0,0 +1,51 @@
+// pulselatency.h
+// Impulzus -> képpont késleltetés szakaszonként. Az impulzus az ISR
+// időbélyegével halad végig a láncon (impulzus sor -> számoló task ->
+// megosztott adat -> GUI -> panel); minden szakasz vége egy mintát ad a
+// szakasz hisztogramjába. A hisztogram logaritmikus: 16 us alatt pontos,
+// felette oktávonként 4 rés (legfeljebb 25% hiba), így a p50/p99 állandó
+// memóriából és zár nélkül számolható. A riport ablakonként (soros riport
+// periódus) kiolvassa és nullázza a hisztogramokat.
+#ifndef PULSELATENCY_H
+#define PULSELATENCY_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+typedef enum {
+  LATENCY_ISR_TO_TASK,     // Él időbélyeg -> számoló task ébredés
+  LATENCY_TASK_TO_PUBLISH, // Ébredés -> metrikák a megosztott struktúrában
+  LATENCY_PUBLISH_TO_GUI,  // Közzététel -> GUI kiolvasás
+  LATENCY_GUI_TO_PIXELS,   // GUI kiolvasás -> képpontok a panelen
+  LATENCY_EDGE_TO_PIXELS,  // Teljes lánc: él -> képpontok
+  LATENCY_STAGE_COUNT
+} LatencyStage_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t p50Us; // A percentilist tartalmazó rés felső határa
+  uint32_t p99Us;
+  uint32_t maxUs; // Pontos érték
+} LatencySummary_t;
+
+// Egy minta a szakasz hisztogramjába (negatív: 0, túl nagy: az utolsó rés)
+void pulse_latency_record(LatencyStage_t stage, int64_t us);
+
+// Az impulzus sor megtelt, az él nem jutott el a számoló taskig (ISR-ből)
+void IRAM_ATTR pulse_latency_dropped(void);
+
+// Az ablak kiolvasása; reset esetén a hisztogramok nullázódnak
+void pulse_latency_summary(LatencyStage_t stage, LatencySummary_t *out, bool reset);
+
+// Eldobott élek induláskor óta
+uint32_t pulse_latency_dropped_count(void);
+
+const char *pulse_latency_stage_name(LatencyStage_t stage);
+
+#endif
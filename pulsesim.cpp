@@ -0,0 +1,169 @@
+#include "pulsesim.h"
+#include <math.h>
+#include <string.h>
+
+static uint32_t next_random(PulseSim_t *sim) {
+  // xorshift32: determinisztikus, hoszton és célhardveren azonos sorozat
+  uint32_t x = sim->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sim->rng = x;
+  return x;
+}
+
+static bool chance_permille(PulseSim_t *sim, uint16_t permille) {
+  return permille > 0 && (next_random(sim) % 1000) < permille;
+}
+
+// A következő valódi impulzus ideje a profil integrálásával
+static int64_t advance_profile(PulseSim_t *sim) {
+  const PulseSimConfig_t *c = &sim->config;
+  double remainingAtWrap = -1.0;
+  while (true) {
+    if (sim->segment >= c->segmentCount) {
+      if (!c->loop || c->segmentCount == 0) return -1;
+      // Egy teljes kör megtett út nélkül: csak megállásból álló profil
+      if (sim->remainingM == remainingAtWrap) return -1;
+      remainingAtWrap = sim->remainingM;
+      sim->segment = 0;
+    }
+    const PulseSimSegment_t *seg = &c->segments[sim->segment];
+    double durS = seg->durationMs / 1000.0;
+    double v0Seg = seg->startKmh / 3.6;
+    double a = durS > 0 ? (seg->endKmh - seg->startKmh) / 3.6 / durS : 0.0;
+    double t = sim->segmentTimeS;
+    double v = v0Seg + a * t; // Sebesség a szakaszon belüli aktuális pontban
+    double leftS = durS - t;
+
+    // s(tau) = v*tau + a*tau^2/2 = remaining megoldása
+    double tau = -1.0;
+    if (fabs(a) < 1e-9) {
+      if (v > 0) tau = sim->remainingM / v;
+    } else {
+      double disc = v * v + 2.0 * a * sim->remainingM;
+      if (disc >= 0) {
+        tau = (-v + sqrt(disc)) / a;
+        if (tau < 0) tau = -1.0;
+      }
+    }
+
+    if (tau >= 0 && tau <= leftS) {
+      sim->segmentTimeS = t + tau;
+      sim->remainingM = sim->pulseDistanceM;
+      return sim->segmentStartUs + (int64_t)llround(sim->segmentTimeS * 1e6);
+    }
+
+    // Ebben a szakaszban nem érjük el a következő impulzust
+    double covered = v * leftS + 0.5 * a * leftS * leftS;
+    if (covered > 0) sim->remainingM -= covered;
+    sim->segmentStartUs += (int64_t)seg->durationMs * 1000;
+    sim->segmentTimeS = 0.0;
+    sim->segment++;
+  }
+}
+
+// Kódolt visszajátszás: az időbélyegek különbségei, a végén opcionálisan újra
+static int64_t advance_encoded(PulseSim_t *sim, int64_t lastUs) {
+  const PulseSimConfig_t *c = &sim->config;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    int64_t t;
+    while (pulse_decoder_next(&sim->decoder, &t)) {
+      bool first = !sim->decodedAny;
+      int64_t dt = t - sim->decodedUs;
+      sim->decodedUs = t;
+      sim->decodedAny = true;
+      if (!first && dt > 0) return lastUs + dt; // Blokkhatáron is folytonos
+    }
+    if (!c->loop) return -1;
+    pulse_decoder_init(&sim->decoder, c->encoded, c->encodedBytes);
+    sim->decodedAny = false;
+  }
+  return -1;
+}
+
+// Visszajátszás: a rögzített intervallumok sorban
+static int64_t advance_replay(PulseSim_t *sim, int64_t lastUs) {
+  const PulseSimConfig_t *c = &sim->config;
+  if (c->intervalsUs == NULL) return advance_encoded(sim, lastUs);
+  if (sim->interval >= c->intervalCount) {
+    if (!c->loop || c->intervalCount == 0) return -1;
+    sim->interval = 0;
+  }
+  return lastUs + c->intervalsUs[sim->interval++];
+}
+
+void pulsesim_init(PulseSim_t *sim, const PulseSimConfig_t *config, int64_t startUs) {
+  memset(sim, 0, sizeof(*sim));
+  sim->config = *config;
+  if (sim->config.pulsesPerRev < 1) sim->config.pulsesPerRev = 1;
+  if (sim->config.bounceEdges > PULSESIM_MAX_BOUNCE) sim->config.bounceEdges = PULSESIM_MAX_BOUNCE;
+  sim->rng = config->seed ? config->seed : 1;
+  sim->pulseDistanceM = config->circumferenceM / sim->config.pulsesPerRev;
+  sim->remainingM = sim->pulseDistanceM;
+  sim->segmentStartUs = startUs;
+  sim->lastRealUs = startUs;
+  if (config->encoded) pulse_decoder_init(&sim->decoder, config->encoded, config->encodedBytes);
+  sim->nextRealUs = config->segments ? advance_profile(sim) : advance_replay(sim, startUs);
+}
+
+bool pulsesim_next(PulseSim_t *sim, int64_t *edgeUs, bool *isBounce) {
+  // Függő pergő élek, amíg a következő valódi zárás előtt vannak
+  if (sim->bounceNext < sim->bounceCount) {
+    int64_t b = sim->bounceUs[sim->bounceNext];
+    if (sim->nextRealUs < 0 || b < sim->nextRealUs) {
+      sim->bounceNext++;
+      sim->bounceEdgesOut++;
+      *edgeUs = b;
+      *isBounce = true;
+      return true;
+    }
+    sim->bounceCount = sim->bounceNext = 0; // A következő zárás megszakítja
+  }
+
+  while (sim->nextRealUs >= 0) {
+    int64_t t = sim->nextRealUs;
+    sim->nextRealUs = sim->config.segments ? advance_profile(sim) : advance_replay(sim, t);
+
+    if (chance_permille(sim, sim->config.missPermille)) {
+      sim->missedPulses++; // Az út megtörtént, csak az él nem jelent meg
+      continue;
+    }
+
+    // Pergés: további élek a zárás után, egyre ritkulva a tartományon belül
+    sim->bounceCount = sim->bounceNext = 0;
+    if (sim->config.bounceEdges > 0 && chance_permille(sim, sim->config.bouncePermille)) {
+      uint32_t span = sim->config.bounceSpanUs ? sim->config.bounceSpanUs : 1;
+      int64_t prev = t;
+      for (uint8_t i = 0; i < sim->config.bounceEdges; i++) {
+        uint32_t slot = span * (i + 1) / sim->config.bounceEdges;
+        if (slot == 0) slot = 1;
+        int64_t b = t + 1 + next_random(sim) % slot;
+        if (b <= prev) b = prev + 1;
+        sim->bounceUs[sim->bounceCount++] = b;
+        prev = b;
+      }
+    }
+
+    sim->realEdges++;
+    sim->lastIntervalUs = t - sim->lastRealUs;
+    sim->lastRealUs = t;
+    *edgeUs = t;
+    *isBounce = false;
+    return true;
+  }
+  return false;
+}
+
+double pulsesim_speed_kmh(const PulseSim_t *sim) {
+  const PulseSimConfig_t *c = &sim->config;
+  if (c->segments == NULL) {
+    if (sim->lastIntervalUs <= 0) return 0.0;
+    return sim->pulseDistanceM / sim->lastIntervalUs * 3.6e6;
+  }
+  if (sim->segment >= c->segmentCount) return 0.0;
+  const PulseSimSegment_t *seg = &c->segments[sim->segment];
+  double durS = seg->durationMs / 1000.0;
+  if (durS <= 0) return seg->endKmh;
+  return seg->startKmh + (seg->endKmh - seg->startKmh) * (sim->segmentTimeS / durS);
+}
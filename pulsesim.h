@@ -0,0 +1,73 @@
+// pulsesim.h
+// REED impulzus generátor sebességprofilokhoz: rámpák, tartások, megállások
+// vagy rögzített intervallumok (nyers vagy kódolt menetnapló) visszajátszása, mikroszekundumos
+// élidőkkel. Pergést (többszörös él a zárás után) és kimaradó impulzusokat is
+// szimulál. Hardverfüggetlen: a firmware esp_timer-ről hajtja, de hoszton is
+// ugyanazt az élsorozatot adja.
+#ifndef PULSESIM_H
+#define PULSESIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pulsecodec.h"
+
+#define PULSESIM_MAX_BOUNCE 8 // Egy záráshoz tartozó pergő élek felső korlátja
+
+// Profil szakasz: a sebesség lineárisan változik startKmh-ról endKmh-ra.
+// Azonos értékek: tartás; 0 -> 0: megállás.
+typedef struct {
+  float startKmh;
+  float endKmh;
+  uint32_t durationMs;
+} PulseSimSegment_t;
+
+typedef struct {
+  const PulseSimSegment_t *segments; // Sebességprofil, vagy NULL visszajátszáskor
+  uint16_t segmentCount;
+  const uint32_t *intervalsUs;       // Rögzített impulzusintervallumok (ha segments == NULL)
+  uint32_t intervalCount;
+  const uint8_t *encoded;            // Vagy pulsecodec blokkok (ha intervalsUs is NULL)
+  uint32_t encodedBytes;
+  bool loop;                         // A profil végén újrakezdés
+  double circumferenceM;
+  uint8_t pulsesPerRev;
+  uint16_t bouncePermille;           // Ennyi ezrelék zárás pereg
+  uint8_t bounceEdges;               // Pergő élek száma zárásonként (max. PULSESIM_MAX_BOUNCE)
+  uint32_t bounceSpanUs;             // A pergés ennyi időn belül zajlik le
+  uint16_t missPermille;             // Ennyi ezrelék impulzus kimarad
+  uint32_t seed;                     // Álvéletlen generátor kezdőértéke (0 helyett 1)
+} PulseSimConfig_t;
+
+typedef struct {
+  PulseSimConfig_t config;
+  double pulseDistanceM;     // Két impulzus közti út
+  uint16_t segment;          // Aktuális szakasz
+  uint32_t interval;         // Visszajátszásnál a következő intervallum indexe
+  PulseDecoder_t decoder;    // Kódolt visszajátszás
+  int64_t decodedUs;         // Az utoljára dekódolt időbélyeg
+  bool decodedAny;
+  int64_t segmentStartUs;
+  double segmentTimeS;       // A szakaszon belül eltelt idő
+  double remainingM;         // Út a következő impulzusig
+  int64_t nextRealUs;        // A következő valódi él ideje, -1 = vége
+  int64_t bounceUs[PULSESIM_MAX_BOUNCE];
+  uint8_t bounceCount, bounceNext;
+  uint32_t rng;
+  int64_t lastRealUs;        // Az utolsó kiadott valódi él (kezdetben az indulás ideje)
+  int64_t lastIntervalUs;    // Kimaradás után a két kiadott él közti idő
+  // Statisztika
+  uint32_t realEdges;        // Kiadott valódi élek
+  uint32_t bounceEdgesOut;   // Kiadott pergő élek
+  uint32_t missedPulses;     // Elnyelt (ki nem adott) impulzusok
+} PulseSim_t;
+
+void pulsesim_init(PulseSim_t *sim, const PulseSimConfig_t *config, int64_t startUs);
+
+// A következő él ideje. false, ha a profil véget ért.
+// isBounce: pergő él (a feldolgozásnak el kell dobnia).
+bool pulsesim_next(PulseSim_t *sim, int64_t *edgeUs, bool *isBounce);
+
+// A profil szerinti sebesség az aktuális pontban (visszajátszásnál az utolsó kiadott intervallumból)
+double pulsesim_speed_kmh(const PulseSim_t *sim);
+
+#endif
@@ -0,0 +1,179 @@
+#include "pulsevalidator.h"
+#include <math.h>
+#include <string.h>
+
+void pulse_validator_init(PulseValidator_t *v, const PulseValidatorConfig_t *config,
+                          uint8_t magnets, double circumferenceM) {
+  memset(v, 0, sizeof(*v));
+  v->config = *config;
+  if (magnets < 1) magnets = 1;
+  if (magnets > PULSE_VALID_MAX_MAGNETS) magnets = PULSE_VALID_MAX_MAGNETS;
+  v->magnets = magnets;
+  v->arcM = circumferenceM / magnets;
+}
+
+void pulse_validator_reset_history(PulseValidator_t *v) {
+  v->historyHead = 0;
+  v->historyCount = 0;
+  v->pendingMissed = 0;
+  v->pendingIntervalUs = 0;
+}
+
+static uint8_t capacity(const PulseValidator_t *v) { return 3 * v->magnets; }
+
+static void push(PulseValidator_t *v, int64_t dt) {
+  uint8_t cap = capacity(v);
+  v->historyUs[v->historyHead] = dt;
+  v->historyHead = (v->historyHead + 1) % cap;
+  if (v->historyCount < cap) v->historyCount++;
+}
+
+static void pop(PulseValidator_t *v) {
+  uint8_t cap = capacity(v);
+  v->historyHead = (v->historyHead + cap - 1) % cap;
+  v->historyCount--;
+}
+
+// lag = 1: a legutóbbi intervallum
+static int64_t at_lag(const PulseValidator_t *v, uint8_t lag) {
+  uint8_t cap = capacity(v);
+  return v->historyUs[(v->historyHead + cap - lag) % cap];
+}
+
+// A mostantól j. ív jósolt intervalluma: ugyanazon mágnes utolsó (legfeljebb
+// három) fordulatának mediánja; 0, ha még nincs egy teljes fordulat
+static int64_t predict(const PulseValidator_t *v, uint8_t j) {
+  const uint8_t n = v->magnets;
+  uint8_t lag = n - (j % n);
+  int64_t s[3];
+  int count = 0;
+  for (int rev = 0; rev < 3 && lag + rev * n <= v->historyCount; rev++) {
+    s[count++] = at_lag(v, lag + rev * n);
+  }
+  if (count == 0) return 0;
+  if (count < 3) return s[0]; // A legutóbbi fordulat
+  if (s[0] > s[1]) { int64_t t = s[0]; s[0] = s[1]; s[1] = t; }
+  if (s[1] > s[2]) s[1] = s[2];
+  return s[0] > s[1] ? s[0] : s[1];
+}
+
+static bool matches(int64_t dt, int64_t expected, double tolerance) {
+  return expected > 0 && fabs((double)(dt - expected)) <= tolerance * expected;
+}
+
+// k kimaradt impulzus: az intervallum a következő k + 1 ív jóslatának összege
+static uint8_t missed_pattern(const PulseValidator_t *v, int64_t dt) {
+  int64_t expected = predict(v, 0);
+  for (uint8_t k = 1; k <= v->config.maxMissed; k++) {
+    expected += predict(v, k);
+    if (matches(dt, expected, v->config.matchTolerance)) return k;
+  }
+  return 0;
+}
+
+// A kimaradást tartalmazó intervallum k + 1 ívre bontva, a jóslatok arányában
+static void push_split(PulseValidator_t *v, int64_t dt, uint8_t k) {
+  int64_t parts[PULSE_VALID_MAX_MAGNETS + 1];
+  int64_t sum = 0;
+  for (uint8_t j = 0; j <= k; j++) {
+    parts[j] = predict(v, j);
+    sum += parts[j];
+  }
+  int64_t used = 0;
+  for (uint8_t j = 0; j < k; j++) {
+    int64_t part = sum > 0 ? dt * parts[j] / sum : dt / (k + 1);
+    push(v, part);
+    used += part;
+  }
+  push(v, dt - used);
+}
+
+// |gyorsulás| az ugyanazon mágnes előző fordulatbeli és a mostani intervalluma
+// között, a két intervallum közepe között eltelt időre, m/s^2
+static double implied_accel(const PulseValidator_t *v, int64_t dt) {
+  const uint8_t n = v->magnets;
+  if (v->historyCount < n) return 0.0;
+  int64_t ref = at_lag(v, n);
+  int64_t spanUs = (ref + dt) / 2;
+  for (uint8_t lag = 1; lag < n; lag++) spanUs += at_lag(v, lag);
+  double v0 = v->arcM * 1e6 / ref;
+  double v1 = v->arcM * 1e6 / dt;
+  return fabs(v1 - v0) * 1e6 / spanUs;
+}
+
+PulseCheck_t pulse_validator_pulse(PulseValidator_t *v, int64_t pulseUs) {
+  PulseCheck_t check = {PULSE_VALID_OK, 0, 0};
+  if (v->lastUs == 0) {
+    v->lastUs = pulseUs;
+    return check;
+  }
+  v->stats.checked++;
+
+  int64_t dt = pulseUs - v->lastUs;
+  if (dt <= 0) {
+    check.verdict = PULSE_VALID_PHANTOM;
+    v->stats.phantom++;
+    return check;
+  }
+  if (dt > v->config.stopIntervalUs) {
+    pulse_validator_reset_history(v); // Megállás után nincs mihez mérni
+    v->lastUs = pulseUs;
+    return check;
+  }
+
+  // Fantom: a jósolt intervallum töredéke, és a hozzá tartozó gyorsulás lehetetlen
+  int64_t expected = predict(v, 0);
+  if (expected > 0 && dt < v->config.phantomRatio * expected &&
+      implied_accel(v, dt) > v->config.maxAccelMps2) {
+    check.verdict = PULSE_VALID_PHANTOM;
+    v->stats.phantom++;
+    return check;
+  }
+
+  // Függő kimaradás: ha a mostani intervallum a pótolt fázissal illik a jóslatba, megerősítjük
+  if (v->pendingMissed > 0) {
+    PulseValidator_t trial = *v;
+    pop(&trial);
+    push_split(&trial, v->pendingIntervalUs, v->pendingMissed);
+    if (matches(dt, predict(&trial, 0), v->config.matchTolerance)) {
+      check.lateMissed = v->pendingMissed;
+      *v = trial; // A számlálók a másolás után nőnek, különben elvesznének
+      v->stats.missed += check.lateMissed;
+      v->stats.lateMissed += check.lateMissed;
+    }
+    v->pendingMissed = 0;
+    v->pendingIntervalUs = 0;
+  }
+
+  expected = predict(v, 0);
+  v->lastUs = pulseUs;
+  if (expected == 0) {
+    push(v, dt); // Még nincs egy teljes fordulat az előzményben
+    return check;
+  }
+
+  bool impossible = implied_accel(v, dt) > v->config.maxAccelMps2;
+  uint8_t k = missed_pattern(v, dt);
+  if (k > 0 && impossible) {
+    check.verdict = PULSE_VALID_MISSED;
+    check.missedPulses = k;
+    v->stats.missed += k;
+    push_split(v, dt, k);
+  } else if (k > 0) {
+    // Valós lassítás is lehet: a következő impulzus dönt
+    v->pendingMissed = k;
+    v->pendingIntervalUs = dt;
+    push(v, dt);
+  } else {
+    if (impossible) {
+      check.verdict = PULSE_VALID_IMPLAUSIBLE;
+      v->stats.implausible++;
+    }
+    push(v, dt);
+  }
+  return check;
+}
+
+int64_t pulse_validator_interpolate(int64_t prevUs, int64_t pulseUs, uint8_t missed, uint8_t index) {
+  return prevUs + (pulseUs - prevUs) * index / (missed + 1);
+}
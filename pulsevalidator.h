@@ -0,0 +1,76 @@
+// pulsevalidator.h
+// Impulzusfolyam ellenőrzés a sebességbecslés előtt. Minden intervallumot az
+// előző fordulatok ugyanazon mágnesének intervallumaiból (medián) jósol meg;
+// a fizikailag lehetetlen gyorsulást jelző intervallumokat osztályozza:
+//  - kimaradt impulzus (elcsúszott mágnes, laza REED): az intervallum a
+//    következő k ív jóslatának összege -> k pótolt impulzus a távolságba és
+//    egyenletesen elosztva a becslőbe;
+//  - fantom impulzus (rezgés): a jósolt intervallum töredéke -> eldobva.
+// Lehetséges (lassításnak is értelmezhető) kimaradásnál a következő impulzus
+// dönt: ha a tempó visszaáll, a kimaradás utólag a távolságba kerül.
+// Minden javítás számolódik, így a szenzor állapota látható.
+// Hardverfüggetlen, hoszton is fordítható (tools/ridestats ugyanezt használja).
+#ifndef PULSEVALIDATOR_H
+#define PULSEVALIDATOR_H
+
+#include <stdint.h>
+
+#define PULSE_VALID_MAX_MAGNETS 8
+#define PULSE_VALID_HISTORY (3 * PULSE_VALID_MAX_MAGNETS) // Három fordulat intervallumai
+
+typedef struct {
+  double maxAccelMps2;     // Ennél nagyobb |gyorsulás| nem valós mozgás
+  double matchTolerance;   // Jóslattól megengedett relatív eltérés egy mintázatnál
+  double phantomRatio;     // Ennél rövidebb intervallum (a jóslathoz képest) fantom lehet
+  uint8_t maxMissed;       // Legfeljebb ennyi egymás utáni kimaradást pótol
+  int64_t stopIntervalUs;  // Ennél hosszabb szünet után az előzmény törlődik
+} PulseValidatorConfig_t;
+
+typedef enum {
+  PULSE_VALID_OK,          // Elfogadva (jóslat nélkül is, pl. indulás után)
+  PULSE_VALID_MISSED,      // Elfogadva, előtte missedPulses impulzus pótolandó
+  PULSE_VALID_PHANTOM,     // Eldobandó: sem a becslőbe, sem a távolságba
+  PULSE_VALID_IMPLAUSIBLE, // Elfogadva, de lehetetlen gyorsulás (csúcsként ne rögzüljön)
+} PulseVerdict_t;
+
+typedef struct {
+  PulseVerdict_t verdict;
+  uint8_t missedPulses;  // MISSED: pótolt impulzusok ebben az intervallumban
+  uint8_t lateMissed;    // Az előző intervallum utólag megerősített kimaradásai (csak távolság)
+} PulseCheck_t;
+
+typedef struct {
+  uint32_t checked;      // Ellenőrzött intervallumok
+  uint32_t missed;       // Pótolt impulzusok (azonnal és utólag)
+  uint32_t lateMissed;   // Ebből utólag megerősítve
+  uint32_t phantom;      // Eldobott impulzusok
+  uint32_t implausible;  // Lehetetlen gyorsulás mintázat nélkül
+} PulseValidatorStats_t;
+
+typedef struct {
+  PulseValidatorConfig_t config;
+  uint8_t magnets;
+  double arcM;                                  // Átlagos ív impulzusonként
+  int64_t lastUs;                               // Utolsó elfogadott impulzus
+  int64_t historyUs[PULSE_VALID_HISTORY];       // Intervallumok, körkörösen
+  uint8_t historyHead;                          // A következő írás helye
+  uint8_t historyCount;
+  uint8_t pendingMissed;                        // Lehetséges kimaradás az utolsó intervallumban
+  int64_t pendingIntervalUs;
+  PulseValidatorStats_t stats;
+} PulseValidator_t;
+
+void pulse_validator_init(PulseValidator_t *v, const PulseValidatorConfig_t *config,
+                          uint8_t magnets, double circumferenceM);
+
+// Új impulzus ellenőrzése. PHANTOM esetén a validátor állapota nem változik
+// (a következő intervallum is az utolsó elfogadott impulzustól számít).
+PulseCheck_t pulse_validator_pulse(PulseValidator_t *v, int64_t pulseUs);
+
+// MISSED esetén a pótolt impulzusok időbélyegei a becslőhöz (index: 1..missedPulses)
+int64_t pulse_validator_interpolate(int64_t prevUs, int64_t pulseUs, uint8_t missed, uint8_t index);
+
+// Előzmény törlése (megállás, profilváltás); a számlálók megmaradnak
+void pulse_validator_reset_history(PulseValidator_t *v);
+
+#endif
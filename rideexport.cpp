@@ -0,0 +1,496 @@
+#include "rideexport.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+
+#define FIT_EPOCH_OFFSET   631065600 // 1989-12-31 00:00:00 UTC unix időben
+#define FIT_HEADER_SIZE    14
+#define FIT_PROFILE_VER    2132
+#define FIT_INVALID_SINT32 0x7FFFFFFF
+#define FIX_MAX_AGE_S      5         // Ennél régebbi fix nem kerül a rekordba
+#define MIN_VALID_EPOCH    1704067200
+
+// FIT alaptípusok
+#define FIT_ENUM    0x00
+#define FIT_UINT8   0x02
+#define FIT_UINT16  0x84
+#define FIT_SINT32  0x85
+#define FIT_UINT32  0x86
+#define FIT_UINT32Z 0x8C
+
+typedef struct {
+  uint8_t num;
+  uint8_t size;
+  uint8_t baseType;
+} FitField_t;
+
+// Helyi üzenettípusok: mindegyik egyszer definiálva
+enum { LOCAL_FILE_ID, LOCAL_EVENT, LOCAL_RECORD, LOCAL_LAP, LOCAL_SESSION, LOCAL_ACTIVITY };
+
+static const FitField_t fileIdFields[] = {
+    {0, 1, FIT_ENUM}, {1, 2, FIT_UINT16}, {2, 2, FIT_UINT16}, {3, 4, FIT_UINT32Z}, {4, 4, FIT_UINT32},
+};
+static const FitField_t eventFields[] = {
+    {253, 4, FIT_UINT32}, {0, 1, FIT_ENUM}, {1, 1, FIT_ENUM}, {4, 1, FIT_UINT8},
+};
+// Az utolsó kettő (pozíció) csak GPS fix forrással
+static const FitField_t recordFields[] = {
+    {253, 4, FIT_UINT32}, {5, 4, FIT_UINT32}, {6, 2, FIT_UINT16}, {0, 4, FIT_SINT32}, {1, 4, FIT_SINT32},
+};
+static const FitField_t lapFields[] = {
+    {253, 4, FIT_UINT32}, {2, 4, FIT_UINT32}, {7, 4, FIT_UINT32}, {8, 4, FIT_UINT32}, {9, 4, FIT_UINT32},
+    {13, 2, FIT_UINT16},  {14, 2, FIT_UINT16}, {0, 1, FIT_ENUM},   {1, 1, FIT_ENUM},
+};
+static const FitField_t sessionFields[] = {
+    {253, 4, FIT_UINT32}, {2, 4, FIT_UINT32}, {7, 4, FIT_UINT32}, {8, 4, FIT_UINT32}, {9, 4, FIT_UINT32},
+    {14, 2, FIT_UINT16},  {15, 2, FIT_UINT16}, {5, 1, FIT_ENUM},   {6, 1, FIT_ENUM},   {0, 1, FIT_ENUM},
+    {1, 1, FIT_ENUM},     {25, 2, FIT_UINT16}, {26, 2, FIT_UINT16},
+};
+static const FitField_t activityFields[] = {
+    {253, 4, FIT_UINT32}, {0, 4, FIT_UINT32}, {1, 2, FIT_UINT16}, {2, 1, FIT_ENUM}, {3, 1, FIT_ENUM}, {4, 1, FIT_ENUM},
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+// --- Impulzus kurzor ---
+
+static bool cursor_fetch(RideExportCursor_t *c) {
+  if (c->version == RIDE_LOG_VERSION_RAW32) {
+    uint32_t dt;
+    if (c->offset + sizeof(dt) > c->length) return c->havePending = false;
+    memcpy(&dt, c->data + c->offset, sizeof(dt));
+    if (dt == 0xFFFFFFFF) return c->havePending = false;
+    c->offset += sizeof(dt);
+    c->pendingUs += dt;
+    return c->havePending = true;
+  }
+  return c->havePending = pulse_decoder_next(&c->decoder, &c->pendingUs);
+}
+
+static bool cursor_reset(RideExportCursor_t *c) {
+  c->offset = 0;
+  c->pulses = 0;
+  c->lastIntervalUs = 0;
+  if (c->version == RIDE_LOG_VERSION_RAW32) {
+    c->pendingUs = c->baseUs;
+    c->havePending = true;
+  } else {
+    pulse_decoder_init(&c->decoder, c->data, c->length);
+    cursor_fetch(c);
+  }
+  c->firstUs = c->lastPulseUs = c->pendingUs;
+  return c->havePending;
+}
+
+// Impulzusok feldolgozása ts-ig (bezárólag); true, ha volt új impulzus
+static bool cursor_advance(RideExportCursor_t *c, int64_t ts) {
+  bool moved = false;
+  while (c->havePending && c->pendingUs <= ts) {
+    if (c->pendingUs >= c->lastPulseUs) {
+      if (c->pulses > 0) c->lastIntervalUs = c->pendingUs - c->lastPulseUs;
+      c->lastPulseUs = c->pendingUs;
+      c->pulses++;
+      moved = true;
+    }
+    cursor_fetch(c);
+  }
+  return moved;
+}
+
+// Sebesség ts-kor: az utolsó intervallum, impulzus nélkül az eltelt idő a felső korlát
+static double cursor_speed_ms(const RideExportCursor_t *c, double pulseDistanceM, int64_t ts) {
+  int64_t since = ts - c->lastPulseUs;
+  if (c->pulses < 2 || c->lastIntervalUs <= 0 || since >= (int64_t)SPEED_TIMEOUT_MS * 1000) return 0.0;
+  int64_t dt = since > c->lastIntervalUs ? since : c->lastIntervalUs;
+  return pulseDistanceM * 1e6 / dt;
+}
+
+// --- Másodperces minták: mozgás közben minden másodpercben, megálláskor egy ---
+
+typedef struct {
+  uint32_t sec;
+  double distanceM;
+  double speedMs;
+} Sample_t;
+
+static bool sample_next(RideExport_t *e, Sample_t *out) {
+  RideExportCursor_t *c = &e->cursor;
+  while (!e->done) {
+    uint32_t sec = e->sec;
+    int64_t ts = c->firstUs + (int64_t)sec * 1000000;
+    bool moved = cursor_advance(c, ts);
+    double speed = cursor_speed_ms(c, e->pulseDistanceM, ts);
+    bool emit = moved || sec == 0 || (speed == 0.0 && !e->stopped);
+
+    e->stopped = speed == 0.0;
+    e->sec = sec + 1;
+    if (e->stopped) {
+      if (!c->havePending) {
+        e->done = true;
+      } else {
+        // Megállás: ugrás a következő impulzus másodpercére
+        int64_t next = (c->pendingUs - c->firstUs + 999999) / 1000000;
+        if (next > e->sec) e->sec = (uint32_t)next;
+      }
+    }
+    if (emit) {
+      out->sec = sec;
+      out->distanceM = c->pulses > 0 ? (c->pulses - 1) * e->pulseDistanceM : 0.0;
+      out->speedMs = speed;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void sampling_reset(RideExport_t *e) {
+  cursor_reset(&e->cursor);
+  e->sec = 0;
+  e->stopped = false;
+  e->done = false;
+}
+
+// --- Kimeneti puffer ---
+
+static uint16_t fit_crc_byte(uint16_t crc, uint8_t byte) {
+  static const uint16_t table[16] = {
+      0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+      0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400,
+  };
+  uint16_t tmp = table[crc & 0xF];
+  crc = (crc >> 4) & 0x0FFF;
+  crc = crc ^ tmp ^ table[byte & 0xF];
+  tmp = table[crc & 0xF];
+  crc = (crc >> 4) & 0x0FFF;
+  return crc ^ tmp ^ table[(byte >> 4) & 0xF];
+}
+
+static void put_bytes(RideExport_t *e, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  if (e->stageLen + len > RIDE_EXPORT_STAGE_SIZE) len = RIDE_EXPORT_STAGE_SIZE - e->stageLen;
+  for (size_t i = 0; i < len; i++) {
+    e->stage[e->stageLen++] = p[i];
+    if (e->format == RIDE_EXPORT_FIT) e->crc = fit_crc_byte(e->crc, p[i]);
+  }
+}
+
+static void put_le(RideExport_t *e, uint32_t value, uint8_t size) {
+  uint8_t b[4];
+  for (uint8_t i = 0; i < size; i++) b[i] = (uint8_t)(value >> (8 * i));
+  put_bytes(e, b, size);
+}
+
+static void put_text(RideExport_t *e, const char *fmt, ...) {
+  int room = RIDE_EXPORT_STAGE_SIZE - e->stageLen;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf((char *)e->stage + e->stageLen, room, fmt, args);
+  va_end(args);
+  if (n > 0) e->stageLen += n < room ? n : room - 1;
+}
+
+// --- FIT üzenetek ---
+
+static uint32_t fit_def_size(uint8_t fieldCount) { return 6 + 3 * fieldCount; }
+
+static uint32_t fit_msg_size(const FitField_t *fields, uint8_t fieldCount) {
+  uint32_t size = 1;
+  for (uint8_t i = 0; i < fieldCount; i++) size += fields[i].size;
+  return size;
+}
+
+static void fit_put_def(RideExport_t *e, uint8_t local, uint16_t global, const FitField_t *fields,
+                        uint8_t fieldCount) {
+  put_le(e, 0x40 | local, 1);
+  put_le(e, 0, 1); // Fenntartott
+  put_le(e, 0, 1); // Little endian
+  put_le(e, global, 2);
+  put_le(e, fieldCount, 1);
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    put_le(e, fields[i].num, 1);
+    put_le(e, fields[i].size, 1);
+    put_le(e, fields[i].baseType, 1);
+  }
+}
+
+static void fit_put_msg(RideExport_t *e, uint8_t local, const FitField_t *fields, uint8_t fieldCount,
+                        const uint32_t *values) {
+  put_le(e, local, 1);
+  for (uint8_t i = 0; i < fieldCount; i++) put_le(e, values[i], fields[i].size);
+}
+
+static uint8_t record_field_count(const RideExport_t *e) {
+  return e->source.nextFix ? COUNT_OF(recordFields) : COUNT_OF(recordFields) - 2;
+}
+
+static uint32_t fit_time(const RideExport_t *e, uint32_t sec) {
+  uint32_t base = e->startEpoch > FIT_EPOCH_OFFSET ? e->startEpoch - FIT_EPOCH_OFFSET : 0;
+  return base + sec;
+}
+
+static uint32_t scaled(double value, double scale) { return (uint32_t)(value * scale + 0.5); }
+
+static bool next_fix(RideExport_t *e) {
+  e->haveNextFix = e->source.nextFix && e->source.nextFix(e->source.fixCtx, &e->nextFix);
+  return e->haveNextFix;
+}
+
+static int32_t semicircles(int32_t e7) { return (int32_t)((int64_t)e7 * 2147483648LL / 1800000000LL); }
+
+static void fit_put_record(RideExport_t *e, const Sample_t *s) {
+  uint32_t values[COUNT_OF(recordFields)] = {
+      fit_time(e, s->sec), scaled(s->distanceM, 100.0), scaled(s->speedMs, 1000.0),
+      FIT_INVALID_SINT32,  FIT_INVALID_SINT32,
+  };
+  if (e->source.nextFix && e->startEpoch >= MIN_VALID_EPOCH) {
+    uint32_t epoch = e->startEpoch + s->sec;
+    while (e->haveNextFix && e->nextFix.epoch <= epoch) {
+      e->fix = e->nextFix;
+      e->haveFix = true;
+      next_fix(e);
+    }
+    if (e->haveFix && epoch - e->fix.epoch <= FIX_MAX_AGE_S) {
+      values[3] = (uint32_t)semicircles(e->fix.latE7);
+      values[4] = (uint32_t)semicircles(e->fix.lonE7);
+    }
+  }
+  fit_put_msg(e, LOCAL_RECORD, recordFields, record_field_count(e), values);
+}
+
+static void fit_put_summary(RideExport_t *e, uint8_t local, uint16_t global) {
+  uint32_t end = fit_time(e, e->lastSec);
+  uint32_t avg = e->movingSec ? scaled(e->totalM / e->movingSec, 1000.0) : 0;
+  uint32_t maxSpeed = scaled(e->maxSpeedMs, 1000.0);
+  if (local == LOCAL_LAP) {
+    // event: lap (9), event_type: stop (1)
+    const uint32_t v[] = {end, fit_time(e, 0), e->lastSec * 1000, e->movingSec * 1000,
+                          scaled(e->totalM, 100.0), avg, maxSpeed, 9, 1};
+    fit_put_def(e, local, global, lapFields, COUNT_OF(lapFields));
+    fit_put_msg(e, local, lapFields, COUNT_OF(lapFields), v);
+  } else {
+    // sport: cycling (2), sub_sport: generic (0), event: session (8), event_type: stop (1)
+    const uint32_t v[] = {end, fit_time(e, 0), e->lastSec * 1000, e->movingSec * 1000,
+                          scaled(e->totalM, 100.0), avg, maxSpeed, 2, 0, 8, 1, 0, 1};
+    fit_put_def(e, local, global, sessionFields, COUNT_OF(sessionFields));
+    fit_put_msg(e, local, sessionFields, COUNT_OF(sessionFields), v);
+  }
+}
+
+// Egy lépésnyi FIT kimenet a pufferbe; false a folyam végén
+static bool fit_step(RideExport_t *e) {
+  Sample_t s;
+  switch (e->step) {
+    case 0: {
+      uint8_t h[FIT_HEADER_SIZE] = {FIT_HEADER_SIZE, 0x20, FIT_PROFILE_VER & 0xFF, FIT_PROFILE_VER >> 8,
+                                    (uint8_t)e->dataSize, (uint8_t)(e->dataSize >> 8),
+                                    (uint8_t)(e->dataSize >> 16), (uint8_t)(e->dataSize >> 24),
+                                    '.', 'F', 'I', 'T', 0, 0};
+      uint16_t crc = 0;
+      for (uint8_t i = 0; i < 12; i++) crc = fit_crc_byte(crc, h[i]);
+      h[12] = crc & 0xFF;
+      h[13] = crc >> 8;
+      put_bytes(e, h, sizeof(h));
+      e->step++;
+      return true;
+    }
+    case 1: {
+      // type: activity (4), manufacturer: development (255)
+      const uint32_t id[] = {4, 255, 1, e->logSeq ? e->logSeq : 1, fit_time(e, 0)};
+      fit_put_def(e, LOCAL_FILE_ID, 0, fileIdFields, COUNT_OF(fileIdFields));
+      fit_put_msg(e, LOCAL_FILE_ID, fileIdFields, COUNT_OF(fileIdFields), id);
+      // event: timer (0), event_type: start (0)
+      const uint32_t start[] = {fit_time(e, 0), 0, 0, 0};
+      fit_put_def(e, LOCAL_EVENT, 21, eventFields, COUNT_OF(eventFields));
+      fit_put_msg(e, LOCAL_EVENT, eventFields, COUNT_OF(eventFields), start);
+      fit_put_def(e, LOCAL_RECORD, 20, recordFields, record_field_count(e));
+      next_fix(e);
+      e->step++;
+      return true;
+    }
+    case 2:
+      if (sample_next(e, &s)) {
+        fit_put_record(e, &s);
+        return true;
+      }
+      e->step++;
+      // fall through
+    case 3: {
+      // event: timer (0), event_type: stop_all (4)
+      const uint32_t stop[] = {fit_time(e, e->lastSec), 0, 4, 0};
+      fit_put_msg(e, LOCAL_EVENT, eventFields, COUNT_OF(eventFields), stop);
+      fit_put_summary(e, LOCAL_LAP, 19);
+      e->step++;
+      return true;
+    }
+    case 4:
+      fit_put_summary(e, LOCAL_SESSION, 18);
+      e->step++;
+      return true;
+    case 5: {
+      // type: manual (0), event: activity (26), event_type: stop (1)
+      const uint32_t v[] = {fit_time(e, e->lastSec), e->movingSec * 1000, 1, 0, 26, 1};
+      fit_put_def(e, LOCAL_ACTIVITY, 34, activityFields, COUNT_OF(activityFields));
+      fit_put_msg(e, LOCAL_ACTIVITY, activityFields, COUNT_OF(activityFields), v);
+      e->step++;
+      return true;
+    }
+    case 6: {
+      uint8_t crc[2] = {(uint8_t)(e->crc & 0xFF), (uint8_t)(e->crc >> 8)};
+      put_bytes(e, crc, sizeof(crc));
+      e->step++;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Előzetes menet: rekordszám és összesítők, ebből a FIT adatrész hossza
+static void fit_prepare(RideExport_t *e) {
+  Sample_t s, prev = {};
+  bool havePrev = false;
+  while (sample_next(e, &s)) {
+    if (havePrev && prev.speedMs > 0.0) e->movingSec += s.sec - prev.sec;
+    if (s.speedMs > e->maxSpeedMs) e->maxSpeedMs = s.speedMs;
+    e->records++;
+    e->lastSec = s.sec;
+    e->totalM = s.distanceM;
+    prev = s;
+    havePrev = true;
+  }
+  sampling_reset(e);
+
+  uint8_t recordCount = record_field_count(e);
+  e->dataSize = fit_def_size(COUNT_OF(fileIdFields)) + fit_msg_size(fileIdFields, COUNT_OF(fileIdFields)) +
+                fit_def_size(COUNT_OF(eventFields)) + 2 * fit_msg_size(eventFields, COUNT_OF(eventFields)) +
+                fit_def_size(recordCount) + e->records * fit_msg_size(recordFields, recordCount) +
+                fit_def_size(COUNT_OF(lapFields)) + fit_msg_size(lapFields, COUNT_OF(lapFields)) +
+                fit_def_size(COUNT_OF(sessionFields)) + fit_msg_size(sessionFields, COUNT_OF(sessionFields)) +
+                fit_def_size(COUNT_OF(activityFields)) + fit_msg_size(activityFields, COUNT_OF(activityFields));
+}
+
+// --- GPX ---
+
+static void put_utc(RideExport_t *e, uint32_t epoch) {
+  time_t t = epoch;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char text[24];
+  strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  put_text(e, "%s", text);
+}
+
+static void put_degrees(RideExport_t *e, int32_t e7) {
+  uint32_t a = e7 < 0 ? (uint32_t)(-(int64_t)e7) : (uint32_t)e7;
+  put_text(e, "%s%lu.%07lu", e7 < 0 ? "-" : "", (unsigned long)(a / 10000000), (unsigned long)(a % 10000000));
+}
+
+static bool gpx_step(RideExport_t *e) {
+  switch (e->step) {
+    case 0:
+      put_text(e, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                  "<gpx version=\"1.1\" creator=\"ESP32 odometer\" xmlns=\"http://www.topografix.com/GPX/1/1\" "
+                  "xmlns:gpxtpx=\"http://www.garmin.com/xmlschemas/TrackPointExtension/v2\">\n");
+      e->step++;
+      return true;
+    case 1:
+      if (e->startEpoch >= MIN_VALID_EPOCH) {
+        put_text(e, "<metadata><time>");
+        put_utc(e, e->startEpoch);
+        put_text(e, "</time></metadata>\n");
+      }
+      put_text(e, "<trk><name>Ride %lu</name><type>cycling</type><trkseg>\n", (unsigned long)e->logSeq);
+      e->step++;
+      return true;
+    case 2:
+      if (next_fix(e)) {
+        RideExportFix_t *f = &e->nextFix;
+        put_text(e, "<trkpt lat=\"");
+        put_degrees(e, f->latE7);
+        put_text(e, "\" lon=\"");
+        put_degrees(e, f->lonE7);
+        put_text(e, "\"><time>");
+        put_utc(e, f->epoch);
+        put_text(e, "</time>");
+        // Sebesség az impulzusokból, ha a napló ideje a fixekhez igazítható
+        if (e->startEpoch >= MIN_VALID_EPOCH && f->epoch >= e->startEpoch) {
+          int64_t ts = e->cursor.firstUs + (int64_t)(f->epoch - e->startEpoch) * 1000000;
+          cursor_advance(&e->cursor, ts);
+          double speed = cursor_speed_ms(&e->cursor, e->pulseDistanceM, ts);
+          put_text(e, "<extensions><gpxtpx:TrackPointExtension><gpxtpx:speed>%.3f</gpxtpx:speed>"
+                      "</gpxtpx:TrackPointExtension></extensions>", speed);
+        }
+        put_text(e, "</trkpt>\n");
+        return true;
+      }
+      e->step++;
+      // fall through
+    case 3:
+      put_text(e, "</trkseg></trk>\n</gpx>\n");
+      e->step++;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ride_export_init(RideExport_t *exp, RideExportFormat_t format, const RideExportSource_t *source) {
+  memset(exp, 0, sizeof(*exp));
+  if (source->log == NULL || source->logBytes < sizeof(RideLogHeader_t)) return false;
+  if (format == RIDE_EXPORT_GPX && source->nextFix == NULL) return false;
+
+  RideLogHeader_t h;
+  memcpy(&h, source->log, sizeof(h));
+  if (h.magic != RIDE_LOG_MAGIC || h.headerSize < sizeof(h) || h.headerSize > source->logBytes) return false;
+  if (h.version != RIDE_LOG_VERSION_RAW32 && h.version != RIDE_LOG_VERSION_DOD) return false;
+
+  exp->format = format;
+  exp->source = *source;
+  exp->logSeq = h.logSeq;
+  exp->startEpoch = source->startEpoch ? source->startEpoch : h.startEpoch;
+
+  // A napló saját kereke, régebbi naplónál a hívóé
+  double circumferenceM = source->circumferenceM;
+  uint8_t pulsesPerRev = source->pulsesPerRev;
+  if (h.wheelMm != 0xFFFF && h.wheelMm != 0 && h.pulsesPerRev != 0xFF && h.pulsesPerRev != 0) {
+    circumferenceM = h.wheelMm / 1000.0;
+    pulsesPerRev = h.pulsesPerRev;
+  }
+  if (circumferenceM <= 0.0 || pulsesPerRev == 0) return false;
+  exp->pulseDistanceM = circumferenceM / pulsesPerRev;
+
+  RideExportCursor_t *c = &exp->cursor;
+  c->version = h.version;
+  c->data = source->log + h.headerSize;
+  c->length = source->logBytes - h.headerSize;
+  if (h.dataBytes != RIDE_LOG_OPEN && h.dataBytes < c->length) c->length = h.dataBytes;
+  c->baseUs = h.firstPulseUs;
+  if (!cursor_reset(c)) return false;
+
+  if (format == RIDE_EXPORT_FIT) fit_prepare(exp);
+  return true;
+}
+
+uint32_t ride_export_size(const RideExport_t *exp) {
+  return exp->format == RIDE_EXPORT_FIT ? FIT_HEADER_SIZE + exp->dataSize + 2 : 0;
+}
+
+size_t ride_export_read(RideExport_t *exp, uint8_t *buf, size_t cap) {
+  size_t n = 0;
+  while (n < cap) {
+    if (exp->stagePos == exp->stageLen) {
+      exp->stagePos = exp->stageLen = 0;
+      bool more = exp->format == RIDE_EXPORT_FIT ? fit_step(exp) : gpx_step(exp);
+      if (!more) break;
+    }
+    size_t chunk = exp->stageLen - exp->stagePos;
+    if (chunk > cap - n) chunk = cap - n;
+    memcpy(buf + n, exp->stage + exp->stagePos, chunk);
+    exp->stagePos += chunk;
+    n += chunk;
+  }
+  exp->emitted += n;
+  return n;
+}
@@ -0,0 +1,102 @@
+// rideexport.h
+// Tárolt menetnapló exportja FIT (Garmin/Strava tevékenység) vagy GPX
+// formátumba, húzásos folyamként: a hívó tetszőleges méretű darabokat kér
+// (soros port, HTTP válasz, SD fájl), a teljes fájl sosem áll elő a
+// memóriában. Az állapot fix méretű (dekóder + egy rekordnyi puffer), a
+// menet hosszától független.
+// FIT: másodpercenkénti rekordok (idő, táv, sebesség) az impulzusokból,
+// GPS fixek esetén pozícióval; a végén kör, menet és tevékenység összesítő.
+// A hossz előre ismert (egy előzetes menet a naplón), a CRC folyamatosan számolódik.
+// GPX: csak GPS fix forrással (a trkpt-hez kötelező a pozíció); a pontokhoz
+// az impulzusokból számolt sebesség kerül. Hardverfüggetlen, a hoszt oldali
+// eszköz (tools/pulselog) ugyanezt a kódot használja.
+#ifndef RIDEEXPORT_H
+#define RIDEEXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pulsecodec.h"
+#include "ridelogformat.h"
+
+#define RIDE_EXPORT_STAGE_SIZE 256 // Egy FIT üzenet vagy egy GPX trkpt sor
+
+typedef enum {
+  RIDE_EXPORT_FIT,
+  RIDE_EXPORT_GPX,
+} RideExportFormat_t;
+
+typedef struct {
+  uint32_t epoch;   // UTC másodperc
+  int32_t latE7;    // Fok * 1e7
+  int32_t lonE7;
+} RideExportFix_t;
+
+// A menet GPS fixei időrendben; false, ha nincs több
+typedef bool (*RideExportFixFn_t)(void *ctx, RideExportFix_t *fix);
+
+typedef struct {
+  const uint8_t *log;          // Napló fejléccel (pl. RideLogInfo_t.data)
+  size_t logBytes;
+  double circumferenceM;       // Ha a napló nem rögzítette a kereket (régebbi napló)
+  uint8_t pulsesPerRev;
+  uint32_t startEpoch;         // 0: a napló fejlécéből
+  RideExportFixFn_t nextFix;   // NULL: nincs GPS (GPX nem készíthető)
+  void *fixCtx;
+} RideExportSource_t;
+
+// Impulzusok sorban, a nyers (1) és a kódolt (2) naplóváltozatból
+typedef struct {
+  uint16_t version;
+  const uint8_t *data;
+  size_t length;
+  size_t offset;              // Nyers változatnál
+  PulseDecoder_t decoder;     // Kódolt változatnál
+  int64_t baseUs;             // A fejléc első impulzusa (nyers változat)
+  bool havePending;
+  int64_t pendingUs;          // A következő impulzus
+  int64_t firstUs;
+  int64_t lastPulseUs;
+  int64_t lastIntervalUs;
+  uint32_t pulses;            // Eddig feldolgozott impulzusok
+} RideExportCursor_t;
+
+typedef struct {
+  RideExportFormat_t format;
+  RideExportSource_t source;
+  uint32_t logSeq;
+  uint32_t startEpoch;        // 0: ismeretlen (FIT-ben 1989-12-31-től)
+  double pulseDistanceM;
+  RideExportCursor_t cursor;
+  uint8_t step;               // A kimeneti állapotgép lépése
+  // Másodperces mintavétel
+  uint32_t sec;               // A következő vizsgált másodperc az első impulzustól
+  bool stopped;
+  bool done;
+  // Előzetes menet eredménye (FIT összesítők és hossz)
+  uint32_t records;
+  uint32_t lastSec;
+  uint32_t movingSec;
+  double totalM;
+  double maxSpeedMs;
+  uint32_t dataSize;          // FIT adatrész
+  uint16_t crc;
+  // GPS
+  RideExportFix_t fix, nextFix;
+  bool haveFix, haveNextFix;
+  // Kimeneti puffer
+  uint8_t stage[RIDE_EXPORT_STAGE_SIZE];
+  uint16_t stageLen;
+  uint16_t stagePos;
+  uint32_t emitted;
+} RideExport_t;
+
+// false: érvénytelen napló, vagy GPX fix forrás nélkül
+bool ride_export_init(RideExport_t *exp, RideExportFormat_t format, const RideExportSource_t *source);
+
+// A teljes kimenet hossza bájtban (FIT), 0 ha előre nem ismert (GPX)
+uint32_t ride_export_size(const RideExport_t *exp);
+
+// Legfeljebb cap bájt a folyamból; 0 a végén
+size_t ride_export_read(RideExport_t *exp, uint8_t *buf, size_t cap);
+
+#endif
@@ -0,0 +1,353 @@
+#include "ridehistory.h"
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "pipelinestats.h"
+#include "energymodel.h"
+#include "wheelprofile.h"
+
+extern const char *TAG;
+
+#define SECTOR_SIZE          4096
+#define INDEX_SECTORS        2      // Váltakozva írt index szektorok a partíció végén
+#define INDEX_SLOT_SIZE      512
+#define INDEX_SLOTS_PER_SEC  (SECTOR_SIZE / INDEX_SLOT_SIZE)
+#define INDEX_SLOTS          (INDEX_SECTORS * INDEX_SLOTS_PER_SEC)
+#define RECORDS_PER_SECTOR   (SECTOR_SIZE / sizeof(RideRecord_t))
+
+static_assert(PIPELINE_COUNTER_COUNT == RIDE_COUNTER_SLOTS, "ride record counter slots");
+#define INDEX_MAGIC          0x52494458 // "RIDX"
+#define RIDE_HISTORY_WEEKS   8
+#define RIDE_HISTORY_MONTHS  12
+#define MIN_VALID_EPOCH      1704067200 // 2024-01-01: ennél korábbi idő = nincs beállítva az óra
+
+static_assert(sizeof(RideRecord_t) == 64, "RideRecord_t must stay 64 bytes");
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;             // Pillanatkép sorszáma, a legnagyobb érvényes az aktuális
+  uint32_t nextRideSeq;
+  uint32_t head;            // A következő rekord helye
+  uint32_t count;           // Érvényes rekordok a gyűrűben
+  RideBucket_t weeks[RIDE_HISTORY_WEEKS];
+  RideBucket_t months[RIDE_HISTORY_MONTHS];
+  RideBucket_t undated;     // Beállított óra nélküli menetek
+  RideBucket_t lifetime;
+  uint32_t crc;
+} RideIndex_t;
+
+static_assert(sizeof(RideIndex_t) <= INDEX_SLOT_SIZE, "RideIndex_t must fit an index slot");
+
+// Folyamatban lévő menet
+typedef struct {
+  bool active;
+  int64_t startUs;
+  int64_t lastMovingUs;
+  uint32_t startEpoch;
+  double startKm;
+  double lastKm;
+  uint32_t startMovingS;
+  uint32_t lastMovingS;
+  float maxSpeedKmh;
+} RideTracker_t;
+
+static const esp_partition_t *partition = NULL;
+static const uint8_t *mapped = NULL;        // A teljes partíció leképezve
+static spi_flash_mmap_handle_t mapHandle;
+static uint32_t recordSlots = 0;
+static uint32_t indexOffset = 0;            // Az index szektorok kezdete
+static int32_t indexSlot = -1;              // Az utoljára írt pillanatkép helye
+
+static RideIndex_t rideIndex = {};          // RAM másolat, historyMux védi
+static RideTracker_t tracker = {};
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t writeMutex = NULL; // Flash írások sorosítása
+
+static uint32_t crc_of(const void *data, size_t len) {
+  return esp_rom_crc32_le(0, (const uint8_t *)data, len);
+}
+
+static bool record_valid(const RideRecord_t *r) {
+  return r->magic == RIDE_RECORD_MAGIC && r->crc == crc_of(r, offsetof(RideRecord_t, crc));
+}
+
+static bool index_valid(const RideIndex_t *idx) {
+  return idx->magic == INDEX_MAGIC && idx->crc == crc_of(idx, offsetof(RideIndex_t, crc));
+}
+
+static bool epoch_valid(uint32_t epoch) { return epoch >= MIN_VALID_EPOCH; }
+
+static uint32_t week_key(uint32_t epoch) { return (epoch / 86400 + 3) / 7; } // 1970-01-01 csütörtök
+
+static uint32_t month_key(uint32_t epoch) {
+  time_t t = epoch;
+  struct tm tmv;
+  localtime_r(&t, &tmv);
+  return (uint32_t)(tmv.tm_year + 1900) * 12 + tmv.tm_mon;
+}
+
+static void bucket_add(RideBucket_t *b, uint32_t key, const RideRecord_t *r) {
+  if (b->key != key) {
+    memset(b, 0, sizeof(*b)); // Új időszak: a régi kiesik a gyűrűből
+    b->key = key;
+  }
+  b->rides++;
+  b->movingS += r->movingS;
+  b->distanceKm += r->distanceKm;
+}
+
+esp_err_t ride_history_init(void) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                       RIDE_HISTORY_PARTITION_LABEL);
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "Ride history partition '%s' not found.", RIDE_HISTORY_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (partition->size < (INDEX_SECTORS + 1) * SECTOR_SIZE) {
+    ESP_LOGE(TAG, "Ride history partition too small (%lu bytes).", (unsigned long)partition->size);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  const void *ptr = NULL;
+  esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &ptr, &mapHandle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Ride history mmap failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  mapped = (const uint8_t *)ptr;
+  indexOffset = partition->size - INDEX_SECTORS * SECTOR_SIZE;
+  recordSlots = indexOffset / sizeof(RideRecord_t);
+
+  static StaticSemaphore_t writeMutexBuffer;
+  writeMutex = xSemaphoreCreateMutexStatic(&writeMutexBuffer);
+  if (writeMutex == NULL) return ESP_ERR_NO_MEM;
+
+  // A legfrissebb érvényes index pillanatkép megkeresése
+  uint32_t bestSeq = 0;
+  for (int32_t slot = 0; slot < INDEX_SLOTS; slot++) {
+    const RideIndex_t *idx = (const RideIndex_t *)(mapped + indexOffset + slot * INDEX_SLOT_SIZE);
+    if (index_valid(idx) && (indexSlot < 0 || idx->seq > bestSeq)) {
+      bestSeq = idx->seq;
+      indexSlot = slot;
+    }
+  }
+
+  if (indexSlot >= 0) {
+    memcpy(&rideIndex, mapped + indexOffset + indexSlot * INDEX_SLOT_SIZE, sizeof(rideIndex));
+    ESP_LOGI(TAG, "Ride history: %lu rides stored (%lu slots), %.1f km lifetime.",
+             (unsigned long)rideIndex.count, (unsigned long)recordSlots, rideIndex.lifetime.distanceKm);
+  } else {
+    memset(&rideIndex, 0, sizeof(rideIndex));
+    rideIndex.magic = INDEX_MAGIC;
+    rideIndex.nextRideSeq = 1;
+    ESP_LOGI(TAG, "Ride history: empty partition, %lu record slots.", (unsigned long)recordSlots);
+  }
+  return ESP_OK;
+}
+
+const RideRecord_t *ride_history_get(uint32_t n) {
+  if (mapped == NULL) return NULL;
+  portENTER_CRITICAL(&historyMux);
+  uint32_t count = rideIndex.count;
+  uint32_t head = rideIndex.head;
+  portEXIT_CRITICAL(&historyMux);
+  if (n >= count) return NULL;
+
+  uint32_t slot = (head + recordSlots - 1 - n) % recordSlots;
+  const RideRecord_t *r = (const RideRecord_t *)(mapped + slot * sizeof(RideRecord_t));
+  return record_valid(r) ? r : NULL;
+}
+
+uint32_t ride_history_count(void) {
+  portENTER_CRITICAL(&historyMux);
+  uint32_t count = rideIndex.count;
+  portEXIT_CRITICAL(&historyMux);
+  return count;
+}
+
+bool ride_history_week(uint32_t weekKey, RideBucket_t *out) {
+  portENTER_CRITICAL(&historyMux);
+  const RideBucket_t *b = &rideIndex.weeks[weekKey % RIDE_HISTORY_WEEKS];
+  bool found = (b->key == weekKey && b->rides > 0);
+  if (found) *out = *b;
+  portEXIT_CRITICAL(&historyMux);
+  return found;
+}
+
+bool ride_history_month(uint32_t monthKey, RideBucket_t *out) {
+  portENTER_CRITICAL(&historyMux);
+  const RideBucket_t *b = &rideIndex.months[monthKey % RIDE_HISTORY_MONTHS];
+  bool found = (b->key == monthKey && b->rides > 0);
+  if (found) *out = *b;
+  portEXIT_CRITICAL(&historyMux);
+  return found;
+}
+
+void ride_history_summary(RideSummary_t *out) {
+  memset(out, 0, sizeof(*out));
+  const RideRecord_t *last = ride_history_get(0);
+  if (last != NULL) {
+    out->lastKm = last->distanceKm;
+    out->lastMovingS = last->movingS;
+  }
+  out->rides = ride_history_count();
+
+  uint32_t now = (uint32_t)time(NULL);
+  RideBucket_t b;
+  if (epoch_valid(now)) {
+    if (ride_history_week(week_key(now), &b)) out->weekKm = b.distanceKm;
+    if (ride_history_month(month_key(now), &b)) out->monthKm = b.distanceKm;
+  } else {
+    // Óra nélkül nincs naptár: a dátum nélküli menetek összege látszik
+    portENTER_CRITICAL(&historyMux);
+    out->weekKm = out->monthKm = rideIndex.undated.distanceKm;
+    portEXIT_CRITICAL(&historyMux);
+  }
+}
+
+// Új index pillanatkép a következő helyre; szektorhatáron előbb törlünk
+static esp_err_t write_index(const RideIndex_t *idx) {
+  int32_t slot = (indexSlot + 1) % INDEX_SLOTS;
+  size_t offset = indexOffset + slot * INDEX_SLOT_SIZE;
+  if (slot % INDEX_SLOTS_PER_SEC == 0) {
+    esp_err_t err = esp_partition_erase_range(partition, offset, SECTOR_SIZE);
+    if (err != ESP_OK) return err;
+  }
+  esp_err_t err = esp_partition_write(partition, offset, idx, sizeof(*idx));
+  if (err == ESP_OK) indexSlot = slot;
+  return err;
+}
+
+static esp_err_t append_record(RideRecord_t *rec) {
+  if (partition == NULL) return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(writeMutex, portMAX_DELAY);
+
+  RideIndex_t next;
+  portENTER_CRITICAL(&historyMux);
+  next = rideIndex;
+  portEXIT_CRITICAL(&historyMux);
+
+  rec->magic = RIDE_RECORD_MAGIC;
+  rec->seq = next.nextRideSeq++;
+  rec->crc = crc_of(rec, offsetof(RideRecord_t, crc));
+
+  esp_err_t err = ESP_OK;
+  size_t offset = next.head * sizeof(RideRecord_t);
+  if (next.head % RECORDS_PER_SECTOR == 0) {
+    // Új szektor: a legrégebbi RECORDS_PER_SECTOR rekord kiesik
+    err = esp_partition_erase_range(partition, offset, SECTOR_SIZE);
+    if (next.count > recordSlots - RECORDS_PER_SECTOR) next.count = recordSlots - RECORDS_PER_SECTOR;
+  }
+  if (err == ESP_OK) err = esp_partition_write(partition, offset, rec, sizeof(*rec));
+
+  if (err == ESP_OK) {
+    next.head = (next.head + 1) % recordSlots;
+    next.count++;
+    if (epoch_valid(rec->startEpoch)) {
+      uint32_t wk = week_key(rec->startEpoch);
+      uint32_t mo = month_key(rec->startEpoch);
+      bucket_add(&next.weeks[wk % RIDE_HISTORY_WEEKS], wk, rec);
+      bucket_add(&next.months[mo % RIDE_HISTORY_MONTHS], mo, rec);
+    } else {
+      bucket_add(&next.undated, 0, rec);
+    }
+    bucket_add(&next.lifetime, 0, rec);
+    next.seq++;
+    next.crc = crc_of(&next, offsetof(RideIndex_t, crc));
+    err = write_index(&next);
+  }
+
+  if (err == ESP_OK) {
+    portENTER_CRITICAL(&historyMux);
+    rideIndex = next;
+    portEXIT_CRITICAL(&historyMux);
+  }
+  xSemaphoreGive(writeMutex);
+  return err;
+}
+
+void ride_history_track(bool moving, double totalKm, uint32_t movingS, double speedKmh, int64_t nowUs) {
+  bool started = false;
+  portENTER_CRITICAL(&historyMux);
+  if (moving && !tracker.active) {
+    started = true;
+    tracker.active = true;
+    tracker.startUs = nowUs;
+    tracker.startEpoch = (uint32_t)time(NULL);
+    tracker.startKm = totalKm;
+    tracker.startMovingS = movingS;
+    tracker.maxSpeedKmh = 0.0f;
+  }
+  if (tracker.active) {
+    if (moving) tracker.lastMovingUs = nowUs;
+    tracker.lastKm = totalKm;
+    tracker.lastMovingS = movingS;
+    if (speedKmh > tracker.maxSpeedKmh) tracker.maxSpeedKmh = (float)speedKmh;
+  }
+  portEXIT_CRITICAL(&historyMux);
+  if (started) {
+    pipeline_ride_begin(); // Feldolgozási számlálók a menet elejétől
+    energy_ride_begin();
+  }
+}
+
+bool ride_history_idle_check(int64_t nowUs) {
+  portENTER_CRITICAL(&historyMux);
+  bool ended = tracker.active && (nowUs - tracker.lastMovingUs) > (int64_t)RIDE_HISTORY_END_IDLE_S * 1000000;
+  portEXIT_CRITICAL(&historyMux);
+  if (ended) ride_history_end_ride();
+  return ended;
+}
+
+esp_err_t ride_history_end_ride(void) {
+  RideTracker_t t;
+  portENTER_CRITICAL(&historyMux);
+  t = tracker;
+  tracker.active = false;
+  portEXIT_CRITICAL(&historyMux);
+  if (!t.active) return ESP_OK;
+
+  RideRecord_t rec = {};
+  rec.startEpoch = epoch_valid(t.startEpoch) ? t.startEpoch : 0;
+  rec.durationS = (uint32_t)((t.lastMovingUs - t.startUs) / 1000000);
+  rec.movingS = t.lastMovingS > t.startMovingS ? t.lastMovingS - t.startMovingS : 0;
+  rec.distanceKm = (float)(t.lastKm - t.startKm);
+  rec.maxSpeedKmh = t.maxSpeedKmh;
+  rec.avgSpeedKmh = rec.movingS > 0 ? rec.distanceKm / (rec.movingS / 3600.0f) : 0.0f;
+  rec.profileIndex = wheel_calib().profileIndex;
+  PipelineCounters_t counters;
+  pipeline_ride_counters(&counters);
+  memcpy(rec.counters, counters.value, sizeof(rec.counters));
+  rec.flags |= RIDE_FLAG_COUNTERS;
+  double rideMah = energy_ride_end();
+  rec.energyDmAh = rideMah * 10.0 < UINT16_MAX ? (uint16_t)(rideMah * 10.0 + 0.5) : UINT16_MAX;
+  rec.flags |= RIDE_FLAG_ENERGY;
+
+  if (rec.distanceKm < RIDE_HISTORY_MIN_KM) {
+    ESP_LOGI(TAG, "Ride ended after %.2f km, too short to store.", rec.distanceKm);
+    return ESP_OK;
+  }
+
+  esp_err_t err = append_record(&rec);
+  if (err == ESP_OK) {
+    ESP_LOGI(TAG, "Ride #%lu stored: %.2f km, moving %lu s, avg %.1f km/h, max %.1f km/h, %.1f mAh.",
+             (unsigned long)rec.seq, rec.distanceKm, (unsigned long)rec.movingS, rec.avgSpeedKmh,
+             rec.maxSpeedKmh, rec.energyDmAh / 10.0);
+    ESP_LOGI(TAG, "Ride #%lu pipeline: seen %lu, accepted %lu, processed %lu, skipped %lu, max backlog %lu, max delay %lu us.",
+             (unsigned long)rec.seq, (unsigned long)rec.counters[PIPELINE_EDGES_SEEN],
+             (unsigned long)rec.counters[PIPELINE_EDGES_ACCEPTED],
+             (unsigned long)rec.counters[PIPELINE_PULSES_PROCESSED],
+             (unsigned long)rec.counters[PIPELINE_UPDATES_SKIPPED],
+             (unsigned long)rec.counters[PIPELINE_MAX_BACKLOG],
+             (unsigned long)rec.counters[PIPELINE_MAX_DELAY_US]);
+  } else {
+    ESP_LOGE(TAG, "Failed to store ride: %s", esp_err_to_name(err));
+  }
+  return err;
+}
@@ -0,0 +1,73 @@
+// ridehistory.h
+// Menetösszesítők tárolása a saját "ridehist" flash partíción. A partíció
+// eleje fix méretű (64 bájtos) rekordok gyűrűje, a végén két szektor
+// csak hozzáfűzött index-pillanatképeket tárol (utolsó rekord helye, heti és
+// havi összesítők). Olvasás esp_partition_mmap-en át, másolás nélkül;
+// az "utolsó N menet" és a heti/havi összeg konstans idejű.
+#ifndef RIDEHISTORY_H
+#define RIDEHISTORY_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define RIDE_HISTORY_PARTITION_LABEL "ridehist"
+#define RIDE_RECORD_MAGIC 0x52494445 // "RIDE"
+#define RIDE_COUNTER_SLOTS 6         // Impulzus-feldolgozási számlálók (pipelinestats.h sorrendjében)
+#define RIDE_FLAG_COUNTERS 0x01      // A counters mező érvényes
+#define RIDE_FLAG_ENERGY   0x02      // Az energyDmAh mező érvényes
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;          // Menet sorszáma (monoton)
+  uint32_t startEpoch;   // Indulás ideje (Unix), 0 = az óra nem volt beállítva
+  uint32_t durationS;    // Indulástól az utolsó mozgásig eltelt idő
+  uint32_t movingS;      // Mozgási idő (autopause)
+  float distanceKm;
+  float maxSpeedKmh;
+  float avgSpeedKmh;
+  uint8_t profileIndex;  // Kerékprofil a menet végén
+  uint8_t flags;
+  uint16_t energyDmAh;   // Becsült energia 0,1 mAh egységben (RIDE_FLAG_ENERGY)
+  uint32_t counters[RIDE_COUNTER_SLOTS];
+  uint32_t crc;          // CRC32 az előző mezőkre
+} RideRecord_t;
+
+// Összesítés egy naptári hétre/hónapra
+typedef struct {
+  uint32_t key;          // Hét: hétfőtől számolt hetek 1970 óta; hónap: év*12+hónap
+  uint16_t rides;
+  uint16_t reserved;
+  uint32_t movingS;
+  float distanceKm;
+} RideBucket_t;
+
+// A kijelzőnek szóló rövid összefoglaló
+typedef struct {
+  uint32_t rides;        // Tárolt menetek száma
+  float lastKm;          // Utolsó menet távja
+  uint32_t lastMovingS;
+  float weekKm;          // Aktuális hét (érvényes órával), egyébként a dátum nélküli menetek
+  float monthKm;
+} RideSummary_t;
+
+esp_err_t ride_history_init(void);
+
+// Utolsó N menet: n = 0 a legutóbbi. Mutató a leképezett flash-re, NULL ha nincs
+const RideRecord_t *ride_history_get(uint32_t n);
+uint32_t ride_history_count(void);
+
+// Heti/havi összesítő kulcs szerint; false, ha nincs (vagy már kiesett) ilyen időszak
+bool ride_history_week(uint32_t weekKey, RideBucket_t *out);
+bool ride_history_month(uint32_t monthKey, RideBucket_t *out);
+void ride_history_summary(RideSummary_t *out);
+
+// Menet követése a számoló taskból: moving = az autopause állapota
+void ride_history_track(bool moving, double totalKm, uint32_t movingS, double speedKmh, int64_t nowUs);
+
+// Menet lezárása, ha RIDE_HISTORY_END_IDLE_S óta nem mozgunk; true, ha lezárult
+bool ride_history_idle_check(int64_t nowUs);
+
+// Folyamatban lévő menet azonnali lezárása és mentése (pl. mélyalvás előtt)
+esp_err_t ride_history_end_ride(void);
+
+#endif
@@ -0,0 +1,382 @@
+#include "ridelog.h"
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "pulsecodec.h"
+#include "taskplacement.h"
+#include "wheelprofile.h"
+
+extern const char *TAG;
+
+#define SECTOR_SIZE       4096
+#define MAX_SLOTS         32
+#define MIN_VALID_EPOCH   1704067200
+
+typedef struct {
+  bool valid;               // Lezárt, letölthető napló
+  uint32_t logSeq;
+  uint32_t startEpoch;
+  uint32_t totalBytes;
+} SlotInfo_t;
+
+static const esp_partition_t *partition = NULL;
+static const uint8_t *mapped = NULL;
+static spi_flash_mmap_handle_t mapHandle;
+static uint32_t slotCount = 0;
+static SlotInfo_t slots[MAX_SLOTS];
+static uint8_t pins[MAX_SLOTS];    // Kiszolgálás alatt álló helyek: nem íródnak felül
+static uint32_t nextSeq = 1;
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Az író task parancsai; a hívók csak sorba állítanak
+typedef enum { RIDE_LOG_CMD_BEGIN, RIDE_LOG_CMD_PULSE, RIDE_LOG_CMD_END } RideLogCmdType_t;
+
+typedef struct {
+  uint8_t type;
+  int64_t pulseUs;
+} RideLogCmd_t;
+
+static StaticQueue_t cmdQueueBuffer;
+static uint8_t cmdQueueStorage[RIDE_LOG_QUEUE_LEN * sizeof(RideLogCmd_t)];
+static QueueHandle_t cmdQueue = NULL;
+static StaticSemaphore_t endDoneBuffer;
+static SemaphoreHandle_t endDone = NULL;     // Az író task lezárta a naplót
+static esp_err_t endResult = ESP_OK;
+static std::atomic<bool> requested(false);   // Fut-e napló (sikertelen indításnál az író task törli)
+static std::atomic<uint32_t> droppedPulses(0); // Megtelt sor miatt kimaradt impulzusok
+
+// Az éppen írt napló (csak az író task használja)
+static bool active = false;
+static bool full = false;
+static uint32_t activeSlot = 0;
+static uint32_t writeOffset = 0;   // A helyen belül már kiírt bájtok
+static uint32_t erasedUpTo = 0;    // A helyen belül eddig törölt tartomány vége
+static PulseEncoder_t encoder;     // A kész blokkok kerülnek a flash-re
+static uint32_t encodeCycles = 0;  // ride_log_pulse CPU ciklusai a menetben
+static uint32_t flushCycles = 0;   // Ebből a blokkok flash írása
+
+static const RideLogHeader_t *slot_header(uint32_t slot) {
+  return (const RideLogHeader_t *)(mapped + slot * RIDE_LOG_SLOT_SIZE);
+}
+
+// Megszakadt (lezáratlan) napló hossza: az utolsó ép blokkig (1-es
+// verziónál az első törölt szóig) tart
+static uint32_t recover_data_bytes(uint32_t slot) {
+  const RideLogHeader_t *h = slot_header(slot);
+  const uint8_t *data = mapped + slot * RIDE_LOG_SLOT_SIZE + h->headerSize;
+  uint32_t maxBytes = RIDE_LOG_SLOT_SIZE - h->headerSize;
+  uint32_t n = 0;
+  if (h->version == RIDE_LOG_VERSION_RAW32) {
+    const uint32_t *words = (const uint32_t *)data;
+    while (n < maxBytes / sizeof(uint32_t) && words[n] != 0xFFFFFFFF) n++;
+    return n * sizeof(uint32_t);
+  }
+  size_t len;
+  while ((len = pulse_block_length(data + n, maxBytes - n)) > 0) n += len;
+  return n;
+}
+
+static void ride_log_task(void *pvParameters);
+
+esp_err_t ride_log_init(void) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                       RIDE_LOG_PARTITION_LABEL);
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "Ride log partition '%s' not found.", RIDE_LOG_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+  slotCount = partition->size / RIDE_LOG_SLOT_SIZE;
+  if (slotCount > MAX_SLOTS) slotCount = MAX_SLOTS;
+  if (slotCount == 0) return ESP_ERR_INVALID_SIZE;
+
+  const void *ptr = NULL;
+  esp_err_t err = esp_partition_mmap(partition, 0, slotCount * RIDE_LOG_SLOT_SIZE,
+                                     ESP_PARTITION_MMAP_DATA, &ptr, &mapHandle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Ride log mmap failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  mapped = (const uint8_t *)ptr;
+
+  uint32_t stored = 0;
+  for (uint32_t i = 0; i < slotCount; i++) {
+    const RideLogHeader_t *h = slot_header(i);
+    slots[i].valid = false;
+    if (h->magic != RIDE_LOG_MAGIC || h->headerSize < sizeof(RideLogHeader_t) ||
+        h->headerSize >= RIDE_LOG_SLOT_SIZE) {
+      continue;
+    }
+    uint32_t dataBytes = h->dataBytes;
+    if (dataBytes == RIDE_LOG_OPEN) {
+      // Mélyalvás/újraindulás lezárás nélkül: a hossz utólag rögzíthető
+      dataBytes = recover_data_bytes(i);
+      esp_partition_write(partition, i * RIDE_LOG_SLOT_SIZE + offsetof(RideLogHeader_t, dataBytes),
+                          &dataBytes, sizeof(dataBytes));
+      ESP_LOGW(TAG, "Ride log #%lu was not closed, recovered %lu bytes.",
+               (unsigned long)h->logSeq, (unsigned long)dataBytes);
+    }
+    if (dataBytes > RIDE_LOG_SLOT_SIZE - h->headerSize) continue;
+    slots[i].valid = true;
+    slots[i].logSeq = h->logSeq;
+    slots[i].startEpoch = h->startEpoch;
+    slots[i].totalBytes = h->headerSize + dataBytes;
+    if (h->logSeq >= nextSeq) nextSeq = h->logSeq + 1;
+    stored++;
+  }
+  ESP_LOGI(TAG, "Ride log: %lu logs stored in %lu slots of %lu KB.", (unsigned long)stored,
+           (unsigned long)slotCount, (unsigned long)(RIDE_LOG_SLOT_SIZE / 1024));
+
+  cmdQueue = xQueueCreateStatic(RIDE_LOG_QUEUE_LEN, sizeof(RideLogCmd_t), cmdQueueStorage, &cmdQueueBuffer);
+  endDone = xSemaphoreCreateBinaryStatic(&endDoneBuffer);
+  err = task_start(TASK_RIDE_LOG, ride_log_task, NULL);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create ride log task!");
+    cmdQueue = NULL;
+    return err;
+  }
+  return ESP_OK;
+}
+
+// Írás a helyen belüli tartományba; a még nem törölt szektorokat előbb töröljük
+static esp_err_t slot_write(uint32_t offset, const void *data, uint32_t len) {
+  uint32_t base = activeSlot * RIDE_LOG_SLOT_SIZE;
+  while (offset + len > erasedUpTo) {
+    esp_err_t err = esp_partition_erase_range(partition, base + erasedUpTo, SECTOR_SIZE);
+    if (err != ESP_OK) return err;
+    erasedUpTo += SECTOR_SIZE;
+  }
+  return esp_partition_write(partition, base + offset, data, len);
+}
+
+// A kódoló nyelője: egy kész blokk a hely következő szabad részére
+static void write_block(const uint8_t *block, uint16_t length, void *ctx) {
+  if (full) return;
+  if (writeOffset + length > RIDE_LOG_SLOT_SIZE) {
+    full = true;
+    ESP_LOGW(TAG, "Ride log #%lu slot full, further pulses are not logged.",
+             (unsigned long)slots[activeSlot].logSeq);
+    return;
+  }
+  uint32_t start = esp_cpu_get_ccount();
+  if (slot_write(writeOffset, block, length) == ESP_OK) writeOffset += length;
+  flushCycles += esp_cpu_get_ccount() - start;
+}
+
+static esp_err_t writer_end(void);
+
+static esp_err_t writer_begin(int64_t firstPulseUs) {
+  if (active) writer_end();
+
+  // A legfrissebb napló utáni hely (a legrégebbi íródik felül), a letöltés
+  // alatt állókat átugorva; a foglalás a letöltés indításával egy zárban
+  bool found = false;
+  portENTER_CRITICAL(&logMux);
+  uint32_t newest = slotCount - 1;
+  uint32_t newestSeq = 0;
+  for (uint32_t i = 0; i < slotCount; i++) {
+    if (slots[i].valid && slots[i].logSeq >= newestSeq) {
+      newestSeq = slots[i].logSeq;
+      newest = i;
+    }
+  }
+  for (uint32_t k = 1; k <= slotCount && !found; k++) {
+    activeSlot = (newest + k) % slotCount;
+    found = pins[activeSlot] == 0;
+  }
+  if (found) {
+    slots[activeSlot].valid = false; // Felülírás alatt nem tölthető le
+    slots[activeSlot].logSeq = nextSeq;
+  }
+  portEXIT_CRITICAL(&logMux);
+  if (!found) {
+    ESP_LOGW(TAG, "Ride log: every slot is being downloaded, ride not logged.");
+    requested.store(false, std::memory_order_relaxed); // Nincs napló: az impulzusok ne menjenek a sorba
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  RideLogHeader_t h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic = RIDE_LOG_MAGIC;
+  h.version = RIDE_LOG_VERSION_DOD;
+  h.headerSize = sizeof(RideLogHeader_t);
+  h.logSeq = nextSeq++;
+  uint32_t now = (uint32_t)time(NULL);
+  h.startEpoch = now >= MIN_VALID_EPOCH ? now : 0;
+  h.firstPulseUs = firstPulseUs;
+  h.dataBytes = RIDE_LOG_OPEN;
+  // A kerék az exportnál kell (táv, sebesség); profilváltás után is a menetét használjuk
+  const WheelCalib_t calib = wheel_calib();
+  h.wheelMm = (uint16_t)(calib.circumferenceM * 1000.0 + 0.5);
+  h.pulsesPerRev = calib.pulsesPerRev;
+
+  erasedUpTo = 0;
+  esp_err_t err = slot_write(0, &h, sizeof(h));
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Ride log header write failed: %s", esp_err_to_name(err));
+    requested.store(false, std::memory_order_relaxed);
+    return err;
+  }
+  writeOffset = sizeof(h);
+  full = false;
+  pulse_encoder_init(&encoder, write_block, NULL);
+  pulse_encoder_add(&encoder, firstPulseUs);
+  encodeCycles = 0;
+  flushCycles = 0;
+  active = true;
+  ESP_LOGI(TAG, "Ride log #%lu started in slot %lu.", (unsigned long)h.logSeq, (unsigned long)activeSlot);
+  return ESP_OK;
+}
+
+static void writer_pulse(int64_t pulseUs) {
+  if (!active || full) return;
+  uint32_t start = esp_cpu_get_ccount();
+  pulse_encoder_add(&encoder, pulseUs); // Blokkhatáron a flash írás is ide esik
+  encodeCycles += esp_cpu_get_ccount() - start;
+}
+
+static esp_err_t writer_end(void) {
+  if (!active) return ESP_OK;
+  uint32_t start = esp_cpu_get_ccount();
+  pulse_encoder_flush(&encoder);
+  encodeCycles += esp_cpu_get_ccount() - start; // A flushCycles-ben is megjelenik
+  active = false;
+
+  uint32_t dataBytes = writeOffset - sizeof(RideLogHeader_t);
+  esp_err_t err = esp_partition_write(partition,
+                                      activeSlot * RIDE_LOG_SLOT_SIZE + offsetof(RideLogHeader_t, dataBytes),
+                                      &dataBytes, sizeof(dataBytes));
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Ride log close failed: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  const RideLogHeader_t *h = slot_header(activeSlot);
+  portENTER_CRITICAL(&logMux);
+  slots[activeSlot].valid = true;
+  slots[activeSlot].startEpoch = h->startEpoch;
+  slots[activeSlot].totalBytes = writeOffset;
+  portEXIT_CRITICAL(&logMux);
+  // Tömörítés a nyers 64 bites időbélyegekhez képest, kódolási költség impulzusonként
+  uint32_t pulses = encoder.pulses;
+  uint32_t coded = pulses > 1 ? pulses - 1 : 1;
+  ESP_LOGI(TAG, "Ride log #%lu closed: %lu pulses in %lu blocks, %lu bytes (%.2f B/pulse, %.1fx vs raw64), encode %lu cycles/pulse, flash write %lu cycles/pulse, %lu dropped (queue full).",
+           (unsigned long)h->logSeq, (unsigned long)pulses, (unsigned long)encoder.blocks,
+           (unsigned long)writeOffset, pulses ? (double)dataBytes / pulses : 0.0,
+           dataBytes ? 8.0 * pulses / dataBytes : 0.0,
+           (unsigned long)((encodeCycles - flushCycles) / coded), (unsigned long)(flushCycles / coded),
+           (unsigned long)droppedPulses.exchange(0, std::memory_order_relaxed));
+  return ESP_OK;
+}
+
+// Író task: a kódolás, a szektortörlés és a flash írás itt fut, alacsony
+// prioritáson, így egy több tíz ms-os törlés sem tartja fel a számoló taskot
+static void ride_log_task(void *pvParameters) {
+  RideLogCmd_t cmd;
+  for (;;) {
+    if (xQueueReceive(cmdQueue, &cmd, portMAX_DELAY) != pdTRUE) continue;
+    switch (cmd.type) {
+      case RIDE_LOG_CMD_BEGIN:
+        writer_begin(cmd.pulseUs);
+        break;
+      case RIDE_LOG_CMD_PULSE:
+        writer_pulse(cmd.pulseUs);
+        break;
+      case RIDE_LOG_CMD_END:
+        endResult = writer_end();
+        xSemaphoreGive(endDone);
+        break;
+    }
+  }
+}
+
+esp_err_t ride_log_begin(int64_t firstPulseUs) {
+  if (cmdQueue == NULL) return ESP_ERR_INVALID_STATE;
+  RideLogCmd_t cmd = {RIDE_LOG_CMD_BEGIN, firstPulseUs};
+  if (xQueueSend(cmdQueue, &cmd, 0) != pdTRUE) return ESP_ERR_TIMEOUT;
+  requested.store(true, std::memory_order_relaxed);
+  return ESP_OK;
+}
+
+bool ride_log_active(void) { return requested.load(std::memory_order_relaxed); }
+
+void ride_log_pulse(int64_t pulseUs) {
+  if (!requested.load(std::memory_order_relaxed)) return;
+  RideLogCmd_t cmd = {RIDE_LOG_CMD_PULSE, pulseUs};
+  if (xQueueSend(cmdQueue, &cmd, 0) != pdTRUE) droppedPulses.fetch_add(1, std::memory_order_relaxed);
+}
+
+esp_err_t ride_log_end(void) {
+  if (cmdQueue == NULL) return ESP_OK;
+  requested.store(false, std::memory_order_relaxed);
+  // Egy korábbi, időtúllépéssel feladott lezárás késői jelzése ne ezt nyugtázza
+  xSemaphoreTake(endDone, 0);
+  // A lezárás a sorban a már beküldött impulzusok után fut; megvárjuk
+  RideLogCmd_t cmd = {RIDE_LOG_CMD_END, 0};
+  TickType_t wait = pdMS_TO_TICKS(RIDE_LOG_END_TIMEOUT_MS);
+  if (xQueueSend(cmdQueue, &cmd, wait) != pdTRUE || xSemaphoreTake(endDone, wait) != pdTRUE) {
+    ESP_LOGW(TAG, "Ride log close timed out.");
+    return ESP_ERR_TIMEOUT;
+  }
+  return endResult;
+}
+
+uint32_t ride_log_count(void) {
+  uint32_t n = 0;
+  portENTER_CRITICAL(&logMux);
+  for (uint32_t i = 0; i < slotCount; i++) {
+    if (slots[i].valid) n++;
+  }
+  portEXIT_CRITICAL(&logMux);
+  return n;
+}
+
+// Az n. legfrissebb lezárt napló helye, -1: nincs. logMux alatt hívandó.
+static int32_t find_nth(uint32_t n) {
+  // Kevés hely van: az n. legfrissebbet egyszerű kiválasztással keressük
+  uint32_t upperSeq = UINT32_MAX;
+  for (uint32_t k = 0; k <= n; k++) {
+    int32_t best = -1;
+    for (uint32_t i = 0; i < slotCount; i++) {
+      if (slots[i].valid && slots[i].logSeq < upperSeq &&
+          (best < 0 || slots[i].logSeq > slots[best].logSeq)) {
+        best = i;
+      }
+    }
+    if (best < 0 || k == n) return best;
+    upperSeq = slots[best].logSeq;
+  }
+  return -1;
+}
+
+static bool lookup(uint32_t n, RideLogInfo_t *out, bool pin) {
+  portENTER_CRITICAL(&logMux);
+  int32_t slot = find_nth(n);
+  if (slot >= 0) {
+    out->logSeq = slots[slot].logSeq;
+    out->startEpoch = slots[slot].startEpoch;
+    out->totalBytes = slots[slot].totalBytes;
+    out->data = mapped + slot * RIDE_LOG_SLOT_SIZE;
+    if (pin) pins[slot]++;
+  }
+  portEXIT_CRITICAL(&logMux);
+  return slot >= 0;
+}
+
+bool ride_log_info(uint32_t n, RideLogInfo_t *out) { return lookup(n, out, false); }
+
+bool ride_log_pin(uint32_t n, RideLogInfo_t *out) { return lookup(n, out, true); }
+
+void ride_log_unpin(const RideLogInfo_t *info) {
+  uint32_t slot = (uint32_t)(info->data - mapped) / RIDE_LOG_SLOT_SIZE;
+  portENTER_CRITICAL(&logMux);
+  if (slot < slotCount && pins[slot] > 0) pins[slot]--;
+  portEXIT_CRITICAL(&logMux);
+}
@@ -0,0 +1,50 @@
+// ridelog.h
+// Nyers impulzusnapló menetenként a "ridelog" flash partíción. A partíció
+// RIDE_LOG_SLOT_SIZE méretű helyekre oszlik, menetenként egy hely (gyűrűben
+// a legrégebbi íródik felül). Minden hely egy fejléccel kezdődik, utána az
+// impulzusidők pulsecodec blokkokban (a régebbi, 1-es verziójú naplókban
+// nyers uint32 intervallumok). Az írás kész blokkonként, szektoronként lusta
+// törléssel történik, egy alacsony prioritású író taskban: a hívók csak
+// sorba állítják az impulzusokat, így a szektortörlés nem késlelteti a
+// számoló taskot. Az olvasás a leképezett flash-ről, másolás nélkül; a
+// kiszolgálás alatt rögzített (pin) hely nem íródik felül.
+#ifndef RIDELOG_H
+#define RIDELOG_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "ridelogformat.h"
+
+#define RIDE_LOG_PARTITION_LABEL "ridelog"
+
+typedef struct {
+  uint32_t logSeq;
+  uint32_t startEpoch;
+  uint32_t totalBytes;     // Fejléc + adat, ennyi tölthető le
+  const uint8_t *data;     // A napló eleje a leképezett flash-ben
+} RideLogInfo_t;
+
+esp_err_t ride_log_init(void);
+
+// Napló indítása az első impulzus idejével; az író task a következő szabad
+// helyet foglalja el. Nem vár a flash-re.
+esp_err_t ride_log_begin(int64_t firstPulseUs);
+bool ride_log_active(void);
+// Impulzus hozzáfűzése (a számoló taskból), nem vár: megtelt sornál vagy
+// helynél eldobja (a sor miatt eldobottak a lezáráskor a naplóba kerülnek)
+void ride_log_pulse(int64_t pulseUs);
+// Puffer kiírása és a hossz rögzítése a fejlécben. Bármelyik taskból hívható:
+// a sorba állított impulzusok után zár, és megvárja az író taskot
+// (legfeljebb RIDE_LOG_END_TIMEOUT_MS).
+esp_err_t ride_log_end(void);
+
+// Lezárt naplók: n = 0 a legutóbbi
+uint32_t ride_log_count(void);
+bool ride_log_info(uint32_t n, RideLogInfo_t *out);
+
+// Mint ride_log_info, de a hely a ride_log_unpin hívásig nem íródik felül
+// (letöltés a leképezett flash-ből); az új menet a következő helyre kerül
+bool ride_log_pin(uint32_t n, RideLogInfo_t *out);
+void ride_log_unpin(const RideLogInfo_t *info);
+
+#endif
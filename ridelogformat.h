@@ -0,0 +1,29 @@
+// ridelogformat.h
+// A menetnapló helyek flash formátuma (fejléc és adatváltozatok). Külön
+// fejlécben, hogy a hoszt oldali eszközök (tools/) ESP-IDF nélkül is
+// olvashassák a letöltött naplókat.
+#ifndef RIDELOGFORMAT_H
+#define RIDELOGFORMAT_H
+
+#include <stdint.h>
+
+#define RIDE_LOG_MAGIC           0x474F4C52 // "RLOG"
+#define RIDE_LOG_VERSION_RAW32   1          // Adat: uint32 intervallumok
+#define RIDE_LOG_VERSION_DOD     2          // Adat: pulsecodec blokkok (delta-of-delta varint)
+#define RIDE_LOG_SLOT_SIZE       0x10000    // 64 KB menetenként
+#define RIDE_LOG_OPEN            0xFFFFFFFF // Lezáratlan napló dataBytes értéke
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;        // Az adatrész formátuma
+  uint16_t headerSize;
+  uint32_t logSeq;         // Napló sorszáma (monoton)
+  uint32_t startEpoch;     // 0 = az óra nem volt beállítva
+  int64_t firstPulseUs;    // Az első impulzus esp_timer ideje
+  uint32_t dataBytes;      // Lezáráskor kerül beírásra (törölt szóra írható)
+  uint16_t wheelMm;        // A menet kerékkerülete mm-ben (0xFFFF: régebbi napló)
+  uint8_t pulsesPerRev;    // Impulzusok fordulatonként (0xFF: régebbi napló)
+  uint8_t reserved;
+} RideLogHeader_t;
+
+#endif
@@ -0,0 +1,311 @@
+#include "scheduler.h"
+#include <atomic>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "taskplacement.h"
+
+extern const char *TAG;
+
+#define WHEEL_MASK (SCHED_WHEEL_SLOTS - 1)
+static_assert((SCHED_WHEEL_SLOTS & WHEEL_MASK) == 0, "SCHED_WHEEL_SLOTS must be a power of two");
+
+// A beolvasztott taskok korábbi statikus stackjei (NVS mentés, inaktivitás,
+// nullázó gomb, soros riport) és a két FreeRTOS timer
+#define SCHED_RETIRED_STACK_BYTES (4096 + 2048 + 2048 + 3072)
+#define SCHED_RETIRED_TIMERS 2
+
+typedef struct {
+  const char *name;
+  SchedHandler_t fn;
+  void *arg;
+  uint32_t intervalTicks;  // Kerék tickben
+  bool periodic;
+  bool armed;              // A kerékben van
+  bool pending;            // Lejárt, futásra vár az aktuális körben
+  uint32_t expires;        // Abszolút kerék tick
+  SchedJob_t next;         // Következő munka ugyanabban a résben
+} SchedJobEntry_t;
+
+typedef enum {
+  SCHED_MSG_CALL,
+  SCHED_MSG_ARM,
+  SCHED_MSG_CANCEL,
+} SchedMsgType_t;
+
+typedef struct {
+  uint8_t type;
+  SchedJob_t job;
+  SchedHandler_t fn;
+  void *arg;
+} SchedMsg_t;
+
+static SchedJobEntry_t jobs[SCHED_MAX_JOBS];
+static uint8_t jobCount = 0;
+static portMUX_TYPE jobsMux = portMUX_INITIALIZER_UNLOCKED;
+static SchedJob_t wheel[SCHED_WHEEL_SLOTS]; // Résenként egyszeresen láncolt lista
+static uint32_t cursor = 0;                 // Az utolsó feldolgozott kerék tick
+
+static StaticQueue_t queueBuffer;
+static uint8_t queueStorage[SCHED_QUEUE_LEN * sizeof(SchedMsg_t)];
+static QueueHandle_t queue = NULL;
+static TaskHandle_t schedTask = NULL;
+
+// Statisztika (az ütemező taskban írva és olvasva, kivéve a sikertelen küldést)
+static uint32_t wakeups = 0, timerRuns = 0, eventRuns = 0;
+static UBaseType_t maxQueued = 0;
+static int64_t statsSinceUs = 0;
+static std::atomic<uint32_t> postsLost(0);
+
+static uint32_t wheel_now(void) {
+  return (uint32_t)(esp_timer_get_time() / (SCHED_TICK_MS * 1000));
+}
+
+// --- Időzítő kerék (csak az ütemező taskból) ---
+
+static void wheel_insert(SchedJob_t id, uint32_t expires) {
+  SchedJobEntry_t *j = &jobs[id];
+  SchedJob_t *head = &wheel[expires & WHEEL_MASK];
+  j->expires = expires;
+  j->next = *head;
+  *head = id;
+  j->armed = true;
+}
+
+static void wheel_remove(SchedJob_t id) {
+  SchedJobEntry_t *j = &jobs[id];
+  j->pending = false;
+  if (!j->armed) return;
+  for (SchedJob_t *link = &wheel[j->expires & WHEEL_MASK]; *link != SCHED_NO_JOB; link = &jobs[*link].next) {
+    if (*link == id) {
+      *link = j->next;
+      break;
+    }
+  }
+  j->armed = false;
+}
+
+static void job_arm(SchedJob_t id) {
+  wheel_remove(id);
+  wheel_insert(id, wheel_now() + jobs[id].intervalTicks);
+}
+
+// A cursor és now közti rések lejárt munkái. Egy körnél hosszabb kimaradásnál
+// is elég minden rést egyszer bejárni.
+static void wheel_advance(uint32_t now) {
+  SchedJob_t due[SCHED_MAX_JOBS];
+  uint8_t dueCount = 0;
+  uint32_t steps = now - cursor;
+  if (steps > SCHED_WHEEL_SLOTS) steps = SCHED_WHEEL_SLOTS;
+
+  for (uint32_t i = 1; i <= steps; i++) {
+    SchedJob_t *link = &wheel[(cursor + i) & WHEEL_MASK];
+    while (*link != SCHED_NO_JOB) {
+      SchedJobEntry_t *j = &jobs[*link];
+      if ((int32_t)(j->expires - now) <= 0) {
+        due[dueCount++] = *link;
+        *link = j->next;
+        j->armed = false;
+        j->pending = true;
+      } else {
+        link = &j->next;
+      }
+    }
+  }
+  cursor = now;
+
+  // Újraélesítés a futás előtt, hogy a munka leállíthassa vagy átütemezhesse magát
+  for (uint8_t k = 0; k < dueCount; k++) {
+    SchedJobEntry_t *j = &jobs[due[k]];
+    if (!j->periodic) continue;
+    uint32_t next = j->expires + j->intervalTicks; // Csúszásmentes periódus
+    if ((int32_t)(next - now) <= 0) next = now + j->intervalTicks;
+    wheel_insert(due[k], next);
+  }
+  for (uint8_t k = 0; k < dueCount; k++) {
+    SchedJobEntry_t *j = &jobs[due[k]];
+    if (!j->pending) continue; // Egy korábbi munka közben leállította
+    j->pending = false;
+    j->fn(j->arg);
+    timerRuns++;
+  }
+}
+
+// Várakozás a legközelebbi lejáratig. Az első olyan résnél megállhatunk,
+// amelynek d távolsága nem kisebb az eddig talált legkorábbi lejáratnál.
+static TickType_t wheel_wait(void) {
+  uint32_t best = UINT32_MAX;
+  for (uint32_t d = 1; d <= SCHED_WHEEL_SLOTS && best >= d; d++) {
+    for (SchedJob_t id = wheel[(cursor + d) & WHEEL_MASK]; id != SCHED_NO_JOB; id = jobs[id].next) {
+      uint32_t left = jobs[id].expires - cursor;
+      if (left < best) best = left;
+    }
+  }
+  if (best == UINT32_MAX) return portMAX_DELAY;
+  int64_t waitUs = (int64_t)(cursor + best) * SCHED_TICK_MS * 1000 - esp_timer_get_time();
+  if (waitUs <= 0) return 0;
+  return pdMS_TO_TICKS((waitUs + 999) / 1000) + 1; // A kerék tick határa után ébredjen
+}
+
+static void handle_msg(const SchedMsg_t *msg) {
+  switch (msg->type) {
+    case SCHED_MSG_CALL:
+      msg->fn(msg->arg);
+      eventRuns++;
+      break;
+    case SCHED_MSG_ARM:
+      job_arm(msg->job);
+      break;
+    case SCHED_MSG_CANCEL:
+      wheel_remove(msg->job);
+      break;
+  }
+}
+
+static void sched_task(void *pvParameters) {
+  schedTask = xTaskGetCurrentTaskHandle();
+  cursor = wheel_now();
+  statsSinceUs = esp_timer_get_time();
+  SchedMsg_t msg;
+  while (true) {
+    bool got = xQueueReceive(queue, &msg, wheel_wait()) == pdTRUE;
+    wakeups++;
+    if (got) {
+      UBaseType_t queued = uxQueueMessagesWaiting(queue) + 1;
+      if (queued > maxQueued) maxQueued = queued;
+      do {
+        handle_msg(&msg);
+      } while (xQueueReceive(queue, &msg, 0) == pdTRUE);
+    }
+    wheel_advance(wheel_now());
+  }
+}
+
+// --- API ---
+
+static bool in_sched_task(void) {
+  return schedTask != NULL && xTaskGetCurrentTaskHandle() == schedTask;
+}
+
+static bool job_valid(SchedJob_t job) {
+  return job >= 0 && job < jobCount;
+}
+
+static bool send(const SchedMsg_t *msg) {
+  if (queue == NULL) return false;
+  if (in_sched_task()) {
+    handle_msg(msg); // A kerék a saját taskunkban közvetlenül módosítható
+    return true;
+  }
+  if (xQueueSend(queue, msg, 0) != pdTRUE) {
+    postsLost.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+static bool IRAM_ATTR send_from_isr(const SchedMsg_t *msg, BaseType_t *hptw) {
+  if (queue == NULL) return false;
+  if (xQueueSendFromISR(queue, msg, hptw) != pdTRUE) {
+    postsLost.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+esp_err_t sched_init(void) {
+  if (queue != NULL) return ESP_ERR_INVALID_STATE;
+  for (uint32_t i = 0; i < SCHED_WHEEL_SLOTS; i++) wheel[i] = SCHED_NO_JOB;
+  queue = xQueueCreateStatic(SCHED_QUEUE_LEN, sizeof(SchedMsg_t), queueStorage, &queueBuffer);
+  if (queue == NULL) return ESP_FAIL;
+  esp_err_t err = task_start(TASK_SCHEDULER, sched_task, NULL);
+  if (err != ESP_OK) return err;
+
+  int32_t used = (int32_t)task_stack_bytes(TASK_SCHEDULER) + (int32_t)(sizeof(jobs) + sizeof(wheel) + sizeof(queueStorage));
+  int32_t freed = SCHED_RETIRED_STACK_BYTES + SCHED_RETIRED_TIMERS * (int32_t)sizeof(StaticTimer_t) + SCHED_LOOP_STACK_BYTES;
+  ESP_LOGI(TAG, "Scheduler: %d-slot wheel x %d ms, %d jobs max. RAM: %ld B retired (%d B task stacks, %d B loop task, %d timers), %ld B used, %ld B saved.",
+           SCHED_WHEEL_SLOTS, SCHED_TICK_MS, SCHED_MAX_JOBS, (long)freed, SCHED_RETIRED_STACK_BYTES,
+           SCHED_LOOP_STACK_BYTES, SCHED_RETIRED_TIMERS, (long)used, (long)(freed - used));
+  return ESP_OK;
+}
+
+SchedJob_t sched_add(const char *name, uint32_t intervalMs, bool periodic, SchedHandler_t fn, void *arg) {
+  SchedJob_t id = SCHED_NO_JOB;
+  portENTER_CRITICAL(&jobsMux);
+  if (jobCount < SCHED_MAX_JOBS) {
+    id = (SchedJob_t)jobCount;
+    SchedJobEntry_t *j = &jobs[id];
+    j->name = name;
+    j->fn = fn;
+    j->arg = arg;
+    j->intervalTicks = (intervalMs + SCHED_TICK_MS - 1) / SCHED_TICK_MS;
+    if (j->intervalTicks == 0) j->intervalTicks = 1;
+    j->periodic = periodic;
+    j->armed = false;
+    j->pending = false;
+    j->next = SCHED_NO_JOB;
+    jobCount++;
+  }
+  portEXIT_CRITICAL(&jobsMux);
+  if (id == SCHED_NO_JOB) ESP_LOGE(TAG, "Scheduler: no room for job '%s' (SCHED_MAX_JOBS %d)", name, SCHED_MAX_JOBS);
+  return id;
+}
+
+SchedJob_t sched_every(const char *name, uint32_t periodMs, SchedHandler_t fn, void *arg) {
+  SchedJob_t id = sched_add(name, periodMs, true, fn, arg);
+  if (id != SCHED_NO_JOB) sched_arm(id);
+  return id;
+}
+
+SchedJob_t sched_after(const char *name, uint32_t delayMs, SchedHandler_t fn, void *arg) {
+  SchedJob_t id = sched_add(name, delayMs, false, fn, arg);
+  if (id != SCHED_NO_JOB) sched_arm(id);
+  return id;
+}
+
+bool sched_arm(SchedJob_t job) {
+  if (!job_valid(job)) return false;
+  SchedMsg_t msg = {SCHED_MSG_ARM, job, NULL, NULL};
+  return send(&msg);
+}
+
+bool IRAM_ATTR sched_arm_from_isr(SchedJob_t job, BaseType_t *hptw) {
+  if (!job_valid(job)) return false;
+  SchedMsg_t msg = {SCHED_MSG_ARM, job, NULL, NULL};
+  return send_from_isr(&msg, hptw);
+}
+
+bool sched_cancel(SchedJob_t job) {
+  if (!job_valid(job)) return false;
+  SchedMsg_t msg = {SCHED_MSG_CANCEL, job, NULL, NULL};
+  return send(&msg);
+}
+
+bool sched_post(SchedHandler_t fn, void *arg) {
+  if (fn == NULL) return false;
+  SchedMsg_t msg = {SCHED_MSG_CALL, SCHED_NO_JOB, fn, arg};
+  return send(&msg);
+}
+
+bool IRAM_ATTR sched_post_from_isr(SchedHandler_t fn, void *arg, BaseType_t *hptw) {
+  if (fn == NULL) return false;
+  SchedMsg_t msg = {SCHED_MSG_CALL, SCHED_NO_JOB, fn, arg};
+  return send_from_isr(&msg, hptw);
+}
+
+void sched_report(void) {
+  if (schedTask == NULL) return;
+  int64_t now = esp_timer_get_time();
+  double secs = (now - statsSinceUs) / 1e6;
+  ESP_LOGI(TAG, "Scheduler: %u jobs, %lu wakeups (%.2f/s), %lu timer runs, %lu events, max queued %u/%d, %lu posts lost, stack free %u B",
+           (unsigned)jobCount, (unsigned long)wakeups, secs > 0 ? wakeups / secs : 0.0,
+           (unsigned long)timerRuns, (unsigned long)eventRuns, (unsigned)maxQueued, SCHED_QUEUE_LEN,
+           (unsigned long)postsLost.load(std::memory_order_relaxed),
+           (unsigned)uxTaskGetStackHighWaterMark(schedTask));
+  wakeups = timerRuns = eventRuns = 0;
+  maxQueued = 0;
+  statsSinceUs = now;
+}
@@ -0,0 +1,56 @@
+// scheduler.h
+// Egyetlen task az időszakos és eseményvezérelt apró munkákra (NVS mentés,
+// inaktivitás figyelés, soros riport, gombok, kijelző automatikus váltás,
+// WiFi lekapcsolás). Korábban mindegyik saját stackkel (vagy FreeRTOS
+// timerrel) ébredt; itt egy időzítő kerék (SCHED_WHEEL_SLOTS rés,
+// SCHED_TICK_MS felbontás) és egy eseménysor osztozik egy stacken. A task a
+// legközelebbi lejáratig alszik, nincs üres ébredés.
+// A munkák rövid, nem blokkoló függvények (a mutex várakozás rövid
+// időkorláttal belefér); egymás után, ugyanazon a stacken futnak.
+// Bármely taskból és ISR-ből hívható: a kerék módosítása üzenetként megy az
+// ütemező taskhoz, így a kerék csak egy taskból változik.
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "config.h"
+
+typedef void (*SchedHandler_t)(void *arg);
+typedef int8_t SchedJob_t;
+#define SCHED_NO_JOB ((SchedJob_t)-1)
+
+// Az Arduino loop task stackje (a loop() törli a saját taskját)
+#ifdef CONFIG_ARDUINO_LOOP_STACK_SIZE
+#define SCHED_LOOP_STACK_BYTES CONFIG_ARDUINO_LOOP_STACK_SIZE
+#else
+#define SCHED_LOOP_STACK_BYTES 8192
+#endif
+
+// Eseménysor és ütemező task (TASK_SCHEDULER) indítása. Az addig felvett
+// munkák és elküldött események az indulás után futnak.
+esp_err_t sched_init(void);
+
+// Munka felvétele élesítés nélkül; periodic esetén élesítés után
+// intervalMs-enként ismétlődik, különben egyszer fut
+SchedJob_t sched_add(const char *name, uint32_t intervalMs, bool periodic, SchedHandler_t fn, void *arg);
+
+// Felvétel és azonnali élesítés (az első futás intervalMs múlva)
+SchedJob_t sched_every(const char *name, uint32_t periodMs, SchedHandler_t fn, void *arg);
+SchedJob_t sched_after(const char *name, uint32_t delayMs, SchedHandler_t fn, void *arg);
+
+// (Újra)élesítés mostantól számítva, mint az xTimerReset; futó munkánál is
+bool sched_arm(SchedJob_t job);
+bool sched_arm_from_isr(SchedJob_t job, BaseType_t *hptw);
+
+bool sched_cancel(SchedJob_t job);
+
+// Egyszeri hívás az ütemező taskban, a lehető leghamarabb
+bool sched_post(SchedHandler_t fn, void *arg);
+bool sched_post_from_isr(SchedHandler_t fn, void *arg, BaseType_t *hptw);
+
+// Ébredések, futások, sor telítettség, stack tartalék és a megtakarított RAM
+void sched_report(void);
+
+#endif
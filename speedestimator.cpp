@@ -0,0 +1,188 @@
+#include "speedestimator.h"
+#include <math.h>
+#include <string.h>
+
+void speed_estimator_init(SpeedEstimator_t *est, const SpeedEstimatorConfig_t *config,
+                          uint8_t magnets, double circumferenceM) {
+  memset(est, 0, sizeof(*est));
+  est->config = *config;
+  if (magnets < 1) magnets = 1;
+  if (magnets > SPEED_EST_MAX_MAGNETS) magnets = SPEED_EST_MAX_MAGNETS;
+  est->magnets = magnets;
+  est->kmhUsPerRev = circumferenceM * 3.6e6; // m / us -> km/h
+  for (int i = 0; i < magnets; i++) {
+    est->arcFraction[i] = 1.0 / magnets; // Kezdetben egyenletes elhelyezést feltételezünk
+  }
+  est->magnetIndex = magnets - 1;        // Az első intervallum a 0. mágnesé lesz
+}
+
+void speed_estimator_reset_history(SpeedEstimator_t *est) {
+  est->validIntervals = 0;
+  memset(est->intervalUs, 0, sizeof(est->intervalUs));
+  memset(est->prevRevIntervalUs, 0, sizeof(est->prevRevIntervalUs));
+}
+
+// Az utolsó fordulat intervallumarányainak eltérése a megtanult ívektől, ha a
+// j. címkéjű intervallum valójában a (j + shift). mágnesé
+static double phase_error(const SpeedEstimator_t *est, int64_t revUs, int shift) {
+  const int n = est->magnets;
+  double err = 0.0;
+  for (int j = 0; j < n; j++) {
+    err += fabs((double)est->intervalUs[j] / revUs - est->arcFraction[(j + shift + n) % n]);
+  }
+  return err;
+}
+
+static void relabel(int64_t *values, uint8_t n, int shift) {
+  int64_t old[SPEED_EST_MAX_MAGNETS];
+  memcpy(old, values, n * sizeof(int64_t));
+  for (int j = 0; j < n; j++) values[(j + shift + n) % n] = old[j];
+}
+
+// Címkefüggetlen egyenletesség: a két utolsó teljes fordulat hossza közel
+// azonos. revUs: az utolsó fordulat hossza.
+static bool revolution_steady(const SpeedEstimator_t *est, int64_t *revUs) {
+  const uint8_t n = est->magnets;
+  if (est->validIntervals < 2 * n) return false;
+  int64_t rev = 0, prevRev = 0;
+  for (int j = 0; j < n; j++) {
+    rev += est->intervalUs[j];
+    prevRev += est->prevRevIntervalUs[j];
+  }
+  *revUs = rev;
+  return prevRev > 0 && fabs((double)(rev - prevRev)) < est->config.steadyTolerance * prevRev;
+}
+
+// Fáziscsúszás: egy ki nem javított kimaradás vagy fölös impulzus után a
+// szabadon futó index minden ívet a szomszéd mágneshez rendelne. Egyenletes
+// haladásnál, ha egy teljes fordulaton át minden impulzusnál a ±1 eltolás
+// illik egyértelműen jobban a megtanult ívekhez, az index és az előzmény
+// átcímkéződik. true: csúszás gyanú, ilyenkor nincs ívtanulás.
+static bool check_phase(SpeedEstimator_t *est) {
+  const uint8_t n = est->magnets;
+  int64_t revUs = 0;
+  if (n < 2 || !revolution_steady(est, &revUs)) {
+    est->slipVotes = 0;
+    return false;
+  }
+
+  double aligned = phase_error(est, revUs, 0);
+  int best = 0;
+  double bestErr = aligned;
+  for (int shift = 1; shift >= -1; shift -= 2) {
+    if (shift == -1 && n == 2) break; // Két mágnesnél a két irány ugyanaz
+    double e = phase_error(est, revUs, shift);
+    if (e < bestErr) {
+      bestErr = e;
+      best = shift;
+    }
+  }
+  if (best == 0 || aligned - bestErr < est->config.slipMargin || bestErr > 0.5 * aligned) {
+    est->slipVotes = 0;
+    return false;
+  }
+  if (best != est->slipShift) {
+    est->slipShift = (int8_t)best;
+    est->slipVotes = 0;
+  }
+  if (++est->slipVotes < n) return true;
+
+  relabel(est->intervalUs, n, best);
+  relabel(est->prevRevIntervalUs, n, best);
+  est->magnetIndex = (uint8_t)((est->magnetIndex + best + n) % n);
+  est->slipVotes = 0;
+  est->phaseResyncs++;
+  return false;
+}
+
+// Ívarányok tanulása az utolsó teljes fordulatból
+static void learn_arcs(SpeedEstimator_t *est) {
+  int64_t revUs = 0;
+  for (int i = 0; i < est->magnets; i++) revUs += est->intervalUs[i];
+  if (revUs <= 0) return;
+
+  double sum = 0.0;
+  for (int i = 0; i < est->magnets; i++) {
+    double target = (double)est->intervalUs[i] / revUs;
+    est->arcFraction[i] += est->config.learnAlpha * (target - est->arcFraction[i]);
+    sum += est->arcFraction[i];
+  }
+  for (int i = 0; i < est->magnets; i++) est->arcFraction[i] /= sum;
+  est->learnUpdates++;
+}
+
+double speed_estimator_pulse(SpeedEstimator_t *est, int64_t pulseUs) {
+  if (est->lastPulseUs == 0) {
+    est->lastPulseUs = pulseUs;
+    return est->speedKmh;
+  }
+
+  int64_t dt = pulseUs - est->lastPulseUs;
+  if (dt <= 0) return est->speedKmh;
+  est->lastPulseUs = pulseUs;
+
+  const uint8_t n = est->magnets;
+  uint8_t idx = (est->magnetIndex + 1) % n;
+  est->magnetIndex = idx;
+
+  // Megállás utáni első intervallum: csak önmagában használjuk
+  if (dt > est->config.stopIntervalUs) speed_estimator_reset_history(est);
+
+  est->prevRevIntervalUs[idx] = (est->validIntervals >= n) ? est->intervalUs[idx] : 0;
+  est->intervalUs[idx] = dt;
+  if (est->validIntervals < UINT8_MAX) est->validIntervals++;
+
+  bool slipSuspected = check_phase(est);
+  idx = est->magnetIndex; // Újraszinkronizálás után az átcímkézett index
+
+  // Tanulás csak egyenletes haladásnál, hogy a gyorsulás ne torzítsa az ívarányokat.
+  // A mágnesenkénti összevetés egy csúszás után a hibás címkékkel is egyenletes
+  // lehet, ezért a két utolsó teljes fordulatnak is egyeznie kell.
+  int64_t revUs;
+  if (n > 1 && !slipSuspected && revolution_steady(est, &revUs)) {
+    double rel = fabs((double)(dt - est->prevRevIntervalUs[idx])) / est->prevRevIntervalUs[idx];
+    if (rel < est->config.steadyTolerance) learn_arcs(est);
+  }
+
+  // Kombinálás visszafelé, amíg az intervallumok sebessége konzisztens a legutóbbival
+  const double k = est->kmhUsPerRev;
+  double latest = est->arcFraction[idx] * k / dt;
+  double arcSum = est->arcFraction[idx];
+  int64_t dtSum = dt;
+  uint8_t window = 1;
+  uint8_t maxWindow = est->validIntervals < n ? est->validIntervals : n;
+  for (uint8_t back = 1; back < maxWindow; back++) {
+    uint8_t j = (idx + n - back) % n;
+    double v = est->arcFraction[j] * k / est->intervalUs[j];
+    if (fabs(v - latest) > est->config.combineTolerance * latest) break;
+    arcSum += est->arcFraction[j];
+    dtSum += est->intervalUs[j];
+    window++;
+  }
+
+  est->lastWindow = window;
+  est->speedKmh = arcSum * k / dtSum;
+  return est->speedKmh;
+}
+
+double speed_estimator_bound(const SpeedEstimator_t *est, int64_t nowUs) {
+  if (est->lastPulseUs == 0) return est->speedKmh;
+  int64_t elapsed = nowUs - est->lastPulseUs;
+  if (elapsed <= 0) return est->speedKmh;
+
+  uint8_t next = (est->magnetIndex + 1) % est->magnets;
+  double bound = est->arcFraction[next] * est->kmhUsPerRev / elapsed;
+  return bound < est->speedKmh ? bound : est->speedKmh;
+}
+
+SpeedDecay_t speed_estimator_decay(const SpeedEstimator_t *est, int64_t nowUs, double zeroKmh,
+                                   int64_t timeoutUs, double *speedKmh) {
+  double bounded = speed_estimator_bound(est, nowUs);
+  if (bounded >= zeroKmh && nowUs - est->lastPulseUs < timeoutUs) {
+    if (bounded >= *speedKmh) return SPEED_DECAY_HOLD;
+    *speedKmh = bounded;
+    return SPEED_DECAY_LOWER;
+  }
+  *speedKmh = 0.0;
+  return SPEED_DECAY_ZERO;
+}
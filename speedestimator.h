@@ -0,0 +1,70 @@
+// speedestimator.h
+// Több mágneses, fáziskompenzált sebességbecslés. Fordulatonként N impulzus
+// esetén minden mágneshez megtanulja a megelőző ív tényleges arányát a teljes
+// kerületből, így a mágnesek egyenetlen elhelyezése nem okoz sebesség-
+// hullámzást. A becslés minden impulzusnál frissül, és az utolsó legfeljebb N
+// intervallumot kombinálja, amíg azok egymással konzisztensek (gyorsításkor
+// az ablak magától egyetlen intervallumra szűkül, így nincs plusz késés).
+// A mágnes index szabadon fut; egy kimaradt vagy fölös impulzus utáni
+// fáziscsúszást a megtanult ívek mintázatából ismeri fel és újraszinkronizál.
+// Hardverfüggetlen, hoszton is fordítható.
+#ifndef SPEEDESTIMATOR_H
+#define SPEEDESTIMATOR_H
+
+#include <stdint.h>
+
+#define SPEED_EST_MAX_MAGNETS 8
+
+typedef struct {
+  double learnAlpha;        // Ívarány tanulási sebessége (0..1)
+  double steadyTolerance;   // Tanulás csak ennél kisebb relatív periódusváltozásnál
+  double combineTolerance;  // Az ablakba csak ennyire eltérő intervallum-sebesség kerül
+  int64_t stopIntervalUs;   // Ennél hosszabb intervallum után az előzmény törlődik
+  double slipMargin;        // Fáziscsúszáshoz ennyivel kisebb ívarány-eltérés kell (összeg)
+} SpeedEstimatorConfig_t;
+
+typedef struct {
+  SpeedEstimatorConfig_t config;
+  uint8_t magnets;                                // N
+  double kmhUsPerRev;                             // km/h = ív * kmhUsPerRev / dt[us]
+  double arcFraction[SPEED_EST_MAX_MAGNETS];      // Az adott mágnesig tartó ív aránya
+  int64_t intervalUs[SPEED_EST_MAX_MAGNETS];      // Utolsó intervallum mágnesenként
+  int64_t prevRevIntervalUs[SPEED_EST_MAX_MAGNETS]; // Egy fordulattal korábbi intervallum
+  uint8_t magnetIndex;                            // Az utolsó impulzus mágnese
+  uint8_t validIntervals;                         // Egymást követő érvényes intervallumok
+  int64_t lastPulseUs;
+  uint32_t learnUpdates;
+  uint8_t lastWindow;                             // Az utolsó becslésben kombinált intervallumok
+  int8_t slipShift;                               // Gyanított fáziscsúszás iránya (+1/-1)
+  uint8_t slipVotes;                              // Egymást követő impulzusok, amelyek ezt jelzik
+  uint32_t phaseResyncs;                          // Újraszinkronizálások száma
+  double speedKmh;
+} SpeedEstimator_t;
+
+void speed_estimator_init(SpeedEstimator_t *est, const SpeedEstimatorConfig_t *config,
+                          uint8_t magnets, double circumferenceM);
+
+// Új impulzus; visszatér a frissített sebességgel (km/h), első impulzusnál 0
+double speed_estimator_pulse(SpeedEstimator_t *est, int64_t pulseUs);
+
+// Az utolsó impulzus óta eltelt idő felső korlátot ad a sebességre: a
+// következő mágnesig tartó ívet legalább ennyi idő alatt tesszük meg.
+// Visszatér min(utolsó becslés, korlát) értékével; a becslőt nem módosítja.
+double speed_estimator_bound(const SpeedEstimator_t *est, int64_t nowUs);
+
+typedef enum {
+  SPEED_DECAY_HOLD,   // A kijelzett sebesség marad
+  SPEED_DECAY_LOWER,  // A korlátra csökken
+  SPEED_DECAY_ZERO,   // zeroKmh alá esett, vagy timeoutUs óta nincs impulzus
+} SpeedDecay_t;
+
+// Impulzus nélküli frissítés a számoló task ütemében: *speedKmh a kijelzett
+// sebesség, LOWER és ZERO esetén felülíródik. A hoszt oldali elemző
+// (tools/ridestats) ugyanezzel a döntéssel játssza vissza a menetet.
+SpeedDecay_t speed_estimator_decay(const SpeedEstimator_t *est, int64_t nowUs, double zeroKmh,
+                                   int64_t timeoutUs, double *speedKmh);
+
+// Előzmény törlése (a megtanult ívarányok megmaradnak)
+void speed_estimator_reset_history(SpeedEstimator_t *est);
+
+#endif
@@ -0,0 +1,154 @@
+#include "taskplacement.h"
+#include <math.h>
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+extern const char *TAG;
+
+typedef struct {
+  const char *name;
+  uint32_t stackBytes;
+  UBaseType_t priority;
+  BaseType_t splitCore; // TASK_AFFINITY_SPLIT módban ezen a magon fut
+} TaskPlacement_t;
+
+// Stackek: ESP32-n a mélység bájtban értendő
+static StackType_t calcStack[4096];
+static StackType_t guiStack[4096];
+static StackType_t schedulerStack[4096];
+static StackType_t reedSimStack[4096];
+static StackType_t logServerStack[4096];
+static StackType_t binlogStack[3072];
+static StackType_t rideLogStack[3072];
+
+static const TaskPlacement_t placements[TASK_ID_COUNT] = {
+    {"calc_ctrl_task",     sizeof(calcStack),       5, TASK_PULSE_CORE},
+    {"TFT task",           sizeof(guiStack),        6, TASK_RADIO_CORE},
+    {"scheduler",          sizeof(schedulerStack),  4, TASK_RADIO_CORE},
+    {"reed_sim_task",      sizeof(reedSimStack),    4, TASK_PULSE_CORE},
+    {"log_server",         sizeof(logServerStack),  LOG_SERVER_TASK_PRIORITY, TASK_RADIO_CORE},
+    {"binlog_drain",       sizeof(binlogStack),     1, TASK_RADIO_CORE},
+    {"ride_log",           sizeof(rideLogStack),    2, TASK_RADIO_CORE},
+};
+
+static StackType_t *const stacks[TASK_ID_COUNT] = {
+    calcStack, guiStack, schedulerStack, reedSimStack, logServerStack, binlogStack, rideLogStack,
+};
+
+static StaticTask_t tcbs[TASK_ID_COUNT];
+static TaskHandle_t handles[TASK_ID_COUNT];
+
+static BaseType_t task_core(TaskId_t id) {
+#if TASK_AFFINITY_MODE == TASK_AFFINITY_SPLIT
+  return placements[id].splitCore;
+#elif TASK_AFFINITY_MODE == TASK_AFFINITY_RADIO_CORE
+  return TASK_RADIO_CORE;
+#else
+  return tskNO_AFFINITY;
+#endif
+}
+
+uint32_t task_stack_bytes(TaskId_t id) {
+  return id < TASK_ID_COUNT ? placements[id].stackBytes : 0;
+}
+
+const char *task_affinity_mode_name(void) {
+#if TASK_AFFINITY_MODE == TASK_AFFINITY_SPLIT
+  return "split";
+#elif TASK_AFFINITY_MODE == TASK_AFFINITY_RADIO_CORE
+  return "radio-core";
+#else
+  return "any";
+#endif
+}
+
+esp_err_t task_start(TaskId_t id, TaskFunction_t fn, void *arg) {
+  if (id >= TASK_ID_COUNT) return ESP_ERR_INVALID_ARG;
+  // A statikus TCB csak a korábbi példány törlése után használható újra
+  if (handles[id] != NULL && eTaskGetState(handles[id]) != eDeleted) return ESP_ERR_INVALID_STATE;
+
+  const TaskPlacement_t *p = &placements[id];
+  BaseType_t core = task_core(id);
+  handles[id] = xTaskCreateStaticPinnedToCore(fn, p->name, p->stackBytes, arg, p->priority,
+                                              stacks[id], &tcbs[id], core);
+  if (handles[id] == NULL) return ESP_FAIL;
+  ESP_LOGI(TAG, "Task '%s' started (prio %u, core %d, %lu B static stack).", p->name,
+           (unsigned)p->priority, core == tskNO_AFFINITY ? -1 : (int)core,
+           (unsigned long)p->stackBytes);
+  return ESP_OK;
+}
+
+// --- Időbélyeg-feldolgozási jitter ---
+typedef struct {
+  uint32_t count;
+  int64_t latSum, latSqSum, latMin, latMax; // Él -> task ébredés (us)
+  uint32_t jitterCount;
+  int64_t jitSqSum, jitMaxAbs;              // Egymást követő késleltetések különbsége
+} JitterStats_t;
+
+static JitterStats_t stats = {};
+static int64_t prevLatencyUs = 0;
+static bool havePrevLatency = false;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+void task_jitter_sample(int64_t edgeUs, int64_t wakeUs) {
+  int64_t lat = wakeUs - edgeUs;
+  if (lat < 0) return;
+  portENTER_CRITICAL(&statsMux);
+  stats.count++;
+  stats.latSum += lat;
+  stats.latSqSum += lat * lat;
+  if (stats.count == 1 || lat < stats.latMin) stats.latMin = lat;
+  if (stats.count == 1 || lat > stats.latMax) stats.latMax = lat;
+  if (havePrevLatency) {
+    int64_t jit = lat - prevLatencyUs;
+    int64_t absJit = jit < 0 ? -jit : jit;
+    stats.jitterCount++;
+    stats.jitSqSum += jit * jit;
+    if (absJit > stats.jitMaxAbs) stats.jitMaxAbs = absJit;
+  }
+  prevLatencyUs = lat;
+  havePrevLatency = true;
+  portEXIT_CRITICAL(&statsMux);
+}
+
+void task_jitter_report(void) {
+  JitterStats_t s;
+  portENTER_CRITICAL(&statsMux);
+  s = stats;
+  stats = JitterStats_t();
+  havePrevLatency = false;
+  portEXIT_CRITICAL(&statsMux);
+
+  if (s.count == 0) return;
+  double mean = (double)s.latSum / s.count;
+  double std = sqrt(fmax(0.0, (double)s.latSqSum / s.count - mean * mean));
+  double jitRms = s.jitterCount ? sqrt((double)s.jitSqSum / s.jitterCount) : 0.0;
+  ESP_LOGI(TAG, "Pulse jitter [%s]: %lu pulses, latency mean %.1f us, std %.1f us, min %lld us, max %lld us; interval jitter rms %.1f us, max |%lld| us",
+           task_affinity_mode_name(), (unsigned long)s.count, mean, std, s.latMin, s.latMax,
+           jitRms, s.jitMaxAbs);
+}
+
+#if TASK_JITTER_REPORT_S > 0
+static esp_timer_handle_t reportTimer = NULL;
+
+static void report_timer_callback(void *arg) {
+  task_jitter_report();
+}
+#endif
+
+void task_jitter_start_report(void) {
+#if TASK_JITTER_REPORT_S > 0
+  const esp_timer_create_args_t timerArgs = {
+      .callback = report_timer_callback,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "jitter_report",
+      .skip_unhandled_events = true,
+  };
+  if (esp_timer_create(&timerArgs, &reportTimer) == ESP_OK) {
+    esp_timer_start_periodic(reportTimer, (uint64_t)TASK_JITTER_REPORT_S * 1000000ULL);
+  }
+#endif
+}
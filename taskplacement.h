@@ -0,0 +1,45 @@
+// taskplacement.h
+// Taskok magokhoz rendelése és statikus létrehozása. A WiFi/lwIP és az
+// esp_timer a PRO_CPU-n (0. mag) fut; TASK_AFFINITY_SPLIT módban az
+// impulzusfeldolgozás az APP_CPU-ra kerül, a kijelző és a flash mentések a
+// rádió mellé. A stackek és TCB-k statikus tömbök, futás közben nincs heap
+// foglalás a taskokhoz.
+#ifndef TASKPLACEMENT_H
+#define TASKPLACEMENT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef enum {
+  TASK_CALC,        // Impulzusfeldolgozás, sebesség, távolság
+  TASK_GUI,         // TFT kirajzolás
+  TASK_SCHEDULER,   // Időzített és gomb munkák (NVS mentés, inaktivitás, riport, gombok)
+  TASK_REED_SIM,    // Szimulált REED impulzusok
+  TASK_LOG_SERVER,  // Naplóletöltés HTTP-n (csak az AP ablak alatt)
+  TASK_BINLOG,      // A bináris napló ürítése a UART-ra
+  TASK_RIDE_LOG,    // Menetnapló flash írás (kódolás, szektortörlés)
+  TASK_ID_COUNT
+} TaskId_t;
+
+// A task létrehozása a saját statikus stackjén, az aktív affinitási mód szerinti magon.
+// Egy azonosító egyszerre csak egyszer futhat.
+esp_err_t task_start(TaskId_t id, TaskFunction_t fn, void *arg);
+
+// A task statikus stackjének mérete bájtban
+uint32_t task_stack_bytes(TaskId_t id);
+
+// Az aktív TASK_AFFINITY_MODE neve a riportokhoz
+const char *task_affinity_mode_name(void);
+
+// Időbélyeg-feldolgozási késleltetés: az él ideje és a számoló task ébredése
+// közti különbség. A szórása a jitter, ami a mágnesintervallumokba kerülne.
+void task_jitter_sample(int64_t edgeUs, int64_t wakeUs);
+
+// Időszakos riport indítása (TASK_JITTER_REPORT_S, 0 = kikapcsolva)
+void task_jitter_start_report(void);
+
+void task_jitter_report(void);
+
+#endif
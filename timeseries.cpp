@@ -0,0 +1,96 @@
+#include "timeseries.h"
+#include <string.h>
+
+#define SECOND_US 1000000LL
+// Hosszú szünet (pl. óraugrás) után legfeljebb ennyi másodpercet pótolunk
+#define MAX_FILL_SECONDS 14400
+
+static const uint8_t factors[TIMESERIES_LEVELS] = TIMESERIES_FACTORS;
+
+static void merge(TimeSeriesPoint_t *acc, uint8_t count, const TimeSeriesPoint_t *p) {
+  if (count == 0) {
+    *acc = *p;
+    return;
+  }
+  if (p->min < acc->min) acc->min = p->min;
+  if (p->max > acc->max) acc->max = p->max;
+  acc->mean += p->mean; // Lezáráskor osztjuk a darabszámmal
+}
+
+static void append(TimeSeries_t *ts, uint8_t level, const TimeSeriesPoint_t *p) {
+  TimeSeriesRing_t *r = &ts->level[level];
+  r->points[r->head] = *p;
+  r->head = (r->head + 1) % TIMESERIES_POINTS;
+  r->seq++;
+
+  // Kaszkád: a következő szint pontja betelt csoportból
+  uint8_t next = level + 1;
+  if (next >= TIMESERIES_LEVELS) return;
+  merge(&ts->pending[next], ts->pendingCount[next], p);
+  if (++ts->pendingCount[next] == factors[next]) {
+    TimeSeriesPoint_t out = ts->pending[next];
+    out.mean /= factors[next];
+    ts->pendingCount[next] = 0;
+    append(ts, next, &out);
+  }
+}
+
+static void close_second(TimeSeries_t *ts) {
+  TimeSeriesPoint_t p;
+  if (ts->curCount > 0) {
+    p.min = ts->curMin;
+    p.max = ts->curMax;
+    p.mean = (float)(ts->curSum / ts->curCount);
+  } else {
+    p.min = p.max = p.mean = ts->lastValue;
+  }
+  append(ts, 0, &p);
+  ts->curCount = 0;
+  ts->curSum = 0.0;
+  ts->secondStartUs += SECOND_US;
+}
+
+void timeseries_init(TimeSeries_t *ts, int64_t nowUs) {
+  memset(ts, 0, sizeof(*ts));
+  ts->secondStartUs = nowUs;
+}
+
+void timeseries_tick(TimeSeries_t *ts, int64_t nowUs) {
+  int64_t elapsed = (nowUs - ts->secondStartUs) / SECOND_US;
+  if (elapsed <= 0) return;
+  if (elapsed > MAX_FILL_SECONDS) {
+    ts->secondStartUs = nowUs - MAX_FILL_SECONDS * SECOND_US;
+  }
+  while (nowUs - ts->secondStartUs >= SECOND_US) close_second(ts);
+}
+
+void timeseries_add(TimeSeries_t *ts, int64_t nowUs, float value) {
+  timeseries_tick(ts, nowUs);
+  if (ts->curCount == 0 || value < ts->curMin) ts->curMin = value;
+  if (ts->curCount == 0 || value > ts->curMax) ts->curMax = value;
+  ts->curSum += value;
+  ts->curCount++;
+  ts->lastValue = value;
+}
+
+uint32_t timeseries_seq(const TimeSeries_t *ts, uint8_t level) {
+  return level < TIMESERIES_LEVELS ? ts->level[level].seq : 0;
+}
+
+uint16_t timeseries_read(const TimeSeries_t *ts, uint8_t level, uint32_t from,
+                         TimeSeriesPoint_t *out, uint16_t max, uint32_t *first) {
+  if (level >= TIMESERIES_LEVELS) return 0;
+  const TimeSeriesRing_t *r = &ts->level[level];
+  uint32_t oldest = r->seq > TIMESERIES_POINTS ? r->seq - TIMESERIES_POINTS : 0;
+  if (from < oldest) from = oldest;
+  if (from >= r->seq) return 0;
+  uint32_t n = r->seq - from;
+  if (n > max) n = max;
+  // A "from" sorszámú pont helye: head a seq-edik pont utáni hely
+  uint32_t pos = (r->head + TIMESERIES_POINTS - (r->seq - from) % TIMESERIES_POINTS) % TIMESERIES_POINTS;
+  for (uint32_t i = 0; i < n; i++) {
+    out[i] = r->points[(pos + i) % TIMESERIES_POINTS];
+  }
+  if (first) *first = from;
+  return (uint16_t)n;
+}
@@ -0,0 +1,61 @@
+// timeseries.h
+// Fix memóriájú, többszintű idősor: 1 s, 10 s és 1 perc felbontású
+// gyűrűk. Minden pont min/max/átlag; egy szint betelő csoportja
+// (10 másodperc, 6 tízmásodperc) összevonva kerül a következő szintre.
+// A minták tetszőleges időpontban érkezhetnek (impulzusonként), a
+// másodpercek lezárása az időbélyegből történik. Hardverfüggetlen; a
+// szinkronizálás a hívó dolga.
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <stdint.h>
+
+#define TIMESERIES_LEVELS 3
+#define TIMESERIES_POINTS 240 // Pontok szintenként (>= a legszélesebb görbe)
+
+// Szintenként ennyi előző szintbeli pont alkot egy pontot (0. szint: 1 s)
+#define TIMESERIES_FACTORS { 1, 10, 6 }
+
+typedef struct {
+  float min;
+  float max;
+  float mean;
+} TimeSeriesPoint_t;
+
+typedef struct {
+  TimeSeriesPoint_t points[TIMESERIES_POINTS];
+  uint16_t head;      // Következő írási pozíció
+  uint32_t seq;       // Eddig hozzáfűzött pontok száma
+} TimeSeriesRing_t;
+
+typedef struct {
+  TimeSeriesRing_t level[TIMESERIES_LEVELS];
+  // Következő szintre váró összevonás
+  TimeSeriesPoint_t pending[TIMESERIES_LEVELS];
+  uint8_t pendingCount[TIMESERIES_LEVELS];
+  // A folyamatban lévő másodperc
+  int64_t secondStartUs;
+  float curMin, curMax;
+  double curSum;
+  uint32_t curCount;
+  float lastValue;    // Minta nélküli másodpercek ezt kapják
+} TimeSeries_t;
+
+void timeseries_init(TimeSeries_t *ts, int64_t nowUs);
+
+// Minta hozzáadása; az azóta eltelt teljes másodpercek lezárulnak
+void timeseries_add(TimeSeries_t *ts, int64_t nowUs, float value);
+
+// Eltelt másodpercek lezárása minta nélkül is (az utolsó értékkel)
+void timeseries_tick(TimeSeries_t *ts, int64_t nowUs);
+
+// A szintre eddig hozzáfűzött pontok száma (a kirajzolás ehhez képest frissít)
+uint32_t timeseries_seq(const TimeSeries_t *ts, uint8_t level);
+
+// Pontok másolása a "from" sorszámtól (legfeljebb max darab, a régebbiek
+// előbb). A gyűrűből már kiesett pontok kimaradnak; visszatér a másolt
+// pontok számával, *first = az első másolt pont sorszáma.
+uint16_t timeseries_read(const TimeSeries_t *ts, uint8_t level, uint32_t from,
+                         TimeSeriesPoint_t *out, uint16_t max, uint32_t *first);
+
+#endif
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# check.py
+# A test_rideexport által rögzített export fájlok ellenőrzése független
+# olvasókkal (pip install fitparse gpxpy), a tools/ könyvtárból:
+#   python3 fixtures/check.py
+import os
+import sys
+
+import fitparse
+import gpxpy
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+# FIT: CRC és szerkezet (fitparse alapból ellenőrzi), üzenetek és összesítők
+fit = fitparse.FitFile(os.path.join(here, "ride.fit"), check_crc=True)
+messages = [m.name for m in fit.get_messages()]
+records = list(fit.get_messages("record"))
+session = next(fit.get_messages("session"))
+assert messages[:2] == ["file_id", "event"], messages[:2]
+assert messages[-4:] == ["event", "lap", "session", "activity"], messages[-4:]
+assert len(records) == messages.count("record") > 90
+times = [r.get_value("timestamp") for r in records]
+distances = [r.get_value("distance") for r in records]
+assert all(a < b for a, b in zip(times, times[1:]))
+assert all(a <= b for a, b in zip(distances, distances[1:]))
+assert session.get_value("sport") == "cycling"
+assert abs(session.get_value("total_distance") - distances[-1]) < 0.01
+assert sum(r.get_value("position_lat") is not None for r in records) > 60
+print("ride.fit: %d records, %.1f m, %s .. %s" % (len(records), distances[-1], times[0], times[-1]))
+
+# GPX: egy track, egy szegmens, pontonként idő és pozíció
+with open(os.path.join(here, "ride.gpx")) as f:
+    gpx = gpxpy.parse(f)
+points = gpx.tracks[0].segments[0].points
+assert len(gpx.tracks) == 1 and len(gpx.tracks[0].segments) == 1
+assert len(points) == 60
+assert all(a.time < b.time for a, b in zip(points, points[1:]))
+assert all(p.extensions for p in points)
+print("ride.gpx: %d points, %.1f m, %s .. %s" % (len(points), gpx.length_2d(), points[0].time, points[-1].time))
+sys.exit(0)
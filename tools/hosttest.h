@@ -0,0 +1,58 @@
+// hosttest.h
+// Ellenőrző makrók a hoszt oldali tesztekhez (make -C tools test). Egy
+// teszt program egy firmware modult hajt szintetikus bemenettel; a hibás
+// ellenőrzések a hibakimenetre kerülnek, hiba esetén a kilépési kód 1.
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static int hostTestChecks = 0;
+static int hostTestFailures = 0;
+
+#define CHECK(cond)                                                                   \
+  do {                                                                                \
+    hostTestChecks++;                                                                 \
+    if (!(cond)) {                                                                    \
+      hostTestFailures++;                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);        \
+    }                                                                                 \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                    \
+  do {                                                                                \
+    hostTestChecks++;                                                                 \
+    long long a_ = (long long)(actual), e_ = (long long)(expected);                   \
+    if (a_ != e_) {                                                                   \
+      hostTestFailures++;                                                             \
+      fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n", __FILE__, __LINE__, \
+              #actual, a_, #expected, e_);                                            \
+    }                                                                                 \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                       \
+  do {                                                                                \
+    hostTestChecks++;                                                                 \
+    double a_ = (double)(actual), e_ = (double)(expected);                            \
+    if (!(fabs(a_ - e_) <= (tolerance))) {                                            \
+      hostTestFailures++;                                                             \
+      fprintf(stderr, "%s:%d: %s == %g, expected %g +/- %g\n", __FILE__, __LINE__,    \
+              #actual, a_, e_, (double)(tolerance));                                  \
+    }                                                                                 \
+  } while (0)
+
+// Ismételhető álvéletlen sorozat a szintetikus bemenetekhez
+static inline uint32_t host_test_rand(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+// A main() végén: összesítés és kilépési kód
+static inline int host_test_done(const char *name) {
+  printf("%-16s %d checks, %d failed\n", name, hostTestChecks, hostTestFailures);
+  return hostTestFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,266 @@
+// pulselog.cpp
+// Hoszt oldali eszköz a letöltött menetnaplókhoz (GET /logs/<n>):
+//   pulselog decode <log.bin> [kerület_m] [impulzus/fordulat]  -> CSV
+//   pulselog bench <log.bin>...                               -> tömörítés és kódolási költség
+//   pulselog export <log.bin> fit|gpx <out> [fixek.csv|-] [kerület_m ppr] -> FIT/GPX
+//   pulselog synth <out.bin>                                  -> szintetikus napló (pulsesim)
+// A firmware pulsecodec, rideexport és pulsesim kódját használja.
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "pulsecodec.h"
+#include "pulsesim.h"
+#include "rideexport.h"
+#include "ridelogformat.h"
+#include "ridelogread.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+static bool read_file(const char *path, std::vector<uint8_t> *out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// Napló -> abszolút impulzusidők (mindkét adatváltozat)
+static bool load_pulses(const char *path, std::vector<int64_t> *pulses) {
+  std::vector<uint8_t> file;
+  if (!read_file(path, &file)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return false;
+  }
+  RideLogRead_t info;
+  if (!ride_log_read(file.data(), file.size(), &info, pulses)) {
+    fprintf(stderr, "%s: %s\n", path, info.error);
+    return false;
+  }
+  if (info.badBlocks) fprintf(stderr, "%s: %u damaged blocks skipped\n", path, info.badBlocks);
+  return true;
+}
+
+static int cmd_decode(int argc, char **argv) {
+  if (argc < 1) return 2;
+  double circumference = argc > 1 ? atof(argv[1]) : 0.0;
+  int ppr = argc > 2 ? atoi(argv[2]) : 1;
+  std::vector<int64_t> pulses;
+  if (!load_pulses(argv[0], &pulses)) return 1;
+  printf("index,time_us,interval_us%s\n", circumference > 0 ? ",speed_kmh" : "");
+  for (size_t i = 0; i < pulses.size(); i++) {
+    int64_t dt = i ? pulses[i] - pulses[i - 1] : 0;
+    printf("%zu,%lld,%lld", i, (long long)pulses[i], (long long)dt);
+    if (circumference > 0) printf(",%.2f", dt > 0 ? circumference / ppr / dt * 3.6e6 : 0.0);
+    printf("\n");
+  }
+  return 0;
+}
+
+static size_t sinkBytes;
+static void count_sink(const uint8_t *block, uint16_t length, void *ctx) {
+  std::vector<uint8_t> *out = (std::vector<uint8_t> *)ctx;
+  if (out) out->insert(out->end(), block, block + length);
+  sinkBytes += length;
+}
+
+static int cmd_bench(int argc, char **argv) {
+  printf("%-24s %9s %9s %9s %9s %7s %9s %9s %9s\n", "log", "pulses", "raw64_B", "raw32_B",
+         "dod_B", "ratio", "B/pulse", "enc_ns", "dec_ns");
+  for (int f = 0; f < argc; f++) {
+    std::vector<int64_t> pulses;
+    if (!load_pulses(argv[f], &pulses) || pulses.empty()) continue;
+
+    // Kódolás: többszöri ismétlés a stabil időméréshez, nyelő másolás nélkül
+    const int reps = 50;
+    PulseEncoder_t enc;
+    auto t0 = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (int r = 0; r < reps; r++) {
+      sinkBytes = 0;
+      pulse_encoder_init(&enc, count_sink, NULL);
+      for (int64_t t : pulses) pulse_encoder_add(&enc, t);
+      pulse_encoder_flush(&enc);
+    }
+#ifdef HAVE_TSC
+    uint64_t cycles = __rdtsc() - c0;
+#endif
+    auto t1 = std::chrono::steady_clock::now();
+    double encNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / reps / pulses.size();
+
+    std::vector<uint8_t> encoded;
+    pulse_encoder_init(&enc, count_sink, &encoded);
+    for (int64_t t : pulses) pulse_encoder_add(&enc, t);
+    pulse_encoder_flush(&enc);
+
+    // Dekódolás és ellenőrzés
+    t0 = std::chrono::steady_clock::now();
+    size_t decoded = 0;
+    bool match = true;
+    for (int r = 0; r < reps; r++) {
+      PulseDecoder_t dec;
+      pulse_decoder_init(&dec, encoded.data(), encoded.size());
+      int64_t t;
+      decoded = 0;
+      while (pulse_decoder_next(&dec, &t)) {
+        if (decoded >= pulses.size() || pulses[decoded] != t) match = false;
+        decoded++;
+      }
+    }
+    t1 = std::chrono::steady_clock::now();
+    double decNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / reps / pulses.size();
+    if (decoded != pulses.size()) match = false;
+
+    size_t n = pulses.size();
+    printf("%-24s %9zu %9zu %9zu %9zu %6.1fx %9.2f %9.1f %9.1f%s\n", argv[f], n, n * 8, n * 4,
+           encoded.size(), 8.0 * n / encoded.size(), (double)encoded.size() / n, encNs, decNs,
+           match ? "" : "  ROUNDTRIP MISMATCH");
+#ifdef HAVE_TSC
+    printf("%-24s host TSC: %.1f cycles/pulse encode\n", "", (double)cycles / reps / n);
+#endif
+  }
+  return 0;
+}
+
+// GPS fixek CSV-ből: epoch,lat,lon soronként
+typedef struct {
+  FILE *f;
+} FixFile_t;
+
+static bool read_fix(void *ctx, RideExportFix_t *fix) {
+  FixFile_t *ff = (FixFile_t *)ctx;
+  char line[128];
+  while (fgets(line, sizeof(line), ff->f)) {
+    unsigned long epoch;
+    double lat, lon;
+    if (sscanf(line, "%lu,%lf,%lf", &epoch, &lat, &lon) != 3) continue;
+    fix->epoch = epoch;
+    fix->latE7 = (int32_t)(lat * 1e7 + (lat < 0 ? -0.5 : 0.5));
+    fix->lonE7 = (int32_t)(lon * 1e7 + (lon < 0 ? -0.5 : 0.5));
+    return true;
+  }
+  return false;
+}
+
+static int cmd_export(int argc, char **argv) {
+  if (argc < 3) return 2;
+  RideExportFormat_t format;
+  if (strcmp(argv[1], "fit") == 0) format = RIDE_EXPORT_FIT;
+  else if (strcmp(argv[1], "gpx") == 0) format = RIDE_EXPORT_GPX;
+  else return 2;
+
+  std::vector<uint8_t> log;
+  if (!read_file(argv[0], &log)) {
+    fprintf(stderr, "%s: cannot read\n", argv[0]);
+    return 1;
+  }
+  FixFile_t fixes = {NULL};
+  if (argc > 3 && strcmp(argv[3], "-") != 0 && !(fixes.f = fopen(argv[3], "r"))) {
+    fprintf(stderr, "%s: cannot read\n", argv[3]);
+    return 1;
+  }
+  RideExportSource_t src = {};
+  src.log = log.data();
+  src.logBytes = log.size();
+  src.circumferenceM = argc > 4 ? atof(argv[4]) : 0.348 * 3.14159265358979;
+  src.pulsesPerRev = argc > 5 ? atoi(argv[5]) : 1;
+  if (fixes.f) {
+    src.nextFix = read_fix;
+    src.fixCtx = &fixes;
+  }
+
+  static RideExport_t exp;
+  if (!ride_export_init(&exp, format, &src)) {
+    fprintf(stderr, "%s: cannot export (invalid log, or GPX without fixes)\n", argv[0]);
+    return 1;
+  }
+  FILE *out = fopen(argv[2], "wb");
+  if (!out) return 1;
+  // Páratlan darabméret: a folyam tetszőleges határon megszakítható
+  uint8_t chunk[509];
+  size_t n, total = 0;
+  while ((n = ride_export_read(&exp, chunk, sizeof(chunk))) > 0) {
+    fwrite(chunk, 1, n, out);
+    total += n;
+  }
+  fclose(out);
+  if (fixes.f) fclose(fixes.f);
+  printf("%s: %zu bytes", argv[2], total);
+  if (format == RIDE_EXPORT_FIT) {
+    printf(" (expected %u), %u records, %.3f km, %u s moving", ride_export_size(&exp), exp.records,
+           exp.totalM / 1000.0, exp.movingSec);
+  }
+  printf(", exporter state %zu bytes\n", sizeof(exp));
+  return 0;
+}
+
+// Szintetikus menet: bemelegítés, intervallumok, megállás, 0.348 m átmérő
+static int cmd_synth(int argc, char **argv) {
+  if (argc < 1) return 2;
+  static const PulseSimSegment_t profile[] = {
+      {0, 25, 20000},  {25, 25, 300000}, {25, 40, 10000}, {40, 40, 60000},
+      {40, 20, 10000}, {20, 20, 60000},  {20, 32, 30000}, {32, 32, 900000},
+      {32, 0, 15000},  {0, 0, 30000},    {0, 28, 20000},  {28, 28, 600000}, {28, 0, 20000},
+  };
+  PulseSimConfig_t cfg = {};
+  cfg.segments = profile;
+  cfg.segmentCount = sizeof(profile) / sizeof(profile[0]);
+  cfg.circumferenceM = 0.348 * 3.14159265358979;
+  cfg.pulsesPerRev = 1;
+  cfg.seed = 1;
+  PulseSim_t sim;
+  pulsesim_init(&sim, &cfg, 1000000);
+
+  std::vector<uint8_t> data;
+  PulseEncoder_t enc;
+  pulse_encoder_init(&enc, count_sink, &data);
+  int64_t t;
+  bool bounce;
+  // Az ISR időbélyegének bizonytalansága: +-8 us
+  uint32_t rng = 12345;
+  while (pulsesim_next(&sim, &t, &bounce)) {
+    rng = rng * 1103515245 + 12345;
+    pulse_encoder_add(&enc, t + (int)((rng >> 16) % 17) - 8);
+  }
+  pulse_encoder_flush(&enc);
+
+  RideLogHeader_t h = {};
+  h.magic = RIDE_LOG_MAGIC;
+  h.version = RIDE_LOG_VERSION_DOD;
+  h.headerSize = sizeof(h);
+  h.logSeq = 1;
+  h.startEpoch = 1780000000;
+  h.firstPulseUs = 1000000;
+  h.dataBytes = data.size();
+  h.wheelMm = (uint16_t)(cfg.circumferenceM * 1000.0 + 0.5);
+  h.pulsesPerRev = cfg.pulsesPerRev;
+  FILE *f = fopen(argv[0], "wb");
+  if (!f) return 1;
+  fwrite(&h, sizeof(h), 1, f);
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+  printf("%s: %u pulses, %zu bytes\n", argv[0], enc.pulses, data.size() + sizeof(h));
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int rc = 2;
+  if (argc >= 2 && strcmp(argv[1], "decode") == 0) rc = cmd_decode(argc - 2, argv + 2);
+  else if (argc >= 2 && strcmp(argv[1], "bench") == 0) rc = cmd_bench(argc - 2, argv + 2);
+  else if (argc >= 2 && strcmp(argv[1], "export") == 0) rc = cmd_export(argc - 2, argv + 2);
+  else if (argc >= 2 && strcmp(argv[1], "synth") == 0) rc = cmd_synth(argc - 2, argv + 2);
+  if (rc == 2) {
+    fprintf(stderr, "usage: pulselog decode <log.bin> [circumference_m] [pulses_per_rev]\n"
+                    "       pulselog bench <log.bin>...\n"
+                    "       pulselog export <log.bin> fit|gpx <out> [fixes.csv|-] [circumference_m pulses_per_rev]\n"
+                    "       pulselog synth <out.bin>\n");
+  }
+  return rc;
+}
@@ -0,0 +1,45 @@
+#include "ridelogread.h"
+#include <string.h>
+#include "pulsecodec.h"
+
+bool ride_log_read(const uint8_t *data, size_t available, RideLogRead_t *info,
+                   std::vector<int64_t> *pulses) {
+  RideLogHeader_t &h = info->header;
+  info->badBlocks = 0;
+  info->error = NULL;
+  pulses->clear();
+  if (available < sizeof(h)) {
+    info->error = "too short";
+    return false;
+  }
+  memcpy(&h, data, sizeof(h));
+  if (h.magic != RIDE_LOG_MAGIC || h.headerSize < sizeof(h) || h.headerSize > available) {
+    info->error = "not a ride log";
+    return false;
+  }
+  const uint8_t *payload = data + h.headerSize;
+  size_t len = available - h.headerSize;
+  if (h.dataBytes != RIDE_LOG_OPEN && h.dataBytes < len) len = h.dataBytes;
+
+  if (h.version == RIDE_LOG_VERSION_RAW32) {
+    int64_t t = h.firstPulseUs;
+    pulses->push_back(t);
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+      uint32_t dt;
+      memcpy(&dt, payload + i, 4);
+      if (dt == 0xFFFFFFFF) break;
+      t += dt;
+      pulses->push_back(t);
+    }
+  } else if (h.version == RIDE_LOG_VERSION_DOD) {
+    PulseDecoder_t dec;
+    pulse_decoder_init(&dec, payload, len);
+    int64_t t;
+    while (pulse_decoder_next(&dec, &t)) pulses->push_back(t);
+    info->badBlocks = dec.badBlocks;
+  } else {
+    info->error = "unknown log version";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,24 @@
+// ridelogread.h
+// Menetnapló dekódolása memóriából (letöltött fájl vagy mmap-elt partíció
+// kép) abszolút impulzusidőkre, mindkét adatváltozatból. A tools/ eszközök
+// közös kódja.
+#ifndef RIDELOGREAD_H
+#define RIDELOGREAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "ridelogformat.h"
+
+typedef struct {
+  RideLogHeader_t header;
+  uint32_t badBlocks;       // Átugrott sérült blokkok (kódolt változat)
+  const char *error;        // NULL, ha a napló érvényes
+} RideLogRead_t;
+
+// A napló a data elején kezdődik; available a rendelkezésre álló bájtok
+// (egy partíció hely, vagy a fájl hátralévő része). A pulses vektor ürül.
+bool ride_log_read(const uint8_t *data, size_t available, RideLogRead_t *info,
+                   std::vector<int64_t> *pulses);
+
+#endif
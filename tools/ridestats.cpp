@@ -0,0 +1,367 @@
+// ridestats.cpp
+// Menetnaplók tömeges elemzése (több egység letöltött naplói vagy ride_log
+// partíció képek):
+//   ridestats [-j szálak] [-f csv|json] [-a] [-c kerület_m -p ppr] <fájl|könyvtár>...
+// A fájlok mmap-pel olvasódnak; egy fájl egy napló (GET /logs/<n>) vagy
+// RIDE_LOG_SLOT_SIZE méretű helyek sorozata (partíció kép). A menetek a
+// szálak között dinamikusan oszlanak el.
+// A firmware impulzus validátorát (pulsevalidator), sebességbecslőjét
+// (speedestimator), lecsengési döntését és automatikus szünet állapotgépét
+// (autopause) használja a config.h
+// beállításaival, impulzusról impulzusra visszajátszva, így a táv, mozgási
+// idő és sebesség ugyanaz, amit a készülék mutatott.
+// Kimenet menetenként és összesítve (-a: csak összesítés) CSV-ben vagy
+// JSON-ban a szabványos kimeneten; az áteresztőképesség a hibakimeneten.
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "autopause.h"
+#include "config.h"
+#include "pulsevalidator.h"
+#include "ridelogread.h"
+#include "speedestimator.h"
+
+#define HIST_BIN_KMH 5   // Sebesség hisztogram sávszélesség
+#define HIST_BINS    12  // Az utolsó sáv felfelé nyitott (55+ km/h)
+
+typedef struct {
+  const char *path;
+  const uint8_t *data;
+  size_t size;
+} MappedFile_t;
+
+typedef struct {
+  uint32_t file;     // Index a fájlok tömbjében
+  size_t offset;     // A napló kezdete a fájlban
+  size_t available;
+} RideRef_t;
+
+typedef struct {
+  bool valid;
+  const char *error;
+  uint32_t logSeq;
+  uint32_t startEpoch;
+  uint16_t version;
+  uint32_t pulses;
+  uint32_t badBlocks;
+  double circumferenceM;
+  uint8_t pulsesPerRev;
+  double durationS;
+  double distanceKm;
+  uint32_t movingS;
+  double maxKmh;
+  uint32_t pauses;
+  uint32_t missed;          // A validátor által pótolt (kimaradt) impulzusok
+  uint32_t phantom;         // Eldobott fantom impulzusok (rezgés, átjutott pergés)
+  uint32_t implausible;     // Lehetetlen gyorsulás mintázat nélkül
+  double histS[HIST_BINS];  // Mozgás közben az egyes sebességsávokban töltött idő
+} RideStats_t;
+
+typedef struct {
+  double circumferenceM;  // Ha a napló nem rögzítette a kereket
+  uint8_t pulsesPerRev;
+} Defaults_t;
+
+static const SpeedEstimatorConfig_t estimatorConfig = {
+    SPEED_EST_LEARN_ALPHA, SPEED_EST_STEADY_PCT / 100.0, SPEED_EST_COMBINE_PCT / 100.0,
+    SPEED_EST_STOP_US, SPEED_EST_SLIP_PCT / 100.0};
+static const PulseValidatorConfig_t validatorConfig = {
+    PULSE_VALID_MAX_ACCEL_MPS2, PULSE_VALID_MATCH_PCT / 100.0, PULSE_VALID_PHANTOM_PCT / 100.0,
+    PULSE_VALID_MAX_MISSED, SPEED_EST_STOP_US};
+static const AutoPauseConfig_t autoPauseConfig = {AUTOPAUSE_RESUME_KMH, AUTOPAUSE_PAUSE_KMH};
+
+// --- Fájlok ---
+
+static bool map_file(const char *path, std::vector<MappedFile_t> *files) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return st.st_size == 0;
+  }
+  void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+  files->push_back({strdup(path), (const uint8_t *)p, (size_t)st.st_size});
+  return true;
+}
+
+static void collect(const char *path, std::vector<MappedFile_t> *files) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "%s: cannot stat\n", path);
+    return;
+  }
+  if (S_ISDIR(st.st_mode)) {
+    DIR *d = opendir(path);
+    if (!d) return;
+    std::vector<std::string> names;
+    while (struct dirent *e = readdir(d)) {
+      if (e->d_name[0] != '.') names.push_back(e->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (const std::string &n : names) collect((std::string(path) + "/" + n).c_str(), files);
+  } else if (S_ISREG(st.st_mode) && !map_file(path, files)) {
+    fprintf(stderr, "%s: cannot map\n", path);
+  }
+}
+
+// Napló a fájl elején, illetve minden RIDE_LOG_SLOT_SIZE határon (partíció kép)
+static void find_rides(const std::vector<MappedFile_t> &files, std::vector<RideRef_t> *rides) {
+  for (uint32_t f = 0; f < files.size(); f++) {
+    const MappedFile_t &m = files[f];
+    for (size_t off = 0; off + sizeof(RideLogHeader_t) <= m.size; off += RIDE_LOG_SLOT_SIZE) {
+      uint32_t magic;
+      memcpy(&magic, m.data + off, sizeof(magic));
+      if (magic != RIDE_LOG_MAGIC) continue; // Üres vagy törölt hely
+      size_t avail = std::min((size_t)RIDE_LOG_SLOT_SIZE, m.size - off);
+      if (off == 0 && m.size < RIDE_LOG_SLOT_SIZE) avail = m.size;
+      rides->push_back({f, off, avail});
+    }
+  }
+}
+
+// --- Elemzés ---
+
+// A számoló task lépései impulzusonként: impulzusfolyam ellenőrzés, lecsengés
+// az impulzusmentes ébredéseken (SPEED_DECAY_TICK_MS), majd becslés és
+// automatikus szünet
+static void analyse(const uint8_t *data, size_t available, const Defaults_t &def,
+                    std::vector<int64_t> &pulses, RideStats_t *st) {
+  memset(st, 0, sizeof(*st));
+  RideLogRead_t info;
+  st->valid = ride_log_read(data, available, &info, &pulses);
+  st->error = info.error;
+  st->logSeq = info.header.logSeq;
+  st->startEpoch = info.header.startEpoch;
+  st->version = info.header.version;
+  st->badBlocks = info.badBlocks;
+  if (!st->valid) return;
+
+  const RideLogHeader_t &h = info.header;
+  st->circumferenceM = h.wheelMm != 0xFFFF && h.wheelMm != 0 ? h.wheelMm / 1000.0 : def.circumferenceM;
+  st->pulsesPerRev = h.pulsesPerRev != 0xFF && h.pulsesPerRev != 0 ? h.pulsesPerRev : def.pulsesPerRev;
+  st->pulses = pulses.size();
+  if (pulses.empty()) return;
+
+  SpeedEstimator_t est;
+  speed_estimator_init(&est, &estimatorConfig, st->pulsesPerRev, st->circumferenceM);
+  PulseValidator_t validator;
+  pulse_validator_init(&validator, &validatorConfig, st->pulsesPerRev, st->circumferenceM);
+  AutoPause_t ap;
+  autopause_init(&ap, &autoPauseConfig, 0, 0.0);
+  const int64_t tickUs = (int64_t)SPEED_DECAY_TICK_MS * 1000;
+  const int64_t timeoutUs = (int64_t)SPEED_TIMEOUT_MS * 1000;
+  double cur = 0.0;
+
+  int64_t prev = 0;
+  uint32_t counted = 0; // Távolságba számító impulzusok (javítva)
+  for (size_t i = 0; i < pulses.size(); i++) {
+    int64_t t = pulses[i];
+    PulseCheck_t check = pulse_validator_pulse(&validator, t);
+    if (check.verdict == PULSE_VALID_PHANTOM) continue;
+    counted += 1 + check.missedPulses + check.lateMissed;
+    if (prev == 0) {
+      speed_estimator_pulse(&est, t); // Első impulzus: csak időbélyeg
+      autopause_pulse(&ap, t, 0.0);
+      prev = t;
+      continue;
+    }
+    for (int64_t tick = prev + tickUs; cur != 0.0 && tick < t; tick += tickUs) {
+      if (speed_estimator_decay(&est, tick, SPEED_ZERO_KMH, timeoutUs, &cur) != SPEED_DECAY_HOLD)
+        autopause_update(&ap, cur);
+    }
+    for (uint8_t m = 1; m <= check.missedPulses; m++) {
+      speed_estimator_pulse(&est, pulse_validator_interpolate(prev, t, check.missedPulses, m));
+    }
+    cur = speed_estimator_pulse(&est, t);
+    autopause_pulse(&ap, t, cur);
+
+    int64_t dt = t - prev;
+    prev = t;
+    if (ap.state == AUTOPAUSE_MOVING) {
+      int bin = (int)(cur / HIST_BIN_KMH);
+      st->histS[bin < HIST_BINS ? bin : HIST_BINS - 1] += dt / 1e6;
+      if (check.verdict != PULSE_VALID_IMPLAUSIBLE && cur > st->maxKmh) st->maxKmh = cur;
+    }
+  }
+  st->missed = validator.stats.missed;
+  st->phantom = validator.stats.phantom;
+  st->implausible = validator.stats.implausible;
+  st->durationS = (pulses.back() - pulses.front()) / 1e6;
+  st->distanceKm = (counted > 0 ? counted - 1 : 0) * st->circumferenceM / st->pulsesPerRev / 1000.0;
+  st->movingS = autopause_moving_seconds(&ap);
+  st->pauses = ap.pauses;
+}
+
+static void accumulate(RideStats_t *sum, const RideStats_t &r) {
+  sum->pulses += r.pulses;
+  sum->badBlocks += r.badBlocks;
+  sum->durationS += r.durationS;
+  sum->distanceKm += r.distanceKm;
+  sum->movingS += r.movingS;
+  if (r.maxKmh > sum->maxKmh) sum->maxKmh = r.maxKmh;
+  sum->pauses += r.pauses;
+  sum->missed += r.missed;
+  sum->phantom += r.phantom;
+  sum->implausible += r.implausible;
+  for (int b = 0; b < HIST_BINS; b++) sum->histS[b] += r.histS[b];
+}
+
+// --- Kimenet ---
+
+static double avg_kmh(const RideStats_t &r) {
+  return r.movingS ? r.distanceKm / (r.movingS / 3600.0) : 0.0;
+}
+
+static void print_csv_header(void) {
+  printf("file,offset,log_seq,start_epoch,version,pulses,bad_blocks,wheel_m,ppr,duration_s,distance_km,"
+         "moving_s,avg_kmh,max_kmh,pauses,missed,phantom,implausible");
+  for (int b = 0; b < HIST_BINS; b++) {
+    if (b < HIST_BINS - 1) printf(",s_%d_%d", b * HIST_BIN_KMH, (b + 1) * HIST_BIN_KMH);
+    else printf(",s_%d_up", b * HIST_BIN_KMH);
+  }
+  printf("\n");
+}
+
+static void print_csv(const char *file, size_t offset, const RideStats_t &r) {
+  printf("%s,%zu,%u,%u,%u,%u,%u,%.3f,%u,%.1f,%.3f,%u,%.2f,%.2f,%u,%u,%u,%u", file, offset, r.logSeq,
+         r.startEpoch, r.version, r.pulses, r.badBlocks, r.circumferenceM, r.pulsesPerRev, r.durationS,
+         r.distanceKm, r.movingS, avg_kmh(r), r.maxKmh, r.pauses, r.missed, r.phantom, r.implausible);
+  for (int b = 0; b < HIST_BINS; b++) printf(",%.1f", r.histS[b]);
+  printf("\n");
+}
+
+static void print_json(const char *indent, const RideStats_t &r) {
+  printf("%s\"pulses\": %u, \"bad_blocks\": %u, \"duration_s\": %.1f, \"distance_km\": %.3f, "
+         "\"moving_s\": %u, \"avg_kmh\": %.2f, \"max_kmh\": %.2f, \"pauses\": %u, "
+         "\"missed\": %u, \"phantom\": %u, \"implausible\": %u,\n%s\"speed_hist_s\": [",
+         indent, r.pulses, r.badBlocks, r.durationS, r.distanceKm, r.movingS, avg_kmh(r), r.maxKmh,
+         r.pauses, r.missed, r.phantom, r.implausible, indent);
+  for (int b = 0; b < HIST_BINS; b++) printf("%s%.1f", b ? ", " : "", r.histS[b]);
+  printf("]");
+}
+
+// JSON stringként a fájlnév (idézőjel és vissza-per escape)
+static void print_json_string(const char *s) {
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') putchar('\\');
+    putchar(*s);
+  }
+  putchar('"');
+}
+
+static int usage(void) {
+  fprintf(stderr, "usage: ridestats [-j threads] [-f csv|json] [-a] [-c circumference_m -p pulses_per_rev] <log|dir>...\n");
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  bool json = false, aggregateOnly = false;
+  Defaults_t def = {WHEEL_DIAMETER_M * 3.14159265358979, PULSES_PER_REVOLUTION};
+  int opt;
+  while ((opt = getopt(argc, argv, "j:f:ac:p:")) != -1) {
+    switch (opt) {
+      case 'j': threads = (unsigned)atoi(optarg); break;
+      case 'f':
+        if (strcmp(optarg, "json") == 0) json = true;
+        else if (strcmp(optarg, "csv") != 0) return usage();
+        break;
+      case 'a': aggregateOnly = true; break;
+      case 'c': def.circumferenceM = atof(optarg); break;
+      case 'p': def.pulsesPerRev = (uint8_t)atoi(optarg); break;
+      default: return usage();
+    }
+  }
+  if (optind >= argc || def.circumferenceM <= 0 || def.pulsesPerRev == 0) return usage();
+  if (threads == 0) threads = 1;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<MappedFile_t> files;
+  for (int i = optind; i < argc; i++) collect(argv[i], &files);
+  std::vector<RideRef_t> rides;
+  find_rides(files, &rides);
+
+  // Dinamikus elosztás: minden szál a következő még fel nem dolgozott menetet veszi
+  std::vector<RideStats_t> stats(rides.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    std::vector<int64_t> pulses; // Szálanként újrahasznosítva
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < rides.size();) {
+      const RideRef_t &r = rides[i];
+      analyse(files[r.file].data + r.offset, r.available, def, pulses, &stats[i]);
+    }
+  };
+  if (threads > rides.size() && !rides.empty()) threads = rides.size();
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+  worker();
+  for (std::thread &t : pool) t.join();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  RideStats_t total;
+  memset(&total, 0, sizeof(total));
+  uint32_t valid = 0, invalid = 0;
+  size_t bytes = 0;
+  for (const MappedFile_t &m : files) bytes += m.size;
+
+  if (json) printf("{\n  \"rides\": [");
+  else print_csv_header();
+  for (size_t i = 0; i < rides.size(); i++) {
+    const RideStats_t &r = stats[i];
+    const char *path = files[rides[i].file].path;
+    if (!r.valid) {
+      fprintf(stderr, "%s@%zu: %s\n", path, rides[i].offset, r.error);
+      invalid++;
+      continue;
+    }
+    accumulate(&total, r);
+    if (!aggregateOnly) {
+      if (json) {
+        printf("%s\n    {\"file\": ", valid ? "," : "");
+        print_json_string(path);
+        printf(", \"offset\": %zu, \"log_seq\": %u, \"start_epoch\": %u, \"version\": %u, "
+               "\"wheel_m\": %.3f, \"ppr\": %u,\n",
+               rides[i].offset, r.logSeq, r.startEpoch, r.version, r.circumferenceM, r.pulsesPerRev);
+        print_json("     ", r);
+        printf("}");
+      } else {
+        print_csv(path, rides[i].offset, r);
+      }
+    }
+    valid++;
+  }
+  if (json) {
+    printf("\n  ],\n  \"aggregate\": {\"rides\": %u, \"invalid\": %u,\n", valid, invalid);
+    print_json("   ", total);
+    printf("},\n  \"throughput\": {\"threads\": %u, \"seconds\": %.3f, \"rides_per_s\": %.1f, \"mb_per_s\": %.1f}\n}\n",
+           threads, elapsed, elapsed > 0 ? valid / elapsed : 0.0, elapsed > 0 ? bytes / 1e6 / elapsed : 0.0);
+  } else {
+    print_csv("TOTAL", 0, total);
+  }
+
+  fprintf(stderr, "ridestats: %u rides (%u invalid) from %zu files, %.1f MB in %.3f s on %u threads: %.0f rides/s, %.1f MB/s\n",
+          valid, invalid, files.size(), bytes / 1e6, elapsed, threads, elapsed > 0 ? valid / elapsed : 0.0,
+          elapsed > 0 ? bytes / 1e6 / elapsed : 0.0);
+  for (MappedFile_t &m : files) {
+    munmap((void *)m.data, m.size);
+    free((void *)m.path);
+  }
+  return valid ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// test_debounce.cpp
+// A sebességfüggő pergésmentesítés (debounce) szintetikus, pergő
+// élsorozatokkal, a config.h DEBOUNCE_* beállításaival:
+//  - a három eldobási kategória (pergés, korai, hideg indulás) külön-külön;
+//  - a tiltási ablak követi a periódus mozgóátlagát, a [min, max] határok
+//    között, és megálláskor visszaáll a max. ablakra;
+//  - pergő zárásokkal tarkított gyorsuló/lassuló menetből pontosan a valódi
+//    impulzusok maradnak meg.
+#include <string.h>
+#include "config.h"
+#include "debounce.h"
+#include "hosttest.h"
+
+static const DebounceConfig_t config = {
+    DEBOUNCE_MIN_US, DEBOUNCE_MAX_US, DEBOUNCE_FRACTION_PCT, DEBOUNCE_STOP_PERIOD_US
+};
+
+static uint32_t expected_lockout(uint32_t predictedUs) {
+  if (predictedUs == 0) return DEBOUNCE_MAX_US;
+  uint32_t window = (uint32_t)((uint64_t)predictedUs * DEBOUNCE_FRACTION_PCT / 100);
+  if (window < DEBOUNCE_MIN_US) return DEBOUNCE_MIN_US;
+  if (window > DEBOUNCE_MAX_US) return DEBOUNCE_MAX_US;
+  return window;
+}
+
+// Pergés a min. ablakon belül: CHATTER, a valódi él megmarad
+static void test_chatter(void) {
+  DebounceState_t s;
+  debounce_init(&s, &config);
+  int64_t t = 1000000;
+  CHECK(debounce_edge(&s, &config, t));
+  CHECK(!debounce_edge(&s, &config, t + 150));
+  CHECK(!debounce_edge(&s, &config, t + DEBOUNCE_MIN_US - 1));
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_CHATTER], 2);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_EARLY], 0);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_COLD], 0);
+  CHECK_EQ(s.accepted, 1);
+}
+
+// Első él után nincs predikció: a max. ablakon belüli (de a min. feletti) él COLD
+static void test_cold(void) {
+  DebounceState_t s;
+  debounce_init(&s, &config);
+  CHECK_EQ(s.lockoutUs, DEBOUNCE_MAX_US);
+  int64_t t = 5000000;
+  CHECK(debounce_edge(&s, &config, t));
+  CHECK(!debounce_edge(&s, &config, t + DEBOUNCE_MIN_US));
+  CHECK(!debounce_edge(&s, &config, t + DEBOUNCE_MAX_US - 1));
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_COLD], 2);
+  CHECK(debounce_edge(&s, &config, t + DEBOUNCE_MAX_US));
+  CHECK_EQ(s.predictedPeriodUs, DEBOUNCE_MAX_US);
+}
+
+// Ismert periódusnál az ablakon belüli, min. feletti él EARLY
+static void test_early(void) {
+  DebounceState_t s;
+  debounce_init(&s, &config);
+  const int64_t period = 30000; // Ablak: 15 ms
+  int64_t t = 1000000;
+  for (int i = 0; i < 4; i++, t += period) CHECK(debounce_edge(&s, &config, t));
+  t -= period;
+  CHECK_EQ(s.predictedPeriodUs, period);
+  CHECK_EQ(s.lockoutUs, expected_lockout(period));
+  CHECK(!debounce_edge(&s, &config, t + 5000));
+  CHECK(!debounce_edge(&s, &config, t + expected_lockout(period) - 1));
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_EARLY], 2);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_CHATTER], 0);
+  CHECK(debounce_edge(&s, &config, t + period));
+  CHECK_EQ(s.accepted, 5);
+}
+
+// Az ablak a periódus 1/4 súlyú mozgóátlagát követi, határok között
+static void test_lockout_adaptation(void) {
+  DebounceState_t s;
+  debounce_init(&s, &config);
+  int64_t t = 1000000;
+  CHECK(debounce_edge(&s, &config, t));
+
+  // Lassú menet: a max. ablak a felső korlát
+  const int64_t slow = 80000;
+  for (int i = 0; i < 3; i++) CHECK(debounce_edge(&s, &config, t += slow));
+  CHECK_EQ(s.lockoutUs, DEBOUNCE_MAX_US);
+
+  // Gyorsítás 30 ms periódusig (impulzusonként 3%), az ablak végig a max.
+  for (double p = slow; p > 30000; p *= 0.97) CHECK(debounce_edge(&s, &config, t += (int64_t)p));
+  for (int i = 0; i < 30; i++) CHECK(debounce_edge(&s, &config, t += 30000));
+  CHECK_NEAR(s.predictedPeriodUs, 30000, 5.0);
+
+  // Lépés 22 ms-ra (az ablakon kívül): a predikció impulzusonként 1/4-del közelít
+  const int64_t step = 22000;
+  uint32_t prev = s.predictedPeriodUs;
+  double reference = prev;
+  for (int i = 0; i < 30; i++) {
+    CHECK(debounce_edge(&s, &config, t += step));
+    reference += (step - reference) / 4.0;
+    CHECK(s.predictedPeriodUs <= prev);
+    CHECK_NEAR(s.predictedPeriodUs, reference, 4.0); // Egész eltolás kerekítése
+    CHECK_EQ(s.lockoutUs, expected_lockout(s.predictedPeriodUs));
+    prev = s.predictedPeriodUs;
+  }
+  CHECK_NEAR(s.predictedPeriodUs, step, 5.0);
+  CHECK_NEAR(s.lockoutUs, step * DEBOUNCE_FRACTION_PCT / 100, 3.0);
+
+  // Fokozatos gyorsítás 1,5 ms periódusig: az ablak arányosan szűkül az alsó korlátig
+  for (double p = step; p > 1500; p *= 0.97) {
+    CHECK(debounce_edge(&s, &config, t += (int64_t)p));
+    CHECK_EQ(s.lockoutUs, expected_lockout(s.predictedPeriodUs));
+  }
+  for (int i = 0; i < 40; i++) CHECK(debounce_edge(&s, &config, t += 1500));
+  CHECK_EQ(s.lockoutUs, DEBOUNCE_MIN_US);
+
+  // Megállás: predikció törlődik, újra a max. ablak
+  CHECK(debounce_edge(&s, &config, t += DEBOUNCE_STOP_PERIOD_US + 1));
+  CHECK_EQ(s.predictedPeriodUs, 0);
+  CHECK_EQ(s.lockoutUs, DEBOUNCE_MAX_US);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_CHATTER] + s.rejected[DEBOUNCE_REJECT_EARLY] +
+               s.rejected[DEBOUNCE_REJECT_COLD], 0);
+}
+
+// Gyorsuló, majd lassuló menet, minden zárás után 0-3 pergéssel a min.
+// ablakon belül és időnként egy késői visszapattanással
+static void test_bouncy_ride(void) {
+  DebounceState_t s;
+  debounce_init(&s, &config);
+  uint32_t rng = 12345;
+  uint32_t chatter = 0, early = 0;
+  int64_t t = 2000000;
+  const int pulses = 2000;
+  int accepted = 0;
+  for (int i = 0; i < pulses; i++) {
+    // 300 ms -> 12 ms -> 300 ms periódus
+    double phase = (double)i / pulses;
+    double periodUs = 12000 + 288000 * (phase < 0.5 ? 1 - 2 * phase : 2 * phase - 1);
+    t += (int64_t)periodUs;
+    if (debounce_edge(&s, &config, t)) accepted++;
+
+    uint32_t bounces = host_test_rand(&rng) % 4;
+    int64_t b = t;
+    for (uint32_t k = 0; k < bounces; k++) {
+      b += 50 + host_test_rand(&rng) % 250; // Legfeljebb 3 x 300 us < min. ablak
+      CHECK(!debounce_edge(&s, &config, b));
+      chatter++;
+    }
+    // Késői visszapattanás: már a min. ablakon túl, a periódus 20%-ánál, de
+    // legfeljebb a max. ablakon belül (lassan a tiltás a max. ablaknál megáll)
+    if (i > 8 && host_test_rand(&rng) % 5 == 0) {
+      double offsetUs = periodUs * 0.2 < DEBOUNCE_MAX_US * 0.9 ? periodUs * 0.2 : DEBOUNCE_MAX_US * 0.9;
+      int64_t late = t + (int64_t)offsetUs;
+      if (late - t >= DEBOUNCE_MIN_US) {
+        CHECK(!debounce_edge(&s, &config, late));
+        early++;
+      }
+    }
+  }
+  CHECK_EQ(accepted, pulses);
+  CHECK_EQ(s.accepted, pulses);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_CHATTER], chatter);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_EARLY], early);
+  CHECK_EQ(s.rejected[DEBOUNCE_REJECT_COLD], 0);
+  CHECK(early > 100);
+}
+
+int main(void) {
+  test_chatter();
+  test_cold();
+  test_early();
+  test_lockout_adaptation();
+  test_bouncy_ride();
+  return host_test_done("test_debounce");
+}
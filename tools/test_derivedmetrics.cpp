@@ -0,0 +1,185 @@
+// test_derivedmetrics.cpp
+// A gyorsulás és becsült teljesítmény a config.h beállításaival:
+//  - a mintánként frissülő regressziós összegek minden lépésben egyeznek a
+//    teljes ablak újraszámolásával (véletlen mintaköz, megállások, hosszú menet);
+//  - DERIVED_MAX_RATE_HZ mintasűrűségig a teljes DERIVED_WINDOW_MS ablak a
+//    pufferben marad, sűrűbb mintáknál a csonkolás számlálódik;
+//  - szimulált profil -> sebességbecslő -> metrikák lánc: rámpákon a profil
+//    gyorsulása, tartáson a gördülési + légellenállás teljesítménye.
+#include "config.h"
+#include "derivedmetrics.h"
+#include "hosttest.h"
+#include "speedestimator.h"
+
+static const DerivedConfig_t config = {
+    RIDER_MASS_KG, ROLLING_CRR, DRAG_CDA_M2, AIR_DENSITY_KGM3, (int64_t)DERIVED_WINDOW_MS * 1000};
+
+// Referencia: a puffer ablakon belüli mintáinak teljes újraszámolása
+static double reference_slope(const DerivedMetrics_t *dm, int64_t nowUs, int *inWindow) {
+  double sumT = 0.0, sumV = 0.0, sumTT = 0.0, sumTV = 0.0;
+  int n = 0;
+  for (int i = 0; i < dm->count; i++) {
+    int idx = (dm->head + DERIVED_MAX_SAMPLES - 1 - i) % DERIVED_MAX_SAMPLES;
+    int64_t age = nowUs - dm->sampleUs[idx];
+    if (age > dm->config.windowUs) break;
+    double t = -age * 1e-6;
+    double v = dm->speedMps[idx];
+    sumT += t;
+    sumV += v;
+    sumTT += t * t;
+    sumTV += t * v;
+    n++;
+  }
+  *inWindow = n;
+  if (n < 2) return 0.0;
+  double denom = n * sumTT - sumT * sumT;
+  if (denom <= 0.0) return 0.0;
+  return (n * sumTV - sumT * sumV) / denom;
+}
+
+static double steady_power(double kmh) {
+  double v = kmh / 3.6;
+  return v * (RIDER_MASS_KG * 9.81 * ROLLING_CRR + 0.5 * AIR_DENSITY_KGM3 * DRAG_CDA_M2 * v * v);
+}
+
+// Véletlen mintaköz (2-250 ms), zajos sebesség, időnként megállás, 30 perc
+static void test_incremental_matches_reference(void) {
+  DerivedMetrics_t dm;
+  derived_metrics_init(&dm, &config);
+  uint32_t rng = 2024;
+  int64_t t = 5000000;
+  double kmh = 20.0;
+  int mismatches = 0, countMismatches = 0, resets = 0;
+  double worst = 0.0;
+  while (t < 5000000 + 1800LL * 1000000) {
+    t += 2000 + host_test_rand(&rng) % 248000;
+    kmh += ((int)(host_test_rand(&rng) % 2001) - 1000) / 1000.0;
+    if (kmh < 0) kmh = 0;
+    if (kmh > 60) kmh = 60;
+    if (host_test_rand(&rng) % 2000 == 0) {
+      derived_metrics_reset(&dm);
+      resets++;
+      continue;
+    }
+    derived_metrics_sample(&dm, t, kmh);
+    int inWindow;
+    double ref = reference_slope(&dm, t, &inWindow);
+    double err = fabs(dm.accelerationMps2 - ref);
+    if (err > worst) worst = err;
+    if (err > 1e-6 * (1 + fabs(ref))) mismatches++;
+    if (inWindow != dm.count) countMismatches++;
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(countMismatches, 0);
+  CHECK(worst < 1e-6);
+  CHECK(resets > 0);
+  CHECK_EQ(dm.truncatedSamples, 0);
+}
+
+// Egyenes vonal: a meredekség pontos, a mintasűrűségtől függetlenül
+static void check_window_coverage(int rateHz, bool expectTruncation) {
+  DerivedMetrics_t dm;
+  derived_metrics_init(&dm, &config);
+  const int64_t stepUs = 1000000 / rateHz;
+  const double accel = 0.8; // m/s^2
+  int64_t t = 1000000;
+  for (int i = 0; i < 5 * rateHz; i++, t += stepUs) {
+    derived_metrics_sample(&dm, t, (5.0 + accel * i * stepUs * 1e-6) * 3.6);
+  }
+  CHECK_NEAR(dm.accelerationMps2, accel, 1e-4);
+  int64_t spanUs = dm.sampleUs[(dm.head + DERIVED_MAX_SAMPLES - 1) % DERIVED_MAX_SAMPLES] -
+                   dm.sampleUs[(dm.head + DERIVED_MAX_SAMPLES - dm.count) % DERIVED_MAX_SAMPLES];
+  if (expectTruncation) {
+    CHECK(dm.truncatedSamples > 0);
+    CHECK_EQ(dm.count, DERIVED_MAX_SAMPLES);
+    CHECK(spanUs < config.windowUs - stepUs);
+  } else {
+    CHECK_EQ(dm.truncatedSamples, 0);
+    CHECK(spanUs > config.windowUs - stepUs);
+  }
+}
+
+static void test_window_coverage(void) {
+  check_window_coverage(10, false);
+  check_window_coverage(DERIVED_MAX_RATE_HZ, false);
+  check_window_coverage(2 * DERIVED_MAX_RATE_HZ, true);
+}
+
+// Sebességprofil szakasz: kezdő és záró sebesség, hossz
+typedef struct {
+  double startKmh, endKmh;
+  uint32_t durationMs;
+} Segment_t;
+
+// A profil gyorsulása m/s^2-ben az adott szakaszon
+static double segment_accel(const Segment_t *s) {
+  return (s->endKmh - s->startKmh) / 3.6 / (s->durationMs / 1000.0);
+}
+
+// Impulzusidők a profilból: 100 us lépésenként integrált út, egy impulzus
+// minden pulseM megtett méter után
+static void profile_pulses(const Segment_t *profile, size_t count, double pulseM, int64_t startUs,
+                           int64_t *out, size_t cap, size_t *n) {
+  const int64_t stepUs = 100;
+  double sinceM = 0.0;
+  int64_t t = startUs;
+  *n = 0;
+  for (size_t i = 0; i < count; i++) {
+    for (int64_t e = 0; e < (int64_t)profile[i].durationMs * 1000; e += stepUs, t += stepUs) {
+      double kmh = profile[i].startKmh + (profile[i].endKmh - profile[i].startKmh) * e / (profile[i].durationMs * 1000.0);
+      sinceM += kmh / 3.6 * stepUs * 1e-6;
+      if (sinceM >= pulseM && *n < cap) {
+        out[(*n)++] = t;
+        sinceM -= pulseM;
+      }
+    }
+  }
+}
+
+// Szimulált menet a firmware láncán: impulzusonként becslés, majd metrikák
+static void test_profile_trace(void) {
+  static const Segment_t profile[] = {
+      {0, 0, 1000}, {0, 30, 12000}, {30, 30, 15000}, {30, 10, 8000}, {10, 10, 6000},
+  };
+  static int64_t pulses[1000];
+  size_t pulseCount;
+  profile_pulses(profile, sizeof(profile) / sizeof(profile[0]), 2.1 / 2, 1000000, pulses,
+                 sizeof(pulses) / sizeof(pulses[0]), &pulseCount);
+
+  static const SpeedEstimatorConfig_t estConfig = {
+      SPEED_EST_LEARN_ALPHA, SPEED_EST_STEADY_PCT / 100.0, SPEED_EST_COMBINE_PCT / 100.0,
+      SPEED_EST_STOP_US, SPEED_EST_SLIP_PCT / 100.0};
+  SpeedEstimator_t est;
+  speed_estimator_init(&est, &estConfig, 2, 2.1);
+  DerivedMetrics_t dm;
+  derived_metrics_init(&dm, &config);
+
+  // Ellenőrzés a szakaszok közepén, a regressziós ablak már a szakaszon belül van
+  const int64_t checksUs[] = {9000000, 22000000, 24000000, 33000000, 40000000};
+  const int segmentOf[] = {1, 2, 2, 3, 4};
+  size_t next = 0;
+  for (size_t i = 0; i < pulseCount && next < sizeof(checksUs) / sizeof(checksUs[0]); i++) {
+    int64_t edgeUs = pulses[i];
+    double kmh = speed_estimator_pulse(&est, edgeUs);
+    if (kmh <= 0.0) continue;
+    derived_metrics_sample(&dm, edgeUs, kmh);
+    if (edgeUs - 1000000 < checksUs[next]) continue;
+
+    const Segment_t *seg = &profile[segmentOf[next]];
+    double accel = segment_accel(seg);
+    CHECK_NEAR(dm.accelerationMps2, accel, 0.05);
+    if (accel == 0.0) CHECK_NEAR(dm.powerW, steady_power(seg->startKmh), 0.03 * steady_power(seg->startKmh));
+    if (accel < -0.5) CHECK_EQ(dm.powerW, 0);
+    if (accel > 0.0) CHECK(dm.powerW > steady_power(kmh));
+    next++;
+  }
+  CHECK_EQ(next, sizeof(checksUs) / sizeof(checksUs[0]));
+  CHECK_EQ(dm.truncatedSamples, 0);
+}
+
+int main(void) {
+  test_incremental_matches_reference();
+  test_window_coverage();
+  test_profile_trace();
+  return host_test_done("test_derivedmetrics");
+}
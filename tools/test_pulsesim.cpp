@@ -0,0 +1,222 @@
+// test_pulsesim.cpp
+// A REED impulzus generátor profilokkal és visszajátszással:
+//  - rámpák, tartások és megállás: a valódi élek száma a profil megtett
+//    útjából, tartáson az intervallum az út/sebesség, megállás alatt nincs él;
+//  - pergéssel az élsorozat szigorúan monoton, a pergő élek a saját zárásuk
+//    után a tartományon belül vannak, és nem változtatják a valódi éleket;
+//  - kimaradó impulzusok: kiadott + elnyelt = a kimaradás nélküli élszám;
+//  - intervallum és kódolt (pulsecodec) visszajátszás: az élközök és a
+//    visszajátszott sebesség a rögzítettel egyezik, körbe is.
+#include <string.h>
+#include <vector>
+#include "hosttest.h"
+#include "pulsecodec.h"
+#include "pulsesim.h"
+
+static const int64_t startUs = 1000000;
+
+// 0 -> 30 km/h 10 s alatt, 20 s tartás, 30 -> 0 10 s alatt, 5 s állás, 0 -> 20 km/h 5 s alatt
+static const PulseSimSegment_t rideProfile[] = {
+    {0, 30, 10000}, {30, 30, 20000}, {30, 0, 10000}, {0, 0, 5000}, {0, 20, 5000},
+};
+
+static PulseSimConfig_t profile_config(uint8_t pulsesPerRev) {
+  PulseSimConfig_t c = {};
+  c.segments = rideProfile;
+  c.segmentCount = sizeof(rideProfile) / sizeof(rideProfile[0]);
+  c.circumferenceM = 2.1;
+  c.pulsesPerRev = pulsesPerRev;
+  c.seed = 99;
+  return c;
+}
+
+// Valódi élek; a pergő élek külön listába
+static std::vector<int64_t> run(const PulseSimConfig_t &c, std::vector<int64_t> *bounces = NULL,
+                                PulseSim_t *out = NULL) {
+  PulseSim_t sim;
+  pulsesim_init(&sim, &c, startUs);
+  std::vector<int64_t> real;
+  int64_t t;
+  bool bounce;
+  while (pulsesim_next(&sim, &t, &bounce)) {
+    if (bounce) {
+      if (bounces) bounces->push_back(t);
+    } else {
+      real.push_back(t);
+    }
+  }
+  if (out) *out = sim;
+  return real;
+}
+
+static void check_profile_edges(uint8_t pulsesPerRev) {
+  PulseSimConfig_t c = profile_config(pulsesPerRev);
+  PulseSim_t sim;
+  std::vector<int64_t> edges = run(c, NULL, &sim);
+
+  // Megtett út: rámpán az átlagsebesség, tartáson a sebesség szorozva az idővel
+  double distanceM = 0.0;
+  for (const PulseSimSegment_t &s : rideProfile) {
+    distanceM += (s.startKmh + s.endKmh) / 2 / 3.6 * s.durationMs / 1000.0;
+  }
+  double pulseM = c.circumferenceM / pulsesPerRev;
+  CHECK_EQ(edges.size(), (size_t)floor(distanceM / pulseM));
+  CHECK_EQ(sim.realEdges, edges.size());
+  CHECK_EQ(sim.bounceEdgesOut, 0);
+  CHECK_EQ(sim.missedPulses, 0);
+
+  int inStop = 0, badHold = 0, nonMonotonic = 0;
+  const double holdIntervalUs = pulseM / (30.0 / 3.6) * 1e6;
+  for (size_t i = 0; i < edges.size(); i++) {
+    int64_t rel = edges[i] - startUs;
+    if (i > 0 && edges[i] <= edges[i - 1]) nonMonotonic++;
+    // A megállás (40-45 s) alatt nincs él; a lassító rámpa utolsó éle előtte van
+    if (rel > 40000000 && rel < 45000000) inStop++;
+    // Tartás közepén az intervallum állandó (1 us kerekítés)
+    if (rel > 12000000 && rel < 29000000 && i > 0 && edges[i - 1] - startUs > 11000000) {
+      if (fabs((double)(edges[i] - edges[i - 1]) - holdIntervalUs) > 1.0) badHold++;
+    }
+  }
+  CHECK_EQ(inStop, 0);
+  CHECK_EQ(badHold, 0);
+  CHECK_EQ(nonMonotonic, 0);
+
+  // Rámpán az intervallum a sebességgel fordítva arányos: gyorsításkor csökken
+  int rampNotShrinking = 0;
+  for (size_t i = 2; i < edges.size() && edges[i] - startUs < 10000000; i++) {
+    if (edges[i] - edges[i - 1] >= edges[i - 1] - edges[i - 2]) rampNotShrinking++;
+  }
+  CHECK_EQ(rampNotShrinking, 0);
+}
+
+static void test_profile_edges(void) {
+  check_profile_edges(1);
+  check_profile_edges(4);
+}
+
+// Pergés: a valódi élek változatlanok, a teljes sorozat szigorúan monoton
+static void check_bounce(uint16_t permille, uint8_t edgesPerClose, uint32_t spanUs) {
+  PulseSimConfig_t clean = profile_config(8);
+  std::vector<int64_t> reference = run(clean);
+
+  PulseSimConfig_t c = clean;
+  c.bouncePermille = permille;
+  c.bounceEdges = edgesPerClose;
+  c.bounceSpanUs = spanUs;
+  PulseSim_t sim;
+  pulsesim_init(&sim, &c, startUs);
+  std::vector<int64_t> real;
+  int64_t t, prev = 0, lastReal = 0;
+  bool bounce;
+  int nonMonotonic = 0, outsideSpan = 0, bounces = 0;
+  while (pulsesim_next(&sim, &t, &bounce)) {
+    if (t <= prev) nonMonotonic++;
+    prev = t;
+    if (bounce) {
+      bounces++;
+      if (t <= lastReal || t > lastReal + spanUs + edgesPerClose) outsideSpan++;
+    } else {
+      real.push_back(t);
+      lastReal = t;
+    }
+  }
+  CHECK(real == reference);
+  CHECK_EQ(nonMonotonic, 0);
+  CHECK_EQ(outsideSpan, 0);
+  CHECK_EQ(bounces, sim.bounceEdgesOut);
+  if (permille == 1000 && spanUs < 5000) CHECK_EQ(bounces, (int)reference.size() * edgesPerClose);
+  else CHECK(bounces > 0);
+}
+
+static void test_bounce(void) {
+  check_bounce(1000, 3, 1500);
+  check_bounce(300, PULSESIM_MAX_BOUNCE, 4000);
+  // A pergés tovább tartana, mint a következő zárás: a zárás megszakítja
+  check_bounce(1000, 4, 200000);
+}
+
+// Kimaradás: az út megtörténik, csak az él hiányzik
+static void test_missed(void) {
+  PulseSimConfig_t clean = profile_config(2);
+  std::vector<int64_t> reference = run(clean);
+  PulseSimConfig_t c = clean;
+  c.missPermille = 100;
+  PulseSim_t sim;
+  std::vector<int64_t> edges = run(c, NULL, &sim);
+  CHECK_EQ(edges.size() + sim.missedPulses, reference.size());
+  CHECK(sim.missedPulses > 0);
+  // Minden kiadott él a kimaradás nélküli sorozat egy eleme
+  size_t j = 0, foreign = 0;
+  for (int64_t e : edges) {
+    while (j < reference.size() && reference[j] < e) j++;
+    if (j == reference.size() || reference[j] != e) foreign++;
+  }
+  CHECK_EQ(foreign, 0);
+}
+
+static const uint32_t recorded[] = {420000, 400000, 380000, 365000, 350000, 350000, 352000,
+                                    360000, 390000, 450000, 600000, 900000};
+static const size_t recordedCount = sizeof(recorded) / sizeof(recorded[0]);
+
+static void check_replay(PulseSimConfig_t c, const char *what) {
+  c.circumferenceM = 2.1;
+  c.pulsesPerRev = 1;
+  c.loop = true;
+  PulseSim_t sim;
+  pulsesim_init(&sim, &c, startUs);
+  int64_t t, prev = startUs;
+  bool bounce;
+  int badInterval = 0, badSpeed = 0;
+  size_t emitted = 0;
+  // Két teljes kör: a hurok a végén újrakezd
+  for (; emitted < 2 * recordedCount && pulsesim_next(&sim, &t, &bounce); emitted++) {
+    uint32_t expected = recorded[emitted % recordedCount];
+    if (t - prev != expected) badInterval++;
+    double kmh = 2.1 / expected * 3.6e6;
+    if (fabs(pulsesim_speed_kmh(&sim) - kmh) > 1e-9 * kmh) badSpeed++;
+    prev = t;
+  }
+  if (badInterval || badSpeed) fprintf(stderr, "%s replay mismatch\n", what);
+  CHECK_EQ(emitted, 2 * recordedCount);
+  CHECK_EQ(badInterval, 0);
+  CHECK_EQ(badSpeed, 0);
+}
+
+static void collect_blocks(const uint8_t *block, uint16_t length, void *ctx) {
+  std::vector<uint8_t> *out = (std::vector<uint8_t> *)ctx;
+  out->insert(out->end(), block, block + length);
+}
+
+static void test_replay(void) {
+  PulseSimConfig_t raw = {};
+  raw.intervalsUs = recorded;
+  raw.intervalCount = recordedCount;
+  check_replay(raw, "interval");
+
+  // Kódolt napló: abszolút időbélyegek pulsecodec blokkokban, az első csak alapidő
+  std::vector<uint8_t> encoded;
+  PulseEncoder_t enc;
+  pulse_encoder_init(&enc, collect_blocks, &encoded);
+  int64_t t = 5000000;
+  pulse_encoder_add(&enc, t);
+  for (size_t i = 0; i < recordedCount; i++) pulse_encoder_add(&enc, t += recorded[i]);
+  pulse_encoder_flush(&enc);
+  PulseSimConfig_t coded = {};
+  coded.encoded = encoded.data();
+  coded.encodedBytes = encoded.size();
+  check_replay(coded, "encoded");
+
+  // Hurok nélkül a visszajátszás a rögzített intervallumok után véget ér
+  raw.loop = false;
+  raw.circumferenceM = 2.1;
+  raw.pulsesPerRev = 1;
+  CHECK_EQ(run(raw).size(), recordedCount);
+}
+
+int main(void) {
+  test_profile_edges();
+  test_bounce();
+  test_missed();
+  test_replay();
+  return host_test_done("test_pulsesim");
+}
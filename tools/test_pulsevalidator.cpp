@@ -0,0 +1,242 @@
+// test_pulsevalidator.cpp
+// Az impulzusfolyam validátor szimulált kerékkel (egyenetlen mágnesívek), a
+// config.h PULSE_VALID_* beállításaival:
+//  - normál menetben (gyorsítás, fékezés, időbélyeg zaj) nincs javítás;
+//  - egy vagy két kimaradt impulzus gyors menetben azonnal pótlódik, a
+//    pótolt időbélyegek egyenletesen osztják az intervallumot;
+//  - lassú menetben a kimaradást a következő impulzus utólag erősíti meg,
+//    valódi lassításnál nem;
+//  - rezgésből eredő fölös impulzus eldobódik, a fázis nem csúszik el;
+//  - lehetetlen gyorsulás mintázat nélkül IMPLAUSIBLE, pótlás nélkül.
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "hosttest.h"
+#include "pulsevalidator.h"
+
+static const PulseValidatorConfig_t config = {
+    PULSE_VALID_MAX_ACCEL_MPS2, PULSE_VALID_MATCH_PCT / 100.0, PULSE_VALID_PHANTOM_PCT / 100.0,
+    PULSE_VALID_MAX_MISSED, SPEED_EST_STOP_US};
+
+static const double circumferenceM = 2.1;
+
+// Szimulált kerék: az i. mágnes impulzusa az (i-1). mágnestől arcs[i] ív után
+typedef struct {
+  const double *arcs;
+  uint8_t magnets;
+  uint8_t magnet; // Az utolsó impulzus mágnese
+  double t;       // us
+} Wheel_t;
+
+static const double two[2] = {0.42, 0.58};
+static const double four[4] = {0.22, 0.28, 0.24, 0.26};
+
+static int64_t wheel_next(Wheel_t *w, double kmh) {
+  w->magnet = (w->magnet + 1) % w->magnets;
+  w->t += w->arcs[w->magnet] * circumferenceM / (kmh / 3.6) * 1e6;
+  return (int64_t)w->t;
+}
+
+static void start(PulseValidator_t *v, Wheel_t *w, const double *arcs, uint8_t magnets) {
+  pulse_validator_init(v, &config, magnets, circumferenceM);
+  w->arcs = arcs;
+  w->magnets = magnets;
+  w->magnet = magnets - 1;
+  w->t = 1000000.0;
+  pulse_validator_pulse(v, (int64_t)w->t);
+}
+
+// Egyenletes haladás; visszatér a nem OK ítéletek számával
+static int ride_steady(PulseValidator_t *v, Wheel_t *w, double kmh, int pulses) {
+  int corrected = 0;
+  for (int i = 0; i < pulses; i++) {
+    if (pulse_validator_pulse(v, wheel_next(w, kmh)).verdict != PULSE_VALID_OK) corrected++;
+  }
+  return corrected;
+}
+
+static void check_clean_stats(const PulseValidator_t *v) {
+  CHECK_EQ(v->stats.missed, 0);
+  CHECK_EQ(v->stats.lateMissed, 0);
+  CHECK_EQ(v->stats.phantom, 0);
+  CHECK_EQ(v->stats.implausible, 0);
+}
+
+// Indulás, gyorsítás 2 m/s^2-tel, utazás, fékezés 4 m/s^2-tel megállásig,
+// +-20 us időbélyeg zajjal: egyetlen javítás sem
+static void check_normal_ride(const double *arcs, uint8_t magnets) {
+  PulseValidator_t v;
+  Wheel_t w;
+  start(&v, &w, arcs, magnets);
+  uint32_t seed = 7u * magnets;
+  double mps = 1.5;
+  int notOk = 0, pulses = 0;
+  for (int phase = 0; phase < 3; phase++) {
+    double accel = phase == 0 ? 2.0 : phase == 1 ? 0.0 : -4.0;
+    int count = phase == 1 ? 300 : 100000;
+    for (int i = 0; i < count; i++) {
+      double arcM = arcs[(w.magnet + 1) % magnets] * circumferenceM;
+      // Egyenletes gyorsulás az íven: s = v*t + a*t^2/2
+      double dtS = accel == 0.0 ? arcM / mps
+                                : (sqrt(mps * mps + 2 * accel * arcM) - mps) / accel;
+      if (phase == 0 && mps >= 35.0 / 3.6) break;
+      if (phase == 2 && (mps * mps + 2 * accel * arcM <= 2.0 * 2.0)) break; // ~2 m/s alatt megáll
+      mps += accel * dtS;
+      w.magnet = (w.magnet + 1) % magnets;
+      w.t += dtS * 1e6;
+      int64_t noise = (int64_t)(host_test_rand(&seed) % 41) - 20;
+      if (pulse_validator_pulse(&v, (int64_t)w.t + noise).verdict != PULSE_VALID_OK) notOk++;
+      pulses++;
+    }
+  }
+  CHECK(pulses > 100);
+  CHECK_EQ(notOk, 0);
+  CHECK_EQ(v.stats.checked, pulses);
+  check_clean_stats(&v);
+}
+
+static void test_normal_riding(void) {
+  check_normal_ride(two, 2);
+  check_normal_ride(four, 4);
+  static const double one[1] = {1.0};
+  check_normal_ride(one, 1);
+}
+
+// Gyors menetben a kimaradás lehetetlen lassulás: azonnali pótlás
+static void check_missed(const double *arcs, uint8_t magnets, uint8_t skip) {
+  PulseValidator_t v;
+  Wheel_t w;
+  start(&v, &w, arcs, magnets);
+  CHECK_EQ(ride_steady(&v, &w, 25.0, 10 * magnets), 0);
+
+  int64_t prev = (int64_t)w.t;
+  int64_t expected[PULSE_VALID_MAX_MISSED];
+  for (uint8_t i = 0; i < skip; i++) expected[i] = wheel_next(&w, 25.0);
+  int64_t now = wheel_next(&w, 25.0);
+  PulseCheck_t check = pulse_validator_pulse(&v, now);
+  CHECK_EQ(check.verdict, PULSE_VALID_MISSED);
+  CHECK_EQ(check.missedPulses, skip);
+  CHECK_EQ(check.lateMissed, 0);
+  CHECK_EQ(v.stats.missed, skip);
+  // A pótolt időbélyegek az intervallumot egyenlően osztják, az elmaradt
+  // valódi élektől legfeljebb a két ív különbségével térnek el
+  for (uint8_t m = 1; m <= skip; m++) {
+    int64_t t = pulse_validator_interpolate(prev, now, skip, m);
+    CHECK_EQ(t, prev + (now - prev) * m / (skip + 1));
+    CHECK(t > prev && t < now);
+    CHECK(llabs(t - expected[m - 1]) < (now - prev) / 4);
+  }
+  // A fázis nem csúszott el: a folytatás javítás nélkül
+  CHECK_EQ(ride_steady(&v, &w, 25.0, 10 * magnets), 0);
+  CHECK_EQ(v.stats.missed, skip);
+  CHECK_EQ(v.stats.phantom, 0);
+  CHECK_EQ(v.stats.implausible, 0);
+}
+
+static void test_missed_pulse(void) {
+  check_missed(two, 2, 1);
+  check_missed(four, 4, 1);
+  check_missed(four, 4, 2);
+}
+
+// Lassú menetben a kétszeres intervallum lassítás is lehet: a következő
+// impulzus dönt. Visszaálló tempónál utólag pótol (csak távolság).
+static void test_late_missed(void) {
+  PulseValidator_t v;
+  Wheel_t w;
+  start(&v, &w, two, 2);
+  CHECK_EQ(ride_steady(&v, &w, 6.0, 20), 0);
+
+  wheel_next(&w, 6.0); // Kimarad
+  PulseCheck_t check = pulse_validator_pulse(&v, wheel_next(&w, 6.0));
+  CHECK_EQ(check.verdict, PULSE_VALID_OK);
+  CHECK_EQ(check.missedPulses, 0);
+  CHECK_EQ(v.pendingMissed, 1);
+  CHECK_EQ(v.stats.missed, 0);
+
+  check = pulse_validator_pulse(&v, wheel_next(&w, 6.0));
+  CHECK_EQ(check.verdict, PULSE_VALID_OK);
+  CHECK_EQ(check.lateMissed, 1);
+  CHECK_EQ(v.stats.missed, 1);
+  CHECK_EQ(v.stats.lateMissed, 1);
+  CHECK_EQ(v.pendingMissed, 0);
+  CHECK_EQ(ride_steady(&v, &w, 6.0, 20), 0);
+  CHECK_EQ(v.stats.missed, 1);
+
+  // Valódi lassítás felére: a hosszú intervallum marad, nincs utólagos pótlás
+  start(&v, &w, two, 2);
+  CHECK_EQ(ride_steady(&v, &w, 6.0, 20), 0);
+  pulse_validator_pulse(&v, wheel_next(&w, 3.0));
+  check = pulse_validator_pulse(&v, wheel_next(&w, 3.0));
+  CHECK_EQ(check.lateMissed, 0);
+  ride_steady(&v, &w, 3.0, 20);
+  CHECK_EQ(v.stats.missed, 0);
+  CHECK_EQ(v.stats.lateMissed, 0);
+}
+
+// Rezgés: a jóslat töredékénél érkező él eldobódik, az állapot nem változik
+static void test_phantom_pulse(void) {
+  PulseValidator_t v;
+  Wheel_t w;
+  start(&v, &w, four, 4);
+  CHECK_EQ(ride_steady(&v, &w, 25.0, 40), 0);
+
+  int64_t last = (int64_t)w.t;
+  int64_t next = wheel_next(&w, 25.0);
+  PulseValidator_t before = v;
+  PulseCheck_t check = pulse_validator_pulse(&v, last + (next - last) * 3 / 10);
+  CHECK_EQ(check.verdict, PULSE_VALID_PHANTOM);
+  CHECK_EQ(v.stats.phantom, 1);
+  CHECK_EQ(v.lastUs, before.lastUs);
+  CHECK(memcmp(v.historyUs, before.historyUs, sizeof(v.historyUs)) == 0);
+
+  // Nem monoton időbélyeg is fantom
+  check = pulse_validator_pulse(&v, last);
+  CHECK_EQ(check.verdict, PULSE_VALID_PHANTOM);
+  CHECK_EQ(v.stats.phantom, 2);
+
+  // A valódi impulzus az utolsó elfogadottól számít, nincs téves kimaradás
+  check = pulse_validator_pulse(&v, next);
+  CHECK_EQ(check.verdict, PULSE_VALID_OK);
+  CHECK_EQ(ride_steady(&v, &w, 25.0, 40), 0);
+  CHECK_EQ(v.stats.missed, 0);
+  CHECK_EQ(v.stats.implausible, 0);
+}
+
+// Lehetetlen gyorsulás, amely sem kimaradás, sem fantom mintázat: elfogadva,
+// de IMPLAUSIBLE (a hívó nem rögzíti csúcssebességként)
+static void test_implausible_accel(void) {
+  PulseValidator_t v;
+  Wheel_t w;
+  start(&v, &w, two, 2);
+  CHECK_EQ(ride_steady(&v, &w, 20.0, 20), 0);
+
+  int64_t last = (int64_t)w.t;
+  int64_t next = wheel_next(&w, 20.0);
+  w.t = (double)(last + (next - last) * 6 / 10); // A 0,6-szoros intervallum ~33 km/h
+  PulseCheck_t check = pulse_validator_pulse(&v, (int64_t)w.t);
+  CHECK_EQ(check.verdict, PULSE_VALID_IMPLAUSIBLE);
+  CHECK_EQ(check.missedPulses, 0);
+  CHECK_EQ(v.stats.implausible, 1);
+  CHECK_EQ(v.stats.missed, 0);
+  CHECK_EQ(v.stats.phantom, 0);
+  CHECK_EQ(v.lastUs, (int64_t)w.t);
+
+  // Megállás (SPEED_EST_STOP_US fölötti szünet) után nincs mihez mérni: OK
+  start(&v, &w, two, 2);
+  ride_steady(&v, &w, 20.0, 20);
+  w.t += SPEED_EST_STOP_US + 1000;
+  check = pulse_validator_pulse(&v, (int64_t)w.t);
+  CHECK_EQ(check.verdict, PULSE_VALID_OK);
+  CHECK_EQ(v.historyCount, 0);
+  check_clean_stats(&v);
+}
+
+int main(void) {
+  test_normal_riding();
+  test_missed_pulse();
+  test_late_missed();
+  test_phantom_pulse();
+  test_implausible_accel();
+  return host_test_done("test_pulsevalidator");
+}
@@ -0,0 +1,407 @@
+// test_rideexport.cpp
+// A FIT/GPX export szintetikus menetnaplóból (pulsesim profil, GPS fixekkel),
+// páratlan méretű darabokban olvasva:
+//  - FIT: fejléc, fejléc CRC és teljes fájl CRC (független, bitenkénti
+//    CRC-16 számolással), az előre közölt hossz, minden adatüzenet előtt a
+//    helyi típus definíciója, az üzenetek sorrendje és a rekord mezők
+//    (monoton idő és táv, pozíció, az összesítők a rekordokkal egyeznek);
+//  - a nyers (1) és kódolt (2) naplóváltozat azonos kimenetet ad;
+//  - GPX: kiegyensúlyozott elemek, fixenként egy trkpt pozícióval, idővel és
+//    az impulzusokból számolt sebességgel;
+//  - a kimenet bájtra egyezik a fixtures/ride.fit és ride.gpx fájlokkal,
+//    amelyek külső olvasóval (fitparse, gpxpy) is ellenőrizhetők:
+//    python3 fixtures/check.py. Szándékos formátumváltozás után:
+//    ./test_rideexport --update
+#include <string.h>
+#include <string>
+#include <vector>
+#include "hosttest.h"
+#include "pulsecodec.h"
+#include "pulsesim.h"
+#include "rideexport.h"
+#include "ridelogformat.h"
+
+#define FIXTURE_FIT "fixtures/ride.fit"
+#define FIXTURE_GPX "fixtures/ride.gpx"
+
+static const uint32_t startEpoch = 1780000000;
+static const int64_t firstPulseUs = 1000000;
+static const double circumferenceM = 2.1;
+
+// 0 -> 25 km/h, tartás, megállás 20 s-ig, újraindulás és lassítás: kb. 2 perc
+static const PulseSimSegment_t profile[] = {
+    {0, 25, 15000}, {25, 25, 40000}, {25, 0, 10000}, {0, 0, 20000}, {0, 30, 10000}, {30, 30, 20000}, {30, 0, 8000},
+};
+
+static std::vector<int64_t> ride_pulses(void) {
+  PulseSimConfig_t c = {};
+  c.segments = profile;
+  c.segmentCount = sizeof(profile) / sizeof(profile[0]);
+  c.circumferenceM = circumferenceM;
+  c.pulsesPerRev = 1;
+  c.seed = 3;
+  PulseSim_t sim;
+  pulsesim_init(&sim, &c, firstPulseUs);
+  std::vector<int64_t> pulses;
+  int64_t t;
+  bool bounce;
+  while (pulsesim_next(&sim, &t, &bounce)) pulses.push_back(t);
+  return pulses;
+}
+
+static void collect_blocks(const uint8_t *block, uint16_t length, void *ctx) {
+  std::vector<uint8_t> *out = (std::vector<uint8_t> *)ctx;
+  out->insert(out->end(), block, block + length);
+}
+
+// Napló fejléccel, a firmware flash formátumában
+static std::vector<uint8_t> build_log(const std::vector<int64_t> &pulses, uint16_t version) {
+  std::vector<uint8_t> data;
+  if (version == RIDE_LOG_VERSION_RAW32) {
+    for (size_t i = 1; i < pulses.size(); i++) {
+      uint32_t dt = (uint32_t)(pulses[i] - pulses[i - 1]);
+      data.resize(data.size() + sizeof(dt));
+      memcpy(data.data() + data.size() - sizeof(dt), &dt, sizeof(dt));
+    }
+  } else {
+    PulseEncoder_t enc;
+    pulse_encoder_init(&enc, collect_blocks, &data);
+    for (int64_t t : pulses) pulse_encoder_add(&enc, t);
+    pulse_encoder_flush(&enc);
+  }
+  RideLogHeader_t h = {};
+  h.magic = RIDE_LOG_MAGIC;
+  h.version = version;
+  h.headerSize = sizeof(h);
+  h.logSeq = 7;
+  h.startEpoch = startEpoch;
+  h.firstPulseUs = pulses[0];
+  h.dataBytes = data.size();
+  h.wheelMm = (uint16_t)(circumferenceM * 1000.0 + 0.5);
+  h.pulsesPerRev = 1;
+  std::vector<uint8_t> log(sizeof(h) + data.size());
+  memcpy(log.data(), &h, sizeof(h));
+  memcpy(log.data() + sizeof(h), data.data(), data.size());
+  return log;
+}
+
+// GPS fixek 2 s-onként egy észak-keleti egyenesen, az első 5 s-ban még nincs fix
+typedef struct {
+  uint32_t next;
+  uint32_t count;
+} Fixes_t;
+
+static const uint32_t fixStartS = 5, fixStepS = 2, fixCount = 60;
+
+static bool next_fix(void *ctx, RideExportFix_t *fix) {
+  Fixes_t *f = (Fixes_t *)ctx;
+  if (f->next >= fixCount) return false;
+  uint32_t i = f->next++;
+  fix->epoch = startEpoch + fixStartS + i * fixStepS;
+  fix->latE7 = 474979000 + (int32_t)i * 1500;
+  fix->lonE7 = 190402000 + (int32_t)i * 2100;
+  f->count++;
+  return true;
+}
+
+static std::vector<uint8_t> export_log(const std::vector<uint8_t> &log, RideExportFormat_t format,
+                                       uint32_t *expectedSize, RideExport_t *state = NULL) {
+  static RideExport_t exp;
+  static Fixes_t fixes;
+  fixes = Fixes_t();
+  RideExportSource_t src = {};
+  src.log = log.data();
+  src.logBytes = log.size();
+  src.nextFix = next_fix;
+  src.fixCtx = &fixes;
+  std::vector<uint8_t> out;
+  if (!ride_export_init(&exp, format, &src)) return out;
+  *expectedSize = ride_export_size(&exp);
+  uint8_t chunk[37];
+  size_t n;
+  while ((n = ride_export_read(&exp, chunk, sizeof(chunk))) > 0) out.insert(out.end(), chunk, chunk + n);
+  if (state) *state = exp;
+  return out;
+}
+
+// --- FIT ellenőrzés, az exportertől független kóddal ---
+
+// CRC-16 (0xA001 reflektált polinom, 0 kezdőérték), bitenként
+static uint16_t crc16(const uint8_t *p, size_t n) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    for (int b = 0; b < 8; b++) crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return crc;
+}
+
+static uint32_t le(const uint8_t *p, uint8_t size) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < size; i++) v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+typedef struct {
+  bool defined;
+  uint16_t global;
+  uint8_t fieldCount;
+  uint8_t num[32], size[32], baseType[32];
+} FitDef_t;
+
+typedef struct {
+  uint16_t global;
+  std::vector<std::pair<uint8_t, uint32_t>> fields;
+} FitMsg_t;
+
+static bool field(const FitMsg_t &m, uint8_t num, uint32_t *value) {
+  for (const auto &f : m.fields) {
+    if (f.first == num) {
+      *value = f.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// A fájl üzenetekre bontva; false, ha a szerkezet hibás
+static bool parse_fit(const std::vector<uint8_t> &fit, std::vector<FitMsg_t> *msgs) {
+  FitDef_t defs[16] = {};
+  size_t end = fit.size() - 2, pos = fit[0];
+  int badDefs = 0, undefined = 0;
+  while (pos < end) {
+    uint8_t header = fit[pos++];
+    if (header & 0xA0) return false; // Tömörített időbélyeg vagy fejlesztői mezők: nem használjuk
+    FitDef_t *d = &defs[header & 0x0F];
+    if (header & 0x40) {
+      if (pos + 5 > end || fit[pos + 1] != 0) return false; // Csak little endian
+      d->defined = true;
+      d->global = le(&fit[pos + 2], 2);
+      d->fieldCount = fit[pos + 4];
+      pos += 5;
+      if (d->fieldCount > 32 || pos + 3 * d->fieldCount > end) return false;
+      for (uint8_t i = 0; i < d->fieldCount; i++, pos += 3) {
+        d->num[i] = fit[pos];
+        d->size[i] = fit[pos + 1];
+        d->baseType[i] = fit[pos + 2];
+        // Az alaptípus mérete (az alsó 4 bit a típus sorszáma) osztja a mezőméretet
+        static const uint8_t typeSize[] = {1, 1, 1, 1, 2, 2, 4, 4, 1, 4, 8, 1, 2, 4, 1, 8, 8, 8};
+        uint8_t t = d->baseType[i] & 0x1F;
+        if (t >= sizeof(typeSize) || d->size[i] == 0 || d->size[i] % typeSize[t] || d->size[i] > 4) badDefs++;
+      }
+      continue;
+    }
+    if (!d->defined) {
+      undefined++;
+      break;
+    }
+    FitMsg_t m;
+    m.global = d->global;
+    for (uint8_t i = 0; i < d->fieldCount; i++) {
+      if (pos + d->size[i] > end) return false;
+      m.fields.push_back({d->num[i], le(&fit[pos], d->size[i])});
+      pos += d->size[i];
+    }
+    msgs->push_back(m);
+  }
+  CHECK_EQ(badDefs, 0);
+  CHECK_EQ(undefined, 0);
+  return pos == end && badDefs == 0 && undefined == 0;
+}
+
+static void check_fit(const std::vector<uint8_t> &fit, uint32_t expectedSize, const RideExport_t &exp,
+                      size_t pulses) {
+  CHECK_EQ(fit.size(), expectedSize);
+  if (fit.size() < 16) return;
+  // Fejléc: 14 bájt, protokoll 2.0, adathossz, ".FIT", fejléc CRC
+  CHECK_EQ(fit[0], 14);
+  CHECK_EQ(fit[1], 0x20);
+  CHECK_EQ(le(&fit[4], 4), fit.size() - 16);
+  CHECK(memcmp(&fit[8], ".FIT", 4) == 0);
+  CHECK_EQ(le(&fit[12], 2), crc16(fit.data(), 12));
+  // Fájl CRC: a fejléccel együtt, a végén; a CRC-vel együtt számolva 0
+  CHECK_EQ(le(&fit[fit.size() - 2], 2), crc16(fit.data(), fit.size() - 2));
+  CHECK_EQ(crc16(fit.data(), fit.size()), 0);
+
+  std::vector<FitMsg_t> msgs;
+  CHECK(parse_fit(fit, &msgs));
+  // file_id, event (start), record..., event (stop), lap, session, activity
+  static const uint16_t head[] = {0, 21}, tail[] = {21, 19, 18, 34};
+  CHECK_EQ(msgs.size(), 2 + exp.records + 4);
+  if (msgs.size() != 2 + exp.records + 4) return;
+  for (size_t i = 0; i < 2; i++) CHECK_EQ(msgs[i].global, head[i]);
+  for (size_t i = 0; i < 4; i++) CHECK_EQ(msgs[msgs.size() - 4 + i].global, tail[i]);
+
+  const uint32_t fitStart = startEpoch - 631065600;
+  uint32_t v;
+  CHECK(field(msgs[0], 0, &v) && v == 4); // Tevékenység fájl
+  CHECK(field(msgs[0], 4, &v) && v == fitStart);
+
+  int notRecord = 0, badTime = 0, badDistance = 0, missingPos = 0, unexpectedPos = 0;
+  uint32_t prevTime = 0, prevDistance = 0, lastDistance = 0, lastTime = 0;
+  for (size_t i = 2; i < msgs.size() - 4; i++) {
+    const FitMsg_t &m = msgs[i];
+    if (m.global != 20) notRecord++;
+    uint32_t ts = 0, dist = 0, lat = 0, lon = 0;
+    field(m, 253, &ts);
+    field(m, 5, &dist);
+    bool hasLat = field(m, 0, &lat), hasLon = field(m, 1, &lon);
+    if (i > 2 ? ts <= prevTime : ts != fitStart) badTime++;
+    if (dist < prevDistance) badDistance++;
+    // Pozíció a fix után legfeljebb 5 s-ig; az első fix előtt érvénytelen
+    uint32_t sec = ts - fitStart;
+    bool covered = sec >= fixStartS && sec <= fixStartS + (fixCount - 1) * fixStepS + 5;
+    bool valid = hasLat && hasLon && lat != 0x7FFFFFFF && lon != 0x7FFFFFFF;
+    if (covered && !valid) missingPos++;
+    if (!covered && valid) unexpectedPos++;
+    prevTime = lastTime = ts;
+    prevDistance = lastDistance = dist;
+  }
+  CHECK_EQ(notRecord, 0);
+  CHECK_EQ(badTime, 0);
+  CHECK_EQ(badDistance, 0);
+  CHECK_EQ(missingPos, 0);
+  CHECK_EQ(unexpectedPos, 0);
+  // Táv: az első impulzustól az utolsóig (cm)
+  CHECK_NEAR(lastDistance, (pulses - 1) * circumferenceM * 100, 1.0);
+
+  // Kör és menet összesítő: a rekordok vége és táv
+  for (size_t i = msgs.size() - 3; i < msgs.size() - 1; i++) {
+    CHECK(field(msgs[i], 253, &v) && v == lastTime);
+    CHECK(field(msgs[i], 2, &v) && v == fitStart);
+    CHECK(field(msgs[i], 7, &v) && v == (lastTime - fitStart) * 1000);
+    CHECK(field(msgs[i], 9, &v) && v == lastDistance);
+    // Mozgási idő: a 20 s megállás nem számít bele
+    CHECK(field(msgs[i], 8, &v) && v < (lastTime - fitStart - 15) * 1000 && v > 60000);
+  }
+  CHECK(field(msgs[msgs.size() - 2], 5, &v) && v == 2); // Kerékpár
+}
+
+// --- GPX ellenőrzés ---
+
+static size_t count(const std::string &s, const char *needle) {
+  size_t n = 0;
+  for (size_t p = s.find(needle); p != std::string::npos; p = s.find(needle, p + 1)) n++;
+  return n;
+}
+
+// Elemek egymásba ágyazása: minden nyitó elemhez a megfelelő záró
+static bool balanced(const std::string &s) {
+  std::vector<std::string> stack;
+  for (size_t p = s.find('<'); p != std::string::npos; p = s.find('<', p + 1)) {
+    size_t e = s.find('>', p);
+    if (e == std::string::npos) return false;
+    if (s[p + 1] == '?') continue;
+    bool closing = s[p + 1] == '/';
+    std::string name = s.substr(p + 1 + closing, s.find_first_of(" >/", p + 1 + closing) - (p + 1 + closing));
+    if (s[e - 1] == '/') continue;
+    if (!closing) {
+      stack.push_back(name);
+    } else {
+      if (stack.empty() || stack.back() != name) return false;
+      stack.pop_back();
+    }
+  }
+  return stack.empty();
+}
+
+static void check_gpx(const std::vector<uint8_t> &bytes, const std::vector<int64_t> &pulses) {
+  std::string gpx(bytes.begin(), bytes.end());
+  CHECK(gpx.compare(0, 38, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>") == 0);
+  CHECK(balanced(gpx));
+  CHECK_EQ(count(gpx, "<gpx "), 1);
+  CHECK_EQ(count(gpx, "<metadata><time>2026-05-28T20:26:40Z</time></metadata>"), 1);
+  CHECK_EQ(count(gpx, "<trkseg>"), 1);
+  CHECK_EQ(count(gpx, "<trkpt "), fixCount);
+  CHECK_EQ(count(gpx, "</trkpt>"), fixCount);
+  CHECK_EQ(count(gpx, "<gpxtpx:speed>"), fixCount);
+  CHECK(gpx.size() > 7 && gpx.compare(gpx.size() - 7, 7, "</gpx>\n") == 0);
+
+  // Pontonként pozíció, idő és sebesség a profilhoz képest
+  int badPoint = 0, badSpeed = 0;
+  size_t p = 0;
+  for (uint32_t i = 0; i < fixCount; i++) {
+    p = gpx.find("<trkpt ", p + 1);
+    double lat, lon, speed;
+    int hh, mm, ss;
+    if (p == std::string::npos ||
+        sscanf(gpx.c_str() + p, "<trkpt lat=\"%lf\" lon=\"%lf\"><time>2026-05-28T%d:%d:%dZ</time>"
+                                "<extensions><gpxtpx:TrackPointExtension><gpxtpx:speed>%lf",
+               &lat, &lon, &hh, &mm, &ss, &speed) != 6) {
+      badPoint++;
+      continue;
+    }
+    uint32_t sec = (hh * 3600 + mm * 60 + ss) - (20 * 3600 + 26 * 60 + 40);
+    if (sec != fixStartS + i * fixStepS || fabs(lat - (47.4979 + i * 0.00015)) > 1e-7 ||
+        fabs(lon - (19.0402 + i * 0.00021)) > 1e-7) {
+      badPoint++;
+    }
+    // A profil sebessége (m/s) a fix idejében, a napló ideje az első impulzustól.
+    // A becslés az utolsó impulzusköz átlaga: rámpán legfeljebb az
+    // impulzusköz (út / becsült sebesség) alatti sebességváltozással tér el
+    double t = sec * 1000.0 + (pulses[0] - firstPulseUs) / 1000.0, v = 0.0, accel = 0.0;
+    for (const PulseSimSegment_t &s : profile) {
+      if (t < s.durationMs) {
+        v = (s.startKmh + (s.endKmh - s.startKmh) * t / s.durationMs) / 3.6;
+        accel = (s.endKmh - s.startKmh) / 3.6 / (s.durationMs / 1000.0);
+        break;
+      }
+      t -= s.durationMs;
+    }
+    if (v > 1.5 && (speed <= 0.0 || fabs(speed - v) > 0.02 * v + fabs(accel) * circumferenceM / speed)) badSpeed++;
+  }
+  CHECK_EQ(badPoint, 0);
+  CHECK_EQ(badSpeed, 0);
+}
+
+// --- Fixture fájlok ---
+
+static bool read_file(const char *path, std::vector<uint8_t> *out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static void check_fixture(const char *path, const std::vector<uint8_t> &out, bool update) {
+  if (update) {
+    FILE *f = fopen(path, "wb");
+    CHECK(f != NULL);
+    if (!f) return;
+    fwrite(out.data(), 1, out.size(), f);
+    fclose(f);
+    printf("%s: %zu bytes written\n", path, out.size());
+    return;
+  }
+  std::vector<uint8_t> fixture;
+  CHECK(read_file(path, &fixture));
+  if (fixture != out) fprintf(stderr, "%s differs from the exporter output\n", path);
+  CHECK(fixture == out);
+}
+
+int main(int argc, char **argv) {
+  bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+  std::vector<int64_t> pulses = ride_pulses();
+  std::vector<uint8_t> dodLog = build_log(pulses, RIDE_LOG_VERSION_DOD);
+  std::vector<uint8_t> rawLog = build_log(pulses, RIDE_LOG_VERSION_RAW32);
+
+  RideExport_t state;
+  uint32_t size = 0, rawSize = 0, gpxSize = 1;
+  std::vector<uint8_t> fit = export_log(dodLog, RIDE_EXPORT_FIT, &size, &state);
+  check_fit(fit, size, state, pulses.size());
+  CHECK(state.records > 90);
+  CHECK(export_log(rawLog, RIDE_EXPORT_FIT, &rawSize) == fit);
+  CHECK_EQ(rawSize, size);
+
+  std::vector<uint8_t> gpx = export_log(dodLog, RIDE_EXPORT_GPX, &gpxSize);
+  CHECK_EQ(gpxSize, 0);
+  check_gpx(gpx, pulses);
+  CHECK(export_log(rawLog, RIDE_EXPORT_GPX, &gpxSize) == gpx);
+
+  check_fixture(FIXTURE_FIT, fit, update);
+  check_fixture(FIXTURE_GPX, gpx, update);
+  return host_test_done("test_rideexport");
+}
@@ -0,0 +1,252 @@
+// test_speedestimator.cpp
+// A több mágneses sebességbecslő szimulált kerékkel, a config.h SPEED_EST_*
+// beállításaival:
+//  - egyenetlen mágnesíveket megtanul, egyenletes haladásnál nincs hullámzás;
+//  - egy ki nem javított kimaradt vagy fölös impulzus utáni fáziscsúszás után
+//    egy-két fordulaton belül újraszinkronizál;
+//  - gyorsuló/lassuló menetben és egyenletes mágneseknél nincs téves
+//    újraszinkronizálás;
+//  - impulzus nélkül a kijelzett sebesség monoton csökken, sosem haladja meg
+//    a következő mágnesig tartó ív/eltelt idő korlátot, és legkésőbb
+//    SPEED_TIMEOUT_MS után 0 (fékezés és hirtelen megállás).
+#include <string.h>
+#include "config.h"
+#include "hosttest.h"
+#include "speedestimator.h"
+
+static const SpeedEstimatorConfig_t config = {
+    SPEED_EST_LEARN_ALPHA, SPEED_EST_STEADY_PCT / 100.0, SPEED_EST_COMBINE_PCT / 100.0,
+    SPEED_EST_STOP_US, SPEED_EST_SLIP_PCT / 100.0};
+
+static const double circumferenceM = 2.1;
+
+// Szimulált kerék: az i. mágnes impulzusa az (i-1). mágnestől arcs[i] ív után
+typedef struct {
+  const double *arcs;
+  uint8_t magnets;
+  uint8_t magnet; // Az utolsó impulzus mágnese
+  double t;       // us
+} Wheel_t;
+
+static void wheel_init(Wheel_t *w, const double *arcs, uint8_t magnets) {
+  w->arcs = arcs;
+  w->magnets = magnets;
+  w->magnet = magnets - 1; // Mint a becslőnél: az első intervallum a 0. mágnesé
+  w->t = 1000000.0;
+}
+
+static int64_t wheel_next(Wheel_t *w, double kmh) {
+  w->magnet = (w->magnet + 1) % w->magnets;
+  w->t += w->arcs[w->magnet] * circumferenceM / (kmh / 3.6) * 1e6;
+  return (int64_t)w->t;
+}
+
+// Egyenletes haladás a becslőben; visszatér a legnagyobb relatív sebességhibával
+static double ride_steady(SpeedEstimator_t *est, Wheel_t *w, double kmh, int pulses) {
+  double worst = 0.0;
+  for (int i = 0; i < pulses; i++) {
+    double v = speed_estimator_pulse(est, wheel_next(w, kmh));
+    double err = fabs(v - kmh) / kmh;
+    if (err > worst) worst = err;
+  }
+  return worst;
+}
+
+static void start(SpeedEstimator_t *est, Wheel_t *w, const double *arcs, uint8_t magnets) {
+  speed_estimator_init(est, &config, magnets, circumferenceM);
+  wheel_init(w, arcs, magnets);
+  speed_estimator_pulse(est, (int64_t)w->t);
+}
+
+static void test_learns_uneven_arcs(void) {
+  static const double arcs[2] = {0.42, 0.58};
+  SpeedEstimator_t est;
+  Wheel_t w;
+  start(&est, &w, arcs, 2);
+  ride_steady(&est, &w, 25.0, 600);
+  CHECK_NEAR(est.arcFraction[0], arcs[0], 0.002);
+  CHECK_NEAR(est.arcFraction[1], arcs[1], 0.002);
+  CHECK(ride_steady(&est, &w, 25.0, 20) < 0.005);
+  CHECK_EQ(est.lastWindow, 2);
+  CHECK_EQ(est.phaseResyncs, 0);
+}
+
+// Kimaradt (shift +1) vagy fölös (shift -1) impulzus a már betanult kerékben
+static void check_slip(const double *arcs, uint8_t magnets, bool missed) {
+  SpeedEstimator_t est;
+  Wheel_t w;
+  start(&est, &w, arcs, magnets);
+  ride_steady(&est, &w, 25.0, 300 * magnets);
+  double learned[SPEED_EST_MAX_MAGNETS];
+  memcpy(learned, est.arcFraction, sizeof(learned));
+  CHECK_EQ(est.magnetIndex, w.magnet);
+
+  if (missed) {
+    wheel_next(&w, 25.0); // Ez az impulzus nem jut el a becslőig
+  } else {
+    // Rezgés az ív felénél, majd a valódi impulzus
+    double half = w.t + w.arcs[(w.magnet + 1) % magnets] * circumferenceM / (25.0 / 3.6) * 0.5e6;
+    speed_estimator_pulse(&est, (int64_t)half);
+  }
+  CHECK(est.magnetIndex != w.magnet); // A becslő fázisa elcsúszott
+
+  // Egy fordulat a csúszott fázissal, a következőben meg kell történnie
+  ride_steady(&est, &w, 25.0, 3 * magnets);
+  CHECK_EQ(est.phaseResyncs, 1);
+  CHECK_EQ(est.magnetIndex, w.magnet);
+  CHECK(ride_steady(&est, &w, 25.0, 4 * magnets) < 0.005);
+  for (int i = 0; i < magnets; i++) CHECK_NEAR(est.arcFraction[i], learned[i], 0.002);
+  CHECK_EQ(est.phaseResyncs, 1);
+}
+
+static void test_phase_slip(void) {
+  static const double two[2] = {0.42, 0.58};
+  static const double four[4] = {0.22, 0.28, 0.24, 0.26};
+  check_slip(two, 2, true);
+  check_slip(two, 2, false);
+  check_slip(four, 4, true);
+  check_slip(four, 4, false);
+}
+
+// Gyorsítás, fékezés és időzítési zaj mellett a fázis nem csúszhat el
+static void check_no_false_resync(const double *arcs, uint8_t magnets) {
+  SpeedEstimator_t est;
+  Wheel_t w;
+  start(&est, &w, arcs, magnets);
+  uint32_t rng = 777;
+  const int pulses = 6000;
+  for (int i = 0; i < pulses; i++) {
+    // 8 -> 45 -> 5 km/h, majd újra egyenletes 30 km/h
+    double phase = (double)i / pulses;
+    double kmh = phase < 0.4 ? 8 + 37 * phase / 0.4 : phase < 0.7 ? 45 - 40 * (phase - 0.4) / 0.3 : 30;
+    int64_t t = wheel_next(&w, kmh);
+    int64_t jitter = (int64_t)(host_test_rand(&rng) % 601) - 300; // +/- 0,3 ms
+    speed_estimator_pulse(&est, t + jitter);
+  }
+  CHECK_EQ(est.phaseResyncs, 0);
+  CHECK_EQ(est.magnetIndex, w.magnet);
+  for (int i = 0; i < magnets; i++) CHECK_NEAR(est.arcFraction[i], arcs[i], 0.01);
+}
+
+static void test_no_false_resync(void) {
+  static const double even[4] = {0.25, 0.25, 0.25, 0.25};
+  static const double four[4] = {0.22, 0.28, 0.24, 0.26};
+  static const double two[2] = {0.45, 0.55};
+  check_no_false_resync(even, 4);
+  check_no_false_resync(four, 4);
+  check_no_false_resync(two, 2);
+}
+
+static const int64_t tickUs = (int64_t)SPEED_DECAY_TICK_MS * 1000;
+static const int64_t timeoutUs = (int64_t)SPEED_TIMEOUT_MS * 1000;
+
+// A korlát közvetlenül: a következő mágnesig tartó ív az eltelt idő alatt
+static double no_pulse_bound(const SpeedEstimator_t *est, int64_t nowUs) {
+  uint8_t next = (est->magnetIndex + 1) % est->magnets;
+  return est->arcFraction[next] * est->kmhUsPerRev / (double)(nowUs - est->lastPulseUs);
+}
+
+// Egyenletes lassulás megállásig 1 ms lépésekkel, a mágnesek helyén impulzus,
+// közte SPEED_DECAY_TICK_MS ütemű lecsengés, mint a számoló taskban
+static void check_braking(const double *arcs, uint8_t magnets, double startKmh, double decelMps2) {
+  SpeedEstimator_t est;
+  Wheel_t w;
+  start(&est, &w, arcs, magnets);
+  ride_steady(&est, &w, startKmh, 200 * magnets);
+
+  double shown = est.speedKmh;
+  int64_t t = (int64_t)w.t;
+  double v = startKmh / 3.6;
+  double sinceM = 0.0; // Az utolsó impulzus óta megtett út
+  int64_t nextTick = t + tickUs, zeroAt = 0;
+  int lowered = 0, increased = 0, overBound = 0, belowTrue = 0, early = 0;
+  while (t < est.lastPulseUs + timeoutUs + 1000000) {
+    t += 1000;
+    v = v > decelMps2 * 1e-3 ? v - decelMps2 * 1e-3 : 0.0;
+    sinceM += v * 1e-3;
+    double arcM = arcs[(w.magnet + 1) % magnets] * circumferenceM;
+    if (sinceM >= arcM) {
+      sinceM = 0.0; // Az 1 ms-os lépés túlfutása az impulzus idejének kerekítése
+      w.magnet = (w.magnet + 1) % magnets;
+      shown = speed_estimator_pulse(&est, t);
+      continue;
+    }
+    if (t < nextTick) continue;
+    nextTick += tickUs;
+    if (shown == 0.0) continue;
+
+    double before = shown;
+    SpeedDecay_t decay = speed_estimator_decay(&est, t, SPEED_ZERO_KMH, timeoutUs, &shown);
+    if (shown > before) increased++;
+    if (decay == SPEED_DECAY_LOWER) lowered++;
+    if (shown > no_pulse_bound(&est, t) * (1 + 1e-9)) overBound++;
+    // A korlát a következő mágnesig hátralévő útból adódik: a valódi
+    // átlagsebesség az utolsó impulzus óta nem lehet nagyobb nála
+    double avgKmh = sinceM / ((t - est.lastPulseUs) / 1e6) * 3.6;
+    if (decay != SPEED_DECAY_ZERO && shown < avgKmh * 0.99) belowTrue++;
+    if (decay == SPEED_DECAY_ZERO) {
+      zeroAt = t;
+      if (t - est.lastPulseUs < timeoutUs && no_pulse_bound(&est, t) >= SPEED_ZERO_KMH) early++;
+    }
+  }
+  CHECK_EQ(increased, 0);
+  CHECK_EQ(overBound, 0);
+  CHECK_EQ(belowTrue, 0);
+  CHECK_EQ(early, 0);
+  CHECK(lowered > 0);
+  CHECK_EQ(shown, 0);
+  CHECK(zeroAt > est.lastPulseUs && zeroAt <= est.lastPulseUs + timeoutUs + tickUs);
+}
+
+static void test_decay_braking(void) {
+  static const double one[1] = {1.0};
+  static const double two[2] = {0.42, 0.58};
+  static const double four[4] = {0.22, 0.28, 0.24, 0.26};
+  check_braking(one, 1, 30.0, 1.5);
+  check_braking(one, 1, 45.0, 6.0);
+  check_braking(two, 2, 30.0, 3.0);
+  check_braking(four, 4, 35.0, 4.0);
+  check_braking(four, 4, 12.0, 0.5);
+}
+
+// Egyenletes haladás után hirtelen megállás: a következő impulzus
+// esedékességéig HOLD, utána tickenként a korlátra csökken, majd
+// SPEED_ZERO_KMH alatt (vagy a timeoutnál) nulláz
+static void test_decay_sudden_stop(void) {
+  static const double two[2] = {0.42, 0.58};
+  SpeedEstimator_t est;
+  Wheel_t w;
+  start(&est, &w, two, 2);
+  ride_steady(&est, &w, 25.0, 400);
+
+  const int64_t last = est.lastPulseUs;
+  const int64_t dueUs = (int64_t)(two[(w.magnet + 1) % 2] * circumferenceM / (25.0 / 3.6) * 1e6);
+  double shown = est.speedKmh, prev = shown;
+  bool zeroSeen = false;
+  for (int64_t t = last + tickUs; t <= last + timeoutUs + 2 * tickUs; t += tickUs) {
+    SpeedDecay_t decay = speed_estimator_decay(&est, t, SPEED_ZERO_KMH, timeoutUs, &shown);
+    if (t - last < dueUs) {
+      CHECK_EQ(decay, SPEED_DECAY_HOLD);
+      CHECK_NEAR(shown, 25.0, 0.1);
+    } else if (t - last < timeoutUs && no_pulse_bound(&est, t) >= SPEED_ZERO_KMH) {
+      CHECK_EQ(decay, SPEED_DECAY_LOWER);
+      CHECK(shown < prev);
+      CHECK_NEAR(shown, no_pulse_bound(&est, t), 1e-9);
+    } else {
+      CHECK_EQ(decay, SPEED_DECAY_ZERO);
+      CHECK_EQ(shown, 0);
+      zeroSeen = true;
+    }
+    prev = shown;
+  }
+  CHECK(zeroSeen);
+}
+
+int main(void) {
+  test_learns_uneven_arcs();
+  test_phase_slip();
+  test_no_false_resync();
+  test_decay_braking();
+  test_decay_sudden_stop();
+  return host_test_done("test_speedestimator");
+}
@@ -0,0 +1,152 @@
+#include "wheelprofile.h"
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+
+extern const char *TAG;
+extern nvs_handle_t g_nvs_handle;
+extern uint64_t dailyTripStartPulseCount;
+
+#define NVS_KEY_WHEEL_PROFILES "wheel_profiles"
+#define NVS_KEY_WHEEL_INDEX    "wheel_idx"
+#define NVS_KEY_ODO_BASE_KM    "odo_base_km"
+#define NVS_KEY_ODO_BASE_P     "odo_base_p"
+#define NVS_KEY_TOTAL_PULSES   "total_pulses"  // A main.cpp impulzusszámláló kulcsa
+
+static WheelProfile_t profiles[WHEEL_PROFILE_COUNT] = WHEEL_PROFILE_DEFAULTS;
+static WheelCalib_t calib;
+
+// Profilváltáskor lezárt táv: total = odoBaseKm + (p - odoBasePulses) * kmPerPulse
+static double odoBaseKm = 0.0;
+static uint64_t odoBasePulses = 0;
+// A napi út profilváltás előtti része (mélyalvást túléli, mint a napi kezdőpont)
+RTC_DATA_ATTR double dailyTripCarryKm = 0.0;
+
+static portMUX_TYPE wheelMux = portMUX_INITIALIZER_UNLOCKED;
+
+static WheelCalib_t compute_calib(uint8_t index) {
+  const WheelProfile_t *p = &profiles[index];
+  WheelCalib_t c;
+  c.pulsesPerRev = p->pulsesPerRev > 0 ? p->pulsesPerRev : 1;
+  c.circumferenceM = M_PI * p->diameterM;
+  c.kmPerPulse = c.circumferenceM / c.pulsesPerRev / 1000.0;
+  c.profileIndex = index;
+  return c;
+}
+
+// Lezárt táv, az impulzusszám és az új profil egyetlen commitban: újraindítás
+// után a betöltött impulzusszám nem lehet kisebb a lezárási pontnál
+static esp_err_t save_profile_switch(double baseKm, uint64_t basePulses, uint8_t index) {
+  if (g_nvs_handle == 0) return ESP_FAIL;
+  esp_err_t err = nvs_set_blob(g_nvs_handle, NVS_KEY_ODO_BASE_KM, &baseKm, sizeof(baseKm));
+  if (err == ESP_OK) err = nvs_set_u64(g_nvs_handle, NVS_KEY_ODO_BASE_P, basePulses);
+  if (err == ESP_OK) err = nvs_set_u64(g_nvs_handle, NVS_KEY_TOTAL_PULSES, basePulses);
+  if (err == ESP_OK) err = nvs_set_u8(g_nvs_handle, NVS_KEY_WHEEL_INDEX, index);
+  if (err == ESP_OK) err = nvs_commit(g_nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error (%s) saving wheel profile switch to NVS!", esp_err_to_name(err));
+  }
+  return err;
+}
+
+esp_err_t wheel_profiles_init(void) {
+  uint8_t index = 0;
+
+  if (g_nvs_handle == 0) {
+    ESP_LOGE(TAG, "NVS handle not open in wheel_profiles_init. Using defaults.");
+  } else {
+    size_t len = sizeof(profiles);
+    esp_err_t err = nvs_get_blob(g_nvs_handle, NVS_KEY_WHEEL_PROFILES, profiles, &len);
+    if (err != ESP_OK || len != sizeof(profiles)) {
+      ESP_LOGI(TAG, "NVS key '%s' not found or size changed. Storing defaults.", NVS_KEY_WHEEL_PROFILES);
+      const WheelProfile_t defaults[WHEEL_PROFILE_COUNT] = WHEEL_PROFILE_DEFAULTS;
+      memcpy(profiles, defaults, sizeof(profiles));
+      err = nvs_set_blob(g_nvs_handle, NVS_KEY_WHEEL_PROFILES, profiles, sizeof(profiles));
+      if (err == ESP_OK) err = nvs_commit(g_nvs_handle);
+      if (err != ESP_OK) ESP_LOGE(TAG, "Failed to store wheel profiles: %s", esp_err_to_name(err));
+    }
+
+    if (nvs_get_u8(g_nvs_handle, NVS_KEY_WHEEL_INDEX, &index) != ESP_OK || index >= WHEEL_PROFILE_COUNT) {
+      index = 0;
+    }
+
+    size_t kmLen = sizeof(odoBaseKm);
+    if (nvs_get_blob(g_nvs_handle, NVS_KEY_ODO_BASE_KM, &odoBaseKm, &kmLen) != ESP_OK ||
+        nvs_get_u64(g_nvs_handle, NVS_KEY_ODO_BASE_P, &odoBasePulses) != ESP_OK) {
+      // Még nem volt profilváltás: a teljes táv a 0. impulzustól számít
+      odoBaseKm = 0.0;
+      odoBasePulses = 0;
+    }
+  }
+
+  calib = compute_calib(index);
+  ESP_LOGI(TAG, "Wheel profile %u '%s': %.3f m, %u pulses/rev, %.6f km/pulse (base %.3f km @ %llu)",
+           index, profiles[index].name, profiles[index].diameterM, calib.pulsesPerRev,
+           calib.kmPerPulse, odoBaseKm, odoBasePulses);
+  return ESP_OK;
+}
+
+WheelCalib_t wheel_calib(void) {
+  portENTER_CRITICAL(&wheelMux);
+  WheelCalib_t c = calib;
+  portEXIT_CRITICAL(&wheelMux);
+  return c;
+}
+
+const WheelProfile_t *wheel_profile(uint8_t index) {
+  return index < WHEEL_PROFILE_COUNT ? &profiles[index] : nullptr;
+}
+
+uint8_t wheel_profile_count(void) {
+  return WHEEL_PROFILE_COUNT;
+}
+
+static double total_km_locked(uint64_t pulses) {
+  uint64_t dp = (pulses >= odoBasePulses) ? (pulses - odoBasePulses) : 0;
+  return odoBaseKm + (double)dp * calib.kmPerPulse;
+}
+
+static double daily_km_locked(uint64_t pulses) {
+  uint64_t dp = (pulses >= dailyTripStartPulseCount) ? (pulses - dailyTripStartPulseCount) : 0;
+  return dailyTripCarryKm + (double)dp * calib.kmPerPulse;
+}
+
+void wheel_distances_km(uint64_t pulses, double *totalKm, double *dailyKm) {
+  portENTER_CRITICAL(&wheelMux);
+  if (totalKm) *totalKm = total_km_locked(pulses);
+  if (dailyKm) *dailyKm = daily_km_locked(pulses);
+  portEXIT_CRITICAL(&wheelMux);
+}
+
+void wheel_reset_daily(uint64_t pulses) {
+  portENTER_CRITICAL(&wheelMux);
+  dailyTripStartPulseCount = pulses;
+  dailyTripCarryKm = 0.0;
+  portEXIT_CRITICAL(&wheelMux);
+}
+
+esp_err_t wheel_select_profile(uint8_t index, uint64_t currentPulses) {
+  if (index >= WHEEL_PROFILE_COUNT) return ESP_ERR_INVALID_ARG;
+
+  WheelCalib_t next = compute_calib(index);
+
+  // Az eddigi táv lezárása a régi kalibrációval, majd az új konstansok érvényesítése
+  portENTER_CRITICAL(&wheelMux);
+  double baseKm = total_km_locked(currentPulses);
+  dailyTripCarryKm = daily_km_locked(currentPulses);
+  dailyTripStartPulseCount = currentPulses;
+  odoBaseKm = baseKm;
+  odoBasePulses = currentPulses;
+  calib = next;
+  portEXIT_CRITICAL(&wheelMux);
+
+  esp_err_t err = save_profile_switch(baseKm, currentPulses, index);
+
+  ESP_LOGI(TAG, "Wheel profile switched to %u '%s' (%.3f m, %u pulses/rev) at %.3f km",
+           index, profiles[index].name, profiles[index].diameterM, next.pulsesPerRev, baseKm);
+  return err;
+}
@@ -0,0 +1,44 @@
+// wheelprofile.h
+// Futásidőben választható kerékprofilok (NVS-ben tárolva) és az ezekből
+// előre számolt kalibrációs konstansok. Profilváltáskor az eddig megtett
+// táv lezárul (alap km + alap impulzus), így a régi összegek nem változnak.
+#ifndef WHEELPROFILE_H
+#define WHEELPROFILE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define WHEEL_PROFILE_NAME_LEN 12
+
+typedef struct {
+  char name[WHEEL_PROFILE_NAME_LEN];
+  float diameterM;       // Kerék átmérője méterben
+  uint8_t pulsesPerRev;  // Mágnesek (impulzusok) száma fordulatonként
+} WheelProfile_t;
+
+// Profilváltáskor egyszer számolt konstansok - a forró ágban csak szorzás/osztás
+typedef struct {
+  double circumferenceM;  // Kerület (m)
+  double kmPerPulse;      // Egy impulzusra eső táv (km)
+  uint8_t pulsesPerRev;
+  uint8_t profileIndex;
+} WheelCalib_t;
+
+// Profilok betöltése NVS-ből (hiányzó kulcsoknál a config.h alapértékei)
+esp_err_t wheel_profiles_init(void);
+
+// Az aktív kalibráció másolata
+WheelCalib_t wheel_calib(void);
+const WheelProfile_t *wheel_profile(uint8_t index);
+uint8_t wheel_profile_count(void);
+
+// Aktív profil váltása; a teljes és napi távot az aktuális impulzusszámnál lezárja
+esp_err_t wheel_select_profile(uint8_t index, uint64_t currentPulses);
+
+// Teljes és napi táv az impulzusszámból, a profilváltások figyelembevételével
+void wheel_distances_km(uint64_t pulses, double *totalKm, double *dailyKm);
+
+// Napi táv nullázása az adott impulzusszámnál
+void wheel_reset_daily(uint64_t pulses);
+
+#endif